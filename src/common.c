@@ -570,3 +570,86 @@ ly_strequal_(const char *s1, const char *s2)
         return 0;
     }
 }
+
+/* does not log */
+static int
+ly_ht_resize(struct ly_ht *ht, uint32_t size)
+{
+    struct ly_ht_rec *old, *rec;
+    uint32_t old_size, i, j;
+
+    old = ht->recs;
+    old_size = ht->size;
+
+    ht->recs = calloc(size, sizeof *ht->recs);
+    if (!ht->recs) {
+        ht->recs = old;
+        return -1;
+    }
+    ht->size = size;
+
+    for (i = 0; i < old_size; ++i) {
+        if (!old[i].val) {
+            continue;
+        }
+        for (j = old[i].hash & (size - 1); ht->recs[j].val; j = (j + 1) & (size - 1));
+        rec = &ht->recs[j];
+        rec->hash = old[i].hash;
+        rec->val = old[i].val;
+    }
+    free(old);
+
+    return EXIT_SUCCESS;
+}
+
+int
+ly_ht_insert(struct ly_ht *ht, uint32_t hash, void *val)
+{
+    uint32_t i;
+
+    assert(ht && val);
+
+    /* keep the table at most half full */
+    if ((ht->used + 1) * 2 > ht->size) {
+        if (ly_ht_resize(ht, ht->size ? ht->size * 2 : 8)) {
+            LOGMEM;
+            return -1;
+        }
+    }
+
+    for (i = hash & (ht->size - 1); ht->recs[i].val; i = (i + 1) & (ht->size - 1));
+    ht->recs[i].hash = hash;
+    ht->recs[i].val = val;
+    ht->used++;
+
+    return EXIT_SUCCESS;
+}
+
+void *
+ly_ht_find(const struct ly_ht *ht, uint32_t hash, uint32_t *iter)
+{
+    uint32_t i;
+
+    if (!ht->size) {
+        return NULL;
+    }
+
+    /* iter is the index of the next record to check increased by 1 */
+    for (i = (*iter ? *iter - 1 : hash & (ht->size - 1)); ht->recs[i].val; i = (i + 1) & (ht->size - 1)) {
+        if (ht->recs[i].hash == hash) {
+            *iter = ((i + 1) & (ht->size - 1)) + 1;
+            return ht->recs[i].val;
+        }
+    }
+
+    return NULL;
+}
+
+void
+ly_ht_clean(struct ly_ht *ht)
+{
+    free(ht->recs);
+    ht->recs = NULL;
+    ht->size = ht->used = 0;
+}
+
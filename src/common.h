@@ -296,4 +296,51 @@ void *ly_realloc(void *ptr, size_t size);
 int ly_strequal_(const char *s1, const char *s2);
 #define ly_strequal(s1, s2, d) ((d) ? (s1 == s2) : ly_strequal_(s1, s2))
 
+/**
+ * @brief Record of the internal hash table
+ */
+struct ly_ht_rec {
+    uint32_t hash;                   /**< full hash of the record key (dict_hash()) */
+    void *val;                       /**< stored value, NULL for an empty record */
+};
+
+/**
+ * @brief Internal hash table with open addressing, records cannot be removed.
+ *
+ * Only the hashes of the keys are stored, so the caller must check every found value
+ * whether it really matches the key.
+ */
+struct ly_ht {
+    uint32_t size;                   /**< number of records, always a power of 2 (or 0) */
+    uint32_t used;                   /**< number of used records */
+    struct ly_ht_rec *recs;          /**< array of the records */
+};
+
+/**
+ * @brief Insert a value into a hash table, the table grows as needed.
+ *
+ * @param[in] ht Hash table, can be zeroed (empty).
+ * @param[in] hash Hash of the value key.
+ * @param[in] val Value to store, must not be NULL.
+ * @return EXIT_SUCCESS on success, -1 on memory allocation failure.
+ */
+int ly_ht_insert(struct ly_ht *ht, uint32_t hash, void *val);
+
+/**
+ * @brief Get the next value with the specified hash.
+ *
+ * @param[in] ht Hash table.
+ * @param[in] hash Hash of the searched key.
+ * @param[in,out] iter Iterator, must be 0 for the first call.
+ * @return Next value stored with \p hash, NULL if there are no more.
+ */
+void *ly_ht_find(const struct ly_ht *ht, uint32_t hash, uint32_t *iter);
+
+/**
+ * @brief Free the records of a hash table, the stored values are not touched.
+ *
+ * @param[in] ht Hash table to clean.
+ */
+void ly_ht_clean(struct ly_ht *ht);
+
 #endif /* LY_COMMON_H_ */
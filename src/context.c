@@ -61,6 +61,11 @@ ly_ctx_new(const char *search_dir)
     /* dictionary */
     lydict_init(&ctx->dict);
 
+#ifdef LY_DATA_POOL
+    /* data nodes */
+    lyd_pool_init(&ctx->data_pool);
+#endif
+
     /* models list */
     ctx->models.list = calloc(16, sizeof *ctx->models.list);
     if (!ctx->models.list) {
@@ -161,10 +166,17 @@ ly_ctx_destroy(struct ly_ctx *ctx, void (*private_destructor)(const struct lys_n
     }
     free(ctx->models.search_path);
     free(ctx->models.list);
+    free(ctx->cond_imprecise.set);
+    free(ctx->cond_open.set);
 
     /* dictionary */
     lydict_clean(&ctx->dict);
 
+#ifdef LY_DATA_POOL
+    /* data nodes, all of them must have been freed already */
+    lyd_pool_clean(&ctx->data_pool);
+#endif
+
     free(ctx);
 }
 
@@ -273,6 +285,18 @@ ly_ctx_get_module_clb(const struct ly_ctx *ctx, void **user_data)
     return ctx->module_clb;
 }
 
+API uint64_t
+ly_ctx_get_union_mispredictions(const struct ly_ctx *ctx)
+{
+    if (!ctx) {
+        ly_errno = LY_EINVAL;
+        return 0;
+    }
+
+    /* updated atomically by the parsers */
+    return __sync_fetch_and_add(&((struct ly_ctx *)ctx)->union_mispredictions, 0);
+}
+
 API const struct lys_module *
 ly_ctx_load_module(struct ly_ctx *ctx, const char *name, const char *revision)
 {
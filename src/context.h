@@ -35,11 +35,27 @@ struct ly_modules_list {
     uint16_t module_set_id;
 };
 
+#ifdef LY_DATA_POOL
+struct lyd_pool {
+    pthread_mutex_t lock;
+    void *free[2];                   /* free inner (and anyxml) nodes and free leaf/leaflist nodes */
+    void *blocks;                    /* allocated blocks of nodes */
+};
+#endif
+
 struct ly_ctx {
     struct dict_table dict;
     struct ly_modules_list models;
     ly_module_clb module_clb;
     void *module_clb_data;
+    uint64_t union_mispredictions;   /* updated atomically, see lyp_parse_value() */
+    struct ly_set cond_imprecise;    /* schema nodes with when or must conditions whose dependencies could not be
+                                        determined, any data change can affect them (lys_cond_deps_add()) */
+    struct ly_set cond_open;         /* schema nodes with when or must conditions that can depend on the schema nodes
+                                        of the modules added later (wildcards, descendants, top-level nodes) */
+#ifdef LY_DATA_POOL
+    struct lyd_pool data_pool;
+#endif
 };
 
 #endif /* LY_CONTEXT_H_ */
@@ -19,6 +19,7 @@
  *    software without specific prior written permission.
  */
 
+#include <assert.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -40,6 +41,34 @@ lydict_init(struct dict_table *dict)
     pthread_mutex_init(&dict->lock, NULL);
 }
 
+/* header of a string from the dictionary */
+static struct dict_str *
+dict_str(const char *value)
+{
+    return (struct dict_str *)(value - sizeof(struct dict_str));
+}
+
+/* allocate a dictionary string with its header */
+static char *
+dict_str_new(const char *value, size_t len)
+{
+    struct dict_str *str;
+    char *result;
+
+    str = malloc(sizeof *str + len + 1);
+    if (!str) {
+        LOGMEM;
+        return NULL;
+    }
+    str->refcount = 1;
+    str->len = len;
+    result = (char *)(str + 1);
+    memcpy(result, value, len);
+    result[len] = '\0';
+
+    return result;
+}
+
 void
 lydict_clean(struct dict_table *dict)
 {
@@ -55,12 +84,14 @@ lydict_clean(struct dict_table *dict)
         rec = &dict->recs[i];
         chain = rec->next;
 
-        free(rec->value);
+        if (rec->value) {
+            free(dict_str(rec->value));
+        }
         while (chain) {
             rec = chain;
             chain = rec->next;
 
-            free(rec->value);
+            free(dict_str(rec->value));
             free(rec);
         }
     }
@@ -74,22 +105,112 @@ lydict_clean(struct dict_table *dict)
  *
  * Spooky hash is faster, but it works only for little endian architectures.
  */
-static uint32_t
-dict_hash(const char *key, size_t len)
+uint32_t
+dict_hash_multi(uint32_t hash, const char *key_part, size_t len)
 {
-    uint32_t hash, i;
+    size_t i;
 
-    for (hash = i = 0; i < len; ++i) {
-        hash += key[i];
-        hash += (hash << 10);
-        hash ^= (hash >> 6);
+    if (key_part) {
+        for (i = 0; i < len; ++i) {
+            hash += key_part[i];
+            hash += (hash << 10);
+            hash ^= (hash >> 6);
+        }
+    } else {
+        hash += (hash << 3);
+        hash ^= (hash >> 11);
+        hash += (hash << 15);
     }
-    hash += (hash << 3);
-    hash ^= (hash >> 11);
-    hash += (hash << 15);
+
     return hash;
 }
 
+uint32_t
+dict_hash(const char *key, size_t len)
+{
+    return dict_hash_multi(dict_hash_multi(0, key, len), NULL, 0);
+}
+
+void
+dict_lock(struct ly_ctx *ctx)
+{
+    pthread_mutex_lock(&ctx->dict.lock);
+}
+
+void
+dict_unlock(struct ly_ctx *ctx)
+{
+    pthread_mutex_unlock(&ctx->dict.lock);
+}
+
+const char *
+dict_ref(struct ly_ctx *ctx, const char *value)
+{
+    (void)ctx;
+
+    if (value) {
+        dict_str(value)->refcount++;
+    }
+    return value;
+}
+
+/* unlink the record of a string from the dictionary and free it */
+static void
+dict_rec_remove(struct ly_ctx *ctx, struct dict_rec *record, struct dict_rec *prev)
+{
+    free(dict_str(record->value));
+    if (record->next) {
+        if (prev) {
+            /* change in dynamically allocated chain */
+            prev->next = record->next;
+            free(record);
+        } else {
+            /* move dynamically allocated record into the static array */
+            prev = record->next;    /* temporary storage */
+            memcpy(record, record->next, sizeof *record);
+            free(prev);
+        }
+    } else if (prev) {
+        /* removing last record from the dynamically allocated chain */
+        prev->next = NULL;
+        free(record);
+    } else {
+        /* clean the static record content */
+        memset(record, 0, sizeof *record);
+    }
+    ctx->dict.used--;
+}
+
+void
+dict_remove(struct ly_ctx *ctx, const char *value)
+{
+    struct dict_str *str;
+    struct dict_rec *record, *prev = NULL;
+
+    if (!value) {
+        return;
+    }
+
+    str = dict_str(value);
+    if (--str->refcount) {
+        /* the record is needed only to remove the string */
+        return;
+    }
+
+    record = &ctx->dict.recs[dict_hash(value, str->len) & ctx->dict.hash_mask];
+    while (record && (record->value != value)) {
+        prev = record;
+        record = record->next;
+    }
+    assert(record);
+    if (!record) {
+        /* not a string of this dictionary */
+        LOGINT;
+        return;
+    }
+    dict_rec_remove(ctx, record, prev);
+}
+
 API void
 lydict_remove(struct ly_ctx *ctx, const char *value)
 {
@@ -97,7 +218,7 @@ lydict_remove(struct ly_ctx *ctx, const char *value)
     uint32_t index;
     struct dict_rec *record, *prev = NULL;
 
-    if (!value || !ctx || !ctx->dict.used) {
+    if (!value || !ctx) {
         return;
     }
 
@@ -105,6 +226,12 @@ lydict_remove(struct ly_ctx *ctx, const char *value)
 
     pthread_mutex_lock(&ctx->dict.lock);
 
+    if (!ctx->dict.used) {
+        pthread_mutex_unlock(&ctx->dict.lock);
+        return;
+    }
+
+    /* the string is searched for, it does not have to come from the dictionary */
     index = dict_hash(value, len) & ctx->dict.hash_mask;
     record = &ctx->dict.recs[index];
 
@@ -113,35 +240,8 @@ lydict_remove(struct ly_ctx *ctx, const char *value)
         record = record->next;
     }
 
-    if (!record) {
-        /* record not found */
-        pthread_mutex_unlock(&ctx->dict.lock);
-        return;
-    }
-
-    record->refcount--;
-    if (!record->refcount) {
-        free(record->value);
-        if (record->next) {
-            if (prev) {
-                /* change in dynamically allocated chain */
-                prev->next = record->next;
-                free(record);
-            } else {
-                /* move dynamically allocated record into the static array */
-                prev = record->next;    /* temporary storage */
-                memcpy(record, record->next, sizeof *record);
-                free(prev);
-            }
-        } else if (prev) {
-            /* removing last record from the dynamically allocated chain */
-            prev->next = NULL;
-            free(record);
-        } else {
-            /* clean the static record content */
-            memset(record, 0, sizeof *record);
-        }
-        ctx->dict.used--;
+    if (record && !--dict_str(value)->refcount) {
+        dict_rec_remove(ctx, record, prev);
     }
 
     pthread_mutex_unlock(&ctx->dict.lock);
@@ -158,18 +258,13 @@ dict_insert(struct ly_ctx *ctx, char *value, size_t len, int zerocopy)
 
     if (!record->value) {
         /* first record with this hash */
+        record->value = dict_str_new(value, len);
         if (zerocopy) {
-            record->value = value;
-        } else {
-            record->value = malloc((len + 1) * sizeof *record->value);
-            if (!record->value) {
-                LOGMEM;
-                return NULL;
-            }
-            memcpy(record->value, value, len);
-            record->value[len] = '\0';
+            free(value);
+        }
+        if (!record->value) {
+            return NULL;
         }
-        record->refcount = 1;
         record->next = NULL;
 
         ctx->dict.used++;
@@ -180,9 +275,9 @@ dict_insert(struct ly_ctx *ctx, char *value, size_t len, int zerocopy)
 
     /* collision, search if the value is already in dict */
     while (record) {
-        if (!memcmp(value, record->value, len) && record->value[len] == '\0') {
+        if ((dict_str(record->value)->len == len) && !memcmp(value, record->value, len)) {
             /* record found */
-            record->refcount++;
+            dict_str(record->value)->refcount++;
 
             if (zerocopy) {
                 free(value);
@@ -204,21 +299,19 @@ dict_insert(struct ly_ctx *ctx, char *value, size_t len, int zerocopy)
     new = malloc(sizeof *record);
     if (!new) {
         LOGMEM;
+        if (zerocopy) {
+            free(value);
+        }
         return NULL;
     }
+    new->value = dict_str_new(value, len);
     if (zerocopy) {
-        new->value = value;
-    } else {
-        new->value = malloc((len + 1) * sizeof *record->value);
-        if (!new->value) {
-            LOGMEM;
-            free(new);
-            return NULL;
-        }
-        memcpy(new->value, value, len);
-        new->value[len] = '\0';
+        free(value);
+    }
+    if (!new->value) {
+        free(new);
+        return NULL;
     }
-    new->refcount = 1;
     new->next = NULL;
 
     record->next = new;
@@ -57,16 +57,16 @@ struct ly_ctx;
 const char *lydict_insert(struct ly_ctx *ctx, const char *value, size_t len);
 
 /**
- * @brief Insert string into dictionary - zerocopy version. If the string is
+ * @brief Insert string into dictionary - ownership passing version. If the string is
  * already present, only a reference counter is incremented and no memory
- * allocation is performed. This insert function variant avoids duplication of
- * specified value - it is inserted into the dictionary directly.
+ * allocation is performed. This insert function variant takes over the
+ * specified value, so the caller does not need to free it.
  *
  * @param[in] ctx libyang context handler
  * @param[in] value NULL-terminated string to be stored in the dictionary. If
- * the string is not present in dictionary, the pointer is directly used by the
- * dictionary. Otherwise, the reference counter is incremented and the value is
- * freed. So, after calling the function, caller is supposed to not use the
+ * the string is not present in dictionary, it is stored by the dictionary
+ * together with its reference counter. In any case, the value is freed.
+ * So, after calling the function, caller is supposed to not use the
  * value address anymore.
  * @return pointer to the string stored in the dictionary
  */
@@ -32,14 +32,22 @@
  */
 #define DICT_SIZE 1024
 
+/**
+ * header of a string stored in the dictionary, the string follows it, so that
+ * the reference count of a dictionary string is reached directly
+ */
+struct dict_str {
+    uint32_t refcount;
+    uint32_t len;
+};
+
 /**
  * record of the dictionary
  * TODO: save the next pointer by different collision strategy, will need to
  * make dictionary size dynamic
  */
 struct dict_rec {
-    char *value;
-    uint32_t refcount;
+    char *value;                     /* string following its struct dict_str header */
     struct dict_rec *next;
 };
 
@@ -68,4 +76,56 @@ void lydict_init(struct dict_table *dict);
  */
 void lydict_clean(struct dict_table *dict);
 
+/**
+ * @brief Hash a string (Bob Jenkin's one-at-a-time hash)
+ *
+ * @param[in] key String to hash, does not have to be terminated
+ * @param[in] len Length of the \p key
+ * @return Hash of the \p key
+ */
+uint32_t dict_hash(const char *key, size_t len);
+
+/**
+ * @brief Hash a key consisting of several parts, the same way as dict_hash() hashes a single string.
+ *
+ * @param[in] hash Hash of the previous parts, 0 for the first one.
+ * @param[in] key_part Next part of the key, NULL to finish the hash.
+ * @param[in] len Length of the \p key_part.
+ * @return Hash of the parts so far or the final hash.
+ */
+uint32_t dict_hash_multi(uint32_t hash, const char *key_part, size_t len);
+
+/**
+ * @brief Lock the dictionary for a batch of dict_ref() and dict_remove() calls, so that a whole
+ * data subtree is processed with a single lock. No other dictionary function can be called
+ * until dict_unlock().
+ *
+ * @param[in] ctx Context of the dictionary.
+ */
+void dict_lock(struct ly_ctx *ctx);
+
+/**
+ * @brief Unlock the dictionary locked by dict_lock().
+ *
+ * @param[in] ctx Context of the dictionary.
+ */
+void dict_unlock(struct ly_ctx *ctx);
+
+/**
+ * @brief Get another reference of a string already stored in the dictionary (locked by dict_lock()).
+ *
+ * @param[in] ctx Context of the dictionary.
+ * @param[in] value String from the dictionary, can be NULL.
+ * @return \p value
+ */
+const char *dict_ref(struct ly_ctx *ctx, const char *value);
+
+/**
+ * @brief lydict_remove() for the dictionary locked by dict_lock().
+ *
+ * @param[in] ctx Context of the dictionary.
+ * @param[in] value String from the dictionary to remove, can be NULL.
+ */
+void dict_remove(struct ly_ctx *ctx, const char *value);
+
 #endif /* LY_DICT_PRIVATE_H_ */
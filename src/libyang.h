@@ -403,6 +403,8 @@ extern "C" {
  * - lyd_insert_before()
  * - lyd_insert_after()
  * - lyd_insert_attr()
+ * - lyd_merge()
+ * - lyd_apply_edit()
  * - lyd_new()
  * - lyd_new_anyxml()
  * - lyd_new_leaf()
@@ -414,6 +416,8 @@ extern "C" {
  * - lyd_free_attr()
  * - lyd_free_withsiblings()
  * - lyd_validate()
+ * - lyd_diff()
+ * - lyd_free_diff()
  */
 
 /**
@@ -652,6 +656,15 @@ void ly_ctx_set_module_clb(struct ly_ctx *ctx, ly_module_clb clb, void *user_dat
  */
 ly_module_clb ly_ctx_get_module_clb(const struct ly_ctx *ctx, void **user_data);
 
+/**
+ * @brief Get the number of union values that did not match the member type remembered for their schema
+ * node (the type of the previous value of the node), so all the member types had to be tried.
+ *
+ * @param[in] ctx Context to read from.
+ * @return Number of union member type mispredictions in the context.
+ */
+uint64_t ly_ctx_get_union_mispredictions(const struct ly_ctx *ctx);
+
 /**
  * @brief Get pointer to the schema tree of the module of the specified namespace
  *
@@ -796,6 +809,8 @@ void ly_set_free(struct ly_set *set);
  * @{
  */
 #define LYP_WITHSIBLINGS 0x01 /**< Flag for printing also the (following) sibling nodes of the data node. */
+#define LYP_LYBSKIP      0x02 /**< Flag for the #LYD_LYB format to prefix every node with its length, so readers can skip
+                                   the nodes they do not know. */
 
 /**
  * @}
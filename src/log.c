@@ -223,12 +223,12 @@ ly_vlog(enum LY_ERR code, unsigned int line, enum LY_VLOG_ELEM elem_type, const
                                 break;
                             }
                         }
-                        if (diter && ((struct lyd_node_leaf_list *)diter)->value_str) {
+                        if (diter && lyd_value_str((struct lyd_node_leaf_list *)diter)) {
                             (*index) -= 2;
                             memcpy(&path[(*index)], "']", 2);
-                            len = strlen(((struct lyd_node_leaf_list *)diter)->value_str);
+                            len = strlen(lyd_value_str((struct lyd_node_leaf_list *)diter));
                             (*index) -= len;
-                            memcpy(&path[(*index)], ((struct lyd_node_leaf_list *)diter)->value_str, len);
+                            memcpy(&path[(*index)], lyd_value_str((struct lyd_node_leaf_list *)diter), len);
                             (*index) -=2;
                             memcpy(&path[(*index)], "='", 2);
                             len = strlen(diter->schema->name);
@@ -308,40 +308,39 @@ parse_uint(const char *val_str, uint64_t max, int base, uint64_t *ret, uint32_t
  * kind == 0 - unsigned (unum used), 1 - signed (snum used), 2 - floating point (fnum used)
  */
 static int
-validate_length_range(uint8_t kind, uint64_t unum, int64_t snum, long double fnum, struct lys_type *type,
+validate_length_range(uint8_t kind, uint64_t unum, int64_t snum, long double fnum, struct lys_ctype *ctype,
                       const char *val_str, uint32_t line, struct lyd_node *node)
 {
-    struct len_ran_intv *intv = NULL, *tmp_intv;
+    struct lys_type_intv *intv;
+    uint32_t lo, hi, mid;
     int ret = EXIT_FAILURE;
 
-    if (resolve_len_ran_interval(NULL, type, 0, &intv)) {
-        /* already done during schema parsing */
-        LOGINT;
-        return EXIT_FAILURE;
-    }
+    /* precompiled during schema parsing */
+    intv = ctype->intv;
     if (!intv) {
         return EXIT_SUCCESS;
     }
-
-    for (tmp_intv = intv; tmp_intv; tmp_intv = tmp_intv->next) {
-        if (((kind == 0) && (unum < tmp_intv->value.uval.min))
-                || ((kind == 1) && (snum < tmp_intv->value.sval.min))
-                || ((kind == 2) && (fnum < tmp_intv->value.fval.min))) {
-            break;
-        }
-
-        if (((kind == 0) && (unum >= tmp_intv->value.uval.min) && (unum <= tmp_intv->value.uval.max))
-                || ((kind == 1) && (snum >= tmp_intv->value.sval.min) && (snum <= tmp_intv->value.sval.max))
-                || ((kind == 2) && (fnum >= tmp_intv->value.fval.min) && (fnum <= tmp_intv->value.fval.max))) {
-            ret = EXIT_SUCCESS;
-            break;
+    assert(intv->kind == kind);
+
+    /* binary search for the last interval with min not greater than the value */
+    lo = 0;
+    hi = intv->count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (((kind == 0) && (intv->bound.uval[2 * mid] <= unum))
+                || ((kind == 1) && (intv->bound.sval[2 * mid] <= snum))
+                || ((kind == 2) && (intv->bound.fval[2 * mid] <= fnum))) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
 
-    while (intv) {
-        tmp_intv = intv->next;
-        free(intv);
-        intv = tmp_intv;
+    /* the value must not be above the max of that interval */
+    if (lo && (((kind == 0) && (unum <= intv->bound.uval[2 * lo - 1]))
+            || ((kind == 1) && (snum <= intv->bound.sval[2 * lo - 1]))
+            || ((kind == 2) && (fnum <= intv->bound.fval[2 * lo - 1])))) {
+        ret = EXIT_SUCCESS;
     }
 
     if (ret) {
@@ -352,62 +351,363 @@ validate_length_range(uint8_t kind, uint64_t unum, int64_t snum, long double fnu
 
 /* logs directly */
 static int
-validate_pattern(const char *val_str, struct lys_type *type, uint32_t line, struct lyd_node *node)
+validate_pattern(const char *val_str, struct lys_ctype *ctype, uint32_t line, struct lyd_node *node)
+{
+    uint32_t i;
+
+    assert(ctype->base == LY_TYPE_STRING);
+
+    if (!val_str) {
+        val_str = "";
+    }
+
+    /* patterns of all the superior types are included */
+    for (i = 0; i < ctype->pat_count; ++i) {
+        if (pcre_exec((pcre *)ctype->patterns[i], NULL, val_str, strlen(val_str), 0, 0, NULL, 0)) {
+            LOGVAL(LYE_INVAL, line, LY_VLOG_LYD, node, val_str, node->schema->name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* logs directly */
+static pcre *
+compile_pattern(const char *expr)
 {
-    int i, err_offset;
     pcre *precomp;
     char *perl_regex;
     const char *err_ptr;
+    int err_offset;
+
+    /*
+     * adjust the expression to a Perl equivalent
+     *
+     * http://www.w3.org/TR/2004/REC-xmlschema-2-20041028/#regexs
+     */
+    perl_regex = malloc((strlen(expr) + 2) * sizeof(char));
+    if (!perl_regex) {
+        LOGMEM;
+        return NULL;
+    }
+    perl_regex[0] = '\0';
+    strcat(perl_regex, expr);
+    if (strncmp(expr + strlen(expr) - 2, ".*", 2)) {
+        strcat(perl_regex, "$");
+    }
+
+    /* must succeed, already checked during parsing */
+    precomp = pcre_compile(perl_regex, PCRE_ANCHORED | PCRE_DOLLAR_ENDONLY | PCRE_NO_AUTO_CAPTURE,
+                           &err_ptr, &err_offset, NULL);
+    free(perl_regex);
+    if (!precomp) {
+        LOGINT;
+        return NULL;
+    }
 
-    assert(type->base == LY_TYPE_STRING);
+    return precomp;
+}
 
-    if (!val_str) {
-        val_str = "";
+/* logs directly */
+static int
+ctype_add_patterns(struct lys_ctype *ctype, struct lys_type *type)
+{
+    void **new;
+    int i;
+
+    if (type->der && ctype_add_patterns(ctype, &type->der->type)) {
+        return -1;
+    }
+    if (!type->info.str.pat_count) {
+        return EXIT_SUCCESS;
     }
 
-    if (type->der && validate_pattern(val_str, &type->der->type, line, node)) {
-        return EXIT_FAILURE;
+    new = realloc(ctype->patterns, (ctype->pat_count + type->info.str.pat_count) * sizeof *ctype->patterns);
+    if (!new) {
+        LOGMEM;
+        return -1;
     }
+    ctype->patterns = new;
 
     for (i = 0; i < type->info.str.pat_count; ++i) {
-        /*
-         * adjust the expression to a Perl equivalent
-         *
-         * http://www.w3.org/TR/2004/REC-xmlschema-2-20041028/#regexs
-         */
-        perl_regex = malloc((strlen(type->info.str.patterns[i].expr)+2) * sizeof(char));
-        if (!perl_regex) {
-            LOGMEM;
-            return EXIT_FAILURE;
+        ctype->patterns[ctype->pat_count] = compile_pattern(type->info.str.patterns[i].expr);
+        if (!ctype->patterns[ctype->pat_count]) {
+            return -1;
         }
-        perl_regex[0] = '\0';
-        strcat(perl_regex, type->info.str.patterns[i].expr);
-        if (strncmp(type->info.str.patterns[i].expr
-                + strlen(type->info.str.patterns[i].expr) - 2, ".*", 2)) {
-            strcat(perl_regex, "$");
+        ctype->pat_count++;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int ctype_find_name(struct lys_ctype *ctype, const char *name, int len);
+
+/* does not log, whether the string could be accepted by any of the numeric types */
+static int
+ctype_numeric_like(const char *str)
+{
+    while (isspace(*str) || (*str == '-') || (*str == '+')) {
+        ++str;
+    }
+    return !*str || isdigit(*str) || (*str == '.');
+}
+
+/* does not log, classes of the union member types with known lexical spaces */
+#define CTYPE_CLASS_NUM  1
+#define CTYPE_CLASS_BOOL 2
+#define CTYPE_CLASS_ENUM 3
+
+static int
+ctype_class(struct lys_type *type)
+{
+    switch (type->base) {
+    case LY_TYPE_DEC64:
+    case LY_TYPE_INT8:
+    case LY_TYPE_UINT8:
+    case LY_TYPE_INT16:
+    case LY_TYPE_UINT16:
+    case LY_TYPE_INT32:
+    case LY_TYPE_UINT32:
+    case LY_TYPE_INT64:
+    case LY_TYPE_UINT64:
+        return CTYPE_CLASS_NUM;
+    case LY_TYPE_BOOL:
+        return CTYPE_CLASS_BOOL;
+    case LY_TYPE_ENUM:
+        return CTYPE_CLASS_ENUM;
+    default:
+        return 0;
+    }
+}
+
+/* does not log, whether the enum names are all outside the lexical space of the other class */
+static int
+ctype_enums_disjoint(struct lys_ctype *enums, struct lys_type *other, int other_class)
+{
+    int i;
+    const char *name;
+
+    for (i = 0; i < enums->info.enums.count; ++i) {
+        name = enums->info.enums.enm[i].name;
+        switch (other_class) {
+        case CTYPE_CLASS_NUM:
+            if (ctype_numeric_like(name)) {
+                return 0;
+            }
+            break;
+        case CTYPE_CLASS_BOOL:
+            if (!strcmp(name, "true") || !strcmp(name, "false")) {
+                return 0;
+            }
+            break;
+        case CTYPE_CLASS_ENUM:
+            if (ctype_find_name(other->ctype, name, strlen(name)) > -1) {
+                return 0;
+            }
+            break;
         }
+    }
 
-        /* must return 0, already checked during parsing */
-        precomp = pcre_compile(perl_regex, PCRE_ANCHORED | PCRE_DOLLAR_ENDONLY | PCRE_NO_AUTO_CAPTURE,
-                               &err_ptr, &err_offset, NULL);
-        if (!precomp) {
-            LOGINT;
-            free(perl_regex);
-            return EXIT_FAILURE;
+    return 1;
+}
+
+/* does not log, whether no value can be valid for both the types (conservative) */
+static int
+ctype_disjoint(struct lys_type *type1, struct lys_type *type2)
+{
+    int class1, class2;
+
+    class1 = ctype_class(type1);
+    class2 = ctype_class(type2);
+    if (!class1 || !class2 || !type1->ctype || !type2->ctype) {
+        return 0;
+    }
+
+    if (class1 == CTYPE_CLASS_ENUM) {
+        return ctype_enums_disjoint(type1->ctype, type2, class2);
+    } else if (class2 == CTYPE_CLASS_ENUM) {
+        return ctype_enums_disjoint(type2->ctype, type1, class1);
+    }
+    return class1 != class2;
+}
+
+/*
+ * logs directly, a member type can be tried first (before the previous member types) only if no
+ * value valid for it can be valid for any previous member type, otherwise the first matching
+ * member type would not be the one chosen
+ */
+static int
+ctype_union_shortcuts(struct lys_ctype *ctype)
+{
+    int i, j;
+
+    if (!ctype->info.uni.count) {
+        return EXIT_SUCCESS;
+    }
+
+    ctype->info.uni.shortcut = calloc(ctype->info.uni.count, sizeof *ctype->info.uni.shortcut);
+    if (!ctype->info.uni.shortcut) {
+        LOGMEM;
+        return -1;
+    }
+
+    for (i = 0; i < ctype->info.uni.count; ++i) {
+        for (j = 0; j < i; ++j) {
+            if (!ctype_disjoint(ctype->info.uni.types[j], ctype->info.uni.types[i])) {
+                break;
+            }
         }
-        free(perl_regex);
+        ctype->info.uni.shortcut[i] = (j == i);
+    }
 
-        if (pcre_exec(precomp, NULL, val_str, strlen(val_str), 0, 0, NULL, 0)) {
-            free(precomp);
-            LOGVAL(LYE_INVAL, line, LY_VLOG_LYD, node, val_str, node->schema->name);
-            return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+/* logs directly, keeps the order of trying the union member types */
+static int
+ctype_add_union_types(struct lys_ctype *ctype, struct lys_type *type)
+{
+    struct lys_type **new;
+    int i;
+
+    for (i = 0; i < type->info.uni.count; ++i) {
+        if (type->info.uni.types[i].base == LY_TYPE_UNION) {
+            if (ctype_add_union_types(ctype, &type->info.uni.types[i])) {
+                return -1;
+            }
+            continue;
         }
-        free(precomp);
+
+        new = realloc(ctype->info.uni.types, (ctype->info.uni.count + 1) * sizeof *ctype->info.uni.types);
+        if (!new) {
+            LOGMEM;
+            return -1;
+        }
+        ctype->info.uni.types = new;
+        ctype->info.uni.types[ctype->info.uni.count++] = &type->info.uni.types[i];
     }
 
+    if (type->der) {
+        return ctype_add_union_types(ctype, &type->der->type);
+    }
     return EXIT_SUCCESS;
 }
 
+int
+lyp_ctype_build(struct lys_type *type)
+{
+    struct lys_ctype *ctype;
+    struct lys_type *def;
+    const char *name;
+    int i;
+
+    lyp_ctype_free(type->ctype);
+    type->ctype = NULL;
+
+    ctype = calloc(1, sizeof *ctype);
+    if (!ctype) {
+        LOGMEM;
+        return -1;
+    }
+    ctype->base = type->base;
+
+    /* the type defining the specific information, the closest one derived directly from the built-in type */
+    for (def = type; def->der && def->der->type.der; def = &def->der->type);
+
+    switch (type->base) {
+    case LY_TYPE_BITS:
+        ctype->info.bits.bit = def->info.bits.bit;
+        ctype->info.bits.count = def->info.bits.count;
+        for (i = 0; i < ctype->info.bits.count; ++i) {
+            name = ctype->info.bits.bit[i].name;
+            if (ly_ht_insert(&ctype->names, dict_hash(name, strlen(name)), &ctype->info.bits.bit[i])) {
+                goto error;
+            }
+        }
+        break;
+    case LY_TYPE_DEC64:
+        ctype->dig = def->info.dec64.dig;
+        break;
+    case LY_TYPE_ENUM:
+        ctype->info.enums.enm = def->info.enums.enm;
+        ctype->info.enums.count = def->info.enums.count;
+        for (i = 0; i < ctype->info.enums.count; ++i) {
+            name = ctype->info.enums.enm[i].name;
+            if (ly_ht_insert(&ctype->names, dict_hash(name, strlen(name)), &ctype->info.enums.enm[i])) {
+                goto error;
+            }
+        }
+        break;
+    case LY_TYPE_STRING:
+        if (ctype_add_patterns(ctype, type)) {
+            goto error;
+        }
+        break;
+    case LY_TYPE_UNION:
+        if (ctype_add_union_types(ctype, type) || ctype_union_shortcuts(ctype)) {
+            goto error;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (resolve_len_ran_compile(type, &ctype->intv)) {
+        goto error;
+    }
+
+    type->ctype = ctype;
+    return EXIT_SUCCESS;
+
+error:
+    lyp_ctype_free(ctype);
+    return -1;
+}
+
+void
+lyp_ctype_free(struct lys_ctype *ctype)
+{
+    uint32_t i;
+
+    if (!ctype) {
+        return;
+    }
+
+    resolve_len_ran_free(ctype->intv);
+    for (i = 0; i < ctype->pat_count; ++i) {
+        pcre_free(ctype->patterns[i]);
+    }
+    free(ctype->patterns);
+    if (ctype->base == LY_TYPE_UNION) {
+        free(ctype->info.uni.types);
+        free(ctype->info.uni.shortcut);
+    }
+    ly_ht_clean(&ctype->names);
+    free(ctype);
+}
+
+/* does not log, returns the index of the enum/bit definition or -1 */
+static int
+ctype_find_name(struct lys_ctype *ctype, const char *name, int len)
+{
+    const char **def;
+    uint32_t hash, iter = 0;
+
+    hash = dict_hash(name, len);
+    while ((def = ly_ht_find(&ctype->names, hash, &iter))) {
+        /* both enum and bit definitions start with the name */
+        if (!strncmp(*def, name, len) && !(*def)[len]) {
+            if (ctype->base == LY_TYPE_ENUM) {
+                return (struct lys_type_enum *)def - ctype->info.enums.enm;
+            }
+            return (struct lys_type_bit *)def - ctype->info.bits.bit;
+        }
+    }
+
+    return -1;
+}
+
 /**
  * @brief Checks the syntax of length or range statement,
  *        on success checks the semantics as well. Does not log.
@@ -562,18 +862,21 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
 {
     #define DECSIZE 21
     struct lys_type *type;
+    struct lys_ctype *ctype;
     char dec[DECSIZE];
     int64_t num;
-    uint64_t unum;
+    uint64_t unum, div;
     int len;
     int c, i, j, d;
     int found;
 
     assert(node && (node->value_type == stype->base));
+    /* NULL only for a type not resolved yet (LY_TYPE_DER), which fails anyway */
+    ctype = stype->ctype;
 
     switch (node->value_type) {
     case LY_TYPE_BINARY:
-        if (validate_length_range(0, (node->value_str ? strlen(node->value_str) : 0), 0, 0, stype,
+        if (validate_length_range(0, (node->value_str ? strlen(node->value_str) : 0), 0, 0, ctype,
                                   node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
@@ -582,13 +885,8 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
         break;
 
     case LY_TYPE_BITS:
-        /* locate bits structure with the bits definitions */
-        for (type = stype; type->der->type.der; type = &type->der->type);
-
-        /* allocate the array of  pointers to bits definition */
-        node->value.bit = calloc(type->info.bits.count, sizeof *node->value.bit);
-        if (!node->value.bit) {
-            LOGMEM;
+        /* prepare the bitmap of the set bits */
+        if (lyd_bits_init(node, ctype->info.bits.count)) {
             return EXIT_FAILURE;
         }
 
@@ -612,21 +910,14 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
             c = c - len;
 
             /* find bit definition, identifiers appear ordered by their posititon */
-            for (found = 0; i < type->info.bits.count; i++) {
-                if (!strncmp(type->info.bits.bit[i].name, &node->value_str[c], len)
-                        && !type->info.bits.bit[i].name[len]) {
-                    /* we have match, store the pointer */
-                    node->value.bit[i] = &type->info.bits.bit[i];
-
-                    /* stop searching */
-                    i++;
-                    found = 1;
-                    break;
-                }
-            }
-
-            if (!found) {
+            j = ctype_find_name(ctype, &node->value_str[c], len);
+            if (j >= i) {
+                /* we have match, set the bit */
+                lyd_bits_set(node, j);
+                i = j + 1;
+            } else {
                 /* referenced bit value does not exists */
+                lyd_bits_free(&node->value, node->flags);
                 LOGVAL(LYE_INVAL, line, LY_VLOG_LYD, node, node->value_str, node->schema->name);
                 return EXIT_FAILURE;
             }
@@ -657,9 +948,6 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
             return EXIT_FAILURE;
         }
 
-        /* locate dec64 structure with the fraction-digits value */
-        for (type = stype; type->der->type.der; type = &type->der->type);
-
         for (c = 0; isspace(node->value_str[c]); c++);
         for (len = 0; node->value_str[c] && !isspace(node->value_str[c]); c++, len++);
         c = c - len;
@@ -674,7 +962,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
         for (i = j = d = found = 0; i < DECSIZE; i++) {
             if (node->value_str[c + i] == '.') {
                 found = 1;
-                j = type->info.dec64.dig;
+                j = ctype->dig;
                 i--;
                 c++;
                 continue;
@@ -682,7 +970,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
             if (node->value_str[c + i] == '\0') {
                 c--;
                 if (!found) {
-                    j = type->info.dec64.dig;
+                    j = ctype->dig;
                     found = 1;
                 }
                 if (!j) {
@@ -715,9 +1003,12 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
             }
         }
 
+        for (div = 1, i = 0; i < ctype->dig; ++i) {
+            div *= 10;
+        }
         if (parse_int(dec, __INT64_C(-9223372036854775807) - __INT64_C(1), __INT64_C(9223372036854775807), 10, &num,
                       line, (struct lyd_node *)node)
-                || validate_length_range(2, 0, 0, ((long double)num)/(1 << type->info.dec64.dig), stype,
+                || validate_length_range(2, 0, 0, ((long double)num)/div, ctype,
                                          node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
@@ -738,19 +1029,12 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
             return EXIT_FAILURE;
         }
 
-        /* locate enums structure with the enumeration definitions */
-        for (type = stype; type->der->type.der; type = &type->der->type);
-
         /* find matching enumeration value */
-        for (i = 0; i < type->info.enums.count; i++) {
-            if (!strcmp(node->value_str, type->info.enums.enm[i].name)) {
-                /* we have match, store pointer to the definition */
-                node->value.enm = &type->info.enums.enm[i];
-                break;
-            }
-        }
-
-        if (!node->value.enm) {
+        i = ctype_find_name(ctype, node->value_str, strlen(node->value_str));
+        if (i > -1) {
+            /* we have match, store pointer to the definition */
+            node->value.enm = &ctype->info.enums.enm[i];
+        } else {
             LOGVAL(LYE_INVAL, line, LY_VLOG_LYD, node, node->value_str, node->schema->name);
             return EXIT_FAILURE;
         }
@@ -822,12 +1106,12 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
         break;
 
     case LY_TYPE_STRING:
-        if (validate_length_range(0, (node->value_str ? strlen(node->value_str) : 0), 0, 0, stype,
+        if (validate_length_range(0, (node->value_str ? strlen(node->value_str) : 0), 0, 0, ctype,
                                   node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
 
-        if (validate_pattern(node->value_str, stype, line, (struct lyd_node *)node)) {
+        if (validate_pattern(node->value_str, ctype, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
 
@@ -836,7 +1120,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
 
     case LY_TYPE_INT8:
         if (parse_int(node->value_str, __INT64_C(-128), __INT64_C(127), 0, &num, line, (struct lyd_node *)node)
-                || validate_length_range(1, 0, num, 0, stype, node->value_str, line, (struct lyd_node *)node)) {
+                || validate_length_range(1, 0, num, 0, ctype, node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
         node->value.int8 = num;
@@ -844,7 +1128,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
 
     case LY_TYPE_INT16:
         if (parse_int(node->value_str, __INT64_C(-32768), __INT64_C(32767), 0, &num, line, (struct lyd_node *)node)
-                || validate_length_range(1, 0, num, 0, stype, node->value_str, line, (struct lyd_node *)node)) {
+                || validate_length_range(1, 0, num, 0, ctype, node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
         node->value.int16 = num;
@@ -852,7 +1136,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
 
     case LY_TYPE_INT32:
         if (parse_int(node->value_str, __INT64_C(-2147483648), __INT64_C(2147483647), 0, &num, line, (struct lyd_node *)node)
-                || validate_length_range(1, 0, num, 0, stype, node->value_str, line, (struct lyd_node *)node)) {
+                || validate_length_range(1, 0, num, 0, ctype, node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
         node->value.int32 = num;
@@ -861,7 +1145,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
     case LY_TYPE_INT64:
         if (parse_int(node->value_str, __INT64_C(-9223372036854775807) - __INT64_C(1), __INT64_C(9223372036854775807),
                       0, &num, line, (struct lyd_node *)node)
-                || validate_length_range(1, 0, num, 0, stype, node->value_str, line, (struct lyd_node *)node)) {
+                || validate_length_range(1, 0, num, 0, ctype, node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
         node->value.int64 = num;
@@ -869,7 +1153,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
 
     case LY_TYPE_UINT8:
         if (parse_uint(node->value_str, __UINT64_C(255), __UINT64_C(0), &unum, line, (struct lyd_node *)node)
-                || validate_length_range(0, unum, 0, 0, stype, node->value_str, line, (struct lyd_node *)node)) {
+                || validate_length_range(0, unum, 0, 0, ctype, node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
         node->value.uint8 = unum;
@@ -877,7 +1161,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
 
     case LY_TYPE_UINT16:
         if (parse_uint(node->value_str, __UINT64_C(65535), __UINT64_C(0), &unum, line, (struct lyd_node *)node)
-                || validate_length_range(0, unum, 0, 0, stype, node->value_str, line, (struct lyd_node *)node)) {
+                || validate_length_range(0, unum, 0, 0, ctype, node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
         node->value.uint16 = unum;
@@ -885,7 +1169,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
 
     case LY_TYPE_UINT32:
         if (parse_uint(node->value_str, __UINT64_C(4294967295), __UINT64_C(0), &unum, line, (struct lyd_node *)node)
-                || validate_length_range(0, unum, 0, 0, stype, node->value_str, line, (struct lyd_node *)node)) {
+                || validate_length_range(0, unum, 0, 0, ctype, node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
         node->value.uint32 = unum;
@@ -893,7 +1177,7 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
 
     case LY_TYPE_UINT64:
         if (parse_uint(node->value_str, __UINT64_C(18446744073709551615), __UINT64_C(0), &unum, line, (struct lyd_node *)node)
-                || validate_length_range(0, unum, 0, 0, stype, node->value_str, line, (struct lyd_node *)node)) {
+                || validate_length_range(0, unum, 0, 0, ctype, node->value_str, line, (struct lyd_node *)node)) {
             return EXIT_FAILURE;
         }
         node->value.uint64 = unum;
@@ -906,51 +1190,80 @@ lyp_parse_value_(struct lyd_node_leaf_list *node, struct lys_type *stype, int re
     return EXIT_SUCCESS;
 }
 
+/* does not log (UINT_MAX line), speculative attempt to parse the value as a union member type */
+static int
+lyp_parse_union_member(struct lyd_node_leaf_list *leaf, struct lyxml_elem *xml, struct lys_type *type, int resolve,
+                       struct unres_data *unres)
+{
+    leaf->value_type = type->base;
+    memset(&leaf->value, 0, sizeof leaf->value);
+
+    /* in these cases we use JSON format */
+    if (xml && ((type->base == LY_TYPE_IDENT) || (type->base == LY_TYPE_INST))) {
+        xml->content = leaf->value_str;
+        leaf->value_str = transform_xml2json(leaf->schema->module->ctx, xml->content, xml, 0);
+        if (!leaf->value_str) {
+            leaf->value_str = xml->content;
+            xml->content = NULL;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!lyp_parse_value_(leaf, type, resolve, unres, UINT_MAX)) {
+        /* success */
+        return EXIT_SUCCESS;
+    }
+
+    if (xml && ((type->base == LY_TYPE_IDENT) || (type->base == LY_TYPE_INST))) {
+        lydict_remove(leaf->schema->module->ctx, leaf->value_str);
+        leaf->value_str = xml->content;
+        xml->content = NULL;
+    }
+    return EXIT_FAILURE;
+}
+
 int
 lyp_parse_value(struct lyd_node_leaf_list *leaf, struct lyxml_elem *xml, int resolve, struct unres_data *unres, int line)
 {
-    int found = 0;
-    struct lys_type *type, *stype;
+    int i, last, cur;
+    struct lys_type *stype;
+    struct lys_ctype *ctype;
 
     assert(leaf);
 
     stype = &((struct lys_node_leaf *)leaf->schema)->type;
     if (stype->base == LY_TYPE_UNION) {
-        type = lyp_get_next_union_type(stype, NULL, &found);
-        while (type) {
-            leaf->value_type = type->base;
-            memset(&leaf->value, 0, sizeof leaf->value);
-
-            /* in these cases we use JSON format */
-            if (xml && ((type->base == LY_TYPE_IDENT) || (type->base == LY_TYPE_INST))) {
-                xml->content = leaf->value_str;
-                leaf->value_str = transform_xml2json(leaf->schema->module->ctx, xml->content, xml, 0);
-                if (!leaf->value_str) {
-                    leaf->value_str = xml->content;
-                    xml->content = NULL;
-
-                    found = 0;
-                    type = lyp_get_next_union_type(stype, type, &found);
-                    continue;
-                }
-            }
+        ctype = stype->ctype;
 
-            if (!lyp_parse_value_(leaf, type, resolve, unres, UINT_MAX)) {
-                /* success */
-                break;
+        /*
+         * try the member type that matched the last time first, values of a node tend to be of the same type,
+         * but only if it cannot change the member type chosen by trying them in order, the prediction is shared
+         * by all the threads parsing data of the schema, so it is accessed atomically
+         */
+        last = __sync_fetch_and_add(&ctype->info.uni.last, 0);
+        if (last) {
+            if (!lyp_parse_union_member(leaf, xml, ctype->info.uni.types[last], resolve, unres)) {
+                return EXIT_SUCCESS;
             }
+            __sync_add_and_fetch(&leaf->schema->module->ctx->union_mispredictions, 1);
+        }
 
-            if (xml && ((type->base == LY_TYPE_IDENT) || (type->base == LY_TYPE_INST))) {
-                lydict_remove(leaf->schema->module->ctx, leaf->value_str);
-                leaf->value_str = xml->content;
-                xml->content = NULL;
+        /* then the rest of the member types in the order they are supposed to be tried */
+        for (i = 0; i < ctype->info.uni.count; ++i) {
+            if (last && (i == last)) {
+                continue;
+            }
+            if (!lyp_parse_union_member(leaf, xml, ctype->info.uni.types[i], resolve, unres)) {
+                /* success, another thread may have changed the prediction meanwhile, then keep its one */
+                cur = ctype->info.uni.shortcut[i] ? i : 0;
+                if (cur != last) {
+                    __sync_bool_compare_and_swap(&ctype->info.uni.last, last, cur);
+                }
+                break;
             }
-
-            found = 0;
-            type = lyp_get_next_union_type(stype, type, &found);
         }
 
-        if (!type) {
+        if (i == ctype->info.uni.count) {
             /* failure */
             LOGVAL(LYE_INVAL, line, LY_VLOG_LYD, leaf, (leaf->value_str ? leaf->value_str : ""), leaf->schema->name);
             return EXIT_FAILURE;
@@ -966,39 +1279,6 @@ lyp_parse_value(struct lyd_node_leaf_list *leaf, struct lyxml_elem *xml, int res
     return EXIT_SUCCESS;
 }
 
-/* does not log, cannot fail */
-struct lys_type *
-lyp_get_next_union_type(struct lys_type *type, struct lys_type *prev_type, int *found)
-{
-    int i;
-    struct lys_type *ret = NULL;
-
-    for (i = 0; i < type->info.uni.count; ++i) {
-        if (type->info.uni.types[i].base == LY_TYPE_UNION) {
-            ret = lyp_get_next_union_type(&type->info.uni.types[i], prev_type, found);
-            if (ret) {
-                break;;
-            }
-            continue;
-        }
-
-        if (!prev_type || *found) {
-            ret = &type->info.uni.types[i];
-            break;
-        }
-
-        if (&type->info.uni.types[i] == prev_type) {
-            *found = 1;
-        }
-    }
-
-    if (!ret && type->der) {
-        ret = lyp_get_next_union_type(&type->der->type, prev_type, found);
-    }
-
-    return ret;
-}
-
 /* does not log */
 static int
 dup_typedef_check(const char *type, struct lys_tpdf *tpdf, int size)
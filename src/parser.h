@@ -60,6 +60,15 @@ struct lyd_node *lyd_parse_json(struct ly_ctx *ctx, const struct lys_node *paren
 
 /**@} jsondata */
 
+/**
+ * @defgroup lybdata LYB data format support
+ * @{
+ */
+struct lyd_node *lyd_parse_lyb(struct ly_ctx *ctx, const struct lys_node *parent, const char *data, size_t size,
+                               int options, struct lyd_arena *arena);
+
+/**@} lybdata */
+
 enum LY_IDENT {
     LY_IDENT_SIMPLE,   /* only syntax rules */
     LY_IDENT_FEATURE,
@@ -75,7 +84,16 @@ struct lys_module *lyp_search_file(struct ly_ctx *ctx, struct lys_module *module
 
 void lyp_set_implemented(struct lys_module *module);
 
-struct lys_type *lyp_get_next_union_type(struct lys_type *type, struct lys_type *prev_type, int *found);
+/**
+ * @brief Build the flattened effective type (::lys_type#ctype) of a resolved type. All the superior
+ * types as well as the union member types must be already resolved. Logs directly.
+ *
+ * @param[in] type Type to process, the previous ::lys_type#ctype (if any) is replaced.
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+int lyp_ctype_build(struct lys_type *type);
+
+void lyp_ctype_free(struct lys_ctype *ctype);
 
 int lyp_parse_value(struct lyd_node_leaf_list *leaf, struct lyxml_elem *xml, int resolve, struct unres_data *unres, int line);
 
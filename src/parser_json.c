@@ -327,17 +327,18 @@ json_get_value(struct lyd_node_leaf_list *leaf, const char *data, int options, s
     struct lys_type *stype;
     struct ly_ctx *ctx;
     unsigned int len = 0, r;
-    int resolve;
-    char *str;
+    int resolve, typed, postpone;
+    char *str, num[32];
 
     assert(leaf && data && unres);
     ctx = leaf->schema->module->ctx;
-
     if (options & (LYD_OPT_FILTER | LYD_OPT_EDIT | LYD_OPT_GET | LYD_OPT_GETCONFIG)) {
         resolve = 0;
     } else {
         resolve = 1;
     }
+    postpone = (options & LYD_OPT_TRUSTED) && (options & LYD_OPT_LAZY) && resolve;
+    typed = !postpone && (options & LYD_OPT_TYPED) && lyd_value_str_droppable(leaf->schema);
 
     stype = &((struct lys_node_leaf *)leaf->schema)->type;
 
@@ -390,7 +391,14 @@ repeat:
             LOGVAL(LYE_PATH, 0, LY_VLOG_LYD, leaf);
             return 0;
         }
-        leaf->value_str = lydict_insert(ctx, &data[len], r);
+        if (typed && (r < sizeof num)) {
+            /* the string is not going to be stored, avoid the dictionary */
+            memcpy(num, &data[len], r);
+            num[r] = '\0';
+            leaf->value_str = num;
+        } else {
+            leaf->value_str = lydict_insert(ctx, &data[len], r);
+        }
         len += r;
     } else if (data[len] == 'f' || data[len] == 't') {
         /* boolean */
@@ -411,17 +419,28 @@ repeat:
         return 0;
     }
 
-    if (lyp_parse_value(leaf, NULL, resolve, unres, lineno)) {
+    if (postpone) {
+        /* trusted value, parse it when needed */
+        leaf->value_type = LY_TYPE_DER;
+    } else if (lyp_parse_value(leaf, NULL, resolve, unres, lineno)) {
+        if (leaf->value_str == num) {
+            leaf->value_str = lydict_insert(ctx, num, 0);
+        }
         ly_errno = LY_EVALID;
         return 0;
     }
+    if (leaf->value_str == num) {
+        leaf->value_str = lyd_value_str_lazy;
+    } else if (typed) {
+        lyd_value_str_drop(leaf);
+    }
 
     if (leaf->schema->nodetype == LYS_LEAFLIST) {
         /* repeat until end-array */
         len += skip_ws(&data[len]);
         if (data[len] == ',') {
             /* another instance of the leaf-list */
-            new = calloc(1, sizeof(struct lyd_node_leaf_list));
+            new = lyd_node_alloc(ctx, leaf->schema->nodetype);
             if (!new) {
                 LOGMEM;
                 return 0;
@@ -848,14 +867,14 @@ attr_repeat:
     case LYS_LIST:
     case LYS_NOTIF:
     case LYS_RPC:
-        result = calloc(1, sizeof *result);
+        result = lyd_node_alloc(ctx, schema->nodetype);
         break;
     case LYS_LEAF:
     case LYS_LEAFLIST:
-        result = calloc(1, sizeof(struct lyd_node_leaf_list));
+        result = lyd_node_alloc(ctx, schema->nodetype);
         break;
     case LYS_ANYXML:
-        result = calloc(1, sizeof(struct lyd_node_anyxml));
+        result = lyd_node_alloc(ctx, schema->nodetype);
         break;
     default:
         LOGINT;
@@ -1024,7 +1043,7 @@ attr_repeat:
                 list->validity = LYD_VAL_OK;
 
                 /* another instance of the list */
-                new = calloc(1, sizeof *new);
+                new = lyd_node_alloc(ctx, list->schema->nodetype);
                 if (!new) {
                     goto error;
                 }
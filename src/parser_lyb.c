@@ -0,0 +1,735 @@
+/**
+ * @file parser_lyb.c
+ * @brief LYB (binary) data parser for libyang
+ *
+ * Copyright (c) 2015 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libyang.h"
+#include "common.h"
+#include "context.h"
+#include "parser.h"
+#include "tree_internal.h"
+#include "validation.h"
+#include "xml_internal.h"
+
+struct lyb_parse_state {
+    struct ly_ctx *ctx;
+    const char *data;                /* current position */
+    const char *end;                 /* end of the data */
+    int flags;                       /* LYB_FLAG_* of the data */
+    int options;
+    const struct lys_module **mods;  /* modules of the data, NULL if not in the context */
+    uint32_t mod_count;
+    const struct lys_node **sids;    /* schema nodes by their ID - 1, NULL if unknown */
+    uint32_t sid_count;
+    struct unres_data *unres;
+    struct lyd_arena *arena;         /* arena for the nodes, if any */
+};
+
+static int
+lyb_read(struct lyb_parse_state *st, void *buf, size_t len)
+{
+    if ((size_t)(st->end - st->data) < len) {
+        LOGVAL(LYE_SPEC, 0, 0, NULL, "Unexpected end of LYB data.");
+        return EXIT_FAILURE;
+    }
+    if (buf) {
+        memcpy(buf, st->data, len);
+    }
+    st->data += len;
+    return EXIT_SUCCESS;
+}
+
+static int
+lyb_read_num(struct lyb_parse_state *st, uint64_t *num)
+{
+    uint8_t byte;
+    int shift = 0;
+
+    *num = 0;
+    do {
+        if ((shift > 63) || lyb_read(st, &byte, 1)) {
+            if (shift > 63) {
+                LOGVAL(LYE_SPEC, 0, 0, NULL, "Invalid number in LYB data.");
+            }
+            return EXIT_FAILURE;
+        }
+        *num |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return EXIT_SUCCESS;
+}
+
+static int
+lyb_read_snum(struct lyb_parse_state *st, int64_t *num)
+{
+    uint64_t unum;
+
+    if (lyb_read_num(st, &unum)) {
+        return EXIT_FAILURE;
+    }
+    *num = (int64_t)(unum >> 1) ^ -(int64_t)(unum & 1);
+    return EXIT_SUCCESS;
+}
+
+/* the string is not terminated, it is only pointed to in the data */
+static int
+lyb_read_str(struct lyb_parse_state *st, const char **str, size_t *len)
+{
+    uint64_t num;
+
+    if (lyb_read_num(st, &num)) {
+        return EXIT_FAILURE;
+    }
+    *str = st->data;
+    *len = num;
+    return lyb_read(st, NULL, num);
+}
+
+static uint32_t
+lyb_read_len(const char *src)
+{
+    const uint8_t *bytes = (const uint8_t *)src;
+
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static int
+lyb_read_module(struct lyb_parse_state *st, const struct lys_module **module)
+{
+    uint64_t idx;
+
+    if (lyb_read_num(st, &idx)) {
+        return EXIT_FAILURE;
+    }
+    if (idx >= st->mod_count) {
+        LOGVAL(LYE_SPEC, 0, 0, NULL, "Invalid module in LYB data.");
+        return EXIT_FAILURE;
+    }
+    *module = st->mods[idx];
+    return EXIT_SUCCESS;
+}
+
+/* find the data schema node in the (schema) siblings, looking into choices, cases, uses and RPC input/output */
+static const struct lys_node *
+lyb_search_schemanode(const struct lys_node *start, const struct lys_module *module, const char *name, size_t len,
+                      int options)
+{
+    const struct lys_node *result, *aux;
+
+    LY_TREE_FOR(start, result) {
+        if (result->nodetype == LYS_GROUPING) {
+            continue;
+        } else if (result->nodetype == LYS_OUTPUT && (options & LYD_OPT_RPC)) {
+            continue;
+        } else if (result->nodetype == LYS_INPUT && (options & LYD_OPT_RPCREPLY)) {
+            continue;
+        }
+
+        if (result->nodetype & (LYS_CHOICE | LYS_CASE | LYS_USES | LYS_INPUT | LYS_OUTPUT)) {
+            aux = lyb_search_schemanode(result->child, module, name, len, options);
+            if (aux) {
+                return aux;
+            }
+            continue;
+        }
+
+        if (!strncmp(result->name, name, len) && !result->name[len] && (lys_node_module(result) == module)) {
+            return result;
+        }
+    }
+
+    return NULL;
+}
+
+/* check that a schema node of a reused ID can be a child of the parent, as lyb_search_schemanode() would find it */
+static int
+lyb_schema_is_child(struct lyb_parse_state *st, const struct lys_node *schema, const struct lys_node *sparent)
+{
+    const struct lys_node *iter;
+
+    for (iter = lys_parent(schema); iter && (iter != sparent); iter = lys_parent(iter)) {
+        if (iter->nodetype == LYS_OUTPUT && (st->options & LYD_OPT_RPC)) {
+            return 0;
+        } else if (iter->nodetype == LYS_INPUT && (st->options & LYD_OPT_RPCREPLY)) {
+            return 0;
+        } else if (!(iter->nodetype & (LYS_CHOICE | LYS_CASE | LYS_USES | LYS_INPUT | LYS_OUTPUT))) {
+            return 0;
+        }
+    }
+
+    return iter == sparent;
+}
+
+/* read the schema node ID (with its definition on the first use), *schema is NULL if the node is unknown */
+static int
+lyb_read_schema(struct lyb_parse_state *st, const struct lys_node *sparent, struct lyd_node *parent,
+                const struct lys_node **schema, uint64_t *sid)
+{
+    const struct lys_module *module;
+    const struct lys_node **new, *start;
+    const char *name;
+    size_t len;
+    uint64_t id;
+    uint32_t i;
+
+    if (lyb_read_num(st, &id)) {
+        return EXIT_FAILURE;
+    }
+    *sid = id >> 1;
+    if (!*sid) {
+        /* end of the siblings */
+        *schema = NULL;
+        return EXIT_SUCCESS;
+    }
+
+    if (!(id & 1)) {
+        /* already defined */
+        if (*sid > st->sid_count) {
+            LOGVAL(LYE_SPEC, 0, 0, NULL, "Invalid schema node in LYB data.");
+            return EXIT_FAILURE;
+        }
+        *schema = st->sids[*sid - 1];
+        if (!*schema) {
+            /* only the unknown nodes can be skipped */
+            if (!(st->flags & LYB_FLAG_LENGTHS) || (st->options & LYD_OPT_STRICT)) {
+                LOGVAL(LYE_SPEC, 0, 0, NULL, "Invalid schema node in LYB data.");
+                return EXIT_FAILURE;
+            }
+        } else if (!lyb_schema_is_child(st, *schema, parent ? parent->schema : sparent)) {
+            LOGVAL(LYE_SPEC, 0, LY_VLOG_LYD, parent, "Invalid schema node \"%s\" in LYB data.", (*schema)->name);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    /* definition, the IDs defined in the skipped subtrees were not seen */
+    if ((*sid <= st->sid_count) || (*sid > UINT32_MAX)) {
+        LOGVAL(LYE_SPEC, 0, 0, NULL, "Invalid schema node in LYB data.");
+        return EXIT_FAILURE;
+    }
+    if (lyb_read_module(st, &module) || lyb_read_str(st, &name, &len)) {
+        return EXIT_FAILURE;
+    }
+    new = realloc(st->sids, *sid * sizeof *st->sids);
+    if (!new) {
+        LOGMEM;
+        return EXIT_FAILURE;
+    }
+    st->sids = new;
+    for (i = st->sid_count; i < *sid; ++i) {
+        st->sids[i] = NULL;
+    }
+    st->sid_count = *sid;
+
+    *schema = NULL;
+    if (module) {
+        if (parent) {
+            start = parent->schema->child;
+        } else if (sparent) {
+            start = sparent->child;
+        } else {
+            start = module->data;
+        }
+        *schema = lyb_search_schemanode(start, module, name, len, st->options);
+    }
+    if (!*schema && (!(st->flags & LYB_FLAG_LENGTHS) || (st->options & LYD_OPT_STRICT) || module)) {
+        /* unknown nodes of the known modules are always an error, as in the XML parser */
+        LOGVAL(LYE_SPEC, 0, LY_VLOG_LYD, parent, "Unknown element \"%.*s\" in LYB data.", (int)len, name);
+        return EXIT_FAILURE;
+    }
+    st->sids[*sid - 1] = *schema;
+
+    return EXIT_SUCCESS;
+}
+
+static int
+lyb_parse_value(struct lyb_parse_state *st, struct lyd_node_leaf_list *leaf)
+{
+    struct lys_ctype *ctype = ((struct lys_node_leaf *)leaf->schema)->type.ctype;
+    const char *str;
+    size_t len;
+    uint8_t tag, bln;
+    uint64_t unum;
+    int64_t snum;
+    int resolve;
+
+    leaf->value_type = ((struct lys_node_leaf *)leaf->schema)->type.base;
+    if (lyb_read(st, &tag, 1)) {
+        return EXIT_FAILURE;
+    }
+
+    if (st->options & (LYD_OPT_FILTER | LYD_OPT_EDIT | LYD_OPT_GET | LYD_OPT_GETCONFIG)) {
+        resolve = 0;
+    } else {
+        resolve = 1;
+    }
+
+    switch (tag) {
+    case LYB_VALUE_NONE:
+        return EXIT_SUCCESS;
+    case LYB_VALUE_STRING:
+        if (lyb_read_str(st, &str, &len)) {
+            return EXIT_FAILURE;
+        }
+        leaf->value_str = lydict_insert(st->ctx, str, len);
+        break;
+    case LYB_VALUE_NATIVE:
+        if (!lyd_value_str_droppable(leaf->schema)) {
+            LOGVAL(LYE_SPEC, 0, LY_VLOG_LYD, leaf, "Invalid value of \"%s\" in LYB data.", leaf->schema->name);
+            return EXIT_FAILURE;
+        }
+        switch (leaf->value_type) {
+        case LY_TYPE_BOOL:
+            if (lyb_read(st, &bln, 1)) {
+                return EXIT_FAILURE;
+            }
+            leaf->value.bln = bln ? 1 : 0;
+            break;
+        case LY_TYPE_ENUM:
+            if (lyb_read_num(st, &unum)) {
+                return EXIT_FAILURE;
+            }
+            if (unum >= (unsigned)ctype->info.enums.count) {
+                LOGVAL(LYE_SPEC, 0, LY_VLOG_LYD, leaf, "Invalid value of \"%s\" in LYB data.", leaf->schema->name);
+                return EXIT_FAILURE;
+            }
+            leaf->value.enm = &ctype->info.enums.enm[unum];
+            break;
+        case LY_TYPE_UINT8:
+        case LY_TYPE_UINT16:
+        case LY_TYPE_UINT32:
+        case LY_TYPE_UINT64:
+            if (lyb_read_num(st, &unum)) {
+                return EXIT_FAILURE;
+            }
+            if (leaf->value_type == LY_TYPE_UINT8) {
+                leaf->value.uint8 = unum;
+            } else if (leaf->value_type == LY_TYPE_UINT16) {
+                leaf->value.uint16 = unum;
+            } else if (leaf->value_type == LY_TYPE_UINT32) {
+                leaf->value.uint32 = unum;
+            } else {
+                leaf->value.uint64 = unum;
+            }
+            break;
+        default:
+            if (lyb_read_snum(st, &snum)) {
+                return EXIT_FAILURE;
+            }
+            if (leaf->value_type == LY_TYPE_INT8) {
+                leaf->value.int8 = snum;
+            } else if (leaf->value_type == LY_TYPE_INT16) {
+                leaf->value.int16 = snum;
+            } else if (leaf->value_type == LY_TYPE_INT32) {
+                leaf->value.int32 = snum;
+            } else if (leaf->value_type == LY_TYPE_INT64) {
+                leaf->value.int64 = snum;
+            } else {
+                leaf->value.dec64 = snum;
+            }
+            break;
+        }
+        leaf->value_str = lyd_value_str_lazy;
+
+        if (st->options & LYD_OPT_TRUSTED) {
+            /* the value is complete */
+            if (!(st->options & LYD_OPT_TYPED)) {
+                lyd_value_str(leaf);
+            }
+            return EXIT_SUCCESS;
+        }
+
+        /* check the value against the type restrictions, the string is cached in the node */
+        if (!lyd_value_str(leaf)) {
+            return EXIT_FAILURE;
+        }
+        memset(&leaf->value, 0, sizeof leaf->value);
+        break;
+    default:
+        LOGVAL(LYE_SPEC, 0, LY_VLOG_LYD, leaf, "Invalid value of \"%s\" in LYB data.", leaf->schema->name);
+        return EXIT_FAILURE;
+    }
+
+    if ((st->options & LYD_OPT_TRUSTED) && (st->options & LYD_OPT_LAZY) && resolve) {
+        /* trusted value, parse it when needed */
+        leaf->value_type = LY_TYPE_DER;
+        return EXIT_SUCCESS;
+    }
+
+    if (lyp_parse_value(leaf, NULL, resolve, st->unres, 0)) {
+        return EXIT_FAILURE;
+    }
+
+    if (st->options & LYD_OPT_TYPED) {
+        lyd_value_str_drop(leaf);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int
+lyb_parse_attrs(struct lyb_parse_state *st, struct lyd_node *node)
+{
+    struct lyd_attr *attr, *last = NULL;
+    const struct lys_module *module;
+    const char *name, *value;
+    size_t name_len, value_len;
+    uint64_t count;
+
+    if (lyb_read_num(st, &count)) {
+        return EXIT_FAILURE;
+    }
+    for (; count; --count) {
+        if (lyb_read_module(st, &module) || lyb_read_str(st, &name, &name_len)
+                || lyb_read_str(st, &value, &value_len)) {
+            return EXIT_FAILURE;
+        }
+        if (!module) {
+            LOGWRN("Attribute \"%.*s\" from unknown schema - skipping.", (int)name_len, name);
+            continue;
+        }
+
+        attr = malloc(sizeof *attr);
+        if (!attr) {
+            LOGMEM;
+            return EXIT_FAILURE;
+        }
+        attr->next = NULL;
+        attr->module = (struct lys_module *)module;
+        attr->name = lydict_insert(st->ctx, name, name_len);
+        attr->value = lydict_insert(st->ctx, value, value_len);
+        if (last) {
+            last->next = attr;
+        } else {
+            node->attr = attr;
+        }
+        last = attr;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int
+lyb_parse_anyxml(struct lyb_parse_state *st, struct lyd_node_anyxml *axml)
+{
+    const char *str;
+    char *xml;
+    size_t len;
+
+    if (lyb_read_str(st, &str, &len)) {
+        return EXIT_FAILURE;
+    }
+    if (!len) {
+        return EXIT_SUCCESS;
+    }
+
+    xml = strndup(str, len);
+    if (!xml) {
+        LOGMEM;
+        return EXIT_FAILURE;
+    }
+    axml->value = lyxml_parse_mem(st->ctx, xml, 0);
+    free(xml);
+
+    return axml->value ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int lyb_parse_siblings(struct lyb_parse_state *st, const struct lys_node *sparent, struct lyd_node *parent,
+                              struct lyd_node **first);
+
+/* parse a node and append it to the siblings, 1 if the siblings ended, -1 on error */
+static int
+lyb_parse_node(struct lyb_parse_state *st, const struct lys_node *sparent, struct lyd_node *parent,
+               struct lyd_node **first, struct lyd_node **last)
+{
+    const struct lys_node *schema;
+    struct lyd_node *node, *child;
+    const char *end = NULL;
+    uint64_t sid;
+    int options = st->options, ret;
+
+    if (lyb_read_schema(st, sparent, parent, &schema, &sid)) {
+        return -1;
+    }
+    if (!sid) {
+        return 1;
+    }
+    if (st->flags & LYB_FLAG_LENGTHS) {
+        if (lyb_read(st, NULL, 4)) {
+            return -1;
+        }
+        end = st->data + lyb_read_len(st->data - 4);
+        if ((end > st->end) || (end < st->data)) {
+            LOGVAL(LYE_SPEC, 0, 0, NULL, "Unexpected end of LYB data.");
+            return -1;
+        }
+        if (!schema) {
+            /* unknown node, skip it */
+            st->data = end;
+            return 0;
+        }
+    }
+
+    if (st->arena) {
+        node = lyd_arena_alloc(st->arena, schema->nodetype);
+    } else {
+        node = lyd_node_alloc(st->ctx, schema->nodetype);
+    }
+    if (!node) {
+        LOGMEM;
+        return -1;
+    }
+    node->schema = (struct lys_node *)schema;
+    node->validity = LYD_VAL_NOT;
+    node->parent = parent;
+
+    /* link the node before its validation, the last sibling is known, so it is constant time even at the top level */
+    if (*last) {
+        (*last)->next = node;
+        node->prev = *last;
+        (*first)->prev = node;
+    } else {
+        node->prev = node;
+        *first = node;
+        if (parent) {
+            parent->child = node;
+        }
+    }
+    *last = node;
+
+    if (lyb_parse_attrs(st, node)) {
+        goto error;
+    }
+
+    if (!(options & LYD_OPT_TRUSTED) && lyv_data_context(node, options, 0, st->unres)) {
+        goto error;
+    }
+
+    switch (schema->nodetype) {
+    case LYS_LEAF:
+    case LYS_LEAFLIST:
+        if (lyb_parse_value(st, (struct lyd_node_leaf_list *)node)) {
+            goto error;
+        }
+        break;
+    case LYS_ANYXML:
+        if (lyb_parse_anyxml(st, (struct lyd_node_anyxml *)node)) {
+            goto error;
+        }
+        break;
+    default:
+        if (schema->nodetype & (LYS_RPC | LYS_NOTIF)) {
+            /* the content is not checked as the data of the given type */
+            st->options = options & (LYD_OPT_TRUSTED | LYD_OPT_LAZY | LYD_OPT_TYPED);
+        }
+        ret = lyb_parse_siblings(st, NULL, node, &child);
+        st->options = options;
+        if (ret) {
+            goto error;
+        }
+        break;
+    }
+
+    if (end && (st->data != end)) {
+        LOGVAL(LYE_SPEC, 0, LY_VLOG_LYD, node, "Invalid length of \"%s\" in LYB data.", schema->name);
+        goto error;
+    }
+
+    ly_errno = 0;
+    ret = !(options & LYD_OPT_TRUSTED) && lyv_data_content(node, options, 0, st->unres);
+    if (options & LYD_OPT_FILTER) {
+        /* the filter normalization could have removed the first sibling */
+        if (parent) {
+            *first = parent->child;
+        } else {
+            for (*first = node; (*first)->prev->next; *first = (*first)->prev);
+        }
+    }
+    if (ret) {
+        if (ly_errno) {
+            goto error;
+        }
+        /* the node is to be removed (filter) */
+        goto remove;
+    }
+
+    node->validity = LYD_VAL_OK;
+    return 0;
+
+error:
+    ret = -1;
+    goto unlink;
+remove:
+    ret = 0;
+unlink:
+    if (node == *first) {
+        *first = *last = NULL;
+        if (parent) {
+            parent->child = NULL;
+        }
+    } else {
+        *last = node->prev;
+    }
+    lyd_free(node);
+    return ret;
+}
+
+static int
+lyb_parse_siblings(struct lyb_parse_state *st, const struct lys_node *sparent, struct lyd_node *parent,
+                   struct lyd_node **first)
+{
+    struct lyd_node *last = NULL;
+    int r;
+
+    *first = NULL;
+    while (!(r = lyb_parse_node(st, sparent, parent, first, &last)));
+    if (r == -1) {
+        goto error;
+    }
+
+    return EXIT_SUCCESS;
+
+error:
+    if (!parent) {
+        lyd_free_withsiblings(*first);
+    }
+    /* otherwise the children are freed with the parent */
+    *first = NULL;
+    return EXIT_FAILURE;
+}
+
+API int
+lyd_lyb_data_length(const char *data, size_t size)
+{
+    uint32_t len;
+
+    if (!data || (size < LYB_HEADER_SIZE) || strncmp(data, LYB_MAGIC, 3)) {
+        return -1;
+    }
+
+    len = lyb_read_len(data + 5);
+    if ((len < LYB_HEADER_SIZE) || (len > INT32_MAX)) {
+        return -1;
+    }
+    return len;
+}
+
+struct lyd_node *
+lyd_parse_lyb(struct ly_ctx *ctx, const struct lys_node *parent, const char *data, size_t size, int options,
+              struct lyd_arena *arena)
+{
+    struct lyb_parse_state st;
+    struct lyd_node *result = NULL;
+    const struct lys_module **mods;
+    const char *name, *rev;
+    char *aux;
+    size_t name_len, rev_len;
+    uint64_t count, i;
+    int len;
+
+    ly_errno = LY_SUCCESS;
+
+    len = lyd_lyb_data_length(data, size);
+    if (len == -1) {
+        LOGVAL(LYE_SPEC, 0, 0, NULL, "Invalid LYB data.");
+        return NULL;
+    }
+    if ((size_t)len > size) {
+        LOGVAL(LYE_SPEC, 0, 0, NULL, "Unexpected end of LYB data.");
+        return NULL;
+    }
+    if ((uint8_t)data[3] != LYB_VERSION) {
+        LOGVAL(LYE_SPEC, 0, 0, NULL, "Unsupported LYB data version %d.", (uint8_t)data[3]);
+        return NULL;
+    }
+
+    memset(&st, 0, sizeof st);
+    st.ctx = ctx;
+    st.flags = (uint8_t)data[4];
+    st.options = options;
+    st.arena = arena;
+    st.data = data + LYB_HEADER_SIZE;
+    st.end = data + len;
+
+    st.unres = calloc(1, sizeof *st.unres);
+    if (!st.unres) {
+        LOGMEM;
+        return NULL;
+    }
+
+    /* modules of the data */
+    if (lyb_read_num(&st, &count)) {
+        goto cleanup;
+    }
+    if (count > (uint64_t)(st.end - st.data)) {
+        LOGVAL(LYE_SPEC, 0, 0, NULL, "Unexpected end of LYB data.");
+        goto cleanup;
+    }
+    mods = malloc((count ? count : 1) * sizeof *mods);
+    if (!mods) {
+        LOGMEM;
+        goto cleanup;
+    }
+    st.mods = mods;
+    st.mod_count = count;
+    for (i = 0; i < count; ++i) {
+        if (lyb_read_str(&st, &name, &name_len) || lyb_read_str(&st, &rev, &rev_len)) {
+            goto cleanup;
+        }
+        aux = strndup(name, name_len);
+        if (!aux) {
+            LOGMEM;
+            goto cleanup;
+        }
+        rev = rev_len ? strndup(rev, rev_len) : NULL;
+        mods[i] = ly_ctx_get_module(ctx, aux, rev);
+        free((char *)rev);
+        free(aux);
+        if (!mods[i] && (options & LYD_OPT_STRICT)) {
+            LOGVAL(LYE_SPEC, 0, 0, NULL, "Module \"%.*s\" of the LYB data not found in the context.", (int)name_len, name);
+            goto cleanup;
+        }
+    }
+
+    if (lyb_parse_siblings(&st, parent, NULL, &result)) {
+        goto cleanup;
+    }
+
+    /* check leafrefs and/or instids if any */
+    if (result && resolve_unres_data(st.unres)) {
+        lyd_free_withsiblings(result);
+        result = NULL;
+    }
+
+cleanup:
+    free(st.mods);
+    free(st.sids);
+    free(st.unres->node);
+    free(st.unres->type);
+#ifndef NDEBUG
+    free(st.unres->line);
+#endif
+    free(st.unres);
+
+    return result;
+}
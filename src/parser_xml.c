@@ -80,6 +80,25 @@ xml_data_search_schemanode(struct lyxml_elem *xml, struct lys_node *start, int o
     return NULL;
 }
 
+/* whether the value parsing can be postponed, unions with namespace-dependent member types cannot be
+ * parsed without the XML element */
+static int
+xml_value_postponable(struct lys_type *type)
+{
+    int i;
+
+    if (type->base != LY_TYPE_UNION) {
+        return 1;
+    }
+    for (i = 0; i < type->ctype->info.uni.count; ++i) {
+        if ((type->ctype->info.uni.types[i]->base == LY_TYPE_IDENT)
+                || (type->ctype->info.uni.types[i]->base == LY_TYPE_INST)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 /* logs directly */
 static int
 xml_get_value(struct lyd_node *node, struct lyxml_elem *xml, int options, struct unres_data *unres)
@@ -119,10 +138,23 @@ xml_get_value(struct lyd_node *node, struct lyxml_elem *xml, int options, struct
         }
     }
 
+    if ((options & LYD_OPT_TRUSTED) && (options & LYD_OPT_LAZY) && resolve
+            && xml_value_postponable(&((struct lys_node_leaf *)node->schema)->type)) {
+        /* trusted value, parse it when needed */
+        leaf->value_type = LY_TYPE_DER;
+        return EXIT_SUCCESS;
+    }
+
     if (lyp_parse_value(leaf, xml, resolve, unres, LOGLINE(xml))) {
         return EXIT_FAILURE;
     }
 
+    if (options & LYD_OPT_TYPED) {
+        /* the string was inserted into the dictionary by the XML parser before the schema was known,
+         * so it cannot be avoided, only released */
+        lyd_value_str_drop(leaf);
+    }
+
     return EXIT_SUCCESS;
 }
 
@@ -203,16 +235,16 @@ xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, const struct lys_node
     case LYS_LIST:
     case LYS_NOTIF:
     case LYS_RPC:
-        *result = calloc(1, sizeof **result);
+        *result = lyd_node_alloc(ctx, schema->nodetype);
         havechildren = 1;
         break;
     case LYS_LEAF:
     case LYS_LEAFLIST:
-        *result = calloc(1, sizeof(struct lyd_node_leaf_list));
+        *result = lyd_node_alloc(ctx, schema->nodetype);
         havechildren = 0;
         break;
     case LYS_ANYXML:
-        *result = calloc(1, sizeof(struct lyd_node_anyxml));
+        *result = lyd_node_alloc(ctx, schema->nodetype);
         havechildren = 0;
         break;
     default:
@@ -332,7 +364,10 @@ xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, const struct lys_node
         }
         /* children are correct now */
 
+        /* the copy is not a sibling of anything, unlinking only corrects its namespaces */
         tmp_xml->parent = NULL;
+        tmp_xml->next = NULL;
+        tmp_xml->prev = tmp_xml;
         lyxml_unlink_elem(ctx, tmp_xml, 1);
         /* tmp_xml is correct now */
 
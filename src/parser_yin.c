@@ -898,6 +898,8 @@ fill_yin_type(struct lys_module *module, struct lys_node *parent, struct lyxml_e
                 type->info.uni.count = 0;
 
                 if (rc == EXIT_FAILURE) {
+                    /* not resolved yet, do not let anyone derive from the incomplete union */
+                    type->base = LY_TYPE_DER;
                     ret = EXIT_FAILURE;
                     goto error;
                 }
@@ -922,6 +924,11 @@ fill_yin_type(struct lys_module *module, struct lys_node *parent, struct lyxml_e
         goto error;
     }
 
+    /* flatten the effective type information for validating data */
+    if (lyp_ctype_build(type)) {
+        goto error;
+    }
+
     return EXIT_SUCCESS;
 
 error:
@@ -1871,6 +1878,7 @@ fill_yin_deviation(struct lys_module *module, struct lyxml_elem *yin, struct lys
                                 (*trg_must)[i].ref = (*trg_must)[*trg_must_size].ref;
                                 (*trg_must)[i].eapptag = (*trg_must)[*trg_must_size].eapptag;
                                 (*trg_must)[i].emsg = (*trg_must)[*trg_must_size].emsg;
+                                (*trg_must)[i].compiled = (*trg_must)[*trg_must_size].compiled;
                             }
                             if (!(*trg_must_size)) {
                                 free(*trg_must);
@@ -1881,6 +1889,7 @@ fill_yin_deviation(struct lys_module *module, struct lyxml_elem *yin, struct lys
                                 (*trg_must)[*trg_must_size].ref = NULL;
                                 (*trg_must)[*trg_must_size].eapptag = NULL;
                                 (*trg_must)[*trg_must_size].emsg = NULL;
+                                (*trg_must)[*trg_must_size].compiled = NULL;
                             }
 
                             i = -1; /* set match flag */
@@ -5443,6 +5452,9 @@ yin_read_module(struct ly_ctx *ctx, const char *data, int implement)
     ctx->models.used++;
     ctx->models.module_set_id++;
 
+    /* the module could have augmented or deviated any other module */
+    lys_cond_deps_add(module);
+
 success:
     /* cleanup */
     lyxml_free(ctx, yin);
@@ -318,6 +318,11 @@ lys_print_clb(ssize_t (*writeclb)(void *arg, const void *buf, size_t count), voi
 static int
 lyd_print_(struct lyout *out, const struct lyd_node *root, LYD_FORMAT format, int options)
 {
+    if (format == LYD_LYB) {
+        /* even an empty tree has its header */
+        return lyb_print_data(out, root, options);
+    }
+
     if (!root) {
         /* no data to print, but even empty tree is valid */
         if (out->type == LYOUT_MEMORY || out->type == LYOUT_CALLBACK) {
@@ -63,6 +63,7 @@ int info_print_model(struct lyout *out, const struct lys_module *module, const c
 
 int json_print_data(struct lyout *out, const struct lyd_node *root, int options);
 int xml_print_data(struct lyout *out, const struct lyd_node *root, int format, int options);
+int lyb_print_data(struct lyout *out, const struct lyd_node *root, int options);
 
 /* 0 - same, 1 - different */
 int nscmp(const struct lyd_node *node1, const struct lyd_node *node2);
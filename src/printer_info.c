@@ -202,6 +202,25 @@ info_print_must(struct lyout *out, const struct lys_restr *must, uint8_t must_si
     }
 }
 
+static void
+info_print_cond_deps(struct lyout *out, const struct lys_node *node)
+{
+    const struct lys_node *owner;
+    unsigned int i;
+
+    ly_print(out, "%-*s", INDENT_LEN, "Affects: ");
+
+    if (node->cond_deps && node->cond_deps->number) {
+        for (i = 0; i < node->cond_deps->number; ++i) {
+            owner = node->cond_deps->sset[i];
+            ly_print(out, "%*s%s \"%s:%s\"\n", (i ? INDENT_LEN : 0), "", strnodetype(owner->nodetype),
+                     lys_node_module(owner)->name, owner->name);
+        }
+    } else {
+        ly_print(out, "\n");
+    }
+}
+
 static void
 info_print_typedef(struct lyout *out, const struct lys_tpdf *tpdf, uint8_t tpdf_size)
 {
@@ -803,6 +822,7 @@ info_print_container(struct lyout *out, const struct lys_node *node)
     info_print_if_feature(out, cont->features, cont->features_size);
     info_print_when(out, cont->when);
     info_print_must(out, cont->must, cont->must_size);
+    info_print_cond_deps(out, node);
     info_print_typedef(out, cont->tpdf, cont->tpdf_size);
     info_print_nacmext(out, cont->nacm);
 
@@ -848,6 +868,7 @@ info_print_leaf(struct lyout *out, const struct lys_node *node)
     info_print_if_feature(out, leaf->features, leaf->features_size);
     info_print_when(out, leaf->when);
     info_print_must(out, leaf->must, leaf->must_size);
+    info_print_cond_deps(out, node);
     info_print_nacmext(out, leaf->nacm);
 }
 
@@ -867,6 +888,7 @@ info_print_leaflist(struct lyout *out, const struct lys_node *node)
     info_print_if_feature(out, llist->features, llist->features_size);
     info_print_when(out, llist->when);
     info_print_must(out, llist->must, llist->must_size);
+    info_print_cond_deps(out, node);
     info_print_nacmext(out, llist->nacm);
 }
 
@@ -884,6 +906,7 @@ info_print_list(struct lyout *out, const struct lys_node *node)
     info_print_if_feature(out, list->features, list->features_size);
     info_print_when(out, list->when);
     info_print_must(out, list->must, list->must_size);
+    info_print_cond_deps(out, node);
     info_print_keys(out, list->keys, list->keys_size);
     info_print_unique(out, list->unique, list->unique_size);
     info_print_typedef(out, list->tpdf, list->tpdf_size);
@@ -905,6 +928,7 @@ info_print_anyxml(struct lyout *out, const struct lys_node *node)
     info_print_if_feature(out, axml->features, axml->features_size);
     info_print_when(out, axml->when);
     info_print_must(out, axml->must, axml->must_size);
+    info_print_cond_deps(out, node);
     info_print_nacmext(out, axml->nacm);
 }
 
@@ -101,14 +101,21 @@ json_print_leaf(struct lyout *out, int level, const struct lyd_node *node, int o
         }
     }
 
+    if (leaf->value_type == LY_TYPE_DER) {
+        /* postponed parsing of a trusted value, the type is needed */
+        lyd_value_parse(leaf);
+    }
+
     switch (leaf->value_type & LY_DATA_TYPE_MASK) {
+    case LY_TYPE_DER:
+        /* unparsable trusted value, print it as it is */
     case LY_TYPE_BINARY:
     case LY_TYPE_STRING:
     case LY_TYPE_BITS:
     case LY_TYPE_ENUM:
     case LY_TYPE_IDENT:
     case LY_TYPE_INST:
-        json_print_string(out, leaf->value_str ? leaf->value_str : "");
+        json_print_string(out, lyd_value_str(leaf) ? lyd_value_str(leaf) : "");
         break;
 
     case LY_TYPE_BOOL:
@@ -121,14 +128,15 @@ json_print_leaf(struct lyout *out, int level, const struct lyd_node *node, int o
     case LY_TYPE_UINT16:
     case LY_TYPE_UINT32:
     case LY_TYPE_UINT64:
-        ly_print(out, "%s", leaf->value_str ? leaf->value_str : "null");
+        ly_print(out, "%s", lyd_value_str(leaf) ? lyd_value_str(leaf) : "null");
         break;
 
     case LY_TYPE_LEAFREF:
         if (leaf->value.leafref) {
             json_print_leaf(out, level, leaf->value.leafref, 1);
         } else {
-            ly_print(out, "");
+            /* unresolved reference */
+            json_print_string(out, leaf->value_str ? leaf->value_str : "");
         }
         break;
 
@@ -0,0 +1,375 @@
+/**
+ * @file printer_lyb.c
+ * @brief LYB (binary) printer for libyang data structure
+ *
+ * Copyright (c) 2015 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+#include "printer.h"
+#include "xml_internal.h"
+#include "tree_data.h"
+#include "tree_schema.h"
+#include "tree_internal.h"
+#include "dict_private.h"
+
+struct lyb_buf {
+    char *data;
+    size_t len;
+    size_t size;
+};
+
+struct lyb_print_state {
+    struct lyb_buf body;
+    const struct lys_node **sids;    /* schema nodes, the index + 1 is their ID */
+    uint32_t sid_count;
+    struct ly_ht sid_ht;             /* schema nodes hashed by their pointer, the values are their IDs */
+    const struct lys_module **mods;  /* modules, the index is their ID */
+    uint32_t mod_count;
+    int options;
+};
+
+static int
+lyb_write(struct lyb_buf *buf, const void *data, size_t len)
+{
+    char *new;
+    size_t size;
+
+    /* keep a place for the terminating zero needed by ly_write() */
+    if (buf->len + len + 1 > buf->size) {
+        for (size = buf->size ? buf->size : 1024; buf->len + len + 1 > size; size *= 2);
+        new = realloc(buf->data, size);
+        if (!new) {
+            LOGMEM;
+            return EXIT_FAILURE;
+        }
+        buf->data = new;
+        buf->size = size;
+    }
+
+    if (len) {
+        /* data may be NULL for an empty value */
+        memcpy(buf->data + buf->len, data, len);
+        buf->len += len;
+    }
+    buf->data[buf->len] = '\0';
+    return EXIT_SUCCESS;
+}
+
+/* unsigned LEB128 */
+static int
+lyb_write_num(struct lyb_buf *buf, uint64_t num)
+{
+    uint8_t bytes[10];
+    int len = 0;
+
+    do {
+        bytes[len] = num & 0x7f;
+        num >>= 7;
+        if (num) {
+            bytes[len] |= 0x80;
+        }
+        ++len;
+    } while (num);
+
+    return lyb_write(buf, bytes, len);
+}
+
+/* zigzag encoded, so that small negative numbers are short as well */
+static int
+lyb_write_snum(struct lyb_buf *buf, int64_t num)
+{
+    return lyb_write_num(buf, ((uint64_t)num << 1) ^ (uint64_t)(num >> 63));
+}
+
+static int
+lyb_write_str(struct lyb_buf *buf, const char *str)
+{
+    size_t len = str ? strlen(str) : 0;
+
+    if (lyb_write_num(buf, len)) {
+        return EXIT_FAILURE;
+    }
+    return lyb_write(buf, str, len);
+}
+
+static void
+lyb_write_len(char *dst, uint32_t len)
+{
+    int i;
+
+    for (i = 0; i < 4; ++i) {
+        dst[i] = (len >> (8 * i)) & 0xff;
+    }
+}
+
+static int
+lyb_print_module(struct lyb_print_state *st, const struct lys_module *module)
+{
+    const struct lys_module **new;
+    uint32_t i;
+
+    for (i = 0; i < st->mod_count; ++i) {
+        if (st->mods[i] == module) {
+            return lyb_write_num(&st->body, i);
+        }
+    }
+
+    new = realloc(st->mods, (st->mod_count + 1) * sizeof *st->mods);
+    if (!new) {
+        LOGMEM;
+        return EXIT_FAILURE;
+    }
+    st->mods = new;
+    st->mods[st->mod_count++] = module;
+
+    return lyb_write_num(&st->body, i);
+}
+
+/* schema node ID, the schema node is defined by its module and name on the first use */
+static int
+lyb_print_schema(struct lyb_print_state *st, const struct lys_node *schema)
+{
+    const struct lys_node **new;
+    uint32_t hash, iter = 0;
+    void *val;
+
+    hash = dict_hash((const char *)&schema, sizeof schema);
+    while ((val = ly_ht_find(&st->sid_ht, hash, &iter))) {
+        if (st->sids[(uintptr_t)val - 1] == schema) {
+            return lyb_write_num(&st->body, (uint64_t)(uintptr_t)val << 1);
+        }
+    }
+
+    new = realloc(st->sids, (st->sid_count + 1) * sizeof *st->sids);
+    if (!new) {
+        LOGMEM;
+        return EXIT_FAILURE;
+    }
+    st->sids = new;
+    st->sids[st->sid_count++] = schema;
+    if (ly_ht_insert(&st->sid_ht, hash, (void *)(uintptr_t)st->sid_count)) {
+        LOGMEM;
+        return EXIT_FAILURE;
+    }
+
+    if (lyb_write_num(&st->body, ((uint64_t)st->sid_count << 1) | 1)
+            || lyb_print_module(st, lys_node_module(schema))) {
+        return EXIT_FAILURE;
+    }
+    return lyb_write_str(&st->body, schema->name);
+}
+
+static int
+lyb_print_value(struct lyb_print_state *st, const struct lyd_node_leaf_list *leaf)
+{
+    struct lys_ctype *ctype = ((struct lys_node_leaf *)leaf->schema)->type.ctype;
+    uint8_t tag, bln;
+
+    if (leaf->value_type == LY_TYPE_DER) {
+        /* postponed parsing of a trusted value, the type is needed */
+        lyd_value_parse((struct lyd_node_leaf_list *)leaf);
+    }
+
+    if (!leaf->value_str) {
+        tag = LYB_VALUE_NONE;
+        return lyb_write(&st->body, &tag, 1);
+    } else if ((leaf->value_type == LY_TYPE_DER) || !lyd_value_str_droppable(leaf->schema)) {
+        /* not a value with a binary form (or an unparsable trusted one) */
+        tag = LYB_VALUE_STRING;
+        if (lyb_write(&st->body, &tag, 1)) {
+            return EXIT_FAILURE;
+        }
+        return lyb_write_str(&st->body, lyd_value_str(leaf));
+    }
+
+    tag = LYB_VALUE_NATIVE;
+    if (lyb_write(&st->body, &tag, 1)) {
+        return EXIT_FAILURE;
+    }
+    switch (leaf->value_type) {
+    case LY_TYPE_BOOL:
+        bln = leaf->value.bln ? 1 : 0;
+        return lyb_write(&st->body, &bln, 1);
+    case LY_TYPE_ENUM:
+        return lyb_write_num(&st->body, leaf->value.enm - ctype->info.enums.enm);
+    case LY_TYPE_DEC64:
+        return lyb_write_snum(&st->body, leaf->value.dec64);
+    case LY_TYPE_INT8:
+        return lyb_write_snum(&st->body, leaf->value.int8);
+    case LY_TYPE_INT16:
+        return lyb_write_snum(&st->body, leaf->value.int16);
+    case LY_TYPE_INT32:
+        return lyb_write_snum(&st->body, leaf->value.int32);
+    case LY_TYPE_INT64:
+        return lyb_write_snum(&st->body, leaf->value.int64);
+    case LY_TYPE_UINT8:
+        return lyb_write_num(&st->body, leaf->value.uint8);
+    case LY_TYPE_UINT16:
+        return lyb_write_num(&st->body, leaf->value.uint16);
+    case LY_TYPE_UINT32:
+        return lyb_write_num(&st->body, leaf->value.uint32);
+    case LY_TYPE_UINT64:
+        return lyb_write_num(&st->body, leaf->value.uint64);
+    default:
+        LOGINT;
+        return EXIT_FAILURE;
+    }
+}
+
+static int
+lyb_print_siblings(struct lyb_print_state *st, const struct lyd_node *first, int withsiblings);
+
+static int
+lyb_print_node(struct lyb_print_state *st, const struct lyd_node *node)
+{
+    struct lyd_attr *attr;
+    char *xml;
+    size_t start = 0;
+    uint32_t count;
+    int ret;
+
+    if (lyb_print_schema(st, node->schema)) {
+        return EXIT_FAILURE;
+    }
+    if (st->options & LYP_LYBSKIP) {
+        /* length placeholder */
+        if (lyb_write(&st->body, "\0\0\0\0", 4)) {
+            return EXIT_FAILURE;
+        }
+        start = st->body.len;
+    }
+
+    for (count = 0, attr = node->attr; attr; attr = attr->next, ++count);
+    if (lyb_write_num(&st->body, count)) {
+        return EXIT_FAILURE;
+    }
+    for (attr = node->attr; attr; attr = attr->next) {
+        if (lyb_print_module(st, attr->module) || lyb_write_str(&st->body, attr->name)
+                || lyb_write_str(&st->body, attr->value)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    switch (node->schema->nodetype) {
+    case LYS_LEAF:
+    case LYS_LEAFLIST:
+        ret = lyb_print_value(st, (struct lyd_node_leaf_list *)node);
+        break;
+    case LYS_ANYXML:
+        xml = NULL;
+        if (((struct lyd_node_anyxml *)node)->value) {
+            lyxml_print_mem(&xml, ((struct lyd_node_anyxml *)node)->value, 0);
+        }
+        ret = lyb_write_str(&st->body, xml);
+        free(xml);
+        break;
+    default:
+        ret = lyb_print_siblings(st, node->child, 1);
+        break;
+    }
+    if (ret) {
+        return EXIT_FAILURE;
+    }
+
+    if (st->options & LYP_LYBSKIP) {
+        if (st->body.len - start > UINT32_MAX) {
+            LOGERR(LY_EINVAL, "Data node \"%s\" too large for the LYB format.", node->schema->name);
+            return EXIT_FAILURE;
+        }
+        lyb_write_len(st->body.data + start - 4, st->body.len - start);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int
+lyb_print_siblings(struct lyb_print_state *st, const struct lyd_node *first, int withsiblings)
+{
+    const struct lyd_node *node;
+
+    LY_TREE_FOR(first, node) {
+        if (lyb_print_node(st, node)) {
+            return EXIT_FAILURE;
+        }
+        if (!withsiblings) {
+            break;
+        }
+    }
+
+    /* end of the siblings */
+    return lyb_write_num(&st->body, 0);
+}
+
+int
+lyb_print_data(struct lyout *out, const struct lyd_node *root, int options)
+{
+    struct lyb_print_state st;
+    struct lyb_buf head;
+    uint32_t i;
+    int ret = EXIT_FAILURE;
+
+    if (root && root->parent) {
+        LOGERR(LY_EINVAL, "Only top-level data nodes can be printed in the LYB format.");
+        return EXIT_FAILURE;
+    }
+
+    memset(&st, 0, sizeof st);
+    memset(&head, 0, sizeof head);
+    st.options = options;
+
+    if (lyb_print_siblings(&st, root, options & LYP_WITHSIBLINGS)) {
+        goto cleanup;
+    }
+
+    /* header and the table of the used modules */
+    if (lyb_write(&head, LYB_MAGIC, 3) || lyb_write(&head, "\0\0\0\0\0\0", LYB_HEADER_SIZE - 3)) {
+        goto cleanup;
+    }
+    head.data[3] = LYB_VERSION;
+    head.data[4] = (options & LYP_LYBSKIP) ? LYB_FLAG_LENGTHS : 0;
+    if (lyb_write_num(&head, st.mod_count)) {
+        goto cleanup;
+    }
+    for (i = 0; i < st.mod_count; ++i) {
+        if (lyb_write_str(&head, st.mods[i]->name)
+                || lyb_write_str(&head, st.mods[i]->rev_size ? st.mods[i]->rev[0].date : NULL)) {
+            goto cleanup;
+        }
+    }
+    if (head.len + st.body.len > UINT32_MAX) {
+        LOGERR(LY_EINVAL, "Data tree too large for the LYB format.");
+        goto cleanup;
+    }
+    lyb_write_len(head.data + 5, head.len + st.body.len);
+
+    if ((ly_write(out, head.data, head.len) < 0) || (ly_write(out, st.body.data, st.body.len) < 0)) {
+        goto cleanup;
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    free(head.data);
+    free(st.body.data);
+    free(st.sids);
+    free(st.mods);
+    ly_ht_clean(&st.sid_ht);
+    return ret;
+}
@@ -178,7 +178,14 @@ xml_print_leaf(struct lyout *out, int level, const struct lyd_node *node, int to
 
     xml_print_attrs(out, node);
 
+    if (leaf->value_type == LY_TYPE_DER) {
+        /* postponed parsing of a trusted value, the type is needed */
+        lyd_value_parse((struct lyd_node_leaf_list *)leaf);
+    }
+
     switch (leaf->value_type & LY_DATA_TYPE_MASK) {
+    case LY_TYPE_DER:
+        /* unparsable trusted value, print it as it is */
     case LY_TYPE_BINARY:
     case LY_TYPE_STRING:
     case LY_TYPE_BITS:
@@ -193,18 +200,18 @@ xml_print_leaf(struct lyout *out, int level, const struct lyd_node *node, int to
     case LY_TYPE_UINT16:
     case LY_TYPE_UINT32:
     case LY_TYPE_UINT64:
-        if (!leaf->value_str) {
+        if (!lyd_value_str(leaf)) {
             ly_print(out, "/>");
         } else {
             ly_print(out, ">");
-            lyxml_dump_text(out, leaf->value_str);
+            lyxml_dump_text(out, lyd_value_str(leaf));
             ly_print(out, "</%s>", node->schema->name);
         }
         break;
 
     case LY_TYPE_IDENT:
     case LY_TYPE_INST:
-        xml_expr = transform_json2xml(node->schema->module, ((struct lyd_node_leaf_list *)node)->value_str,
+        xml_expr = transform_json2xml(node->schema->module, lyd_value_str((struct lyd_node_leaf_list *)node),
                                       &prefs, &nss, &ns_count);
         if (!xml_expr) {
             /* error */
@@ -231,7 +238,10 @@ xml_print_leaf(struct lyout *out, int level, const struct lyd_node *node, int to
     case LY_TYPE_LEAFREF:
         ly_print(out, ">");
         if (leaf->value.leafref) {
-            lyxml_dump_text(out, ((struct lyd_node_leaf_list *)(leaf->value.leafref))->value_str);
+            lyxml_dump_text(out, lyd_value_str((struct lyd_node_leaf_list *)(leaf->value.leafref)));
+        } else if (leaf->value_str) {
+            /* unresolved reference */
+            lyxml_dump_text(out, leaf->value_str);
         }
         ly_print(out, "</%s>", node->schema->name);
         break;
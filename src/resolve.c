@@ -1614,6 +1614,107 @@ cleanup:
     return rc;
 }
 
+int
+resolve_len_ran_compile(struct lys_type *type, struct lys_type_intv **ret)
+{
+    struct len_ran_intv *intv = NULL, *tmp_intv;
+    struct lys_type_intv *cintv;
+    uint32_t count, i;
+    size_t size;
+
+    *ret = NULL;
+
+    switch (type->base) {
+    case LY_TYPE_BINARY:
+    case LY_TYPE_DEC64:
+    case LY_TYPE_INT8:
+    case LY_TYPE_INT16:
+    case LY_TYPE_INT32:
+    case LY_TYPE_INT64:
+    case LY_TYPE_UINT8:
+    case LY_TYPE_UINT16:
+    case LY_TYPE_UINT32:
+    case LY_TYPE_UINT64:
+    case LY_TYPE_STRING:
+        break;
+    default:
+        /* no length or range restriction possible */
+        return EXIT_SUCCESS;
+    }
+
+    /* get the effective restriction, it is the closest one in the chain of the derived types */
+    if (resolve_len_ran_interval(NULL, type, 1, &intv)) {
+        LOGINT;
+        return -1;
+    }
+    if (!intv) {
+        return EXIT_SUCCESS;
+    }
+
+    for (count = 0, tmp_intv = intv; tmp_intv; tmp_intv = tmp_intv->next, count++);
+
+    cintv = malloc(sizeof *cintv);
+    if (!cintv) {
+        LOGMEM;
+        goto error;
+    }
+    cintv->kind = intv->kind;
+    cintv->count = count;
+    if (cintv->kind == 0) {
+        size = sizeof *cintv->bound.uval;
+    } else if (cintv->kind == 1) {
+        size = sizeof *cintv->bound.sval;
+    } else {
+        size = sizeof *cintv->bound.fval;
+    }
+    cintv->bound.uval = malloc(2 * count * size);
+    if (!cintv->bound.uval) {
+        LOGMEM;
+        free(cintv);
+        goto error;
+    }
+
+    for (i = 0, tmp_intv = intv; tmp_intv; tmp_intv = tmp_intv->next, i++) {
+        if (cintv->kind == 0) {
+            cintv->bound.uval[2 * i] = tmp_intv->value.uval.min;
+            cintv->bound.uval[2 * i + 1] = tmp_intv->value.uval.max;
+        } else if (cintv->kind == 1) {
+            cintv->bound.sval[2 * i] = tmp_intv->value.sval.min;
+            cintv->bound.sval[2 * i + 1] = tmp_intv->value.sval.max;
+        } else {
+            cintv->bound.fval[2 * i] = tmp_intv->value.fval.min;
+            cintv->bound.fval[2 * i + 1] = tmp_intv->value.fval.max;
+        }
+    }
+    *ret = cintv;
+
+    while (intv) {
+        tmp_intv = intv->next;
+        free(intv);
+        intv = tmp_intv;
+    }
+    return EXIT_SUCCESS;
+
+error:
+    while (intv) {
+        tmp_intv = intv->next;
+        free(intv);
+        intv = tmp_intv;
+    }
+    return -1;
+}
+
+void
+resolve_len_ran_free(struct lys_type_intv *intv)
+{
+    if (!intv) {
+        return;
+    }
+
+    free(intv->bound.uval);
+    free(intv);
+}
+
 /**
  * @brief Resolve a typedef, return only resolved typedefs if derived. Does not log.
  *
@@ -1753,6 +1854,7 @@ check_default(struct lys_type *type, const char *value, int first, uint32_t line
     /* dummy leaf */
     node.value_str = value;
     node.value_type = type->base;
+    node.flags = 0;
     node.schema = calloc(1, sizeof (struct lys_node_leaf));
     if (!node.schema) {
         LOGMEM;
@@ -1781,7 +1883,7 @@ check_default(struct lys_type *type, const char *value, int first, uint32_t line
 
 finish:
     if (node.value_type == LY_TYPE_BITS) {
-        free(node.value.bit);
+        lyd_bits_free(&node.value, node.flags);
     }
     free((char *)node.schema->name);
     free(node.schema);
@@ -2228,8 +2330,8 @@ resolve_path_predicate_data(const char *pred, int first, uint32_t line,struct ly
                 goto remove_leafref;
             }
 
-            if (!ly_strequal(((struct lyd_node_leaf_list *)source_match.node[0])->value_str,
-                             ((struct lyd_node_leaf_list *)dest_match.node[0])->value_str, 1)) {
+            if (!ly_strequal(lyd_value_str((struct lyd_node_leaf_list *)source_match.node[0]),
+                             lyd_value_str((struct lyd_node_leaf_list *)dest_match.node[0]), 1)) {
                 goto remove_leafref;
             }
 
@@ -2339,6 +2441,15 @@ resolve_path_arg_data(struct lyd_node *node, const char *path, int first, uint32
             }
         }
 
+        if (!data) {
+            /* the data tree ends above the node (a copied subtree) */
+            if (!first) {
+                LOGVAL(LYE_NORESOLV, line, LY_VLOG_LYD, node, path);
+            }
+            rc = EXIT_FAILURE;
+            goto error;
+        }
+
         /* node identifier */
         if ((rc = resolve_data_node(prefix, pref_len, name, nam_len, data, ret))) {
             if ((rc == -1) || !first) {
@@ -2699,8 +2810,8 @@ resolve_predicate(const char *pred, struct unres_data *node_match)
                 }
             }
 
-            if ((value && (strncmp(((struct lyd_node_leaf_list *)target_match.node[0])->value_str, value, val_len)
-                    || ((struct lyd_node_leaf_list *)target_match.node[0])->value_str[val_len]))
+            if ((value && (strncmp(lyd_value_str((struct lyd_node_leaf_list *)target_match.node[0]), value, val_len)
+                    || lyd_value_str((struct lyd_node_leaf_list *)target_match.node[0])[val_len]))
                     || (!value && (idx != cur_idx))) {
                 goto remove_instid;
             }
@@ -3078,6 +3189,7 @@ resolve_uses(struct lys_node_uses *uses, struct unres_schema *unres, uint32_t li
                 must[j].ref = lydict_insert(ctx, rfn->must[i].ref, 0);
                 must[j].eapptag = lydict_insert(ctx, rfn->must[i].eapptag, 0);
                 must[j].emsg = lydict_insert(ctx, rfn->must[i].emsg, 0);
+                must[j].compiled = NULL;
             }
 
             *old_must = must;
@@ -3177,6 +3289,18 @@ matchfound:
             der->next = NULL;
             der->ident = ident;
 
+            /* and the hash table for resolving identityref values */
+            if (!base->der_ht) {
+                base->der_ht = calloc(1, sizeof *base->der_ht);
+                if (!base->der_ht) {
+                    LOGMEM;
+                    return EXIT_FAILURE;
+                }
+            }
+            if (ly_ht_insert(base->der_ht, dict_hash(ident->name, strlen(ident->name)), ident)) {
+                return EXIT_FAILURE;
+            }
+
             base = base->base;
         }
         *ret = ident->base;
@@ -3293,7 +3417,8 @@ resolve_identref(struct lys_ident *base, const char *ident_name, uint32_t line,
 {
     const char *mod_name, *name;
     int mod_name_len, rc;
-    struct lys_ident_der *der;
+    uint32_t hash, iter = 0;
+    struct lys_ident *der_ident;
 
     if (!base || !ident_name) {
         return NULL;
@@ -3310,12 +3435,15 @@ resolve_identref(struct lys_ident *base, const char *ident_name, uint32_t line,
         return base;
     }
 
-    for (der = base->der; der; der = der->next) {
-        if (!strcmp(der->ident->name, name) && (!mod_name
-                || (!strncmp(der->ident->module->name, mod_name, mod_name_len)
-                && !der->ident->module->name[mod_name_len]))) {
-            /* we have match */
-            return der->ident;
+    if (base->der_ht) {
+        hash = dict_hash(name, strlen(name));
+        while ((der_ident = ly_ht_find(base->der_ht, hash, &iter))) {
+            if (!strcmp(der_ident->name, name) && (!mod_name
+                    || (!strncmp(der_ident->module->name, mod_name, mod_name_len)
+                    && !der_ident->module->name[mod_name_len]))) {
+                /* we have match */
+                return der_ident;
+            }
         }
     }
 
@@ -3494,6 +3622,7 @@ resolve_must(struct lyd_node *node, int first, uint32_t line)
 {
     uint8_t i, must_size;
     struct lys_restr *must;
+    struct lyxp_expr *exp;
     struct lyxp_set set;
 
     assert(node);
@@ -3526,7 +3655,8 @@ resolve_must(struct lyd_node *node, int first, uint32_t line)
     }
 
     for (i = 0; i < must_size; ++i) {
-        if (lyxp_eval(must[i].expr, node, &set, 1, line)) {
+        exp = lyxp_compile_cached(&must[i].compiled, must[i].expr, line);
+        if (!exp || lyxp_eval_compiled(exp, node, &set, 1, line)) {
             return -1;
         }
 
@@ -3603,13 +3733,15 @@ resolve_when(struct lyd_node *node, int first, uint32_t line)
 {
     struct lyd_node *ctx_node = NULL;
     struct lys_node *parent;
+    struct lyxp_expr *exp;
     struct lyxp_set set;
 
     assert(node);
     memset(&set, 0, sizeof set);
 
     if (!(node->schema->nodetype & (LYS_NOTIF | LYS_RPC)) && (((struct lys_node_container *)node->schema)->when)) {
-        if (lyxp_eval(((struct lys_node_container *)node->schema)->when->cond, node, &set, 1, line)) {
+        exp = lyxp_compile_cached(&((struct lys_node_container *)node->schema)->when->compiled, ((struct lys_node_container *)node->schema)->when->cond, line);
+        if (!exp || lyxp_eval_compiled(exp, node, &set, 1, line)) {
             return -1;
         }
 
@@ -3636,7 +3768,8 @@ resolve_when(struct lyd_node *node, int first, uint32_t line)
                     return -1;
                 }
             }
-            if (lyxp_eval(((struct lys_node_uses *)parent)->when->cond, ctx_node, &set, 1, line)) {
+            exp = lyxp_compile_cached(&((struct lys_node_uses *)parent)->when->compiled, ((struct lys_node_uses *)parent)->when->cond, line);
+            if (!exp || lyxp_eval_compiled(exp, ctx_node, &set, 1, line)) {
                 return -1;
             }
 
@@ -3659,7 +3792,8 @@ check_augment:
                     return -1;
                 }
             }
-            if (lyxp_eval(((struct lys_node_augment *)parent->parent)->when->cond, ctx_node, &set, 1, line)) {
+            exp = lyxp_compile_cached(&((struct lys_node_augment *)parent->parent)->when->compiled, ((struct lys_node_augment *)parent->parent)->when->cond, line);
+            if (!exp || lyxp_eval_compiled(exp, ctx_node, &set, 1, line)) {
                 return -1;
             }
 
@@ -4151,7 +4285,7 @@ print_unres_data_item_fail(struct lyd_node *node, enum UNRES_ITEM type, uint32_t
         break;
     case UNRES_INSTID:
         LOGVRB("Instance-identifier \"%s\" could not be resolved, it will be attempted later%s.",
-               ((struct lyd_node_leaf_list *)node)->value_str, line_str);
+               lyd_value_str((struct lyd_node_leaf_list *)node), line_str);
         break;
     case UNRES_WHEN:
         LOGVRB("There was an unsatisfied when condition, evaluation will be attempted later%s.", line_str);
@@ -4182,6 +4316,7 @@ resolve_unres_data_item(struct lyd_node *node, enum UNRES_ITEM type, int first,
     int rc;
     struct lyd_node_leaf_list *leaf;
     struct lys_node_leaf *sleaf;
+    struct lys_type *stype;
     struct unres_data matches;
 
     memset(&matches, 0, sizeof matches);
@@ -4197,7 +4332,7 @@ resolve_unres_data_item(struct lyd_node *node, enum UNRES_ITEM type, int first,
 
         /* check that value matches */
         for (i = 0; i < matches.count; ++i) {
-            if (ly_strequal(leaf->value_str, ((struct lyd_node_leaf_list *)matches.node[i])->value_str, 1)) {
+            if (ly_strequal(lyd_value_str(leaf), lyd_value_str((struct lyd_node_leaf_list *)matches.node[i]), 1)) {
                 leaf->value.leafref = matches.node[i];
                 break;
             }
@@ -4217,13 +4352,24 @@ resolve_unres_data_item(struct lyd_node *node, enum UNRES_ITEM type, int first,
         break;
 
     case UNRES_INSTID:
-        assert(sleaf->type.base == LY_TYPE_INST);
+        assert((sleaf->type.base == LY_TYPE_INST) || (sleaf->type.base == LY_TYPE_UNION));
+        stype = &sleaf->type;
+        if (stype->base == LY_TYPE_UNION) {
+            /* the value matched the instance-identifier member type */
+            for (i = 0; (i < (unsigned)stype->ctype->info.uni.count) && (stype->ctype->info.uni.types[i]->base != LY_TYPE_INST);
+                 ++i);
+            if (i == (unsigned)stype->ctype->info.uni.count) {
+                LOGINT;
+                return -1;
+            }
+            stype = stype->ctype->info.uni.types[i];
+        }
         ly_errno = 0;
         leaf->value.instance = resolve_instid(node, leaf->value_str, line);
         if (!leaf->value.instance) {
             if (ly_errno) {
                 return -1;
-            } else if (sleaf->type.info.inst.req > -1) {
+            } else if (stype->info.inst.req > -1) {
                 if (!first) {
                     LOGVAL(LYE_SPEC, line, LY_VLOG_LYD, leaf, "There is no instance of \"%s\".", leaf->value_str);
                 }
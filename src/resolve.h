@@ -99,6 +99,23 @@ struct len_ran_intv {
     struct len_ran_intv *next;
 };
 
+/**
+ * @brief Precompiled effective length or range restriction of a type (::lys_ctype#intv).
+ *
+ * Intervals are sorted in ascending order and do not overlap, the i-th interval is stored
+ * as bound[2 * i] (min) and bound[2 * i + 1] (max) in the array matching the kind.
+ */
+struct lys_type_intv {
+    /* 0 - unsigned, 1 - signed, 2 - floating point */
+    uint8_t kind;
+    uint32_t count;
+    union {
+        uint64_t *uval;
+        int64_t *sval;
+        long double *fval;
+    } bound;
+};
+
 int parse_identifier(const char *id);
 
 struct lyd_node *resolve_data_descendant_schema_nodeid(const char *nodeid, struct lyd_node *start);
@@ -119,6 +136,20 @@ int resolve_json_absolute_schema_nodeid(const char *nodeid, struct ly_ctx *ctx,
 int resolve_len_ran_interval(const char *str_restr, struct lys_type *type, int superior_restr,
                              struct len_ran_intv **local_intv);
 
+/**
+ * @brief Precompile the effective length or range restriction of a type so that the data values
+ * can be checked without parsing the restriction strings. The type and all its superior types
+ * must be already resolved. Logs directly.
+ *
+ * @param[in] type Type to compile, types without length/range restriction are skipped.
+ * @param[out] ret Compiled restriction, NULL if there is none.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+int resolve_len_ran_compile(struct lys_type *type, struct lys_type_intv **ret);
+
+void resolve_len_ran_free(struct lys_type_intv *intv);
+
 int resolve_superior_type(const char *name, const char *prefix, const struct lys_module *module,
                           const struct lys_node *parent, struct lys_tpdf **ret);
 
@@ -33,6 +33,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 
 #include "libyang.h"
 #include "common.h"
@@ -45,8 +46,10 @@
 #include "validation.h"
 #include "xpath.h"
 
+/* size is the length of the buffer with the data, SIZE_MAX if not known */
 static struct lyd_node *
-lyd_parse_(struct ly_ctx *ctx, const struct lys_node *parent, const char *data, LYD_FORMAT format, int options)
+lyd_parse_(struct ly_ctx *ctx, const struct lys_node *parent, const char *data, size_t size, LYD_FORMAT format,
+           int options)
 {
     struct lyxml_elem *xml, *xmlnext;
     struct lyd_node *result = NULL;
@@ -76,6 +79,9 @@ lyd_parse_(struct ly_ctx *ctx, const struct lys_node *parent, const char *data,
     case LYD_JSON:
         result = lyd_parse_json(ctx, parent, data, options);
         break;
+    case LYD_LYB:
+        result = lyd_parse_lyb(ctx, parent, data, size, options, NULL);
+        break;
     default:
         /* error */
         return NULL;
@@ -89,7 +95,7 @@ lyd_parse_(struct ly_ctx *ctx, const struct lys_node *parent, const char *data,
 }
 
 static struct lyd_node *
-lyd_parse_data_(struct ly_ctx *ctx, const char *data, LYD_FORMAT format, int options, va_list ap)
+lyd_parse_data_(struct ly_ctx *ctx, const char *data, size_t size, LYD_FORMAT format, int options, va_list ap)
 {
     const struct lys_node *rpc = NULL;
 
@@ -106,7 +112,7 @@ lyd_parse_data_(struct ly_ctx *ctx, const char *data, LYD_FORMAT format, int opt
         }
     }
 
-    return lyd_parse_(ctx, rpc, data, format, options);
+    return lyd_parse_(ctx, rpc, data, size, format, options);
 }
 
 API struct lyd_node *
@@ -116,7 +122,7 @@ lyd_parse_mem(struct ly_ctx *ctx, const char *data, LYD_FORMAT format, int optio
     struct lyd_node *result;
 
     va_start(ap, options);
-    result = lyd_parse_data_(ctx, data, format, options, ap);
+    result = lyd_parse_data_(ctx, data, SIZE_MAX, format, options, ap);
     va_end(ap);
 
     return result;
@@ -147,7 +153,7 @@ lyd_parse_fd(struct ly_ctx *ctx, int fd, LYD_FORMAT format, int options, ...)
     }
 
     va_start(ap, options);
-    ret = lyd_parse_data_(ctx, data, format, options, ap);
+    ret = lyd_parse_data_(ctx, data, sb.st_size, format, options, ap);
 
     va_end(ap);
     munmap(data, sb.st_size);
@@ -192,6 +198,9 @@ lyd_new(struct lyd_node *parent, const struct lys_module *module, const char *na
         ly_errno = LY_EINVAL;
         return NULL;
     }
+    if (lyd_check_writable(parent, __func__)) {
+        return NULL;
+    }
 
     if (!parent) {
         siblings = module->data;
@@ -207,7 +216,7 @@ lyd_new(struct lyd_node *parent, const struct lys_module *module, const char *na
         return NULL;
     }
 
-    ret = calloc(1, sizeof *ret);
+    ret = lyd_node_alloc(snode->module->ctx, snode->nodetype);
     if (!ret) {
         LOGMEM;
         return NULL;
@@ -230,7 +239,7 @@ lyd_create_leaf(const struct lys_node *schema, const char *val_str)
 {
     struct lyd_node_leaf_list *ret;
 
-    ret = calloc(1, sizeof *ret);
+    ret = lyd_node_alloc(schema->module->ctx, schema->nodetype);
     if (!ret) {
         LOGMEM;
         return NULL;
@@ -261,6 +270,9 @@ lyd_new_leaf(struct lyd_node *parent, const struct lys_module *module, const cha
         ly_errno = LY_EINVAL;
         return NULL;
     }
+    if (lyd_check_writable(parent, __func__)) {
+        return NULL;
+    }
 
     if (!parent) {
         siblings = module->data;
@@ -304,30 +316,52 @@ lyd_new_leaf(struct lyd_node *parent, const struct lys_module *module, const cha
 
 }
 
-int
+API int
 lyd_change_leaf(struct lyd_node_leaf_list *leaf, const char *val_str)
 {
     const char *backup;
+    lyd_val backup_val;
+    LY_DATA_TYPE backup_type;
+    uint8_t backup_flags;
     struct lyd_node *parent;
 
     if (!leaf) {
         ly_errno = LY_EINVAL;
         return EXIT_FAILURE;
     }
+    if (lyd_check_writable((struct lyd_node *)leaf, __func__)) {
+        return EXIT_FAILURE;
+    }
 
     backup = leaf->value_str;
+    backup_val = leaf->value;
+    backup_type = leaf->value_type;
+    backup_flags = leaf->flags;
     leaf->value_str = val_str;
 
     /* resolve the type correctly */
     if (lyp_parse_value(leaf, NULL, 1, NULL, 0)) {
         leaf->value_str = backup;
+        leaf->value = backup_val;
+        leaf->value_type = backup_type;
+        leaf->flags = backup_flags;
         ly_errno = LY_EINVAL;
         return EXIT_FAILURE;
     }
 
     /* value is correct, finish the changes in leaf */
+    if (backup_type == LY_TYPE_BITS) {
+        lyd_bits_free(&backup_val, backup_flags);
+    }
     lydict_remove(leaf->schema->module->ctx, backup);
     leaf->value_str = lydict_insert(leaf->schema->module->ctx, val_str, 0);
+    if (leaf->value_type == LY_TYPE_STRING) {
+        leaf->value.string = leaf->value_str;
+    } else if (leaf->value_type == LY_TYPE_BINARY) {
+        leaf->value.binary = leaf->value_str;
+    }
+    lyd_hash_invalidate((struct lyd_node *)leaf);
+    leaf->validity = LYD_VAL_NOT;
 
     if (leaf->schema->flags & LYS_UNIQUE) {
         /* locate the first parent list */
@@ -342,6 +376,504 @@ lyd_change_leaf(struct lyd_node_leaf_list *leaf, const char *val_str)
     return EXIT_SUCCESS;
 }
 
+const char lyd_value_str_lazy[] = "";
+
+int
+lyd_value_str_droppable(const struct lys_node *schema)
+{
+    switch (((struct lys_node_leaf *)schema)->type.base) {
+    case LY_TYPE_BOOL:
+    case LY_TYPE_DEC64:
+    case LY_TYPE_ENUM:
+    case LY_TYPE_INT8:
+    case LY_TYPE_UINT8:
+    case LY_TYPE_INT16:
+    case LY_TYPE_UINT16:
+    case LY_TYPE_INT32:
+    case LY_TYPE_UINT32:
+    case LY_TYPE_INT64:
+    case LY_TYPE_UINT64:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+int
+lyd_value_str_drop(struct lyd_node_leaf_list *leaf)
+{
+    if (!leaf->value_str || (leaf->value_str == lyd_value_str_lazy) || !lyd_value_str_droppable(leaf->schema)) {
+        return 0;
+    }
+
+    lydict_remove(leaf->schema->module->ctx, leaf->value_str);
+    leaf->value_str = lyd_value_str_lazy;
+    return 1;
+}
+
+API const char *
+lyd_value_str(const struct lyd_node_leaf_list *leaf)
+{
+    struct lyd_node_leaf_list *cache;
+    struct ly_ctx *ctx;
+    char buf[32];
+    const char *str = buf, *cur;
+    uint64_t div, num;
+    int dig, len, i;
+
+    if (!leaf) {
+        ly_errno = LY_EINVAL;
+        return NULL;
+    }
+    cur = __sync_fetch_and_add((const char **)&leaf->value_str, 0);
+    if (cur != lyd_value_str_lazy) {
+        return cur;
+    }
+
+    ctx = leaf->schema->module->ctx;
+    switch (leaf->value_type) {
+    case LY_TYPE_BOOL:
+        str = leaf->value.bln ? "true" : "false";
+        break;
+    case LY_TYPE_ENUM:
+        str = leaf->value.enm->name;
+        break;
+    case LY_TYPE_DEC64:
+        dig = ((struct lys_node_leaf *)leaf->schema)->type.ctype->dig;
+        for (div = 1, i = 0; i < dig; ++i) {
+            div *= 10;
+        }
+        num = (leaf->value.dec64 < 0) ? (uint64_t)0 - (uint64_t)leaf->value.dec64 : (uint64_t)leaf->value.dec64;
+        len = snprintf(buf, sizeof buf, "%s%" PRIu64 ".%0*" PRIu64, (leaf->value.dec64 < 0) ? "-" : "", num / div, dig, num % div);
+        /* canonical form, no trailing zeros except the first fraction digit */
+        while ((buf[len - 1] == '0') && (buf[len - 2] != '.')) {
+            buf[--len] = '\0';
+        }
+        break;
+    case LY_TYPE_INT8:
+        sprintf(buf, "%" PRId8, leaf->value.int8);
+        break;
+    case LY_TYPE_INT16:
+        sprintf(buf, "%" PRId16, leaf->value.int16);
+        break;
+    case LY_TYPE_INT32:
+        sprintf(buf, "%" PRId32, leaf->value.int32);
+        break;
+    case LY_TYPE_INT64:
+        sprintf(buf, "%" PRId64, leaf->value.int64);
+        break;
+    case LY_TYPE_UINT8:
+        sprintf(buf, "%" PRIu8, leaf->value.uint8);
+        break;
+    case LY_TYPE_UINT16:
+        sprintf(buf, "%" PRIu16, leaf->value.uint16);
+        break;
+    case LY_TYPE_UINT32:
+        sprintf(buf, "%" PRIu32, leaf->value.uint32);
+        break;
+    case LY_TYPE_UINT64:
+        sprintf(buf, "%" PRIu64, leaf->value.uint64);
+        break;
+    default:
+        LOGINT;
+        return NULL;
+    }
+
+    /* cache it, the node is logically not modified, but other threads may be reading (caching) it as well */
+    cache = (struct lyd_node_leaf_list *)leaf;
+    str = lydict_insert(ctx, str, 0);
+    if (!__sync_bool_compare_and_swap(&cache->value_str, lyd_value_str_lazy, str)) {
+        /* cached by someone else meanwhile */
+        lydict_remove(ctx, str);
+    }
+    return cache->value_str;
+}
+
+API int
+lyd_value_parse(struct lyd_node_leaf_list *leaf)
+{
+    if (!leaf || !(leaf->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST))) {
+        ly_errno = LY_EINVAL;
+        return EXIT_FAILURE;
+    }
+    if (leaf->value_type != LY_TYPE_DER) {
+        /* already parsed */
+        return EXIT_SUCCESS;
+    }
+
+    /* will be changed in case of union */
+    leaf->value_type = ((struct lys_node_leaf *)leaf->schema)->type.base;
+    if (lyp_parse_value(leaf, NULL, 1, NULL, 0)) {
+        leaf->value_type = LY_TYPE_DER;
+        memset(&leaf->value, 0, sizeof leaf->value);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* bitmaps of at most this many bits are stored directly in the value */
+#define LYD_BITS_INLINE_MAX 64
+
+int
+lyd_bits_init(struct lyd_node_leaf_list *leaf, uint32_t count)
+{
+    uint32_t words;
+
+    if (count <= LYD_BITS_INLINE_MAX) {
+        leaf->value.bits = 0;
+        leaf->flags &= ~LYD_NODE_BITS_EXT;
+        return EXIT_SUCCESS;
+    }
+
+    /* the first item holds the number of the following bitmap items */
+    words = (count + 63) / 64;
+    leaf->value.bits_ext = calloc(words + 1, sizeof *leaf->value.bits_ext);
+    if (!leaf->value.bits_ext) {
+        LOGMEM;
+        return -1;
+    }
+    leaf->value.bits_ext[0] = words;
+    leaf->flags |= LYD_NODE_BITS_EXT;
+
+    return EXIT_SUCCESS;
+}
+
+void
+lyd_bits_set(struct lyd_node_leaf_list *leaf, uint32_t idx)
+{
+    if (!(leaf->flags & LYD_NODE_BITS_EXT)) {
+        assert(idx < LYD_BITS_INLINE_MAX);
+        leaf->value.bits |= (uint64_t)1 << idx;
+    } else {
+        assert(idx / 64 < leaf->value.bits_ext[0]);
+        leaf->value.bits_ext[1 + idx / 64] |= (uint64_t)1 << (idx % 64);
+    }
+}
+
+API int
+lyd_bits_isset(const struct lyd_node_leaf_list *leaf, uint32_t idx)
+{
+    if (!leaf || (leaf->value_type != LY_TYPE_BITS)) {
+        ly_errno = LY_EINVAL;
+        return 0;
+    }
+
+    if (!(leaf->flags & LYD_NODE_BITS_EXT)) {
+        if (idx >= LYD_BITS_INLINE_MAX) {
+            return 0;
+        }
+        return (leaf->value.bits >> idx) & 1;
+    }
+
+    if (idx / 64 >= leaf->value.bits_ext[0]) {
+        return 0;
+    }
+    return (leaf->value.bits_ext[1 + idx / 64] >> (idx % 64)) & 1;
+}
+
+int
+lyd_bits_dup(struct lyd_node_leaf_list *new, const struct lyd_node_leaf_list *old)
+{
+    size_t size;
+
+    if (!(old->flags & LYD_NODE_BITS_EXT)) {
+        new->value = old->value;
+        new->flags &= ~LYD_NODE_BITS_EXT;
+        return EXIT_SUCCESS;
+    }
+
+    size = (old->value.bits_ext[0] + 1) * sizeof *old->value.bits_ext;
+    new->value.bits_ext = malloc(size);
+    if (!new->value.bits_ext) {
+        LOGMEM;
+        return -1;
+    }
+    memcpy(new->value.bits_ext, old->value.bits_ext, size);
+    new->flags |= LYD_NODE_BITS_EXT;
+
+    return EXIT_SUCCESS;
+}
+
+void
+lyd_bits_free(lyd_val *value, uint8_t flags)
+{
+    if (flags & LYD_NODE_BITS_EXT) {
+        free(value->bits_ext);
+    }
+    memset(value, 0, sizeof *value);
+}
+
+#ifdef LY_DATA_POOL
+
+/* number of nodes allocated at once */
+#define LYD_POOL_BLOCK_NODES 64
+
+/* sizes of the pool node classes, inner nodes (anyxml is of the same size) and leaves */
+static const size_t lyd_pool_node_size[2] = {
+    sizeof(union { struct lyd_node node; struct lyd_node_anyxml axml; }),
+    sizeof(struct lyd_node_leaf_list)
+};
+
+void
+lyd_pool_init(struct lyd_pool *pool)
+{
+    memset(pool, 0, sizeof *pool);
+    pthread_mutex_init(&pool->lock, NULL);
+}
+
+void
+lyd_pool_clean(struct lyd_pool *pool)
+{
+    void *block;
+
+    while (pool->blocks) {
+        block = pool->blocks;
+        pool->blocks = *(void **)block;
+        free(block);
+    }
+    pthread_mutex_destroy(&pool->lock);
+}
+
+#endif
+
+/* alignment and the maximal size of the node blocks of lyd_dup(), the block of a node is found by masking its address */
+#define LYD_BLOCK_SIZE 65536
+
+/* smaller subtrees are duplicated into separately allocated nodes */
+#define LYD_BLOCK_MIN_NODES 8
+
+/* header of a node block, the nodes follow */
+struct lyd_block {
+    uint32_t refcount;               /* number of nodes not released yet (+ 1 while being filled) */
+    uint32_t padding;
+};
+
+/* state of the node block allocation of a duplicated subtree */
+struct lyd_dup_blocks {
+    struct lyd_block *cur;           /* block being filled */
+    char *next;                      /* free space in the block */
+    char *end;                       /* end of the block */
+    size_t remaining;                /* size of the nodes not allocated yet, 0 to allocate them separately */
+};
+
+static size_t
+lyd_node_size(LYS_NODE nodetype)
+{
+    if (nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
+        return sizeof(struct lyd_node_leaf_list);
+    } else if (nodetype == LYS_ANYXML) {
+        return sizeof(struct lyd_node_anyxml);
+    }
+    return sizeof(struct lyd_node);
+}
+
+static struct lyd_block *
+lyd_block_of(struct lyd_node *node)
+{
+    return (struct lyd_block *)((uintptr_t)node & ~(uintptr_t)(LYD_BLOCK_SIZE - 1));
+}
+
+static void
+lyd_block_unref(struct lyd_block *block)
+{
+    if (block && !__sync_sub_and_fetch(&block->refcount, 1)) {
+        free(block);
+    }
+}
+
+static void *
+lyd_block_alloc(struct lyd_dup_blocks *blocks, LYS_NODE nodetype)
+{
+    struct lyd_node *node;
+    size_t size, block_size;
+    void *block;
+
+    size = lyd_node_size(nodetype);
+    if (!blocks->cur || ((size_t)(blocks->end - blocks->next) < size)) {
+        /* a new block for the rest of the nodes, as much of them as fits */
+        block_size = sizeof(struct lyd_block) + blocks->remaining;
+        if (block_size > LYD_BLOCK_SIZE) {
+            block_size = LYD_BLOCK_SIZE;
+        }
+        if (posix_memalign(&block, LYD_BLOCK_SIZE, block_size)) {
+            return NULL;
+        }
+        lyd_block_unref(blocks->cur);
+        blocks->cur = block;
+        blocks->cur->refcount = 1;
+        blocks->next = (char *)block + sizeof(struct lyd_block);
+        blocks->end = (char *)block + block_size;
+    }
+
+    node = (struct lyd_node *)blocks->next;
+    blocks->next += size;
+    blocks->remaining -= size;
+    ++blocks->cur->refcount;
+
+    memset(node, 0, size);
+    node->flags = LYD_NODE_BLOCK;
+    return node;
+}
+
+/* size of all the nodes of a subtree, 0 if it is too small to use a node block */
+static size_t
+lyd_dup_size(const struct lyd_node *node)
+{
+    const struct lyd_node *next, *elem;
+    size_t size = 0, count = 0;
+
+    LY_TREE_DFS_BEGIN(node, next, elem) {
+        size += lyd_node_size(elem->schema->nodetype);
+        ++count;
+        LY_TREE_DFS_END(node, next, elem);
+    }
+
+    return (count < LYD_BLOCK_MIN_NODES) ? 0 : size;
+}
+
+void *
+lyd_node_alloc(struct ly_ctx *ctx, LYS_NODE nodetype)
+{
+#ifdef LY_DATA_POOL
+    struct lyd_pool *pool = &ctx->data_pool;
+    char *block;
+    void *node;
+    size_t size;
+    int class, i;
+
+    class = (nodetype & (LYS_LEAF | LYS_LEAFLIST)) ? 1 : 0;
+    size = lyd_pool_node_size[class];
+
+    pthread_mutex_lock(&pool->lock);
+
+    if (!pool->free[class]) {
+        /* the first item links the blocks, the nodes follow */
+        block = malloc(sizeof(void *) + LYD_POOL_BLOCK_NODES * size);
+        if (!block) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        *(void **)block = pool->blocks;
+        pool->blocks = block;
+
+        /* free nodes are linked through their first item */
+        block += sizeof(void *);
+        for (i = 0; i < LYD_POOL_BLOCK_NODES - 1; ++i) {
+            *(void **)(block + i * size) = block + (i + 1) * size;
+        }
+        *(void **)(block + i * size) = NULL;
+        pool->free[class] = block;
+    }
+
+    node = pool->free[class];
+    pool->free[class] = *(void **)node;
+
+    pthread_mutex_unlock(&pool->lock);
+
+    memset(node, 0, size);
+    return node;
+#else
+    (void)ctx;
+
+    if (nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
+        return calloc(1, sizeof(struct lyd_node_leaf_list));
+    } else if (nodetype == LYS_ANYXML) {
+        return calloc(1, sizeof(struct lyd_node_anyxml));
+    }
+    return calloc(1, sizeof(struct lyd_node));
+#endif
+}
+
+void
+lyd_node_release(struct ly_ctx *ctx, struct lyd_node *node)
+{
+#ifdef LY_DATA_POOL
+    struct lyd_pool *pool = &ctx->data_pool;
+    int class;
+#endif
+
+    if (!node || (node->flags & LYD_NODE_ARENA)) {
+        /* arena nodes are freed all at once with the arena */
+        return;
+    } else if (node->flags & LYD_NODE_BLOCK) {
+        lyd_block_unref(lyd_block_of(node));
+        return;
+    }
+
+#ifdef LY_DATA_POOL
+    class = (node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) ? 1 : 0;
+
+    pthread_mutex_lock(&pool->lock);
+    *(void **)node = pool->free[class];
+    pool->free[class] = node;
+    pthread_mutex_unlock(&pool->lock);
+#else
+    (void)ctx;
+
+    free(node);
+#endif
+}
+
+void *
+lyd_arena_alloc(struct lyd_arena *arena, LYS_NODE nodetype)
+{
+    struct lyd_node *node;
+    char *block;
+    size_t size;
+
+    /* keep the nodes aligned */
+    size = (lyd_node_size(nodetype) + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if ((size_t)(arena->end - arena->next) < size) {
+        if (arena->block_size < 4096) {
+            arena->block_size = 4096;
+        }
+
+        /* the first item links the blocks, the nodes follow */
+        block = malloc(sizeof(void *) + arena->block_size);
+        if (!block) {
+            return NULL;
+        }
+        *(void **)block = arena->blocks;
+        arena->blocks = block;
+        arena->next = block + sizeof(void *);
+        arena->end = arena->next + arena->block_size;
+        arena->block_size *= 2;
+    }
+
+    node = (struct lyd_node *)arena->next;
+    arena->next += size;
+
+    memset(node, 0, size);
+    node->flags = LYD_NODE_ARENA;
+    return node;
+}
+
+void
+lyd_arena_clean(struct lyd_arena *arena)
+{
+    void *block;
+
+    while (arena->blocks) {
+        block = arena->blocks;
+        arena->blocks = *(void **)block;
+        free(block);
+    }
+    arena->next = arena->end = NULL;
+}
+
+int
+lyd_check_writable(const struct lyd_node *node, const char *func)
+{
+    if (node && (node->flags & LYD_NODE_RDONLY)) {
+        LOGERR(LY_EINVAL, "%s: The data tree is read-only.", func);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 static struct lyd_node *
 lyd_create_anyxml(const struct lys_node *schema, const char *val_xml)
 {
@@ -349,7 +881,7 @@ lyd_create_anyxml(const struct lys_node *schema, const char *val_xml)
     struct lyxml_elem *root;
     char *xml;
 
-    ret = calloc(1, sizeof *ret);
+    ret = lyd_node_alloc(schema->module->ctx, schema->nodetype);
     if (!ret) {
         LOGMEM;
         return NULL;
@@ -385,6 +917,9 @@ lyd_new_anyxml(struct lyd_node *parent, const struct lys_module *module, const c
         ly_errno = LY_EINVAL;
         return NULL;
     }
+    if (lyd_check_writable(parent, __func__)) {
+        return NULL;
+    }
 
     if (!parent) {
         siblings = module->data;
@@ -426,7 +961,7 @@ lyd_output_new(const struct lys_node *schema)
         return NULL;
     }
 
-    ret = calloc(1, sizeof *ret);
+    ret = lyd_node_alloc(schema->module->ctx, schema->nodetype);
     if (!ret) {
         LOGMEM;
         return NULL;
@@ -536,6 +1071,9 @@ lyd_insert(struct lyd_node *parent, struct lyd_node *node)
         ly_errno = LY_EINVAL;
         return EXIT_FAILURE;
     }
+    if (lyd_check_writable(parent, __func__) || lyd_check_writable(node, __func__)) {
+        return EXIT_FAILURE;
+    }
 
     /* check placing the node to the appropriate place according to the schema */
     for (sparent = lys_parent(node->schema);
@@ -572,6 +1110,7 @@ lyd_insert(struct lyd_node *parent, struct lyd_node *node)
             lyd_insert_setinvalid(iter);
         }
     }
+    lyd_hash_invalidate(parent);
 
     return EXIT_SUCCESS;
 }
@@ -586,6 +1125,9 @@ lyd_insert_sibling(struct lyd_node *sibling, struct lyd_node *node, int before)
     if (sibling == node) {
         return EXIT_SUCCESS;
     }
+    if (lyd_check_writable(sibling, __func__) || lyd_check_writable(node, __func__)) {
+        return EXIT_FAILURE;
+    }
 
     /* check placing the node to the appropriate place according to the schema */
     for (par1 = lys_parent(sibling->schema);
@@ -657,6 +1199,7 @@ lyd_insert_sibling(struct lyd_node *sibling, struct lyd_node *node, int before)
         sibling->next = node;
         node->prev = sibling;
     }
+    lyd_hash_invalidate(node->parent);
 
     return EXIT_SUCCESS;
 }
@@ -683,45 +1226,223 @@ lyd_insert_after(struct lyd_node *sibling, struct lyd_node *node)
     return EXIT_SUCCESS;
 }
 
-API int
-lyd_validate(struct lyd_node *node, int options, ...)
+static uint32_t
+lyd_validate_snode_hash(const struct lys_node *snode)
 {
-    struct lyd_node *root, *next1, *next2, *iter, *to_free = NULL;
-    const struct lys_node *schema;
-    struct ly_ctx *ctx;
-    int i;
-    va_list ap;
+    return dict_hash((const char *)&snode, sizeof snode);
+}
 
-    ly_errno = 0;
+static int
+lyd_validate_snode_find(const struct ly_ht *ht, const struct lys_node *snode)
+{
+    void *val;
+    uint32_t iter = 0;
 
-    if (!node) {
-        /* TODO what about LYD_OPT_NOTIF, LYD_OPT_RPC and LYD_OPT_RPCREPLY ? */
-        if (options & (LYD_OPT_FILTER | LYD_OPT_EDIT | LYD_OPT_GET | LYD_OPT_GETCONFIG)) {
-            return EXIT_SUCCESS;
+    while ((val = ly_ht_find(ht, lyd_validate_snode_hash(snode), &iter))) {
+        if (val == snode) {
+            return 1;
         }
-        /* LYD_OPT_DATA || LYD_OPT_CONFIG */
+    }
 
-        /* get context with schemas from the variable arguments */
-        va_start(ap, options);
-        ctx = va_arg(ap,  struct ly_ctx*);
-        if (!ctx) {
-            LOGERR(LY_EINVAL, "%s: Invalid variable argument.", __func__);
-            va_end(ap);
-            return EXIT_FAILURE;
-        }
+    return 0;
+}
 
-        /* check for missing mandatory elements according to schemas in context */
-        for (i = 0; i < ctx->models.used; i++) {
-            if (!ctx->models.list[i]->data) {
-                continue;
-            }
-            schema = ly_check_mandatory(NULL, ctx->models.list[i]->data);
-            if (schema) {
-                if (schema->nodetype & (LYS_LIST | LYS_LEAFLIST)) {
-                    LOGVAL(LYE_SPEC, 0, LY_VLOG_LYS, schema,
-                           "Number of \"%s\" instances in \"%s\" does not follow min-elements constraint.",
-                           schema->name, schema->parent ? schema->parent->name : ctx->models.list[i]->name);
-                } else {
+/**
+ * @brief Add a schema node into a set of schema nodes.
+ *
+ * @param[in] ht Hash table used as the set.
+ * @param[in] snode Schema node to add.
+ * @return 1 if added, 0 if it already was in the set, -1 on error.
+ */
+static int
+lyd_validate_snode_add(struct ly_ht *ht, const struct lys_node *snode)
+{
+    if (lyd_validate_snode_find(ht, snode)) {
+        return 0;
+    }
+    if (ly_ht_insert(ht, lyd_validate_snode_hash(snode), (void *)snode)) {
+        return -1;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Add a schema node with all its descendants into the set of changed schema nodes.
+ *
+ * @param[in] changed Set of the changed schema nodes.
+ * @param[in] snode Schema node to add.
+ * @return EXIT_SUCCESS or -1 on error.
+ */
+static int
+lyd_validate_changed_subtree(struct ly_ht *changed, const struct lys_node *snode)
+{
+    const struct lys_node *iter;
+    int r;
+
+    r = lyd_validate_snode_add(changed, snode);
+    if (r < 1) {
+        /* error or already added together with its subtree */
+        return r;
+    }
+    if (snode->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML)) {
+        return EXIT_SUCCESS;
+    }
+
+    LY_TREE_FOR(snode->child, iter) {
+        if ((iter->nodetype != LYS_GROUPING) && lyd_validate_changed_subtree(changed, iter)) {
+            return -1;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Get all the schema nodes whose when or must conditions can be affected by the
+ * changes in the data trees since their last validation (#LYD_OPT_CHANGED).
+ *
+ * @param[in] node First data tree to process.
+ * @param[in] options Validation options, only #LYD_OPT_NOSIBLINGS is taken into account.
+ * @param[out] affected Set of the schema nodes whose conditions must be evaluated.
+ * @return EXIT_SUCCESS or -1 on error.
+ */
+static int
+lyd_validate_affected(struct lyd_node *node, int options, struct ly_ht *affected)
+{
+    struct ly_ht changed;
+    struct ly_ctx *ctx = node->schema->module->ctx;
+    struct lyd_node *root, *next, *iter;
+    struct lys_node *snode;
+    struct ly_set *deps;
+    unsigned int i, j;
+    int ret = -1;
+
+    memset(&changed, 0, sizeof changed);
+
+    /* all the changed (or new) data nodes, the whole schema subtree of a changed inner node is considered
+     * changed since some of its children could have been removed */
+    LY_TREE_FOR(node, root) {
+        LY_TREE_DFS_BEGIN(root, next, iter) {
+            if ((iter->validity == LYD_VAL_NOT) && lyd_validate_changed_subtree(&changed, iter->schema)) {
+                goto cleanup;
+            }
+            LY_TREE_DFS_END(root, next, iter)
+        }
+        if (options & LYD_OPT_NOSIBLINGS) {
+            break;
+        }
+    }
+
+    /* conditions depending on the changed nodes */
+    for (i = 0; i < changed.size; i++) {
+        snode = changed.recs[i].val;
+        if (!snode || !(deps = snode->cond_deps)) {
+            continue;
+        }
+        for (j = 0; j < deps->number; j++) {
+            if (lyd_validate_snode_add(affected, deps->sset[j]) == -1) {
+                goto cleanup;
+            }
+        }
+    }
+
+    /* conditions with unknown dependencies */
+    for (i = 0; i < ctx->cond_imprecise.number; i++) {
+        if (lyd_validate_snode_add(affected, ctx->cond_imprecise.sset[i]) == -1) {
+            goto cleanup;
+        }
+    }
+
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    ly_ht_clean(&changed);
+    return ret;
+}
+
+/**
+ * @brief Get the validation options skipping the conditions of a previously validated node
+ * which are not affected by the changes (#LYD_OPT_CHANGED).
+ *
+ * @param[in] node Previously validated data node.
+ * @param[in] affected Set of the schema nodes whose conditions must be evaluated.
+ * @return Internal validation options (#LYV_OPT_NOWHEN, #LYV_OPT_NOMUST).
+ */
+static int
+lyd_validate_skip(const struct lyd_node *node, const struct ly_ht *affected)
+{
+    const struct lys_node *parent;
+    int skip = LYV_OPT_NOWHEN | LYV_OPT_NOMUST;
+
+    if (lyd_validate_snode_find(affected, node->schema)) {
+        return 0;
+    }
+
+    /* the same when conditions as checked by resolve_when() */
+    for (parent = node->schema; parent; ) {
+        if (parent->parent && (parent->parent->nodetype == LYS_AUGMENT)
+                && lyd_validate_snode_find(affected, parent->parent)) {
+            skip &= ~LYV_OPT_NOWHEN;
+            break;
+        }
+        parent = lys_parent(parent);
+        if (!parent || !(parent->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE))) {
+            break;
+        }
+        if (lyd_validate_snode_find(affected, parent)) {
+            skip &= ~LYV_OPT_NOWHEN;
+            break;
+        }
+    }
+
+    return skip;
+}
+
+API int
+lyd_validate(struct lyd_node *node, int options, ...)
+{
+    struct lyd_node *root, *next1, *next2, *iter, *to_free = NULL;
+    const struct lys_node *schema;
+    struct ly_ctx *ctx;
+    struct ly_ht affected;
+    int i, vopts, ret = EXIT_FAILURE;
+    va_list ap;
+
+    ly_errno = 0;
+
+    if (lyd_check_writable(node, __func__)) {
+        return EXIT_FAILURE;
+    }
+
+    if (!node) {
+        /* TODO what about LYD_OPT_NOTIF, LYD_OPT_RPC and LYD_OPT_RPCREPLY ? */
+        if (options & (LYD_OPT_FILTER | LYD_OPT_EDIT | LYD_OPT_GET | LYD_OPT_GETCONFIG)) {
+            return EXIT_SUCCESS;
+        }
+        /* LYD_OPT_DATA || LYD_OPT_CONFIG */
+
+        /* get context with schemas from the variable arguments */
+        va_start(ap, options);
+        ctx = va_arg(ap,  struct ly_ctx*);
+        if (!ctx) {
+            LOGERR(LY_EINVAL, "%s: Invalid variable argument.", __func__);
+            va_end(ap);
+            return EXIT_FAILURE;
+        }
+
+        /* check for missing mandatory elements according to schemas in context */
+        for (i = 0; i < ctx->models.used; i++) {
+            if (!ctx->models.list[i]->data) {
+                continue;
+            }
+            schema = ly_check_mandatory(NULL, ctx->models.list[i]->data);
+            if (schema) {
+                if (schema->nodetype & (LYS_LIST | LYS_LEAFLIST)) {
+                    LOGVAL(LYE_SPEC, 0, LY_VLOG_LYS, schema,
+                           "Number of \"%s\" instances in \"%s\" does not follow min-elements constraint.",
+                           schema->name, schema->parent ? schema->parent->name : ctx->models.list[i]->name);
+                } else {
                     LOGVAL(LYE_MISSELEM, 0, LY_VLOG_LYS, schema,
                            schema->name, schema->parent ? schema->parent->name : ctx->models.list[i]->name);
                 }
@@ -742,6 +1463,11 @@ lyd_validate(struct lyd_node *node, int options, ...)
         }
     }
 
+    memset(&affected, 0, sizeof affected);
+    if ((options & LYD_OPT_CHANGED) && lyd_validate_affected(node, options, &affected)) {
+        goto cleanup;
+    }
+
     LY_TREE_FOR_SAFE(node, next1, root) {
         LY_TREE_DFS_BEGIN(root, next2, iter) {
             if (to_free) {
@@ -749,15 +1475,25 @@ lyd_validate(struct lyd_node *node, int options, ...)
                 to_free = NULL;
             }
 
-            if (lyv_data_context(iter, options, 0, NULL)) {
-                return EXIT_FAILURE;
+            if ((iter->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST))
+                    && lyd_value_parse((struct lyd_node_leaf_list *)iter)) {
+                goto cleanup;
+            }
+            vopts = options;
+            if ((options & LYD_OPT_CHANGED) && (iter->validity == LYD_VAL_OK)) {
+                /* skip the conditions not affected by the changes */
+                vopts |= lyd_validate_skip(iter, &affected);
+            }
+
+            if (lyv_data_context(iter, vopts, 0, NULL)) {
+                goto cleanup;
             }
             if (lyv_data_value(iter, options)) {
-                return EXIT_FAILURE;
+                goto cleanup;
             }
-            if (lyv_data_content(iter, options, 0, NULL)) {
+            if (lyv_data_content(iter, vopts, 0, NULL)) {
                 if (ly_errno) {
-                    return EXIT_FAILURE;
+                    goto cleanup;
                 } else {
                     /* safe deferred removal */
                     to_free = iter;
@@ -810,39 +1546,1068 @@ nextsiblings:
         }
     }
 
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    ly_ht_clean(&affected);
+    return ret;
+}
+
+/* growing list of differences */
+struct lyd_diff_state {
+    struct lyd_difflist *diff;
+    uint32_t used;
+    uint32_t size;
+};
+
+static int
+lyd_diff_add(struct lyd_diff_state *st, LYD_DIFFTYPE type, struct lyd_node *first, struct lyd_node *second)
+{
+    LYD_DIFFTYPE *new_type;
+    struct lyd_node **new_first, **new_second;
+
+    /* keep a place for the terminating item */
+    if (st->used + 1 == st->size) {
+        new_type = realloc(st->diff->type, st->size * 2 * sizeof *new_type);
+        if (new_type) {
+            st->diff->type = new_type;
+        }
+        new_first = realloc(st->diff->first, st->size * 2 * sizeof *new_first);
+        if (new_first) {
+            st->diff->first = new_first;
+        }
+        new_second = realloc(st->diff->second, st->size * 2 * sizeof *new_second);
+        if (new_second) {
+            st->diff->second = new_second;
+        }
+        if (!new_type || !new_first || !new_second) {
+            LOGMEM;
+            return EXIT_FAILURE;
+        }
+        st->size *= 2;
+    }
+
+    st->diff->type[st->used] = type;
+    st->diff->first[st->used] = first;
+    st->diff->second[st->used] = second;
+    ++st->used;
+    st->diff->type[st->used] = LYD_DIFF_END;
 
     return EXIT_SUCCESS;
 }
 
-/* create an attribute copy */
-static struct lyd_attr *
-lyd_dup_attr(struct ly_ctx *ctx, struct lyd_node *parent, struct lyd_attr *attr)
+/* instances of keyless lists have no identity, they are matched by their content */
+static int
+lyd_keyless_list(const struct lyd_node *node)
 {
-    struct lyd_attr *ret;
+    return (node->schema->nodetype == LYS_LIST) && !((struct lys_node_list *)node->schema)->keys_size;
+}
 
-    /* allocate new attr */
-    if (!parent->attr) {
-        parent->attr = malloc(sizeof *parent->attr);
-        ret = parent->attr;
-    } else {
-        for (ret = parent->attr; ret->next; ret = ret->next);
-        ret->next = malloc(sizeof *ret);
-        ret = ret->next;
+static uint32_t
+lyd_diff_hash(struct lyd_node *node)
+{
+    uint32_t hash;
+
+    hash = lyd_instance_hash(node);
+    if (lyd_keyless_list(node)) {
+        hash ^= lyd_subtree_hash(node);
     }
-    if (!ret) {
+    return hash;
+}
+
+/* find the not yet matched instance of node among the indexed siblings, count if there is none */
+static uint32_t
+lyd_diff_match(struct ly_ht *index, struct lyd_node **sibs, uint32_t *pos, uint32_t count, struct lyd_node *node)
+{
+    struct lyd_node **match;
+    uint32_t iter = 0, i;
+
+    while ((match = ly_ht_find(index, lyd_diff_hash(node), &iter))) {
+        i = match - sibs;
+        if (pos[i] || lyd_compare(node, sibs[i], 0)) {
+            continue;
+        }
+        if (lyd_keyless_list(node) && ((lyd_subtree_hash(node) != lyd_subtree_hash(sibs[i]))
+                || !lyd_subtree_equal(node, sibs[i]))) {
+            continue;
+        }
+        return i;
+    }
+
+    return count;
+}
+
+/* instances of a user-ordered list/leaflist not in the longest sequence keeping their original order moved */
+static int
+lyd_diff_moved(struct lyd_diff_state *st, struct lyd_node **sibs, uint32_t *pos, uint32_t count, uint32_t start,
+               uint8_t *done, struct lyd_node **firsts)
+{
+    uint32_t *inst, *tail, *pred, m = 0, len = 0, lo, hi, mid, i;
+    int ret = EXIT_FAILURE;
+
+    inst = malloc(3 * (count - start) * sizeof *inst);
+    if (!inst) {
+        LOGMEM;
+        return EXIT_FAILURE;
+    }
+    tail = inst + (count - start);
+    pred = tail + (count - start);
+
+    /* matched instances of the schema node in the order of the second tree */
+    for (i = start; i < count; ++i) {
+        if (sibs[i]->schema == sibs[start]->schema) {
+            done[i] = 1;
+            if (pos[i]) {
+                inst[m++] = i;
+            }
+        }
+    }
+
+    /* longest increasing subsequence of their positions in the first tree */
+    for (i = 0; i < m; ++i) {
+        lo = 0;
+        hi = len;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (pos[inst[tail[mid]]] < pos[inst[i]]) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        pred[i] = lo ? tail[lo - 1] : UINT32_MAX;
+        tail[lo] = i;
+        if (lo == len) {
+            ++len;
+        }
+    }
+
+    /* mark the instances in it, the rest moved */
+    for (i = len ? tail[len - 1] : UINT32_MAX; i != UINT32_MAX; i = pred[i]) {
+        inst[i] = UINT32_MAX;
+    }
+    for (i = 0; i < m; ++i) {
+        if ((inst[i] != UINT32_MAX)
+                && lyd_diff_add(st, LYD_DIFF_MOVED, firsts[pos[inst[i]] - 1], sibs[inst[i]])) {
+            goto cleanup;
+        }
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    free(inst);
+    return ret;
+}
+
+static int
+lyd_diff_siblings(struct lyd_diff_state *st, struct lyd_node *parent, struct lyd_node *first, struct lyd_node *second,
+                  int nosiblings)
+{
+    struct ly_ht index;
+    struct lyd_node **sibs = NULL, **firsts = NULL, *iter;
+    uint32_t *pos = NULL, count = 0, count1 = 0, i;
+    uint8_t *done = NULL;
+    int ret = EXIT_FAILURE;
+
+    memset(&index, 0, sizeof index);
+
+    for (iter = second; iter; iter = nosiblings ? NULL : iter->next) {
+        ++count;
+    }
+    for (iter = first; iter; iter = nosiblings ? NULL : iter->next) {
+        ++count1;
+    }
+    /* pos holds the position + 1 of the matching node in the first siblings, 0 if there is none */
+    sibs = malloc((count + 1) * sizeof *sibs);
+    pos = calloc(count + 1, sizeof *pos);
+    done = calloc(count + 1, sizeof *done);
+    firsts = malloc((count1 + 1) * sizeof *firsts);
+    if (!sibs || !pos || !done || !firsts) {
+        LOGMEM;
+        goto cleanup;
+    }
+
+    /* index the second siblings */
+    for (i = 0, iter = second; iter; iter = nosiblings ? NULL : iter->next, ++i) {
+        sibs[i] = iter;
+        if (ly_ht_insert(&index, lyd_diff_hash(iter), &sibs[i])) {
+            LOGMEM;
+            goto cleanup;
+        }
+    }
+
+    /* match the first siblings */
+    for (count1 = 0, iter = first; iter; iter = nosiblings ? NULL : iter->next) {
+        firsts[count1++] = iter;
+        i = lyd_diff_match(&index, sibs, pos, count, iter);
+        if (i == count) {
+            if (lyd_diff_add(st, LYD_DIFF_DELETED, iter, NULL)) {
+                goto cleanup;
+            }
+            continue;
+        }
+        pos[i] = count1;
+
+        if ((lyd_subtree_hash(iter) == lyd_subtree_hash(sibs[i])) && lyd_subtree_equal(iter, sibs[i])) {
+            /* identical subtrees, the hashes only rule out the different ones quickly */
+            continue;
+        }
+        switch (iter->schema->nodetype) {
+        case LYS_LEAF:
+        case LYS_ANYXML:
+            if (lyd_diff_add(st, LYD_DIFF_CHANGED, iter, sibs[i])) {
+                goto cleanup;
+            }
+            break;
+        case LYS_LEAFLIST:
+            /* matched by the value */
+            break;
+        default:
+            if (lyd_diff_siblings(st, iter, iter->child, sibs[i]->child, 0)) {
+                goto cleanup;
+            }
+            break;
+        }
+    }
+
+    /* created subtrees and moved instances in the order of the second tree */
+    for (i = 0; i < count; ++i) {
+        if (!pos[i]) {
+            if (lyd_diff_add(st, LYD_DIFF_CREATED, parent, sibs[i])) {
+                goto cleanup;
+            }
+        } else if ((sibs[i]->schema->flags & LYS_USERORDERED) && !done[i]) {
+            if (lyd_diff_moved(st, sibs, pos, count, i, done, firsts)) {
+                goto cleanup;
+            }
+        }
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    ly_ht_clean(&index);
+    free(sibs);
+    free(pos);
+    free(done);
+    free(firsts);
+    return ret;
+}
+
+API struct lyd_difflist *
+lyd_diff(struct lyd_node *first, struct lyd_node *second, int options)
+{
+    struct lyd_diff_state st;
+
+    if (first && second && (first->schema->module->ctx != second->schema->module->ctx)) {
+        LOGERR(LY_EINVAL, "%s: The data trees are not from the same context.", __func__);
+        return NULL;
+    }
+
+    if (!(options & LYD_DIFFOPT_NOSIBLINGS)) {
+        /* the first siblings */
+        for (; first && first->prev->next; first = first->prev);
+        for (; second && second->prev->next; second = second->prev);
+    }
+
+    st.used = 0;
+    st.size = 16;
+    st.diff = malloc(sizeof *st.diff);
+    if (!st.diff) {
         LOGMEM;
         return NULL;
     }
+    st.diff->type = malloc(st.size * sizeof *st.diff->type);
+    st.diff->first = malloc(st.size * sizeof *st.diff->first);
+    st.diff->second = malloc(st.size * sizeof *st.diff->second);
+    if (!st.diff->type || !st.diff->first || !st.diff->second) {
+        LOGMEM;
+        lyd_free_diff(st.diff);
+        return NULL;
+    }
+    st.diff->type[0] = LYD_DIFF_END;
+
+    if (lyd_diff_siblings(&st, first ? first->parent : NULL, first, second, options & LYD_DIFFOPT_NOSIBLINGS)) {
+        lyd_free_diff(st.diff);
+        return NULL;
+    }
+
+    return st.diff;
+}
+
+API void
+lyd_free_diff(struct lyd_difflist *diff)
+{
+    if (!diff) {
+        return;
+    }
+
+    free(diff->type);
+    free(diff->first);
+    free(diff->second);
+    free(diff);
+}
+
+/* append node to the siblings of the target, the top-level ones are linked directly not to look for the first one */
+static int
+lyd_merge_append(struct lyd_node *parent, struct lyd_node *first, struct lyd_node *node)
+{
+    if (parent) {
+        return lyd_insert(parent, node);
+    }
+
+    node->parent = NULL;
+    node->next = NULL;
+    node->prev = first->prev;
+    first->prev->next = node;
+    first->prev = node;
+    lyd_insert_setinvalid(node);
+
+    return EXIT_SUCCESS;
+}
+
+static int lyd_merge_siblings(struct lyd_node *parent, struct lyd_node *first, struct lyd_node *source, int options);
+
+/* merge the source node (with its subtree) into the matching target node */
+static int
+lyd_merge_node(struct lyd_node *target, struct lyd_node *source, int options)
+{
+    struct ly_ctx *ctx = target->schema->module->ctx;
+    struct lyd_node_leaf_list *tleaf, *sleaf;
+    struct lyd_node_anyxml *taxml, *saxml;
+    struct lyxml_elem *xml;
+    const char *val_str;
+
+    switch (target->schema->nodetype) {
+    case LYS_LEAF:
+        tleaf = (struct lyd_node_leaf_list *)target;
+        sleaf = (struct lyd_node_leaf_list *)source;
+        val_str = lyd_value_str(sleaf);
+        if (ly_strequal(lyd_value_str(tleaf), val_str, 1)) {
+            break;
+        }
+        if (lyd_change_leaf(tleaf, val_str)) {
+            return EXIT_FAILURE;
+        }
+        target->validity = LYD_VAL_NOT;
+        break;
+    case LYS_LEAFLIST:
+        /* matched by the value, nothing to change */
+        break;
+    case LYS_ANYXML:
+        taxml = (struct lyd_node_anyxml *)target;
+        saxml = (struct lyd_node_anyxml *)source;
+        if (options & LYD_MERGEOPT_DESTRUCT) {
+            xml = saxml->value;
+            saxml->value = NULL;
+        } else {
+            xml = lyxml_dup_elem(ctx, saxml->value, NULL, 1);
+            if (!xml && saxml->value) {
+                return EXIT_FAILURE;
+            }
+        }
+        lyxml_free(ctx, taxml->value);
+        taxml->value = xml;
+        target->validity = LYD_VAL_NOT;
+        lyd_hash_invalidate(target);
+        break;
+    default:
+        if (source->child) {
+            return lyd_merge_siblings(target, target->child, source->child, options & ~LYD_MERGEOPT_NOSIBLINGS);
+        }
+        break;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* merge source siblings into the target siblings (children of parent) */
+static int
+lyd_merge_siblings(struct lyd_node *parent, struct lyd_node *first, struct lyd_node *source, int options)
+{
+    struct ly_ht index;
+    struct lyd_node *iter, *next, *match, *node;
+    uint32_t hash, hiter;
+    int ret = EXIT_FAILURE;
+
+    memset(&index, 0, sizeof index);
+
+    /* index the target siblings, keyless list instances are never matched */
+    LY_TREE_FOR(first, match) {
+        if (lyd_keyless_list(match)) {
+            continue;
+        }
+        if (ly_ht_insert(&index, lyd_instance_hash(match), match)) {
+            LOGMEM;
+            /* nothing merged yet */
+            iter = source;
+            goto cleanup;
+        }
+    }
+
+    for (iter = source; iter; iter = next) {
+        next = (options & LYD_MERGEOPT_NOSIBLINGS) ? NULL : iter->next;
+
+        match = NULL;
+        if (!lyd_keyless_list(iter)) {
+            hash = lyd_instance_hash(iter);
+            hiter = 0;
+            while ((match = ly_ht_find(&index, hash, &hiter)) && lyd_compare(match, iter, 0));
+        }
+
+        if (match) {
+            if (lyd_merge_node(match, iter, options)) {
+                goto cleanup;
+            }
+            if (options & LYD_MERGEOPT_DESTRUCT) {
+                lyd_free(iter);
+            }
+            continue;
+        }
+
+        /* a new node */
+        if (options & LYD_MERGEOPT_DESTRUCT) {
+            lyd_unlink(iter);
+            node = iter;
+        } else {
+            node = lyd_dup(iter, 1);
+            if (!node) {
+                goto cleanup;
+            }
+        }
+        if (first ? lyd_merge_append(parent, first, node) : lyd_insert(parent, node)) {
+            if (!(options & LYD_MERGEOPT_DESTRUCT)) {
+                lyd_free(node);
+            }
+            goto cleanup;
+        }
+        if (!first) {
+            /* the parent had no children */
+            first = node;
+        }
+        if (!lyd_keyless_list(node) && ly_ht_insert(&index, lyd_instance_hash(node), node)) {
+            LOGMEM;
+            /* already merged */
+            iter = next;
+            goto cleanup;
+        }
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (ret && (options & LYD_MERGEOPT_DESTRUCT)) {
+        /* the source is consumed even on error */
+        for (; iter; iter = next) {
+            next = (options & LYD_MERGEOPT_NOSIBLINGS) ? NULL : iter->next;
+            lyd_free(iter);
+        }
+    }
+    ly_ht_clean(&index);
+    return ret;
+}
+
+API int
+lyd_merge(struct lyd_node *target, struct lyd_node *source, int options)
+{
+    const struct lys_node *tparent, *sparent;
+
+    if (!target || !source) {
+        ly_errno = LY_EINVAL;
+        return EXIT_FAILURE;
+    }
+    if (lyd_check_writable(target, __func__)
+            || ((options & LYD_MERGEOPT_DESTRUCT) && lyd_check_writable(source, __func__))) {
+        return EXIT_FAILURE;
+    }
+    if (target->schema->module->ctx != source->schema->module->ctx) {
+        LOGERR(LY_EINVAL, "%s: The data trees are not from the same context.", __func__);
+        return EXIT_FAILURE;
+    }
+
+    for (tparent = lys_parent(target->schema);
+         tparent && !(tparent->nodetype & (LYS_CONTAINER | LYS_LIST | LYS_RPC | LYS_OUTPUT | LYS_NOTIF));
+         tparent = lys_parent(tparent));
+    for (sparent = lys_parent(source->schema);
+         sparent && !(sparent->nodetype & (LYS_CONTAINER | LYS_LIST | LYS_RPC | LYS_OUTPUT | LYS_NOTIF));
+         sparent = lys_parent(sparent));
+
+    if (!(options & LYD_MERGEOPT_NOSIBLINGS)) {
+        for (; source->prev->next; source = source->prev);
+    }
+
+    if (tparent == sparent) {
+        /* merge into the target siblings */
+        for (; target->prev->next; target = target->prev);
+        return lyd_merge_siblings(target->parent, target, source, options);
+    } else if (sparent == target->schema) {
+        /* merge into the target children */
+        return lyd_merge_siblings(target, target->child, source, options);
+    }
+
+    LOGERR(LY_EINVAL, "%s: The source data tree does not belong to the target data tree.", __func__);
+    if (options & LYD_MERGEOPT_DESTRUCT) {
+        if (options & LYD_MERGEOPT_NOSIBLINGS) {
+            lyd_free(source);
+        } else {
+            lyd_free_withsiblings(source);
+        }
+    }
+    return EXIT_FAILURE;
+}
+
+/* NETCONF edit-config operations */
+enum lyd_edit_op {
+    LYD_EDIT_NONE,
+    LYD_EDIT_MERGE,
+    LYD_EDIT_REPLACE,
+    LYD_EDIT_CREATE,
+    LYD_EDIT_DELETE,
+    LYD_EDIT_REMOVE
+};
+
+/* record of a change in the target tree to be undone on error */
+struct lyd_edit_undo {
+    enum {
+        LYD_EDIT_UNDO_CREATED,       /* node was linked into the tree */
+        LYD_EDIT_UNDO_REMOVED,       /* node was unlinked from parent after prev (NULL if it was the first) */
+        LYD_EDIT_UNDO_VALUE,         /* value of the leaf node was changed, the previous one is kept */
+        LYD_EDIT_UNDO_ANYXML         /* value of the anyxml node was changed, the previous one is kept */
+    } type;
+    struct lyd_node *node;
+    struct lyd_node *parent;
+    struct lyd_node *prev;
+    const char *value_str;
+    lyd_val value;
+    uint8_t flags;               /* node flags with the #LYD_NODE_BITS_EXT of the previous value */
+    LY_DATA_TYPE value_type;
+    struct lyxml_elem *xml;
+};
+
+struct lyd_edit_state {
+    struct lyd_node **root;          /* first top-level node of the target tree */
+    struct lyd_edit_undo *undo;
+    uint32_t used;
+    uint32_t size;
+    int detached;                    /* building a new subtree not linked into the tree yet, no need to undo */
+};
+
+static int lyd_edit_siblings(struct lyd_edit_state *st, struct lyd_node *parent, const struct lyd_node *edit,
+                             enum lyd_edit_op op);
+
+static struct lyd_edit_undo *
+lyd_edit_log(struct lyd_edit_state *st, int type, struct lyd_node *node)
+{
+    struct lyd_edit_undo *new;
+
+    if (st->used == st->size) {
+        new = realloc(st->undo, (st->size ? st->size * 2 : 16) * sizeof *new);
+        if (!new) {
+            LOGMEM;
+            return NULL;
+        }
+        st->undo = new;
+        st->size = st->size ? st->size * 2 : 16;
+    }
+
+    new = &st->undo[st->used++];
+    memset(new, 0, sizeof *new);
+    new->type = type;
+    new->node = node;
+    return new;
+}
+
+static int
+lyd_edit_is_opattr(const struct lyd_attr *attr)
+{
+    return attr->module && !strcmp(attr->module->ns, LY_NSNC) && !strcmp(attr->name, "operation");
+}
+
+/* get the operation of the edit node, inherited one if not specified, -1 on error */
+static int
+lyd_edit_op(const struct lyd_node *edit, enum lyd_edit_op op)
+{
+    struct lyd_attr *attr;
+
+    for (attr = edit->attr; attr && !lyd_edit_is_opattr(attr); attr = attr->next);
+    if (!attr) {
+        return op;
+    }
+
+    if (!strcmp(attr->value, "merge")) {
+        return LYD_EDIT_MERGE;
+    } else if (!strcmp(attr->value, "replace")) {
+        return LYD_EDIT_REPLACE;
+    } else if (!strcmp(attr->value, "create")) {
+        return LYD_EDIT_CREATE;
+    } else if (!strcmp(attr->value, "delete")) {
+        return LYD_EDIT_DELETE;
+    } else if (!strcmp(attr->value, "remove")) {
+        return LYD_EDIT_REMOVE;
+    } else if (!strcmp(attr->value, "none")) {
+        return LYD_EDIT_NONE;
+    }
+
+    LOGVAL(LYE_INARG, 0, LY_VLOG_LYD, edit, attr->value, attr->name);
+    return -1;
+}
+
+/* copy of the edit node without its operation */
+static struct lyd_node *
+lyd_edit_dup(const struct lyd_node *edit)
+{
+    struct lyd_node *node;
+    struct lyd_attr *attr, *next;
+
+    node = lyd_dup(edit, 0);
+    if (!node) {
+        return NULL;
+    }
+    for (attr = node->attr; attr; attr = next) {
+        next = attr->next;
+        if (lyd_edit_is_opattr(attr)) {
+            lyd_free_attr(node->schema->module->ctx, node, attr, 0);
+        }
+    }
+
+    return node;
+}
+
+static int
+lyd_edit_is_key(const struct lyd_node *parent, const struct lyd_node *node)
+{
+    struct lys_node_list *slist;
+    int i;
+
+    if (!parent || (parent->schema->nodetype != LYS_LIST)) {
+        return 0;
+    }
+    slist = (struct lys_node_list *)parent->schema;
+    for (i = 0; i < slist->keys_size; ++i) {
+        if (node->schema == (struct lys_node *)slist->keys[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+lyd_edit_remove(struct lyd_edit_state *st, struct lyd_node *node)
+{
+    struct lyd_edit_undo *undo;
+
+    undo = lyd_edit_log(st, LYD_EDIT_UNDO_REMOVED, node);
+    if (!undo) {
+        return EXIT_FAILURE;
+    }
+    undo->parent = node->parent;
+    undo->prev = node->prev->next ? node->prev : NULL;
+
+    if (*st->root == node) {
+        *st->root = node->next;
+    }
+    lyd_unlink(node);
+    if (undo->parent) {
+        /* mandatory nodes or min-elements may not be satisfied anymore */
+        undo->parent->validity = LYD_VAL_NOT;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* create a node (with its subtree) from the edit node, in place of replace if set */
+static int
+lyd_edit_create(struct lyd_edit_state *st, struct lyd_node *parent, const struct lyd_node *edit, enum lyd_edit_op op,
+                struct lyd_node *replace, struct lyd_node **created)
+{
+    struct lyd_node *node, *key;
+    const struct lyd_node *iter;
+    int ret;
+
+    *created = NULL;
+    node = lyd_edit_dup(edit);
+    if (!node) {
+        return EXIT_FAILURE;
+    }
+
+    if (node->schema->nodetype & (LYS_CONTAINER | LYS_LIST)) {
+        /* keys identify the instance, they are not subject to the operations */
+        LY_TREE_FOR(edit->child, iter) {
+            if (lyd_edit_is_key(edit, iter)) {
+                key = lyd_edit_dup(iter);
+                if (!key || lyd_insert(node, key)) {
+                    lyd_free(key);
+                    lyd_free(node);
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+
+        /* the children are created in the new node before it is linked into the tree */
+        ++st->detached;
+        ret = lyd_edit_siblings(st, node, edit->child, op);
+        --st->detached;
+        if (ret) {
+            lyd_free(node);
+            return EXIT_FAILURE;
+        }
+
+        if ((op == LYD_EDIT_NONE) && (!node->child || lyd_edit_is_key(node, node->child->prev))) {
+            /* only needed to hold the created descendants, but there are none */
+            lyd_free(node);
+            return EXIT_SUCCESS;
+        }
+    } else if (op == LYD_EDIT_NONE) {
+        lyd_free(node);
+        return EXIT_SUCCESS;
+    }
+
+    if (replace) {
+        ret = lyd_insert_before(replace, node);
+        if (!ret && (*st->root == replace)) {
+            *st->root = node;
+        }
+    } else if (parent) {
+        ret = lyd_insert(parent, node);
+    } else if (*st->root) {
+        ret = lyd_merge_append(NULL, *st->root, node);
+    } else {
+        *st->root = node;
+        ret = EXIT_SUCCESS;
+    }
+    if (ret) {
+        lyd_free(node);
+        return EXIT_FAILURE;
+    }
+    if (!st->detached && !lyd_edit_log(st, LYD_EDIT_UNDO_CREATED, node)) {
+        if (*st->root == node) {
+            *st->root = node->next;
+        }
+        lyd_free(node);
+        return EXIT_FAILURE;
+    }
+    if (replace && lyd_edit_remove(st, replace)) {
+        return EXIT_FAILURE;
+    }
+
+    *created = node;
+    return EXIT_SUCCESS;
+}
+
+/* change the value of an existing leaf or anyxml */
+static int
+lyd_edit_value(struct lyd_edit_state *st, struct lyd_node *node, const struct lyd_node *edit)
+{
+    struct ly_ctx *ctx = node->schema->module->ctx;
+    struct lyd_node_leaf_list *leaf = (struct lyd_node_leaf_list *)node;
+    struct lyd_node_anyxml *axml = (struct lyd_node_anyxml *)node;
+    struct lyd_node *parent;
+    struct lyd_edit_undo *undo;
+    const char *val_str;
+
+    if (node->schema->nodetype == LYS_ANYXML) {
+        undo = lyd_edit_log(st, LYD_EDIT_UNDO_ANYXML, node);
+        if (!undo) {
+            return EXIT_FAILURE;
+        }
+        undo->xml = axml->value;
+        axml->value = lyxml_dup_elem(ctx, ((struct lyd_node_anyxml *)edit)->value, NULL, 1);
+        if (!axml->value && ((struct lyd_node_anyxml *)edit)->value) {
+            axml->value = undo->xml;
+            --st->used;
+            return EXIT_FAILURE;
+        }
+    } else {
+        val_str = lyd_value_str((struct lyd_node_leaf_list *)edit);
+        if (ly_strequal(lyd_value_str(leaf), val_str, 1)) {
+            return EXIT_SUCCESS;
+        }
+
+        undo = lyd_edit_log(st, LYD_EDIT_UNDO_VALUE, node);
+        if (!undo) {
+            return EXIT_FAILURE;
+        }
+        undo->value_str = leaf->value_str;
+        undo->value = leaf->value;
+        undo->value_type = leaf->value_type;
+        undo->flags = leaf->flags;
+
+        leaf->value_str = lydict_insert(ctx, val_str, 0);
+        if (lyp_parse_value(leaf, NULL, 1, NULL, 0)) {
+            lydict_remove(ctx, leaf->value_str);
+            leaf->value_str = undo->value_str;
+            leaf->value = undo->value;
+            leaf->value_type = undo->value_type;
+            leaf->flags = undo->flags;
+            --st->used;
+            ly_errno = LY_EINVAL;
+            return EXIT_FAILURE;
+        }
+
+        if (leaf->schema->flags & LYS_UNIQUE) {
+            for (parent = leaf->parent; parent && parent->schema->nodetype != LYS_LIST; parent = parent->parent);
+            if (parent) {
+                parent->validity |= LYD_VAL_UNIQUE;
+            }
+        }
+    }
+    node->validity = LYD_VAL_NOT;
+    lyd_hash_invalidate(node);
+
+    return EXIT_SUCCESS;
+}
+
+/* get the target node matching the edit node, if any */
+static struct lyd_node *
+lyd_edit_match(struct ly_ht *index, struct lyd_node *parent, struct lyd_node *first, const struct lyd_node *edit)
+{
+    struct lyd_node *match;
+    uint32_t hash, iter = 0;
+
+    if (lyd_keyless_list(edit)) {
+        return NULL;
+    }
+
+    hash = lyd_instance_hash(edit);
+    while ((match = ly_ht_find(index, hash, &iter))) {
+        if ((match->parent != parent) || ((match->prev == match) && (match != first))) {
+            /* removed in the meantime */
+            continue;
+        }
+        if (!lyd_compare(match, (struct lyd_node *)edit, 0)) {
+            return match;
+        }
+    }
+
+    return NULL;
+}
+
+static int
+lyd_edit_siblings(struct lyd_edit_state *st, struct lyd_node *parent, const struct lyd_node *edit, enum lyd_edit_op op)
+{
+    struct ly_ht index;
+    struct lyd_node *iter, *match, *created;
+    int eop, ret = EXIT_FAILURE;
+
+    memset(&index, 0, sizeof index);
+
+    /* index the target siblings */
+    LY_TREE_FOR(parent ? parent->child : *st->root, iter) {
+        if (!lyd_keyless_list(iter) && ly_ht_insert(&index, lyd_instance_hash(iter), iter)) {
+            LOGMEM;
+            goto cleanup;
+        }
+    }
+
+    for (; edit; edit = edit->next) {
+        if (lyd_edit_is_key(edit->parent, edit)) {
+            continue;
+        }
+        eop = lyd_edit_op(edit, op);
+        if (eop == -1) {
+            goto cleanup;
+        }
+
+        match = lyd_edit_match(&index, parent, parent ? parent->child : *st->root, edit);
+        created = NULL;
+        switch (eop) {
+        case LYD_EDIT_CREATE:
+            if (match) {
+                LOGVAL(LYE_SPEC, 0, LY_VLOG_LYD, edit, "Data node \"%s\" to create already exists.",
+                       edit->schema->name);
+                goto cleanup;
+            }
+            if (lyd_edit_create(st, parent, edit, eop, NULL, &created)) {
+                goto cleanup;
+            }
+            break;
+        case LYD_EDIT_DELETE:
+            if (!match) {
+                LOGVAL(LYE_SPEC, 0, LY_VLOG_LYD, edit, "Data node \"%s\" to delete does not exist.",
+                       edit->schema->name);
+                goto cleanup;
+            }
+            /* fallthrough */
+        case LYD_EDIT_REMOVE:
+            if (match && lyd_edit_remove(st, match)) {
+                goto cleanup;
+            }
+            break;
+        case LYD_EDIT_REPLACE:
+            if (lyd_edit_create(st, parent, edit, eop, match, &created)) {
+                goto cleanup;
+            }
+            break;
+        case LYD_EDIT_MERGE:
+        case LYD_EDIT_NONE:
+            if (!match) {
+                if (lyd_edit_create(st, parent, edit, eop, NULL, &created)) {
+                    goto cleanup;
+                }
+                break;
+            }
+
+            switch (match->schema->nodetype) {
+            case LYS_LEAF:
+            case LYS_ANYXML:
+                if ((eop == LYD_EDIT_MERGE) && lyd_edit_value(st, match, edit)) {
+                    goto cleanup;
+                }
+                break;
+            case LYS_LEAFLIST:
+                break;
+            default:
+                if (lyd_edit_siblings(st, match, edit->child, eop)) {
+                    goto cleanup;
+                }
+                break;
+            }
+            break;
+        }
+
+        if (created && !lyd_keyless_list(created) && ly_ht_insert(&index, lyd_instance_hash(created), created)) {
+            LOGMEM;
+            goto cleanup;
+        }
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    ly_ht_clean(&index);
+    return ret;
+}
+
+static void
+lyd_edit_rollback(struct lyd_edit_state *st)
+{
+    struct lyd_edit_undo *undo;
+    struct lyd_node_leaf_list *leaf;
+    struct ly_ctx *ctx;
+
+    while (st->used) {
+        undo = &st->undo[--st->used];
+        ctx = undo->node->schema->module->ctx;
+
+        switch (undo->type) {
+        case LYD_EDIT_UNDO_CREATED:
+            if (*st->root == undo->node) {
+                *st->root = undo->node->next;
+            }
+            lyd_free(undo->node);
+            break;
+        case LYD_EDIT_UNDO_REMOVED:
+            if (undo->prev) {
+                lyd_insert_after(undo->prev, undo->node);
+            } else if (undo->parent) {
+                if (undo->parent->child) {
+                    lyd_insert_before(undo->parent->child, undo->node);
+                } else {
+                    lyd_insert(undo->parent, undo->node);
+                }
+            } else {
+                if (*st->root) {
+                    lyd_insert_before(*st->root, undo->node);
+                }
+                *st->root = undo->node;
+            }
+            break;
+        case LYD_EDIT_UNDO_VALUE:
+            leaf = (struct lyd_node_leaf_list *)undo->node;
+            if (leaf->value_type == LY_TYPE_BITS) {
+                lyd_bits_free(&leaf->value, leaf->flags);
+            }
+            lydict_remove(ctx, leaf->value_str);
+            leaf->value_str = undo->value_str;
+            leaf->value = undo->value;
+            leaf->value_type = undo->value_type;
+            leaf->flags = (leaf->flags & ~LYD_NODE_BITS_EXT) | (undo->flags & LYD_NODE_BITS_EXT);
+            lyd_hash_invalidate(undo->node);
+            break;
+        case LYD_EDIT_UNDO_ANYXML:
+            lyxml_free(ctx, ((struct lyd_node_anyxml *)undo->node)->value);
+            ((struct lyd_node_anyxml *)undo->node)->value = undo->xml;
+            lyd_hash_invalidate(undo->node);
+            break;
+        }
+    }
+}
+
+static void
+lyd_edit_commit(struct lyd_edit_state *st)
+{
+    struct lyd_edit_undo *undo;
+    struct ly_ctx *ctx;
+    uint32_t i;
+
+    for (i = 0; i < st->used; ++i) {
+        undo = &st->undo[i];
+        ctx = undo->node->schema->module->ctx;
+
+        switch (undo->type) {
+        case LYD_EDIT_UNDO_CREATED:
+            break;
+        case LYD_EDIT_UNDO_REMOVED:
+            lyd_free(undo->node);
+            break;
+        case LYD_EDIT_UNDO_VALUE:
+            if (undo->value_type == LY_TYPE_BITS) {
+                lyd_bits_free(&undo->value, undo->flags);
+            }
+            if (undo->value_str != lyd_value_str_lazy) {
+                lydict_remove(ctx, undo->value_str);
+            }
+            break;
+        case LYD_EDIT_UNDO_ANYXML:
+            lyxml_free(ctx, undo->xml);
+            break;
+        }
+    }
+}
+
+API int
+lyd_apply_edit(struct lyd_node **root, const struct lyd_node *edit, int options)
+{
+    struct lyd_edit_state st;
+    enum lyd_edit_op op;
+    int ret;
+
+    if (!root || !edit) {
+        ly_errno = LY_EINVAL;
+        return EXIT_FAILURE;
+    }
+    if (lyd_check_writable(*root, __func__)) {
+        return EXIT_FAILURE;
+    }
+    if (*root && ((*root)->schema->module->ctx != edit->schema->module->ctx)) {
+        LOGERR(LY_EINVAL, "%s: The data trees are not from the same context.", __func__);
+        return EXIT_FAILURE;
+    }
+
+    if (options & LYD_EDITOPT_NONE) {
+        op = LYD_EDIT_NONE;
+    } else if (options & LYD_EDITOPT_REPLACE) {
+        op = LYD_EDIT_REPLACE;
+    } else {
+        op = LYD_EDIT_MERGE;
+    }
+
+    /* the first siblings */
+    for (; *root && (*root)->prev->next; *root = (*root)->prev);
+    for (; edit->prev->next; edit = edit->prev);
 
-    /* fill new attr except */
-    ret->next = NULL;
-    ret->module = attr->module;
-    ret->name = lydict_insert(ctx, attr->name, 0);
-    ret->value = lydict_insert(ctx, attr->value, 0);
+    memset(&st, 0, sizeof st);
+    st.root = root;
+
+    ret = lyd_edit_siblings(&st, NULL, edit, op);
+    if (ret) {
+        lyd_edit_rollback(&st);
+    } else {
+        lyd_edit_commit(&st);
+    }
+    free(st.undo);
 
     return ret;
 }
 
+/* create an attribute copy */
 API int
 lyd_unlink(struct lyd_node *node)
 {
@@ -854,6 +2619,9 @@ lyd_unlink(struct lyd_node *node)
         ly_errno = LY_EINVAL;
         return EXIT_FAILURE;
     }
+    if (lyd_check_writable(node, __func__)) {
+        return EXIT_FAILURE;
+    }
 
     /* fix leafrefs */
     LY_TREE_DFS_BEGIN(node, next, iter) {
@@ -898,6 +2666,9 @@ lyd_unlink(struct lyd_node *node)
 
     /* unlink from parent */
     if (node->parent) {
+        lyd_hash_invalidate(node->parent);
+        /* the parent content changed */
+        node->parent->validity = LYD_VAL_NOT;
         if (node->parent->child == node) {
             /* the node is the first child */
             node->parent->child = node->next;
@@ -911,112 +2682,154 @@ lyd_unlink(struct lyd_node *node)
     return EXIT_SUCCESS;
 }
 
+/* references copied from a snapshot would outlive it, resolve them in the copy, those pointing outside of it
+ * stay unresolved */
+static int
+lyd_dup_refs(struct lyd_node *root)
+{
+    struct lyd_node *next, *elem;
+    struct lyd_node_leaf_list *leaf;
+
+    LY_TREE_DFS_BEGIN(root, next, elem) {
+        if (elem->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
+            leaf = (struct lyd_node_leaf_list *)elem;
+            if (leaf->value_type == LY_TYPE_LEAFREF) {
+                leaf->value.leafref = NULL;
+                if (resolve_unres_data_item(elem, UNRES_LEAFREF, 1, 0) == -1) {
+                    return EXIT_FAILURE;
+                }
+            } else if (leaf->value_type == LY_TYPE_INST) {
+                leaf->value.instance = NULL;
+                if (resolve_unres_data_item(elem, UNRES_INSTID, 1, 0) == -1) {
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        LY_TREE_DFS_END(root, next, elem);
+    }
+
+    return EXIT_SUCCESS;
+}
+
 API struct lyd_node *
 lyd_dup(const struct lyd_node *node, int recursive)
 {
     const struct lyd_node *next, *elem;
     struct lyd_node *ret, *parent, *new_node;
-    struct lyd_attr *attr;
-    struct lyd_node_leaf_list *new_leaf;
+    struct lyd_attr *attr, *new_attr, **last_attr;
+    struct lyd_node_leaf_list *new_leaf, *leaf;
     struct lyd_node_anyxml *new_axml;
-    struct lys_type *type;
+    struct lyd_dup_blocks blocks;
+    struct ly_ctx *ctx;
 
     if (!node) {
         ly_errno = LY_EINVAL;
         return NULL;
     }
+    ctx = node->schema->module->ctx;
 
     ret = NULL;
     parent = NULL;
 
+    /* bigger subtrees are allocated in blocks */
+    memset(&blocks, 0, sizeof blocks);
+    if (recursive) {
+        blocks.remaining = lyd_dup_size(node);
+    }
+
+    /* all the strings are referenced with a single dictionary lock */
+    dict_lock(ctx);
+
     /* LY_TREE_DFS */
     for (elem = next = node; elem; elem = next) {
+        if (!(elem->schema->nodetype & (LYS_CONTAINER | LYS_LIST | LYS_NOTIF | LYS_RPC | LYS_LEAF | LYS_LEAFLIST
+                                        | LYS_ANYXML))) {
+            LOGINT;
+            goto error;
+        }
+
+        if (blocks.remaining) {
+            new_node = lyd_block_alloc(&blocks, elem->schema->nodetype);
+        } else {
+            new_node = lyd_node_alloc(ctx, elem->schema->nodetype);
+        }
+        if (!new_node) {
+            LOGMEM;
+            goto error;
+        }
+
+        /* fill common part and connect it as the last child, so that it is freed on error */
+        new_node->schema = elem->schema;
+        new_node->prev = new_node;
+        new_node->validity = LYD_VAL_NOT;
+        if (!ret) {
+            ret = new_node;
+        }
+        if (parent) {
+            new_node->parent = parent;
+            if (parent->child) {
+                new_node->prev = parent->child->prev;
+                parent->child->prev->next = new_node;
+                parent->child->prev = new_node;
+            } else {
+                parent->child = new_node;
+            }
+        }
+
+        last_attr = &new_node->attr;
+        LY_TREE_FOR(elem->attr, attr) {
+            new_attr = malloc(sizeof *new_attr);
+            if (!new_attr) {
+                LOGMEM;
+                goto error;
+            }
+            new_attr->next = NULL;
+            new_attr->module = attr->module;
+            new_attr->name = dict_ref(ctx, attr->name);
+            new_attr->value = dict_ref(ctx, attr->value);
+            *last_attr = new_attr;
+            last_attr = &new_attr->next;
+        }
 
         /* fill specific part */
         switch (elem->schema->nodetype) {
         case LYS_LEAF:
         case LYS_LEAFLIST:
-            new_leaf = malloc(sizeof *new_leaf);
-            new_node = (struct lyd_node *)new_leaf;
-            if (!new_node) {
-                LOGMEM;
-                return NULL;
-            }
+            leaf = (struct lyd_node_leaf_list *)elem;
+            new_leaf = (struct lyd_node_leaf_list *)new_node;
 
-            new_leaf->value = ((struct lyd_node_leaf_list *)elem)->value;
-            new_leaf->value_str = lydict_insert(elem->schema->module->ctx,
-                                                ((struct lyd_node_leaf_list *)elem)->value_str, 0);
-            new_leaf->value_type = ((struct lyd_node_leaf_list *)elem)->value_type;
             /* bits type must be treated specially */
-            if (new_leaf->value_type == LY_TYPE_BITS) {
-                for (type = &((struct lys_node_leaf *)elem->schema)->type; type->der->module; type = &type->der->type) {
-                    if (type->base != LY_TYPE_BITS) {
-                        LOGINT;
-                        lyd_free(new_node);
-                        lyd_free(ret);
-                        return NULL;
-                    }
-                }
-
-                new_leaf->value.bit = malloc(type->info.bits.count * sizeof *new_leaf->value.bit);
-                if (!new_leaf->value.bit) {
-                    LOGMEM;
-                    lyd_free(new_node);
-                    lyd_free(ret);
-                    return NULL;
+            if (leaf->value_type == LY_TYPE_BITS) {
+                if (lyd_bits_dup(new_leaf, leaf)) {
+                    goto error;
                 }
-                memcpy(new_leaf->value.bit, ((struct lyd_node_leaf_list *)elem)->value.bit,
-                       type->info.bits.count * sizeof *new_leaf->value.bit);
+            } else {
+                new_leaf->value = leaf->value;
             }
-            break;
-        case LYS_ANYXML:
-            new_axml = malloc(sizeof *new_axml);
-            new_node = (struct lyd_node *)new_axml;
-            if (!new_node) {
-                LOGMEM;
-                return NULL;
+            if (leaf->value_str == lyd_value_str_lazy) {
+                /* keep it lazy */
+                new_leaf->value_str = lyd_value_str_lazy;
+            } else {
+                new_leaf->value_str = dict_ref(ctx, leaf->value_str);
             }
-
-            new_axml->value = lyxml_dup_elem(elem->schema->module->ctx, ((struct lyd_node_anyxml *)elem)->value,
-                                             NULL, 1);
+            new_leaf->value_type = leaf->value_type;
             break;
-        case LYS_CONTAINER:
-        case LYS_LIST:
-        case LYS_NOTIF:
-        case LYS_RPC:
-            new_node = malloc(sizeof *new_node);
-            if (!new_node) {
-                LOGMEM;
-                return NULL;
+        case LYS_ANYXML:
+            new_axml = (struct lyd_node_anyxml *)new_node;
+            dict_unlock(ctx);
+            new_axml->value = lyxml_dup_elem(ctx, ((struct lyd_node_anyxml *)elem)->value, NULL, 1);
+            dict_lock(ctx);
+            if (!new_axml->value && ((struct lyd_node_anyxml *)elem)->value) {
+                goto error;
             }
-            new_node->child = NULL;
             break;
         default:
-            lyd_free(ret);
-            LOGINT;
-            return NULL;
-        }
-
-        /* fill common part */
-        new_node->schema = elem->schema;
-        new_node->attr = NULL;
-        LY_TREE_FOR(elem->attr, attr) {
-            lyd_dup_attr(elem->schema->module->ctx, new_node, attr);
+            break;
         }
-        new_node->next = NULL;
-        new_node->prev = new_node;
-        new_node->parent = NULL;
-        new_node->validity = LYD_VAL_NOT;
 
-        if (!ret) {
-            ret = new_node;
-        }
-        if (parent) {
-            if (lyd_insert(parent, new_node)) {
-                lyd_free(ret);
-                LOGINT;
-                return NULL;
-            }
+        if (elem->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML)) {
+            /* the same content, hashes of the other nodes are computed again with their children */
+            new_node->hash = elem->hash;
         }
 
         if (!recursive) {
@@ -1031,6 +2844,10 @@ lyd_dup(const struct lyd_node *node, int recursive)
             next = NULL;
         }
         if (!next) {
+            if (elem == node) {
+                /* the duplicated node has no children, its siblings are not duplicated */
+                break;
+            }
             /* no children, so try siblings */
             next = elem->next;
         } else {
@@ -1043,9 +2860,8 @@ lyd_dup(const struct lyd_node *node, int recursive)
                 break;
             }
             if (!parent) {
-                lyd_free(ret);
                 LOGINT;
-                return NULL;
+                goto error;
             }
             parent = parent->parent;
             /* parent is already processed, go to its sibling */
@@ -1053,7 +2869,251 @@ lyd_dup(const struct lyd_node *node, int recursive)
         }
     }
 
+    dict_unlock(ctx);
+    lyd_block_unref(blocks.cur);
+
+    if ((node->flags & LYD_NODE_RDONLY) && lyd_dup_refs(ret)) {
+        lyd_free(ret);
+        return NULL;
+    }
     return ret;
+
+error:
+    dict_unlock(ctx);
+    lyd_free(ret);
+    lyd_block_unref(blocks.cur);
+    return NULL;
+}
+
+/* parse and print all the postponed values so that reading the tree does not modify it, references
+ * copied by lyd_dup() still point to the original tree so they are resolved again (also union members, so
+ * only the value type decides), the nodes are made read-only */
+static int
+lyd_snapshot_prepare(struct lyd_node *root)
+{
+    struct lyd_node *next, *elem;
+    struct lyd_node_leaf_list *leaf;
+
+    LY_TREE_DFS_BEGIN(root, next, elem) {
+        if (elem->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
+            leaf = (struct lyd_node_leaf_list *)elem;
+            if (leaf->value_type == LY_TYPE_LEAFREF) {
+                /* a reference not found (the original tree was not valid) stays unresolved */
+                leaf->value.leafref = NULL;
+                if (resolve_unres_data_item(elem, UNRES_LEAFREF, 1, 0) == -1) {
+                    return EXIT_FAILURE;
+                }
+            } else if (leaf->value_type == LY_TYPE_INST) {
+                leaf->value.instance = NULL;
+                if (resolve_unres_data_item(elem, UNRES_INSTID, 1, 0) == -1) {
+                    return EXIT_FAILURE;
+                }
+            } else if (lyd_value_parse(leaf)) {
+                return EXIT_FAILURE;
+            }
+            lyd_value_str(leaf);
+        }
+        LY_TREE_DFS_END(root, next, elem);
+    }
+
+    /* cache the subtree hashes (lyd_diff()) of all the nodes while the tree is not shared yet */
+    lyd_subtree_hash(root);
+
+    return EXIT_SUCCESS;
+}
+
+/* set or clear the read-only flag of all the nodes of a tree */
+static void
+lyd_snapshot_rdonly(struct lyd_node *first, int rdonly)
+{
+    struct lyd_node *root, *next, *elem;
+
+    LY_TREE_FOR(first, root) {
+        LY_TREE_DFS_BEGIN(root, next, elem) {
+            if (rdonly) {
+                elem->flags |= LYD_NODE_RDONLY;
+            } else {
+                elem->flags &= ~LYD_NODE_RDONLY;
+            }
+            LY_TREE_DFS_END(root, next, elem);
+        }
+    }
+}
+
+API struct lyd_snapshot *
+lyd_snapshot_new(const struct lyd_node *node)
+{
+    struct lyd_snapshot *snap;
+    struct lyd_node *first = NULL, *dup;
+    const struct lyd_node *iter;
+
+    if (!node) {
+        ly_errno = LY_EINVAL;
+        return NULL;
+    }
+
+    snap = calloc(1, sizeof *snap);
+    if (!snap) {
+        LOGMEM;
+        return NULL;
+    }
+
+    /* the whole data tree, starting with the first sibling */
+    while (node->parent) {
+        node = node->parent;
+    }
+    while (node->prev->next) {
+        node = node->prev;
+    }
+
+    LY_TREE_FOR(node, iter) {
+        dup = lyd_dup(iter, 1);
+        if (!dup) {
+            goto error;
+        }
+
+        /* connect it as the last sibling */
+        if (!first) {
+            first = dup;
+        } else {
+            first->prev->next = dup;
+            dup->prev = first->prev;
+            first->prev = dup;
+        }
+    }
+
+    /* the whole copy is needed to resolve references */
+    LY_TREE_FOR(first, dup) {
+        if (lyd_snapshot_prepare(dup)) {
+            goto error;
+        }
+    }
+
+    lyd_snapshot_rdonly(first, 1);
+    snap->data = first;
+    snap->refcount = 1;
+    return snap;
+
+error:
+    lyd_free_withsiblings(first);
+    free(snap);
+    return NULL;
+}
+
+API struct lyd_snapshot *
+lyd_snapshot_load(struct ly_ctx *ctx, const char *path, int options)
+{
+    struct lyd_snapshot *snap;
+    struct lyd_node *iter;
+    struct stat sb;
+    char *data;
+    int fd, len;
+
+    if (!ctx || !path) {
+        LOGERR(LY_EINVAL, "%s: Invalid parameter.", __func__);
+        return NULL;
+    }
+    if (lyp_check_options(options) || (options & LYD_OPT_RPCREPLY)) {
+        LOGERR(LY_EINVAL, "%s: Invalid options.", __func__);
+        return NULL;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        LOGERR(LY_ESYS, "Failed to open data file \"%s\" (%s).", path, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &sb) == -1) {
+        LOGERR(LY_ESYS, "Failed to stat the file descriptor (%s).", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if (sb.st_size < LYB_HEADER_SIZE) {
+        LOGERR(LY_EINVAL, "%s: File \"%s\" does not contain LYB data.", __func__, path);
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOGERR(LY_ESYS, "Mapping file descriptor into memory failed.");
+        return NULL;
+    }
+
+    len = lyd_lyb_data_length(data, sb.st_size);
+    if ((len == -1) || (len > sb.st_size)) {
+        LOGERR(LY_EINVAL, "%s: File \"%s\" does not contain LYB data.", __func__, path);
+        munmap(data, sb.st_size);
+        return NULL;
+    }
+
+    snap = calloc(1, sizeof *snap);
+    if (!snap) {
+        LOGMEM;
+        munmap(data, sb.st_size);
+        return NULL;
+    }
+    /* the nodes take several times more than their binary form, start with a single block for most of them */
+    snap->arena.block_size = (size_t)len * 8;
+
+    ly_errno = LY_SUCCESS;
+    snap->data = lyd_parse_lyb(ctx, NULL, data, sb.st_size, options & ~LYD_OPT_TYPED, &snap->arena);
+    munmap(data, sb.st_size);
+    if (ly_errno) {
+        goto error;
+    }
+
+    LY_TREE_FOR(snap->data, iter) {
+        if (lyd_snapshot_prepare(iter)) {
+            goto error;
+        }
+    }
+
+    lyd_snapshot_rdonly(snap->data, 1);
+    snap->refcount = 1;
+    return snap;
+
+error:
+    lyd_free_withsiblings(snap->data);
+    lyd_arena_clean(&snap->arena);
+    free(snap);
+    return NULL;
+}
+
+API const struct lyd_node *
+lyd_snapshot_data(const struct lyd_snapshot *snap)
+{
+    if (!snap) {
+        ly_errno = LY_EINVAL;
+        return NULL;
+    }
+
+    return snap->data;
+}
+
+API struct lyd_snapshot *
+lyd_snapshot_ref(struct lyd_snapshot *snap)
+{
+    if (!snap) {
+        ly_errno = LY_EINVAL;
+        return NULL;
+    }
+
+    __sync_add_and_fetch(&snap->refcount, 1);
+    return snap;
+}
+
+API void
+lyd_snapshot_unref(struct lyd_snapshot *snap)
+{
+    if (!snap || __sync_sub_and_fetch(&snap->refcount, 1)) {
+        return;
+    }
+
+    lyd_snapshot_rdonly(snap->data, 0);
+    lyd_free_withsiblings(snap->data);
+    lyd_arena_clean(&snap->arena);
+    free(snap);
 }
 
 API void
@@ -1061,7 +3121,7 @@ lyd_free_attr(struct ly_ctx *ctx, struct lyd_node *parent, struct lyd_attr *attr
 {
     struct lyd_attr *iter;
 
-    if (!ctx || !attr) {
+    if (!ctx || !attr || lyd_check_writable(parent, __func__)) {
         return;
     }
 
@@ -1125,7 +3185,7 @@ lyd_insert_attr(struct lyd_node *parent, const char *name, const char *value)
     const char *p;
     char *aux;
 
-    if (!parent || !name || !value) {
+    if (!parent || !name || !value || lyd_check_writable(parent, __func__)) {
         return NULL;
     }
     ctx = parent->schema->module->ctx;
@@ -1171,43 +3231,84 @@ lyd_insert_attr(struct lyd_node *parent, const char *name, const char *value)
     return a;
 }
 
-API void
-lyd_free(struct lyd_node *node)
+/* free a data node without children, the dictionary is locked */
+static void
+lyd_free_node(struct ly_ctx *ctx, struct lyd_node *node)
 {
-    struct lyd_node *next, *iter;
-
-    if (!node) {
-        return;
-    }
-
-    if (!(node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML))) {
-        /* free children */
-        LY_TREE_FOR_SAFE(node->child, next, iter) {
-            lyd_free(iter);
-        }
-    } else if (node->schema->nodetype == LYS_ANYXML) {
-        lyxml_free(node->schema->module->ctx, ((struct lyd_node_anyxml *)node)->value);
-    } else { /* LYS_LEAF | LYS_LEAFLIST */
+    struct lyd_node_leaf_list *leaf;
+    struct lyd_attr *attr, *next;
+
+    if (node->schema->nodetype == LYS_ANYXML) {
+        dict_unlock(ctx);
+        lyxml_free(ctx, ((struct lyd_node_anyxml *)node)->value);
+        dict_lock(ctx);
+    } else if (node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
         /* free value */
-        switch (((struct lyd_node_leaf_list *)node)->value_type) {
+        leaf = (struct lyd_node_leaf_list *)node;
+        switch (leaf->value_type) {
         case LY_TYPE_BINARY:
         case LY_TYPE_STRING:
-            lydict_remove(node->schema->module->ctx, ((struct lyd_node_leaf_list *)node)->value.string);
+            dict_remove(ctx, leaf->value.string);
             break;
         case LY_TYPE_BITS:
-            if (((struct lyd_node_leaf_list *)node)->value.bit) {
-                free(((struct lyd_node_leaf_list *)node)->value.bit);
-            }
+            lyd_bits_free(&leaf->value, leaf->flags);
+            dict_remove(ctx, leaf->value_str);
             break;
         default:
-            lydict_remove(node->schema->module->ctx, ((struct lyd_node_leaf_list *)node)->value_str);
+            if (leaf->value_str != lyd_value_str_lazy) {
+                dict_remove(ctx, leaf->value_str);
+            }
             break;
         }
-    }
+    }
+
+    for (attr = node->attr; attr; attr = next) {
+        next = attr->next;
+        dict_remove(ctx, attr->name);
+        dict_remove(ctx, attr->value);
+        free(attr);
+    }
+
+    lyd_node_release(ctx, node);
+}
+
+API void
+lyd_free(struct lyd_node *node)
+{
+    struct lyd_node *elem, *next;
+    struct ly_ctx *ctx;
+
+    if (!node || lyd_check_writable(node, __func__)) {
+        return;
+    }
+    ctx = node->schema->module->ctx;
+
+    /* only the subtree is unlinked, its nodes are freed bottom-up without relinking them */
+    lyd_unlink(node);
+
+    /* all the strings are removed with a single dictionary lock */
+    dict_lock(ctx);
+    elem = node;
+    while (elem) {
+        /* go down to the first node without children */
+        while (!(elem->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML)) && elem->child) {
+            elem = elem->child;
+        }
+
+        /* continue with its next sibling, after the last one with the parent with no children left */
+        if (elem == node) {
+            next = NULL;
+        } else if (elem->next) {
+            next = elem->next;
+        } else {
+            next = elem->parent;
+            next->child = NULL;
+        }
 
-    lyd_unlink(node);
-    lyd_free_attr(node->schema->module->ctx, node, node->attr, 1);
-    free(node);
+        lyd_free_node(ctx, elem);
+        elem = next;
+    }
+    dict_unlock(ctx);
 }
 
 API void
@@ -1215,7 +3316,7 @@ lyd_free_withsiblings(struct lyd_node *node)
 {
     struct lyd_node *iter, *aux;
 
-    if (!node) {
+    if (!node || lyd_check_writable(node, __func__)) {
         return;
     }
 
@@ -1231,6 +3332,148 @@ lyd_free_withsiblings(struct lyd_node *node)
     }
 }
 
+uint32_t
+lyd_instance_hash(const struct lyd_node *node)
+{
+    struct lys_node_list *slist;
+    const struct lyd_node *iter;
+    const char *str;
+    uint32_t hash;
+    int i;
+
+    hash = dict_hash_multi(0, (const char *)&node->schema, sizeof node->schema);
+
+    switch (node->schema->nodetype) {
+    case LYS_LEAFLIST:
+        str = lyd_value_str((struct lyd_node_leaf_list *)node);
+        if (str) {
+            hash = dict_hash_multi(hash, str, strlen(str) + 1);
+        }
+        break;
+    case LYS_LIST:
+        slist = (struct lys_node_list *)node->schema;
+        for (i = 0; i < slist->keys_size; i++) {
+            LY_TREE_FOR(node->child, iter) {
+                if (iter->schema == (struct lys_node *)slist->keys[i]) {
+                    str = lyd_value_str((struct lyd_node_leaf_list *)iter);
+                    if (str) {
+                        hash = dict_hash_multi(hash, str, strlen(str) + 1);
+                    }
+                    break;
+                }
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+static ssize_t
+lyd_subtree_hash_clb(void *arg, const void *buf, size_t count)
+{
+    *(uint32_t *)arg = dict_hash_multi(*(uint32_t *)arg, (const char *)buf, count);
+    return count;
+}
+
+uint32_t
+lyd_subtree_hash(struct lyd_node *node)
+{
+    struct lyd_node *child;
+    const char *str;
+    uint32_t hash, chash;
+
+    if (node->flags & LYD_NODE_RDONLY) {
+        /* computed before the snapshot was shared */
+        assert(node->hash);
+        return node->hash;
+    }
+    hash = __sync_fetch_and_add(&node->hash, 0);
+    if (hash) {
+        return hash;
+    }
+
+    hash = dict_hash_multi(0, (const char *)&node->schema, sizeof node->schema);
+
+    switch (node->schema->nodetype) {
+    case LYS_LEAF:
+    case LYS_LEAFLIST:
+        str = lyd_value_str((struct lyd_node_leaf_list *)node);
+        if (str) {
+            hash = dict_hash_multi(hash, str, strlen(str) + 1);
+        }
+        break;
+    case LYS_ANYXML:
+        if (((struct lyd_node_anyxml *)node)->value) {
+            lyxml_print_clb(lyd_subtree_hash_clb, &hash, ((struct lyd_node_anyxml *)node)->value, 0);
+        }
+        break;
+    default:
+        /* the order of the children matters, it can be significant (user-ordered lists) */
+        LY_TREE_FOR(node->child, child) {
+            chash = lyd_subtree_hash(child);
+            hash = dict_hash_multi(hash, (const char *)&chash, sizeof chash);
+        }
+        break;
+    }
+
+    hash = dict_hash_multi(hash, NULL, 0);
+    if (!hash) {
+        /* reserved for not computed */
+        hash = 1;
+    }
+    /* the tree is only being read, possibly by other threads computing the same hash */
+    __sync_bool_compare_and_swap(&node->hash, 0, hash);
+    return hash;
+}
+
+int
+lyd_subtree_equal(const struct lyd_node *node1, const struct lyd_node *node2)
+{
+    const struct lyd_node *child1, *child2;
+    char *str1 = NULL, *str2 = NULL;
+    int ret;
+
+    if (node1->schema != node2->schema) {
+        return 0;
+    }
+
+    switch (node1->schema->nodetype) {
+    case LYS_LEAF:
+    case LYS_LEAFLIST:
+        /* both in the dictionary of the same context */
+        return ly_strequal(lyd_value_str((struct lyd_node_leaf_list *)node1),
+                           lyd_value_str((struct lyd_node_leaf_list *)node2), 1);
+    case LYS_ANYXML:
+        if (((struct lyd_node_anyxml *)node1)->value) {
+            lyxml_print_mem(&str1, ((struct lyd_node_anyxml *)node1)->value, 0);
+        }
+        if (((struct lyd_node_anyxml *)node2)->value) {
+            lyxml_print_mem(&str2, ((struct lyd_node_anyxml *)node2)->value, 0);
+        }
+        ret = (!str1 && !str2) || (str1 && str2 && !strcmp(str1, str2));
+        free(str1);
+        free(str2);
+        return ret;
+    default:
+        for (child1 = node1->child, child2 = node2->child;
+                child1 && child2 && lyd_subtree_equal(child1, child2);
+                child1 = child1->next, child2 = child2->next);
+        return !child1 && !child2;
+    }
+}
+
+void
+lyd_hash_invalidate(struct lyd_node *node)
+{
+    /* a parent of a node without a valid hash cannot have a valid one either */
+    for (; node && node->hash; node = node->parent) {
+        node->hash = 0;
+    }
+}
+
 int
 lyd_compare(struct lyd_node *first, struct lyd_node *second, int unique)
 {
@@ -1250,8 +3493,8 @@ lyd_compare(struct lyd_node *first, struct lyd_node *second, int unique)
     switch (first->schema->nodetype) {
     case LYS_LEAFLIST:
         /* compare values */
-        if (ly_strequal(((struct lyd_node_leaf_list *)first)->value_str,
-                        ((struct lyd_node_leaf_list *)second)->value_str, 1)) {
+        if (ly_strequal(lyd_value_str((struct lyd_node_leaf_list *)first),
+                        lyd_value_str((struct lyd_node_leaf_list *)second), 1)) {
             return 0;
         }
         return 1;
@@ -1265,7 +3508,7 @@ lyd_compare(struct lyd_node *first, struct lyd_node *second, int unique)
                     /* first */
                     diter = resolve_data_descendant_schema_nodeid(slist->unique[i].expr[j], first->child);
                     if (diter) {
-                        val1 = ((struct lyd_node_leaf_list *)diter)->value_str;
+                        val1 = lyd_value_str((struct lyd_node_leaf_list *)diter);
                     } else {
                         /* use default value */
                         if (resolve_descendant_schema_nodeid(slist->unique[i].expr[j], first->schema->child, LYS_LEAF, &snode)) {
@@ -1278,7 +3521,7 @@ lyd_compare(struct lyd_node *first, struct lyd_node *second, int unique)
                     /* second */
                     diter = resolve_data_descendant_schema_nodeid(slist->unique[i].expr[j], second->child);
                     if (diter) {
-                        val2 = ((struct lyd_node_leaf_list *)diter)->value_str;
+                        val2 = lyd_value_str((struct lyd_node_leaf_list *)diter);
                     } else {
                         /* use default value */
                         if (resolve_descendant_schema_nodeid(slist->unique[i].expr[j], second->schema->child, LYS_LEAF, &snode)) {
@@ -1297,11 +3540,11 @@ lyd_compare(struct lyd_node *first, struct lyd_node *second, int unique)
                     return 0;
                 }
             }
-        }
 
-        if (second->validity == LYD_VAL_UNIQUE) {
-            /* only unique part changed somewhere, so it is no need to check keys */
-            return 0;
+            if (second->validity == LYD_VAL_UNIQUE) {
+                /* only unique part changed somewhere, so it is no need to check keys */
+                return 0;
+            }
         }
 
         /* compare keys */
@@ -1310,13 +3553,13 @@ lyd_compare(struct lyd_node *first, struct lyd_node *second, int unique)
             val1 = val2 = NULL;
             LY_TREE_FOR(first->child, diter) {
                 if (diter->schema == snode) {
-                    val1 = ((struct lyd_node_leaf_list *)diter)->value_str;
+                    val1 = lyd_value_str((struct lyd_node_leaf_list *)diter);
                     break;
                 }
             }
             LY_TREE_FOR(second->child, diter) {
                 if (diter->schema == snode) {
-                    val2 = ((struct lyd_node_leaf_list *)diter)->value_str;
+                    val2 = lyd_value_str((struct lyd_node_leaf_list *)diter);
                     break;
                 }
             }
@@ -1332,12 +3575,55 @@ lyd_compare(struct lyd_node *first, struct lyd_node *second, int unique)
     }
 }
 
+/**
+ * @brief Convert the result of an XPath evaluation into a set of data nodes and clean it.
+ *
+ * @param[in] xp_set Evaluated XPath set.
+ * @param[in] data Context node of the evaluation.
+ * @return Set of found data nodes, NULL on error.
+ */
+static struct ly_set *
+lyd_xpath_set2ly_set(struct lyxp_set *xp_set, const struct lyd_node *data)
+{
+    struct ly_set *set;
+    uint32_t i;
+
+    set = ly_set_new();
+    if (!set) {
+        LOGMEM;
+        lyxp_set_cast(xp_set, LYXP_SET_EMPTY, data, 0);
+        return NULL;
+    }
+
+    if (xp_set->type == LYXP_SET_NODE_SET) {
+        /* XPath node set has no duplicates, only a text node may follow its element */
+        set->set = malloc(xp_set->used * sizeof *set->set);
+        if (!set->set) {
+            LOGMEM;
+            ly_set_free(set);
+            lyxp_set_cast(xp_set, LYXP_SET_EMPTY, data, 0);
+            return NULL;
+        }
+        set->size = xp_set->used;
+
+        for (i = 0; i < xp_set->used; ++i) {
+            if ((xp_set->node_type[i] == LYXP_NODE_ELEM) || (xp_set->node_type[i] == LYXP_NODE_TEXT)) {
+                if (set->number && (set->set[set->number - 1] == xp_set->value.nodes[i])) {
+                    continue;
+                }
+                set->set[set->number++] = xp_set->value.nodes[i];
+            }
+        }
+    }
+    lyxp_set_cast(xp_set, LYXP_SET_EMPTY, data, 0);
+
+    return set;
+}
+
 API struct ly_set *
 lyd_get_node(const struct lyd_node *data, const char *expr)
 {
     struct lyxp_set xp_set;
-    struct ly_set *set;
-    uint16_t i;
 
     if (!data || !expr) {
         ly_errno = LY_EINVAL;
@@ -1350,35 +3636,172 @@ lyd_get_node(const struct lyd_node *data, const char *expr)
         return NULL;
     }
 
-    set = ly_set_new();
-    if (!set) {
-        LOGMEM;
+    return lyd_xpath_set2ly_set(&xp_set, data);
+}
+
+API struct lyxp_expr *
+lyd_xpath_compile(const char *expr)
+{
+    if (!expr) {
+        ly_errno = LY_EINVAL;
         return NULL;
     }
 
-    if (xp_set.type == LYXP_SET_NODE_SET) {
-        for (i = 0; i < xp_set.used; ++i) {
-            if ((xp_set.node_type[i] == LYXP_NODE_ELEM) || (xp_set.node_type[i] == LYXP_NODE_TEXT)) {
-                if (ly_set_add(set, xp_set.value.nodes[i])) {
-                    ly_set_free(set);
-                    set = NULL;
-                    break;
-                }
-            }
+    return lyxp_compile(expr, 0);
+}
+
+API void
+lyd_xpath_free(struct lyxp_expr *exp)
+{
+    lyxp_expr_free(exp);
+}
+
+API struct ly_set *
+lyd_get_node_compiled(const struct lyd_node *data, const struct lyxp_expr *exp)
+{
+    struct lyxp_set xp_set;
+
+    if (!data || !exp) {
+        ly_errno = LY_EINVAL;
+        return NULL;
+    }
+
+    memset(&xp_set, 0, sizeof xp_set);
+
+    if (lyxp_eval_compiled((struct lyxp_expr *)exp, data, &xp_set, 0, 0) != EXIT_SUCCESS) {
+        return NULL;
+    }
+
+    return lyd_xpath_set2ly_set(&xp_set, data);
+}
+
+/**
+ * @brief Append a node into a set without checking for duplicates.
+ *
+ * @param[in] set Set to append to.
+ * @param[in] node Node to append.
+ * @return EXIT_SUCCESS or EXIT_FAILURE on memory allocation failure.
+ */
+static int
+lyd_set_append(struct ly_set *set, void *node)
+{
+    void **new;
+    unsigned int size;
+
+    if (set->number == set->size) {
+        size = (set->size ? set->size * 2 : 8);
+        new = realloc(set->set, size * sizeof *(set->set));
+        if (!new) {
+            LOGMEM;
+            return EXIT_FAILURE;
         }
+        set->size = size;
+        set->set = new;
     }
-    lyxp_set_cast(&xp_set, LYXP_SET_EMPTY, data, 0);
 
-    return set;
+    set->set[set->number++] = node;
+
+    return EXIT_SUCCESS;
 }
 
 API struct ly_set *
 lyd_get_node2(const struct lyd_node *data, const struct lys_node *schema)
 {
-    struct ly_set *ret, *ret_aux, *spath;
+    struct lyd_find_iter *iter;
+    struct lyd_node *node;
+    struct ly_set *ret;
+
+    iter = lyd_find_iter_new2(data, schema);
+    if (!iter) {
+        return NULL;
+    }
+
+    ret = ly_set_new();
+    if (!ret) {
+        LOGMEM;
+        goto error;
+    }
+
+    /* all the found nodes are distinct */
+    while ((node = lyd_find_iter_next(iter))) {
+        if (lyd_set_append(ret, node)) {
+            goto error;
+        }
+    }
+
+    lyd_find_iter_free(iter);
+    return ret;
+
+error:
+    lyd_find_iter_free(iter);
+    ly_set_free(ret);
+
+    return NULL;
+}
+
+API struct lyd_find_iter *
+lyd_find_iter_new(const struct lyd_node *data, const char *expr)
+{
+    struct lyd_find_iter *iter;
+    int absolute, count;
+
+    if (!data || !expr) {
+        ly_errno = LY_EINVAL;
+        return NULL;
+    }
+
+    iter = calloc(1, sizeof *iter);
+    if (!iter) {
+        LOGMEM;
+        return NULL;
+    }
+
+    iter->exp = lyxp_compile(expr, 0);
+    if (!iter->exp) {
+        goto error;
+    }
+
+    count = lyxp_path_steps(iter->exp, data->schema->module->ctx, &absolute, &iter->steps);
+    if (count == -1) {
+        goto error;
+    } else if (!count) {
+        /* not a simple location path, get all the matches at once */
+        iter->set = lyd_get_node_compiled(data, iter->exp);
+        if (!iter->set) {
+            goto error;
+        }
+        return iter;
+    }
+
+    iter->count = count;
+    iter->nodes = malloc(count * sizeof *iter->nodes);
+    if (!iter->nodes) {
+        LOGMEM;
+        goto error;
+    }
+
+    if (absolute) {
+        /* the same root as lyxp_eval() uses */
+        for (; data->parent; data = data->parent);
+        iter->first = (struct lyd_node *)data;
+    } else if (!(data->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML))) {
+        iter->first = data->child;
+    }
+
+    return iter;
+
+error:
+    lyd_find_iter_free(iter);
+    return NULL;
+}
+
+API struct lyd_find_iter *
+lyd_find_iter_new2(const struct lyd_node *data, const struct lys_node *schema)
+{
+    struct lyd_find_iter *iter;
     const struct lys_node *siter;
-    struct lyd_node *iter;
-    unsigned int i, j;
+    uint32_t i;
+    int pass;
 
     if (!data || !schema ||
             !(schema->nodetype & (LYS_CONTAINER | LYS_LEAF | LYS_LIST | LYS_ANYXML | LYS_NOTIF | LYS_RPC))) {
@@ -1386,11 +3809,45 @@ lyd_get_node2(const struct lyd_node *data, const struct lys_node *schema)
         return NULL;
     }
 
-    ret = ly_set_new();
-    spath = ly_set_new();
-    if (!ret || !spath) {
+    iter = calloc(1, sizeof *iter);
+    if (!iter) {
         LOGMEM;
-        goto error;
+        return NULL;
+    }
+
+    /* build schema path, the data nodes are counted in the first pass */
+    for (pass = 0; pass < 2; pass++) {
+        i = iter->count;
+        for (siter = schema; siter; ) {
+            if (siter->nodetype == LYS_AUGMENT) {
+                siter = ((struct lys_node_augment *)siter)->target;
+                continue;
+            } else if (siter->nodetype == LYS_OUTPUT) {
+                /* done for RPC reply */
+                break;
+            } else if (siter->nodetype & (LYS_CONTAINER | LYS_LEAF | LYS_LIST | LYS_ANYXML | LYS_NOTIF | LYS_RPC)) {
+                /* standard data node */
+                if (pass) {
+                    iter->snodes[--i] = siter;
+                } else {
+                    ++iter->count;
+                }
+            } /* else skip the rest node types */
+            siter = siter->parent;
+        }
+
+        if (!pass) {
+            if (!iter->count) {
+                /* no valid path */
+                goto error;
+            }
+            iter->snodes = malloc(iter->count * sizeof *iter->snodes);
+            iter->nodes = malloc(iter->count * sizeof *iter->nodes);
+            if (!iter->snodes || !iter->nodes) {
+                LOGMEM;
+                goto error;
+            }
+        }
     }
 
     /* find data root */
@@ -1402,63 +3859,93 @@ lyd_get_node2(const struct lyd_node *data, const struct lys_node *schema)
         /* horizontal move (left) */
         data = data->prev;
     }
+    iter->first = (struct lyd_node *)data;
 
-    /* build schema path */
-    for (siter = schema; siter; ) {
-        if (siter->nodetype == LYS_AUGMENT) {
-            siter = ((struct lys_node_augment *)siter)->target;
-            continue;
-        } else if (siter->nodetype == LYS_OUTPUT) {
-            /* done for RPC reply */
-            break;
-        } else if (siter->nodetype & (LYS_CONTAINER | LYS_LEAF | LYS_LIST | LYS_ANYXML | LYS_NOTIF | LYS_RPC)) {
-            /* standard data node */
-            ly_set_add(spath, (void*)siter);
+    return iter;
 
-        } /* else skip the rest node types */
-        siter = siter->parent;
-    }
-    if (!spath->number) {
-        /* no valid path */
-        goto error;
+error:
+    lyd_find_iter_free(iter);
+    return NULL;
+}
+
+API struct lyd_node *
+lyd_find_iter_next(struct lyd_find_iter *iter)
+{
+    struct lyd_node *node;
+    uint32_t i;
+
+    if (!iter) {
+        ly_errno = LY_EINVAL;
+        return NULL;
     }
 
-    /* start searching */
-    LY_TREE_FOR((struct lyd_node *)data, iter) {
-        if (iter->schema == spath->sset[spath->number - 1]) {
-            ly_set_add(ret, iter);
+    if (iter->set) {
+        if (iter->pos < iter->set->number) {
+            return iter->set->dset[iter->pos++];
         }
+        return NULL;
     }
-    for (i = spath->number - 1; i; i--) {
-        if (!ret->number) {
-            /* nothing found */
-            break;
-        }
 
-        ret_aux = ly_set_new();
-        if (!ret_aux) {
-            LOGMEM;
-            goto error;
+    if (iter->state == 2) {
+        return NULL;
+    } else if (!iter->state) {
+        iter->state = 1;
+        i = 0;
+        node = iter->first;
+    } else {
+        /* continue after the last match */
+        i = iter->count - 1;
+        node = iter->nodes[i]->next;
+    }
+
+    while (1) {
+        /* find the next matching sibling */
+        if (iter->snodes) {
+            for (; node && (node->schema != iter->snodes[i]); node = node->next);
+        } else {
+            for (; node && !lyxp_path_step_match(&iter->steps[i], node); node = node->next);
         }
-        for (j = 0; j < ret->number; j++) {
-            LY_TREE_FOR(ret->dset[j]->child, iter) {
-                if (iter->schema == spath->sset[i - 1]) {
-                    ly_set_add(ret_aux, iter);
-                }
+
+        if (!node) {
+            if (!i) {
+                /* done */
+                iter->state = 2;
+                return NULL;
             }
+            /* no more children, continue with the next sibling of the parent */
+            --i;
+            node = iter->nodes[i]->next;
+            continue;
         }
-        ly_set_free(ret);
-        ret = ret_aux;
-    }
 
-    ly_set_free(spath);
-    return ret;
+        iter->nodes[i] = node;
+        if (i == iter->count - 1) {
+            return node;
+        }
 
-error:
-    ly_set_free(ret);
-    ly_set_free(spath);
+        /* next step */
+        if (node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML)) {
+            node = node->next;
+        } else {
+            ++i;
+            node = node->child;
+        }
+    }
+}
 
-    return NULL;
+API void
+lyd_find_iter_free(struct lyd_find_iter *iter)
+{
+    if (!iter) {
+        return;
+    }
+
+    lyxp_expr_free(iter->exp);
+    free(iter->steps);
+    free(iter->snodes);
+    free(iter->nodes);
+    ly_set_free(iter->set);
+    free(iter);
 }
 
 API struct ly_set *
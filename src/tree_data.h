@@ -48,6 +48,8 @@ typedef enum {
     LYD_XML,             /**< XML format of the instance data */
     LYD_XML_FORMAT,      /**< For input data, it is interchangeable with #LYD_XML, for output it formats XML with indentantion */
     LYD_JSON,            /**< JSON format of the instance data */
+    LYD_LYB,             /**< LYB (binary) format of the instance data, it can be read only with the same schemas
+                              in the context, see lyd_lyb_data_length() */
 } LYD_FORMAT;
 
 /**
@@ -74,8 +76,10 @@ struct lyd_attr {
  */
 typedef union lyd_value_u {
     const char *binary;          /**< base64 encoded, NULL terminated string */
-    struct lys_type_bit **bit;   /**< bitmap of pointers to the schema definition of the bit value that are set,
-                                      its size is always the number of defined bits in the schema */
+    uint64_t bits;               /**< bitmap of the bits that are set if the type defines at most 64 bits, the bit
+                                      definition index is the bit index, always access it using lyd_bits_isset() */
+    uint64_t *bits_ext;          /**< bitmap of the bits that are set if the type defines more than 64 bits
+                                      (internal, #LYD_NODE_BITS_EXT is set, see lyd_bits_isset()) */
     int8_t bln;                  /**< 0 as false, 1 as true */
     int64_t dec64;               /**< decimal64: value = dec64 / 10^fraction-digits  */
     struct lys_type_enum *enm;   /**< pointer to the schema definition of the enumeration value */
@@ -110,6 +114,23 @@ typedef union lyd_value_u {
  * @}
  */
 
+/**
+ * @defgroup dnodeflags Data node flags
+ * @ingroup datatree
+ *
+ * Flags of data nodes set by the library.
+ *
+ * @{
+ */
+#define LYD_NODE_RDONLY  0x01    /**< node is part of a read-only data tree (snapshot), all the functions modifying it fail */
+#define LYD_NODE_ARENA   0x02    /**< node is allocated in the memory block of its snapshot (internal) */
+#define LYD_NODE_BLOCK   0x04    /**< node is allocated in a memory block shared with the other nodes duplicated
+                                      together (internal) */
+#define LYD_NODE_BITS_EXT 0x08   /**< #LY_TYPE_BITS value of the node is stored in ::lyd_value_u#bits_ext (internal) */
+/**
+ * @}
+ */
+
 /**
  * @brief Generic structure for a data node, directly applicable to the data nodes defined as #LYS_CONTAINER, #LYS_LIST
  * and #LYS_CHOICE.
@@ -125,6 +146,9 @@ typedef union lyd_value_u {
 struct lyd_node {
     struct lys_node *schema;         /**< pointer to the schema definition of this node */
     uint8_t validity;                /**< [validity flags](@ref validityflags) */
+    uint8_t flags;                   /**< [data node flags](@ref dnodeflags) */
+    uint32_t hash;                   /**< cached hash of the subtree content maintained by the library, 0 if not
+                                          computed (see lyd_diff()) */
 
     struct lyd_attr *attr;           /**< pointer to the list of attributes of this node */
     struct lyd_node *next;           /**< pointer to the next sibling node (NULL if there is no one) */
@@ -146,7 +170,9 @@ struct lyd_node {
  * Extension for ::lyd_node structure. It replaces the ::lyd_node#child member by
  * three new members (#value, #value_str and #value_type) to provide
  * information about the value. The first five members (#schema, #attr, #next,
- * #prev and #parent) are compatible with the ::lyd_node's members.
+ * #prev and #parent) are compatible with the ::lyd_node's members. The #value_type
+ * member is stored in the padding after #validity and #flags (as is #hash in all the data node
+ * structures) so that it does not enlarge the node.
  *
  * To traverse through all the child elements or attributes, use #LY_TREE_FOR or #LY_TREE_FOR_SAFE macro.
  */
@@ -154,6 +180,13 @@ struct lyd_node_leaf_list {
     struct lys_node *schema;         /**< pointer to the schema definition of this node which is ::lys_node_leaflist
                                           structure */
     uint8_t validity;                /**< [validity flags](@ref validityflags) */
+    uint8_t flags;                   /**< [data node flags](@ref dnodeflags) */
+    uint8_t value_type;              /**< type of the value in the node (#LY_DATA_TYPE possibly with the
+                                          #LY_TYPE_LEAFREF_UNRES or #LY_TYPE_INST_UNRES flag), mainly for union to
+                                          avoid repeating of type detection, #LY_TYPE_DER if the value was not
+                                          parsed yet (#LYD_OPT_LAZY) */
+    uint32_t hash;                   /**< cached hash of the subtree content maintained by the library, 0 if not
+                                          computed (see lyd_diff()) */
 
     struct lyd_attr *attr;           /**< pointer to the list of attributes of this node */
     struct lyd_node *next;           /**< pointer to the next sibling node (NULL if there is no one) */
@@ -166,9 +199,9 @@ struct lyd_node_leaf_list {
     /* struct lyd_node *child; should be here, but is not */
 
     /* leaflist's specific members */
-    const char *value_str;           /**< string representation of value (for comparison, printing,...) */
+    const char *value_str;           /**< string representation of value (for comparison, printing,...), use
+                                          lyd_value_str() for data parsed with #LYD_OPT_TYPED */
     lyd_val value;                   /**< node's value representation */
-    LY_DATA_TYPE value_type;         /**< type of the value in the node, mainly for union to avoid repeating of type detection */
 };
 
 /**
@@ -183,6 +216,9 @@ struct lyd_node_anyxml {
     struct lys_node *schema;         /**< pointer to the schema definition of this node which is ::lys_node_anyxml
                                           structure */
     uint8_t validity;                /**< [validity flags](@ref validityflags) */
+    uint8_t flags;                   /**< [data node flags](@ref dnodeflags) */
+    uint32_t hash;                   /**< cached hash of the subtree content maintained by the library, 0 if not
+                                          computed (see lyd_diff()) */
 
     struct lyd_attr *attr;           /**< pointer to the list of attributes of this node */
     struct lyd_node *next;           /**< pointer to the next sibling node (NULL if there is no one) */
@@ -271,6 +307,25 @@ struct lyd_node_anyxml {
                                        are connected with the schema, but the most validation checks (mandatory nodes,
                                        list instance uniqueness, etc.) are not performed. This option does not make
                                        sense for lyd_validate() so it is ignored by this function. */
+#define LYD_OPT_TYPED      0x2000 /**< Leaves and leaflists of numeric, boolean and enumeration types (not unions) keep
+                                       only the typed value, their ::lyd_node_leaf_list#value_str is created from the
+                                       value on demand by lyd_value_str() (and cached), so it must not be accessed
+                                       directly. The string representation is the canonical one. With XML input,
+                                       the string is still stored in the dictionary while the XML document is
+                                       being parsed and it is released once the value is parsed, so the option
+                                       saves memory of the resulting tree but not the parsing work. */
+#define LYD_OPT_CHANGED    0x4000 /**< Applicable only to lyd_validate(), the data were already validated and then
+                                       modified. The when and must conditions of the previously validated nodes are
+                                       re-evaluated only if they depend on a changed node (according to
+                                       ::lys_node#cond_deps), the conditions of the new and changed nodes are always
+                                       checked. Removing a top-level node is not tracked, validate the data without
+                                       this option in such a case. */
+#define LYD_OPT_LAZY       0x8000 /**< Applicable only together with #LYD_OPT_TRUSTED, the values of leaves and
+                                       leaflists are not parsed either (unless combined with #LYD_OPT_FILTER,
+                                       #LYD_OPT_EDIT, #LYD_OPT_GET or #LYD_OPT_GETCONFIG), only their string
+                                       representation is stored and the ::lyd_node_leaf_list#value_type is
+                                       #LY_TYPE_DER. The typed value is parsed by lyd_value_parse() (called implicitly
+                                       by printers and lyd_validate()). #LYD_OPT_TYPED is ignored for such values. */
 
 /**@} parseroptions */
 
@@ -282,6 +337,11 @@ struct lyd_node_anyxml {
  * returned data node is a root of the first tree with other trees connected via the next pointer.
  * This behavior can be changed by #LYD_OPT_NOSIBLINGS option.
  *
+ * In case of LYD_LYB format, the data length is stored in the data themselves (see lyd_lyb_data_length())
+ * and the buffer must contain all of it, lyd_parse_fd() and lyd_parse_path() check it against the file size.
+ * The values of the numeric, boolean and enumeration types are read in their binary form, with
+ * #LYD_OPT_TRUSTED they are not checked and no validation is performed at all.
+ *
  * @param[in] ctx Context to connect with the data tree being built here.
  * @param[in] data Serialized data in the specified format.
  * @param[in] format Format of the input data to be parsed.
@@ -339,6 +399,17 @@ struct lyd_node *lyd_parse_fd(struct ly_ctx *ctx, int fd, LYD_FORMAT format, int
  */
 struct lyd_node *lyd_parse_path(struct ly_ctx *ctx, const char *path, LYD_FORMAT format, int options, ...);
 
+/**
+ * @brief Get the length of data in the #LYD_LYB format, for example printed by lyd_print_mem().
+ *
+ * Only the header of the data is read, so it can be used to learn how much data to read.
+ *
+ * @param[in] data LYB data.
+ * @param[in] size Size of the buffer with the data, at least the size of the header.
+ * @return Length of the data in bytes, -1 if they are not LYB data. The length can exceed \p size.
+ */
+int lyd_lyb_data_length(const char *data, size_t size);
+
 /**
  * @brief Parse (and validate according to appropriate schema from the given context) XML tree.
  *
@@ -407,6 +478,37 @@ struct lyd_node *lyd_new_leaf(struct lyd_node *parent, const struct lys_module *
  */
 int lyd_change_leaf(struct lyd_node_leaf_list *leaf, const char *val_str);
 
+/**
+ * @brief Get the string representation of a leaf or leaflist value. Unlike accessing
+ * ::lyd_node_leaf_list#value_str directly, it works also for the values parsed with #LYD_OPT_TYPED,
+ * whose string representation is created (and cached in the node) on the first access. It can be called
+ * concurrently by several threads reading the same data tree.
+ *
+ * @param[in] leaf Leaf or leaflist node.
+ * @return String representation of the value stored in the dictionary, NULL if the node has no value.
+ */
+const char *lyd_value_str(const struct lyd_node_leaf_list *leaf);
+
+/**
+ * @brief Parse the typed value of a leaf or leaflist whose parsing was postponed by #LYD_OPT_LAZY
+ * (::lyd_node_leaf_list#value_type is #LY_TYPE_DER). Leafref and instance-identifier values are resolved
+ * against the current data tree. Does nothing for an already parsed value.
+ *
+ * @param[in] leaf Leaf or leaflist node.
+ * @return 0 on success, non-zero on error (the value stays unparsed).
+ */
+int lyd_value_parse(struct lyd_node_leaf_list *leaf);
+
+/**
+ * @brief Check whether a bit is set in a value of the #LY_TYPE_BITS type.
+ *
+ * @param[in] leaf Leaf or leaflist node with the #LY_TYPE_BITS value type.
+ * @param[in] idx Index of the bit definition in the bit array of the type defining the bits, the definitions
+ * are ordered by their positions.
+ * @return 1 if the bit is set, 0 otherwise.
+ */
+int lyd_bits_isset(const struct lyd_node_leaf_list *leaf, uint32_t idx);
+
 /**
  * @brief Create a new anyxml node in a data tree.
  *
@@ -450,12 +552,78 @@ struct lyd_node *lyd_output_new_anyxml(const struct lys_node *schema, const char
  * @brief Create a copy of the specified data tree \p node. Namespaces are copied as needed,
  * schema references are kept the same.
  *
+ * The leafref and instance-identifier values of a copy of a snapshot (see lyd_snapshot_new()) are resolved
+ * in the copy, so it can outlive the snapshot. Those referring outside of the copy are left unresolved.
+ *
  * @param[in] node Data tree node to be duplicated.
  * @param[in] recursive 1 if all children are supposed to be also duplicated.
  * @return Created copy of the provided data \p node.
  */
 struct lyd_node *lyd_dup(const struct lyd_node *node, int recursive);
 
+/**
+ * @brief Opaque structure of a data tree snapshot, see lyd_snapshot_new().
+ */
+struct lyd_snapshot;
+
+/**
+ * @brief Create a read-only snapshot of the whole data tree \p node is part of, to be shared by readers while
+ * the original tree is being modified.
+ *
+ * The snapshot is a copy made once, all its postponed values (#LYD_OPT_LAZY, #LYD_OPT_TYPED) are
+ * parsed and printed during its creation, so any number of threads can read it at the same time (using only
+ * functions not modifying the tree). Creating it costs a copy of the whole tree (allocated in blocks by lyd_dup()),
+ * the snapshots do not share unchanged subtrees with each other because every node links to its parent and
+ * siblings, so create them per a batch of changes rather than per a single change. Every reader holds its own reference acquired by lyd_snapshot_ref()
+ * and releases it by lyd_snapshot_unref(), the last one frees the snapshot. Its data must be freed
+ * before the context they belong to is destroyed.
+ *
+ * @param[in] node Any node of the data tree.
+ * @return Created snapshot with a single reference owned by the caller, NULL on error (also when a postponed
+ * value is invalid).
+ */
+struct lyd_snapshot *lyd_snapshot_new(const struct lyd_node *node);
+
+/**
+ * @brief Get the data tree of a snapshot. It must not be modified.
+ *
+ * @param[in] snap Snapshot to read.
+ * @return The first top-level node of the snapshot data tree.
+ */
+const struct lyd_node *lyd_snapshot_data(const struct lyd_snapshot *snap);
+
+/**
+ * @brief Acquire another reference to a snapshot. Thread-safe.
+ *
+ * @param[in] snap Snapshot to reference.
+ * @return \p snap
+ */
+struct lyd_snapshot *lyd_snapshot_ref(struct lyd_snapshot *snap);
+
+/**
+ * @brief Release a reference to a snapshot, the snapshot is freed with the last one. Thread-safe.
+ *
+ * @param[in] snap Snapshot to release.
+ */
+void lyd_snapshot_unref(struct lyd_snapshot *snap);
+
+/**
+ * @brief Load a read-only snapshot from a file with data in the #LYD_LYB format, typically a large and
+ * rarely changing tree prebuilt by lyd_print_file().
+ *
+ * The file is memory-mapped and all the nodes are allocated in a single memory block of the snapshot, there is
+ * no allocation per node. Values of the numeric, boolean and enumeration types are read directly in their
+ * binary form. The snapshot is then used and released the same way as the one created by lyd_snapshot_new().
+ * To modify the data, duplicate them by lyd_dup().
+ *
+ * @param[in] ctx Context with the schemas of the data.
+ * @param[in] path Path to the file.
+ * @param[in] options [Parser options](@ref parseroptions), with #LYD_OPT_TRUSTED the data are not validated.
+ * #LYD_OPT_TYPED is ignored.
+ * @return Loaded snapshot with a single reference owned by the caller, NULL on error.
+ */
+struct lyd_snapshot *lyd_snapshot_load(struct ly_ctx *ctx, const char *path, int options);
+
 /**
  * @brief Insert the \p node element as child to the \p parent element. The \p node is inserted as a last child of the
  * \p parent.
@@ -507,6 +675,41 @@ int lyd_insert_after(struct lyd_node *sibling, struct lyd_node *node);
  */
 struct ly_set *lyd_get_node(const struct lyd_node *data, const char *expr);
 
+/**
+ * @brief Opaque structure of a compiled XPath expression, see lyd_xpath_compile().
+ */
+struct lyxp_expr;
+
+/**
+ * @brief Compile an XPath expression for repeated searches with lyd_get_node_compiled(). The expression
+ * is parsed and its syntax checked only once, node names are resolved on every search.
+ *
+ * @param[in] expr XPath expression in the same format as for lyd_get_node(). The compiled expression
+ * keeps its own copy of it.
+ * @return Compiled expression to be freed with lyd_xpath_free(), NULL on error.
+ */
+struct lyxp_expr *lyd_xpath_compile(const char *expr);
+
+/**
+ * @brief Free an expression compiled by lyd_xpath_compile().
+ *
+ * @param[in] exp Compiled expression to free, can be NULL.
+ */
+void lyd_xpath_free(struct lyxp_expr *exp);
+
+/**
+ * @brief Search in the given data for instances of nodes matching the precompiled XPath expression.
+ * Equivalent to lyd_get_node(), but the expression is not parsed again. A compiled expression is not
+ * modified by the search so it can be used concurrently from several threads.
+ *
+ * @param[in] data A node in the data tree considered the context node. If the node is a configuration one,
+ * any state nodes in its tree are not accessible!
+ * @param[in] exp XPath expression compiled by lyd_xpath_compile().
+ * @return Set of found data nodes (use dset member of ::ly_set). If no nodes are matching \p exp or the result
+ * would be a number, a string, or a boolean, the returned set is empty. In case of an error, NULL is returned.
+ */
+struct ly_set *lyd_get_node_compiled(const struct lyd_node *data, const struct lyxp_expr *exp);
+
 /**
  * @brief Search in the given data for instances of the provided schema node.
  *
@@ -519,6 +722,51 @@ struct ly_set *lyd_get_node(const struct lyd_node *data, const char *expr);
  */
 struct ly_set *lyd_get_node2(const struct lyd_node *data, const struct lys_node *schema);
 
+/**
+ * @brief Opaque iterator over the data nodes matching a path, see lyd_find_iter_new().
+ */
+struct lyd_find_iter;
+
+/**
+ * @brief Create an iterator over the instances of nodes matching the provided XPath expression.
+ *
+ * The iterator returns the same nodes as lyd_get_node() in the same (document) order. If \p expr is a simple
+ * location path, only node names (optionally prefixed or '*') joined by '/', the nodes are searched lazily
+ * by lyd_find_iter_next(), so the matches are never collected and the search can be stopped at any time.
+ * Other expressions are evaluated at once by this function. The data tree must not be modified while
+ * iterating.
+ *
+ * @param[in] data A node in the data tree considered the context node.
+ * @param[in] expr XPath expression filtering the matching nodes.
+ * @return Iterator to be freed with lyd_find_iter_free(), NULL in case of an error.
+ */
+struct lyd_find_iter *lyd_find_iter_new(const struct lyd_node *data, const char *expr);
+
+/**
+ * @brief Create an iterator over the instances of the provided schema node. The iterator returns the same nodes
+ * as lyd_get_node2(), but lazily, see lyd_find_iter_new().
+ *
+ * @param[in] data A node in the data tree to search.
+ * @param[in] schema Schema node of the data nodes caller want to find.
+ * @return Iterator to be freed with lyd_find_iter_free(), NULL in case of an error.
+ */
+struct lyd_find_iter *lyd_find_iter_new2(const struct lyd_node *data, const struct lys_node *schema);
+
+/**
+ * @brief Get the next data node matched by an iterator.
+ *
+ * @param[in] iter Iterator created by lyd_find_iter_new() or lyd_find_iter_new2().
+ * @return Next matching data node, NULL if there are no more.
+ */
+struct lyd_node *lyd_find_iter_next(struct lyd_find_iter *iter);
+
+/**
+ * @brief Free an iterator created by lyd_find_iter_new() or lyd_find_iter_new2().
+ *
+ * @param[in] iter Iterator to free, can be NULL.
+ */
+void lyd_find_iter_free(struct lyd_find_iter *iter);
+
 /**
  * @brief Get all key nodes of a \p list instance.
  *
@@ -540,6 +788,129 @@ struct ly_set *lyd_get_list_keys(const struct lyd_node *list);
  */
 int lyd_validate(struct lyd_node *node, int options, ...);
 
+/**
+ * @brief Types of the differences between two data trees, see lyd_diff().
+ */
+typedef enum {
+    LYD_DIFF_END = 0,        /**< end of the differences list */
+    LYD_DIFF_DELETED,        /**< subtree deleted, ::lyd_difflist#first is its root in the first tree,
+                                  ::lyd_difflist#second is NULL */
+    LYD_DIFF_CHANGED,        /**< value of a leaf or anyxml changed, ::lyd_difflist#first and ::lyd_difflist#second
+                                  are the node in the first and the second tree */
+    LYD_DIFF_MOVED,          /**< instance of a user-ordered list or leaflist moved, ::lyd_difflist#first and
+                                  ::lyd_difflist#second are the instance in the first and the second tree (where
+                                  its new position can be found) */
+    LYD_DIFF_CREATED         /**< subtree created, ::lyd_difflist#first is the parent in the first tree where it was
+                                  created (NULL for a top-level node), ::lyd_difflist#second is its root in the
+                                  second tree */
+} LYD_DIFFTYPE;
+
+/**
+ * @brief List of the differences between two data trees, all the arrays are terminated by #LYD_DIFF_END
+ * in the #type array.
+ */
+struct lyd_difflist {
+    LYD_DIFFTYPE *type;              /**< array of the difference types */
+    struct lyd_node **first;         /**< array of the nodes from the first tree */
+    struct lyd_node **second;        /**< array of the nodes from the second tree */
+};
+
+/**
+ * @defgroup diffoptions Diff options
+ * @ingroup datatree
+ *
+ * Various options to change lyd_diff() behavior.
+ *
+ * @{
+ */
+#define LYD_DIFFOPT_NOSIBLINGS 0x01 /**< Compare only the given subtrees, not their siblings. */
+/**@} diffoptions */
+
+/**
+ * @brief Compare two data trees and list their differences.
+ *
+ * List instances are matched by their keys, leaflist instances by their values and the other nodes by their
+ * schema node. Matching nodes with the same subtree hash (::lyd_node#hash, computed and cached in both trees
+ * as needed) are considered identical without comparing their subtrees. Only the roots of the created and
+ * deleted subtrees are listed. Attributes are not compared. Both trees must belong to the same context.
+ *
+ * @param[in] first The first (original) data tree, any of its top-level nodes, can be NULL.
+ * @param[in] second The second (new) data tree, any of its top-level nodes, can be NULL.
+ * @param[in] options [Diff options](@ref diffoptions).
+ * @return List of the differences (even an empty one) to be freed by lyd_free_diff(), NULL on error.
+ */
+struct lyd_difflist *lyd_diff(struct lyd_node *first, struct lyd_node *second, int options);
+
+/**
+ * @brief Free a list of differences created by lyd_diff(), the data trees are not affected.
+ *
+ * @param[in] diff List of differences to free.
+ */
+void lyd_free_diff(struct lyd_difflist *diff);
+
+/**
+ * @defgroup mergeoptions Merge options
+ * @ingroup datatree
+ *
+ * Various options to change lyd_merge() behavior.
+ *
+ * @{
+ */
+#define LYD_MERGEOPT_DESTRUCT 0x01   /**< The source data tree is consumed, its nodes are moved into the target tree
+                                          instead of being duplicated and the rest is freed. */
+#define LYD_MERGEOPT_NOSIBLINGS 0x02 /**< Merge only the given source subtree, not its siblings. */
+/**@} mergeoptions */
+
+/**
+ * @brief Merge a data tree into another one.
+ *
+ * The source nodes are merged either into the siblings of the target (if they are instances of the same
+ * schema level) or into its children. Containers are matched by their schema node, list instances by
+ * their keys and leaflist instances by their values, in the target tree indexed by a hash table. Values of
+ * the matching leaves and anyxmls are replaced, the source nodes without a match are added (keyless list
+ * instances always) at the end of the target siblings. Validity of the target nodes that were not changed
+ * is kept, so only the changed part of the tree needs validation.
+ *
+ * @param[in] target Data tree to merge into, it is modified.
+ * @param[in] source Data tree to merge, it is not changed unless #LYD_MERGEOPT_DESTRUCT is used.
+ * @param[in] options [Merge options](@ref mergeoptions).
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error (the target can be partially merged). With
+ * #LYD_MERGEOPT_DESTRUCT, source is consumed in both cases.
+ */
+int lyd_merge(struct lyd_node *target, struct lyd_node *source, int options);
+
+/**
+ * @defgroup editoptions Edit options
+ * @ingroup datatree
+ *
+ * Default operation of lyd_apply_edit() for the edit nodes without the operation attribute, "merge" if none
+ * of these is set.
+ *
+ * @{
+ */
+#define LYD_EDITOPT_REPLACE 0x01     /**< The "replace" default operation. */
+#define LYD_EDITOPT_NONE 0x02        /**< The "none" default operation. */
+/**@} editoptions */
+
+/**
+ * @brief Apply NETCONF \<edit-config\> content to a data tree.
+ *
+ * The edit tree is supposed to be parsed with #LYD_OPT_EDIT, its "operation" attributes (merge, replace, create,
+ * delete, remove, none) from the ietf-netconf module (so it must be present in the context) are applied
+ * as specified in RFC 6241. The target nodes are looked up in hash tables of their siblings, so each edit node
+ * is resolved in constant time. Either all the changes are applied or, in case of an error (such as creating
+ * an existing node or deleting a missing one), the tree content is restored. The changed and created nodes
+ * (and the parents of the deleted ones) are marked to be validated, the caller is supposed to validate the tree
+ * by lyd_validate() afterwards.
+ *
+ * @param[in,out] root Data tree to change, any of its top-level nodes (NULL for an empty tree). It is set to
+ * the first top-level node of the changed tree (NULL if it becomes empty).
+ * @param[in] edit Edit data tree, any of its top-level nodes.
+ * @param[in] options [Edit options](@ref editoptions).
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error (the tree is not changed).
+ */
+int lyd_apply_edit(struct lyd_node **root, const struct lyd_node *edit, int options);
+
 /**
  * @brief Unlink the specified data subtree. All referenced namespaces are copied.
  *
@@ -23,6 +23,7 @@
 #ifndef LY_TREE_INTERNAL_H_
 #define LY_TREE_INTERNAL_H_
 
+#include "common.h"
 #include "tree_schema.h"
 #include "tree_data.h"
 #include "resolve.h"
@@ -62,6 +63,26 @@ struct internal_modules {
  */
 #define LY_NSNACM "urn:ietf:params:xml:ns:yang:ietf-netconf-acm"
 
+/**
+ * @brief LYB format header: magic string, version, flags and the total length (32-bit little-endian) of the data
+ */
+#define LYB_MAGIC "lyb"
+#define LYB_VERSION 0x01
+#define LYB_HEADER_SIZE 9
+
+/**
+ * @brief LYB format flag: every node is prefixed with the length (32-bit little-endian) of the rest of its
+ * encoding, so it can be skipped
+ */
+#define LYB_FLAG_LENGTHS 0x01
+
+/**
+ * @brief Tags of the LYB leaf values
+ */
+#define LYB_VALUE_NATIVE 0x00        /**< value stored in its binary form according to the type */
+#define LYB_VALUE_STRING 0x01        /**< value stored as its canonical string */
+#define LYB_VALUE_NONE 0x02          /**< no value (selection node in a filter) */
+
 /**
  * @brief Internal list of built-in types
  */
@@ -71,6 +92,59 @@ struct ly_types {
 };
 extern struct ly_types ly_types[LY_DATA_TYPE_COUNT];
 
+/**
+ * @brief Flattened effective type (::lys_type#ctype).
+ *
+ * Everything needed to parse and check a value of the type is collected here from the whole
+ * chain of the derived types, so the data parsers do not need to follow the ::lys_type#der links.
+ */
+struct lys_ctype {
+    LY_DATA_TYPE base;               /**< built-in base type */
+    uint8_t dig;                     /**< fraction-digits, #LY_TYPE_DEC64 only */
+    struct lys_type_intv *intv;      /**< effective length/range restriction, NULL if there is none */
+    uint32_t pat_count;              /**< number of precompiled patterns */
+    void **patterns;                 /**< precompiled (pcre) patterns of the type and all its superior types,
+                                          all of them must match, #LY_TYPE_STRING only */
+    union {
+        struct {
+            struct lys_type_enum *enm; /**< enum definitions (owned by the type defining them) */
+            int count;                 /**< number of enum definitions */
+        } enums;                     /**< #LY_TYPE_ENUM */
+        struct {
+            struct lys_type_bit *bit;  /**< bit definitions (owned by the type defining them) */
+            int count;                 /**< number of bit definitions */
+        } bits;                      /**< #LY_TYPE_BITS */
+        struct {
+            struct lys_type **types;   /**< member types of all the (nested) unions in the order they are tried */
+            int count;                 /**< number of member types */
+            uint8_t *shortcut;         /**< whether the member type can be tried before the previous ones (none
+                                            of the previous member types can accept any of its values) */
+            int last;                  /**< index of the member type to try first (with shortcut set) that
+                                            matched the last parsed value, 0 if none, accessed atomically */
+        } uni;                       /**< #LY_TYPE_UNION */
+    } info;
+    struct ly_ht names;              /**< enum/bit definitions hashed by their names, #LY_TYPE_ENUM and #LY_TYPE_BITS */
+};
+
+/**
+ * @brief Iterator over the data nodes matching a path, see lyd_find_iter_new().
+ *
+ * Nodes of a simple location path (or a schema node path) are searched lazily, one step after another,
+ * the iterator keeps the current node of every step. Other XPath expressions are evaluated at once
+ * and the iterator only walks the result.
+ */
+struct lyd_find_iter {
+    struct lyxp_expr *exp;           /**< compiled XPath expression the steps point into, NULL for a schema path */
+    struct lyxp_path_step *steps;    /**< name tests of the steps of a simple location path */
+    const struct lys_node **snodes;  /**< schema nodes of the steps of a schema path */
+    struct lyd_node **nodes;         /**< current node of every step */
+    uint32_t count;                  /**< number of steps */
+    struct lyd_node *first;          /**< first candidate node of the first step, NULL if there is none */
+    int state;                       /**< 0 - not started, 1 - searching, 2 - finished */
+    struct ly_set *set;              /**< all the matching nodes of a general XPath expression */
+    unsigned int pos;                /**< index of the next node in set */
+};
+
 /**
  * @brief Create submodule structure by reading data from memory.
  *
@@ -259,6 +333,17 @@ void lys_node_free(struct lys_node *node, void (*private_destructor)(const struc
  */
 void lys_free(struct lys_module *module, void (*private_destructor)(const struct lys_node *node, void *priv), int remove_from_ctx);
 
+/**
+ * @brief Add a new module to the dependencies of the when and must conditions in the context. Every data
+ * schema node gets ::lys_node#cond_deps with the nodes whose conditions can access its instances, the
+ * nodes with conditions that cannot be analyzed are stored in the context instead. Only the conditions
+ * of the module and the older conditions that can reach its nodes, augments, and deviations are analyzed.
+ * Call it once the module is successfully added into the context.
+ *
+ * @param[in] module New module.
+ */
+void lys_cond_deps_add(struct lys_module *module);
+
 /**
  * @brief Check presence of all the mandatory elements in the given data tree subtree
  *
@@ -352,4 +437,183 @@ int lys_get_data_sibling(const struct lys_module *mod, const struct lys_node *si
  */
 int lyd_compare(struct lyd_node *first, struct lyd_node *second, int unique);
 
+/**
+ * @brief Marker of the ::lyd_node_leaf_list#value_str to be created from the value on demand (#LYD_OPT_TYPED).
+ */
+extern const char lyd_value_str_lazy[];
+
+/**
+ * @brief Drop the string representation of a successfully parsed leaf value if the value can be
+ * printed back from its typed form (#LYD_OPT_TYPED), the node is left with ::lyd_value_str_lazy.
+ *
+ * @param[in] leaf Leaf or leaflist node with the value parsed.
+ * @return 1 if the string was dropped, 0 if the value keeps its string representation.
+ */
+int lyd_value_str_drop(struct lyd_node_leaf_list *leaf);
+
+/**
+ * @brief Check whether values of a schema node can be stored without their string representation.
+ *
+ * @param[in] schema Leaf or leaflist schema node.
+ * @return 1 if they can, 0 otherwise.
+ */
+int lyd_value_str_droppable(const struct lys_node *schema);
+
+/**
+ * @brief Initialize an empty bitmap of a #LY_TYPE_BITS value. Bitmaps of types with at most 64 bits
+ * are stored directly in the value, larger ones are allocated and #LYD_NODE_BITS_EXT is set. Logs directly.
+ *
+ * @param[in] leaf Leaf or leaflist node whose value to initialize, the previous value is overwritten.
+ * @param[in] count Number of the bit definitions of the type.
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+int lyd_bits_init(struct lyd_node_leaf_list *leaf, uint32_t count);
+
+/**
+ * @brief Set a bit in an initialized bitmap of a #LY_TYPE_BITS value.
+ *
+ * @param[in] leaf Leaf or leaflist node to modify.
+ * @param[in] idx Index of the bit definition to set.
+ */
+void lyd_bits_set(struct lyd_node_leaf_list *leaf, uint32_t idx);
+
+/**
+ * @brief Duplicate the bitmap of a #LY_TYPE_BITS value. Logs directly.
+ *
+ * @param[out] new Leaf or leaflist node to fill the value of.
+ * @param[in] old Leaf or leaflist node whose value to duplicate.
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+int lyd_bits_dup(struct lyd_node_leaf_list *new, const struct lyd_node_leaf_list *old);
+
+/**
+ * @brief Free the bitmap of a #LY_TYPE_BITS value, the value is zeroed.
+ *
+ * @param[in] value Value to clean.
+ * @param[in] flags [Data node flags](@ref dnodeflags) of the node the value belongs (belonged) to.
+ */
+void lyd_bits_free(lyd_val *value, uint8_t flags);
+
+/**
+ * @brief Hash identifying a data node instance among its siblings, it covers the schema node and the values of
+ * the keys (lists) or the value (leaflists). Nodes that lyd_compare() (without \p unique) considers the same have
+ * the same hash.
+ *
+ * @param[in] node Data node.
+ * @return Instance hash.
+ */
+uint32_t lyd_instance_hash(const struct lyd_node *node);
+
+/**
+ * @brief Get the hash of the whole subtree content (schema nodes and values, not attributes), computed only
+ * if not cached in ::lyd_node#hash already. The cache is updated atomically, so the function can be used by
+ * several threads reading the same tree, the hashes of read-only nodes are always cached. Subtrees with different
+ * hashes differ, but equal hashes must be confirmed by lyd_subtree_equal().
+ *
+ * @param[in] node Root of the subtree.
+ * @return Subtree hash, never 0.
+ */
+uint32_t lyd_subtree_hash(struct lyd_node *node);
+
+/**
+ * @brief Compare the whole subtree content the same way lyd_subtree_hash() hashes it.
+ *
+ * @param[in] node1 Root of the first subtree.
+ * @param[in] node2 Root of the second subtree, from the same context.
+ * @return 1 if the subtrees are equal, 0 otherwise.
+ */
+int lyd_subtree_equal(const struct lyd_node *node1, const struct lyd_node *node2);
+
+/**
+ * @brief Invalidate the cached subtree hashes of a modified node and all its parents.
+ *
+ * @param[in] node Modified node, can be NULL.
+ */
+void lyd_hash_invalidate(struct lyd_node *node);
+
+/**
+ * @brief Memory block for the nodes of a whole data tree, they are never released one by one.
+ */
+struct lyd_arena {
+    void *blocks;                    /**< allocated blocks linked through their first item */
+    char *next;                      /**< free space in the last block */
+    char *end;                       /**< end of the last block */
+    size_t block_size;               /**< size of the next block to allocate */
+};
+
+/**
+ * @brief Allocate a zeroed data node structure in an arena, it is flagged #LYD_NODE_ARENA so that
+ * lyd_node_release() ignores it.
+ *
+ * @param[in] arena Arena to allocate from, its block_size is used for the first block.
+ * @param[in] nodetype Type of the schema node of the data node.
+ * @return Allocated node, NULL on memory allocation failure (not logged).
+ */
+void *lyd_arena_alloc(struct lyd_arena *arena, LYS_NODE nodetype);
+
+/**
+ * @brief Free all the blocks of an arena.
+ *
+ * @param[in] arena Arena to clean.
+ */
+void lyd_arena_clean(struct lyd_arena *arena);
+
+/**
+ * @brief Read-only shared copy of a data tree.
+ */
+struct lyd_snapshot {
+    struct lyd_node *data;           /**< copied data tree */
+    uint32_t refcount;               /**< number of references, the snapshot is freed when it drops to 0 */
+    struct lyd_arena arena;          /**< nodes of a loaded snapshot (lyd_snapshot_load()), empty otherwise */
+};
+
+/**
+ * @brief Check that a data node can be modified, it is not part of a read-only tree (#LYD_NODE_RDONLY).
+ * Logs directly.
+ *
+ * @param[in] node Node to check, can be NULL.
+ * @param[in] func Name of the calling function for the error message.
+ * @return EXIT_SUCCESS if the node can be modified, EXIT_FAILURE otherwise.
+ */
+int lyd_check_writable(const struct lyd_node *node, const char *func);
+
+/**
+ * @brief Allocate a zeroed data node structure of the size given by the schema node type. Without the
+ * LY_DATA_POOL build option it is just calloc(), with it the node is taken from the context's data node pool.
+ * Such nodes must be released by lyd_node_release().
+ *
+ * @param[in] ctx Context of the data node.
+ * @param[in] nodetype Type of the schema node of the data node.
+ * @return Allocated node, NULL on memory allocation failure (not logged).
+ */
+void *lyd_node_alloc(struct ly_ctx *ctx, LYS_NODE nodetype);
+
+/**
+ * @brief Release a data node structure allocated by lyd_node_alloc(). Its schema member must be set.
+ *
+ * @param[in] ctx Context of the data node.
+ * @param[in] node Node to release.
+ */
+void lyd_node_release(struct ly_ctx *ctx, struct lyd_node *node);
+
+#ifdef LY_DATA_POOL
+
+struct lyd_pool;
+
+/**
+ * @brief Initialize data node pool of a context.
+ *
+ * @param[in] pool Pool to initialize.
+ */
+void lyd_pool_init(struct lyd_pool *pool);
+
+/**
+ * @brief Free all the memory of a data node pool, no node allocated from it can be used anymore.
+ *
+ * @param[in] pool Pool to clean.
+ */
+void lyd_pool_clean(struct lyd_pool *pool);
+
+#endif
+
 #endif /* LY_TREE_INTERNAL_H_ */
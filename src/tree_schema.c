@@ -40,6 +40,7 @@
 #include "xml_internal.h"
 #include "tree_internal.h"
 #include "validation.h"
+#include "xpath.h"
 
 API const struct lys_feature *
 lys_is_disabled(const struct lys_node *node, int recursive)
@@ -1150,6 +1151,7 @@ lys_restr_free(struct ly_ctx *ctx, struct lys_restr *restr)
     lydict_remove(ctx, restr->ref);
     lydict_remove(ctx, restr->eapptag);
     lydict_remove(ctx, restr->emsg);
+    lyxp_expr_free(restr->compiled);
 }
 
 static int
@@ -1291,7 +1293,7 @@ lys_type_dup(struct lys_module *mod, struct lys_node *parent, struct lys_type *n
         break;
     }
 
-    return EXIT_SUCCESS;
+    return lyp_ctype_build(new);
 }
 
 void
@@ -1305,6 +1307,8 @@ lys_type_free(struct ly_ctx *ctx, struct lys_type *type)
     }
 
     lydict_remove(ctx, type->module_name);
+    lyp_ctype_free(type->ctype);
+    type->ctype = NULL;
 
     switch (type->base) {
     case LY_TYPE_BINARY:
@@ -1458,6 +1462,7 @@ lys_when_free(struct ly_ctx *ctx, struct lys_when *w)
     lydict_remove(ctx, w->cond);
     lydict_remove(ctx, w->dsc);
     lydict_remove(ctx, w->ref);
+    lyxp_expr_free(w->compiled);
 
     free(w);
 }
@@ -1613,6 +1618,10 @@ lys_ident_free(struct ly_ctx *ctx, struct lys_ident *ident)
         ident->der = der->next;
         free(der);
     }
+    if (ident->der_ht) {
+        ly_ht_clean(ident->der_ht);
+        free(ident->der_ht);
+    }
 
     lydict_remove(ctx, ident->name);
     lydict_remove(ctx, ident->dsc);
@@ -1919,6 +1928,7 @@ lys_node_free(struct lys_node *node, void (*private_destructor)(const struct lys
     }
 
     /* again common part */
+    ly_set_free(node->cond_deps);
     lys_node_unlink(node);
     free(node);
 }
@@ -2527,6 +2537,288 @@ lys_free(struct lys_module *module, void (*private_destructor)(const struct lys_
     free(module);
 }
 
+/**
+ * @brief Add a node with a when or must condition to the dependencies of all the nodes
+ * the condition can access.
+ *
+ * @param[in] owner Node with the condition.
+ * @param[in] cur_snode Schema node of the context node of the condition, NULL if there is none.
+ * @param[in,out] compiled Cache of the compiled condition.
+ * @param[in] expr Condition expression.
+ */
+static void
+lys_cond_deps_expr(struct lys_node *owner, struct lys_node *cur_snode, struct lyxp_expr **compiled, const char *expr)
+{
+    struct ly_ctx *ctx = owner->module->ctx;
+    struct lyxp_expr *exp;
+    struct ly_set *snodes;
+    unsigned int i;
+    int rc = EXIT_FAILURE, open = 0;
+
+    snodes = ly_set_new();
+    if (!snodes) {
+        LOGMEM;
+        ly_set_add(&ctx->cond_imprecise, owner);
+        return;
+    }
+
+    exp = lyxp_compile_cached(compiled, expr, 0);
+    if (exp && cur_snode) {
+        rc = lyxp_node_deps(exp, cur_snode, snodes, &open);
+    }
+
+    for (i = 0; !rc && (i < snodes->number); ++i) {
+        if (!snodes->sset[i]->cond_deps) {
+            snodes->sset[i]->cond_deps = ly_set_new();
+        }
+        if (ly_set_add(snodes->sset[i]->cond_deps, owner)) {
+            rc = -1;
+        }
+    }
+
+    if (rc) {
+        /* the condition can depend on anything */
+        ly_set_add(&ctx->cond_imprecise, owner);
+    } else if (open) {
+        /* the condition can also depend on the schema nodes added later */
+        ly_set_add(&ctx->cond_open, owner);
+    }
+    ly_set_free(snodes);
+}
+
+/**
+ * @brief Add a node to the dependencies of its when and must conditions.
+ *
+ * @param[in] node Schema node to process.
+ */
+static void
+lys_cond_deps_node(struct lys_node *node)
+{
+    struct lys_node *cur_snode;
+    struct lys_when *when;
+    struct lys_restr *must = NULL;
+    uint8_t i, must_size = 0;
+
+    switch (node->nodetype) {
+    case LYS_CONTAINER:
+        when = ((struct lys_node_container *)node)->when;
+        must_size = ((struct lys_node_container *)node)->must_size;
+        must = ((struct lys_node_container *)node)->must;
+        break;
+    case LYS_LEAF:
+        when = ((struct lys_node_leaf *)node)->when;
+        must_size = ((struct lys_node_leaf *)node)->must_size;
+        must = ((struct lys_node_leaf *)node)->must;
+        break;
+    case LYS_LEAFLIST:
+        when = ((struct lys_node_leaflist *)node)->when;
+        must_size = ((struct lys_node_leaflist *)node)->must_size;
+        must = ((struct lys_node_leaflist *)node)->must;
+        break;
+    case LYS_LIST:
+        when = ((struct lys_node_list *)node)->when;
+        must_size = ((struct lys_node_list *)node)->must_size;
+        must = ((struct lys_node_list *)node)->must;
+        break;
+    case LYS_ANYXML:
+        when = ((struct lys_node_anyxml *)node)->when;
+        must_size = ((struct lys_node_anyxml *)node)->must_size;
+        must = ((struct lys_node_anyxml *)node)->must;
+        break;
+    case LYS_CHOICE:
+        when = ((struct lys_node_choice *)node)->when;
+        break;
+    case LYS_CASE:
+        when = ((struct lys_node_case *)node)->when;
+        break;
+    case LYS_USES:
+        when = ((struct lys_node_uses *)node)->when;
+        break;
+    case LYS_AUGMENT:
+        when = ((struct lys_node_augment *)node)->when;
+        break;
+    default:
+        return;
+    }
+
+    /* conditions of schema-only nodes are evaluated in their first data ancestor (the augment target) */
+    cur_snode = (node->nodetype == LYS_AUGMENT ? ((struct lys_node_augment *)node)->target : node);
+    while (cur_snode && (cur_snode->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE | LYS_INPUT | LYS_OUTPUT))) {
+        cur_snode = lys_parent(cur_snode);
+    }
+
+    if (when) {
+        lys_cond_deps_expr(node, cur_snode, &when->compiled, when->cond);
+    }
+    for (i = 0; i < must_size; ++i) {
+        lys_cond_deps_expr(node, cur_snode, &must[i].compiled, must[i].expr);
+    }
+}
+
+/**
+ * @brief Add all the data schema nodes in a subtree to the dependencies of their conditions.
+ *
+ * @param[in] first First sibling of the subtree roots.
+ * @param[in] parent Process only the siblings with this parent, NULL for all of them.
+ */
+static void
+lys_cond_deps_subtree(struct lys_node *first, struct lys_node *parent)
+{
+    struct lys_node *elem;
+
+    LY_TREE_FOR(first, elem) {
+        if (parent && (elem->parent != parent)) {
+            /* the children of an augment end here */
+            break;
+        }
+        if (elem->nodetype & (LYS_GROUPING | LYS_AUGMENT)) {
+            continue;
+        }
+
+        lys_cond_deps_node(elem);
+        /* augments are not in the tree, process them with their first child */
+        if (elem->parent && (elem->parent->nodetype == LYS_AUGMENT) && (elem->parent->child == elem)) {
+            lys_cond_deps_node(elem->parent);
+        }
+
+        if (!(elem->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML))) {
+            lys_cond_deps_subtree(elem->child, NULL);
+        }
+    }
+}
+
+/**
+ * @brief Add the schema-only nodes evaluating their conditions in a data node (choices, cases, uses, and
+ * augments of the node) into a set.
+ *
+ * @param[in] node Data schema node.
+ * @param[in,out] owners Set to add the nodes to.
+ */
+static void
+lys_cond_deps_ctx_owners(struct lys_node *node, struct ly_set *owners)
+{
+    struct lys_node *elem;
+
+    if (node->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML)) {
+        return;
+    }
+
+    LY_TREE_FOR(node->child, elem) {
+        if (elem->parent && (elem->parent->nodetype == LYS_AUGMENT)) {
+            ly_set_add(owners, elem->parent);
+        }
+        if (elem->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE)) {
+            ly_set_add(owners, elem);
+            lys_cond_deps_ctx_owners(elem, owners);
+        }
+    }
+}
+
+/**
+ * @brief Analyze again the conditions that can reach the nodes added into or changed in a subtree of
+ * an older module. Those are the conditions of the subtree root and its ancestors, the conditions
+ * evaluated in the root, the conditions depending on them, and the conditions depending on the schema
+ * nodes added later. The dependencies are only added, the previous ones stay.
+ *
+ * @param[in] node Root of the changed subtree.
+ */
+static void
+lys_cond_deps_reach(struct lys_node *node)
+{
+    struct ly_ctx *ctx = node->module->ctx;
+    struct ly_set *owners;
+    struct lys_node *iter;
+    unsigned int i;
+
+    owners = ly_set_new();
+    if (!owners) {
+        LOGMEM;
+        return;
+    }
+
+    lys_cond_deps_ctx_owners(node, owners);
+    for (iter = node; iter; iter = lys_parent(iter)) {
+        ly_set_add(owners, iter);
+        if (iter->parent && (iter->parent->nodetype == LYS_AUGMENT)) {
+            ly_set_add(owners, iter->parent);
+        }
+        for (i = 0; iter->cond_deps && (i < iter->cond_deps->number); ++i) {
+            ly_set_add(owners, iter->cond_deps->sset[i]);
+        }
+    }
+    for (i = 0; i < ctx->cond_open.number; ++i) {
+        ly_set_add(owners, ctx->cond_open.sset[i]);
+    }
+
+    for (i = 0; i < owners->number; ++i) {
+        lys_cond_deps_node(owners->sset[i]);
+    }
+    ly_set_free(owners);
+}
+
+/**
+ * @brief Add the changes of the augments and deviations of a (sub)module in the older modules
+ * to the dependencies.
+ *
+ * @param[in] module Module of the augments and deviations.
+ * @param[in] mainmod Main module of \p module.
+ */
+static void
+lys_cond_deps_modify(struct lys_module *module, struct lys_module *mainmod)
+{
+    struct lys_node_augment *aug;
+    struct lys_node *target;
+    int i;
+
+    for (i = 0; i < module->augment_size; ++i) {
+        aug = &module->augment[i];
+        if (!aug->target || (lys_node_module(aug->target) == mainmod)) {
+            /* processed with the module data */
+            continue;
+        }
+
+        lys_cond_deps_subtree(aug->child, (struct lys_node *)aug);
+        lys_cond_deps_reach(aug->target);
+    }
+
+    for (i = 0; i < module->deviation_size; ++i) {
+        if (!module->deviation[i].deviate_size || (module->deviation[i].deviate[0].mod == LY_DEVIATE_NO)) {
+            /* removed nodes can only stay among the dependencies, nothing else is reachable now */
+            continue;
+        }
+
+        target = NULL;
+        resolve_augment_schema_nodeid(module->deviation[i].target_name, NULL, mainmod, (const struct lys_node **)&target);
+        if (target && (lys_node_module(target) != mainmod)) {
+            lys_cond_deps_reach(target);
+        }
+    }
+}
+
+void
+lys_cond_deps_add(struct lys_module *module)
+{
+    unsigned int i, open;
+
+    /* the older conditions that can access the new top-level nodes */
+    open = module->ctx->cond_open.number;
+    if (module->data) {
+        for (i = 0; i < open; ++i) {
+            lys_cond_deps_node(module->ctx->cond_open.sset[i]);
+        }
+    }
+
+    /* the conditions of the new nodes */
+    lys_cond_deps_subtree(module->data, NULL);
+
+    lys_cond_deps_modify(module, module);
+    for (i = 0; i < module->inc_size; ++i) {
+        if (module->inc[i].submodule) {
+            lys_cond_deps_modify((struct lys_module *)module->inc[i].submodule, module);
+        }
+    }
+}
+
 /*
  * op: 1 - enable, 0 - disable
  */
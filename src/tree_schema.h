@@ -365,6 +365,10 @@ struct lys_type {
                                           structure provides information about one of the built-in types */
     struct lys_tpdf *parent;         /**< except ::lys_tpdf, it can points also to ::lys_node_leaf or ::lys_node_leaflist
                                           so access only the compatible members! */
+    struct lys_ctype *ctype;         /**< flattened effective type information (base type, merged restrictions,
+                                          patterns, enum/bit definitions, union members) collected from the whole
+                                          chain of the derived types when the type is resolved (internal, do not
+                                          modify) */
 
     union {
         /* LY_TYPE_BINARY */
@@ -531,6 +535,8 @@ struct lys_node {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 };
 
 /**
@@ -563,6 +569,8 @@ struct lys_node_container {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific container's data */
     struct lys_when *when;           /**< when statement (optional) */
@@ -605,6 +613,8 @@ struct lys_node_choice {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific choice's data */
     struct lys_when *when;           /**< when statement (optional) */
@@ -647,6 +657,8 @@ struct lys_node_leaf {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific leaf's data */
     struct lys_when *when;           /**< when statement (optional) */
@@ -695,6 +707,8 @@ struct lys_node_leaflist {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific leaf-list's data */
     struct lys_when *when;           /**< when statement (optional) */
@@ -739,6 +753,8 @@ struct lys_node_list {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific list's data */
     struct lys_when *when;           /**< when statement (optional) */
@@ -789,6 +805,8 @@ struct lys_node_anyxml {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific anyxml's data */
     struct lys_when *when;           /**< when statement (optional) */
@@ -829,6 +847,8 @@ struct lys_node_uses {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific uses's data */
     struct lys_when *when;           /**< when statement (optional) */
@@ -873,6 +893,8 @@ struct lys_node_grp {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific grouping's data */
     uint8_t tpdf_size;               /**< number of elements in #tpdf array */
@@ -908,6 +930,8 @@ struct lys_node_case {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific case's data */
     struct lys_when *when;           /**< when statement (optional) */
@@ -944,6 +968,8 @@ struct lys_node_rpc_inout {
 
     /* again ::lys_node compatible data */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 };
 
 /**
@@ -973,6 +999,8 @@ struct lys_node_notif {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific rpc's data */
     uint8_t tpdf_size;               /**< number of elements in the #tpdf array */
@@ -1006,6 +1034,8 @@ struct lys_node_rpc {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
     /* specific rpc's data */
     uint8_t tpdf_size;               /**< number of elements in the #tpdf array */
@@ -1051,6 +1081,8 @@ struct lys_node_augment {
     struct lys_feature **features;   /**< array of pointers to feature definitions, this is not the array of feature
                                           definitions themselves, but the array of if-feature references */
     void *private;                   /**< private caller's data, not used by libyang */
+    struct ly_set *cond_deps;        /**< set of ::lys_node objects with when or must conditions that depend on the data
+                                          instances of this node, NULL if there are none (managed by libyang) */
 
 };
 
@@ -1206,6 +1238,7 @@ struct lys_restr {
     const char *ref;                 /**< reference (optional) */
     const char *eapptag;             /**< error-app-tag value (optional) */
     const char *emsg;                /**< error-message (optional) */
+    struct lyxp_expr *compiled;      /**< compiled must expression, internal, created on the first data validation */
 };
 
 /**
@@ -1215,6 +1248,7 @@ struct lys_when {
     const char *cond;                /**< specified condition (mandatory) */
     const char *dsc;                 /**< description (optional) */
     const char *ref;                 /**< reference (optional) */
+    struct lyxp_expr *compiled;      /**< compiled condition, internal, created on the first data validation */
 };
 
 /**
@@ -1231,6 +1265,7 @@ struct lys_ident {
 
     struct lys_ident *base;          /**< pointer to the base identity */
     struct lys_ident_der *der;       /**< list of pointers to the derived identities */
+    struct ly_ht *der_ht;            /**< derived identities hashed by their names (internal, do not modify) */
 };
 /**
  * @brief Structure to serialize pointers to the identities.
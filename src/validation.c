@@ -94,8 +94,8 @@ filter_compare(const struct lyd_node *first, const struct lyd_node *second)
             LY_TREE_FOR(second->child, diter2) {
                 if (diter2->schema != diter1->schema) {
                     continue;
-                } else if (!ly_strequal(((struct lyd_node_leaf_list *)diter1)->value_str,
-                                        ((struct lyd_node_leaf_list *)diter2)->value_str, 1)) {
+                } else if (!ly_strequal(lyd_value_str((struct lyd_node_leaf_list *)diter1),
+                                        lyd_value_str((struct lyd_node_leaf_list *)diter2), 1)) {
                     continue;
                 }
                 match = 1;
@@ -124,8 +124,8 @@ filter_compare(const struct lyd_node *first, const struct lyd_node *second)
         break;
     case LYS_LEAF:
     case LYS_LEAFLIST:
-        if (!ly_strequal(((struct lyd_node_leaf_list *)first)->value_str,
-                         ((struct lyd_node_leaf_list *)second)->value_str, 1)) {
+        if (!ly_strequal(lyd_value_str((struct lyd_node_leaf_list *)first),
+                         lyd_value_str((struct lyd_node_leaf_list *)second), 1)) {
             return 1;
         }
         break;
@@ -361,7 +361,9 @@ lyv_data_context(const struct lyd_node *node, int options, unsigned int line, st
     }
 
     /* check all relevant when conditions */
-    if (unres) {
+    if (options & LYV_OPT_NOWHEN) {
+        /* not affected by the changes since the last validation */
+    } else if (unres) {
         if (unres_data_add(unres, (struct lyd_node *)node, UNRES_WHEN, line) == -1) {
             return EXIT_FAILURE;
         }
@@ -534,8 +536,8 @@ lyv_data_content(struct lyd_node *node, int options, unsigned int line, struct u
                                 /* return success to keep the node in the tree */
                                 return EXIT_SUCCESS;
                             } else if (!((struct lyd_node_leaf_list *)node)->value_str
-                                    || ly_strequal(((struct lyd_node_leaf_list *)diter)->value_str,
-                                                   ((struct lyd_node_leaf_list *)node)->value_str, 1)) {
+                                    || ly_strequal(lyd_value_str((struct lyd_node_leaf_list *)diter),
+                                                   lyd_value_str((struct lyd_node_leaf_list *)node), 1)) {
                                 /* keep the previous instance and remove the current one ->
                                  * return failure but do not set ly_errno */
                                 return EXIT_FAILURE;
@@ -663,7 +665,9 @@ lyv_data_content(struct lyd_node *node, int options, unsigned int line, struct u
     }
 
     /* check must conditions */
-    if (unres) {
+    if (options & LYV_OPT_NOMUST) {
+        /* not affected by the changes since the last validation */
+    } else if (unres) {
         if (unres_data_add(unres, node, UNRES_MUST, line) == -1) {
             return EXIT_FAILURE;
         }
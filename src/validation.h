@@ -26,6 +26,10 @@
 #include "resolve.h"
 #include "tree_data.h"
 
+/* internal validation options, out of the @ref parseroptions range */
+#define LYV_OPT_NOWHEN 0x10000 /**< do not evaluate the when conditions affecting the node */
+#define LYV_OPT_NOMUST 0x20000 /**< do not evaluate the must conditions of the node */
+
 /**
  * @brief Check, that the data node of the given schema node can even appear in a data tree.
  *
@@ -301,17 +301,17 @@ lyxml_dup_elem(struct ly_ctx *ctx, struct lyxml_elem *elem, struct lyxml_elem *p
         lyxml_add_child(ctx, parent, result);
     }
 
+    /* duplicate attributes first, so a namespace defined on elem itself is found in the copy */
+    for (attr = elem->attr; attr; attr = attr->next) {
+        lyxml_dup_attr(ctx, result, attr);
+    }
+
     /* keep old namespace for now */
     result->ns = elem->ns;
 
     /* correct namespaces */
     lyxml_correct_elem_ns(ctx, result, 1, 0);
 
-    /* duplicate attributes */
-    for (attr = elem->attr; attr; attr = attr->next) {
-        lyxml_dup_attr(ctx, result, attr);
-    }
-
     if (!recursive) {
         return result;
     }
@@ -364,8 +364,8 @@ lyxml_unlink_elem(struct ly_ctx *ctx, struct lyxml_elem *elem, int copy_ns)
             first = parent->child;
         } else {
             first = elem;
-            while (elem->prev->next) {
-                first = elem->prev;
+            while (first->prev->next) {
+                first = first->prev;
             }
         }
         first->prev = elem->prev;
@@ -32,6 +32,10 @@
 #include <limits.h>
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 #include "xpath.h"
 #include "libyang.h"
@@ -46,20 +50,22 @@
 #include "dict_private.h"
 
 static struct lyd_node *moveto_get_root(struct lyd_node *cur_node, int when_must_eval, enum lyxp_node_type *root_type);
-static int reparse_expr(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line);
-static int eval_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+static int reparse_expr(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line);
+static int eval_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                      int when_must_eval, uint32_t line);
+static void set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_node *cur_node,
+                     int when_must_eval);
 
-/**
- * @brief Frees a parsed XPath expression. \p exp should not be used afterwards.
- *
- * @param[in] exp Expression to free.
- */
-static void
-exp_free(struct lyxp_expr *exp)
+void
+lyxp_expr_free(struct lyxp_expr *exp)
 {
-    uint16_t i;
+    uint32_t i;
+
+    if (!exp) {
+        return;
+    }
 
+    free((char *)exp->expr);
     free(exp->tokens);
     free(exp->expr_pos);
     free(exp->tok_len);
@@ -67,6 +73,7 @@ exp_free(struct lyxp_expr *exp)
         free(exp->repeat[i]);
     }
     free(exp->repeat);
+    free(exp->eq_pred);
     free(exp);
 }
 
@@ -157,28 +164,280 @@ print_token(enum lyxp_token tok)
 static void
 print_expr_struct_debug(struct lyxp_expr *exp)
 {
-    uint16_t i, j;
+    uint32_t i, j;
+    size_t len;
     char tmp[128];
 
-    if (!exp) {
+    if (!exp || (ly_log_level < LY_LLDBG)) {
         return;
     }
 
     LOGDBG("XPATH: expression \"%s\":", exp->expr);
     for (i = 0; i < exp->used; ++i) {
-        sprintf(tmp, "XPATH:\tToken %s, in expression \"%.*s\"", print_token(exp->tokens[i]), exp->tok_len[i],
-               &exp->expr[exp->expr_pos[i]]);
-        if (exp->repeat[i]) {
-            sprintf(tmp + strlen(tmp), " (repeat %d", exp->repeat[i][0]);
-            for (j = 1; exp->repeat[i][j]; ++j) {
-                sprintf(tmp + strlen(tmp), ", %d", exp->repeat[i][j]);
+        /* long literals are cut */
+        len = snprintf(tmp, sizeof tmp, "XPATH:\tToken %s, in expression \"%.*s\"", print_token(exp->tokens[i]),
+                       (int)(exp->tok_len[i] < 32 ? exp->tok_len[i] : 32), &exp->expr[exp->expr_pos[i]]);
+        if (exp->repeat[i] && (len < sizeof tmp)) {
+            len += snprintf(tmp + len, sizeof tmp - len, " (repeat %u", exp->repeat[i][0]);
+            for (j = 1; exp->repeat[i][j] && (len < sizeof tmp); ++j) {
+                len += snprintf(tmp + len, sizeof tmp - len, ", %u", exp->repeat[i][j]);
+            }
+            if (len < sizeof tmp - 1) {
+                strcat(tmp, ")");
             }
-            strcat(tmp, ")");
         }
         LOGDBG(tmp);
     }
 }
 
+/*
+ * scratch memory functions
+ */
+
+/* minimal size of a scratch memory block */
+#define LYXP_SCRATCH_BLOCK_SIZE 4096
+
+static pthread_once_t lyxp_scratch_once = PTHREAD_ONCE_INIT;
+static pthread_key_t lyxp_scratch_key;
+#ifdef __linux__
+static struct lyxp_scratch lyxp_scratch_main;
+#endif
+
+/**
+ * @brief Free blocks of the scratch memory up to a block.
+ *
+ * @param[in] scratch Scratch memory to use.
+ * @param[in] block First block to keep, NULL to free all of them.
+ */
+static void
+scratch_free_blocks(struct lyxp_scratch *scratch, struct lyxp_scratch_block *block)
+{
+    struct lyxp_scratch_block *prev;
+
+    while (scratch->block != block) {
+        prev = scratch->block->prev;
+        free(scratch->block);
+        scratch->block = prev;
+    }
+}
+
+/**
+ * @brief Free the node arrays and the sets pooled in the scratch memory.
+ *
+ * @param[in] scratch Scratch memory to use.
+ */
+static void
+scratch_free_sets(struct lyxp_scratch *scratch)
+{
+    while (scratch->buf_count) {
+        --scratch->buf_count;
+        free(scratch->bufs[scratch->buf_count].nodes);
+        free(scratch->bufs[scratch->buf_count].node_type);
+    }
+    while (scratch->set_count) {
+        free(scratch->sets[--scratch->set_count]);
+    }
+}
+
+static void
+scratch_free(void *ptr)
+{
+    scratch_free_blocks(ptr, NULL);
+    scratch_free_sets(ptr);
+#ifdef __linux__
+    /* static memory is used in the main thread */
+    if (ptr != &lyxp_scratch_main) {
+#else
+    {
+#endif
+        free(ptr);
+    }
+}
+
+static void
+scratch_createkey(void)
+{
+    int r;
+
+    while ((r = pthread_key_create(&lyxp_scratch_key, scratch_free)) == EAGAIN);
+    pthread_setspecific(lyxp_scratch_key, NULL);
+}
+
+/**
+ * @brief Get the scratch memory of the current thread.
+ *
+ * @return Scratch memory, NULL on memory allocation failure.
+ */
+static struct lyxp_scratch *
+scratch_get(void)
+{
+    struct lyxp_scratch *scratch;
+
+    pthread_once(&lyxp_scratch_once, scratch_createkey);
+    scratch = pthread_getspecific(lyxp_scratch_key);
+    if (!scratch) {
+#ifdef __linux__
+        if (getpid() == syscall(SYS_gettid)) {
+            scratch = &lyxp_scratch_main;
+        } else {
+#else
+        {
+#endif
+            scratch = calloc(1, sizeof *scratch);
+            if (!scratch) {
+                LOGMEM;
+                return NULL;
+            }
+        }
+        pthread_setspecific(lyxp_scratch_key, scratch);
+    }
+
+    return scratch;
+}
+
+/**
+ * @brief Start an evaluation using the scratch memory, must be paired with scratch_leave().
+ */
+static void
+scratch_enter(void)
+{
+    struct lyxp_scratch *scratch;
+
+    scratch = scratch_get();
+    if (scratch) {
+        ++scratch->depth;
+    }
+}
+
+/**
+ * @brief Finish an evaluation started by scratch_enter(). Once the outermost one finishes,
+ *        all the scratch memory is freed.
+ */
+static void
+scratch_leave(void)
+{
+    struct lyxp_scratch *scratch;
+
+    scratch = scratch_get();
+    if (!scratch) {
+        return;
+    }
+
+    assert(scratch->depth);
+    if (!--scratch->depth) {
+        scratch_free_blocks(scratch, NULL);
+        scratch_free_sets(scratch);
+    }
+}
+
+/**
+ * @brief Remember the current position in the scratch memory.
+ *
+ * @param[out] mark Position to fill.
+ */
+static void
+scratch_mark(struct lyxp_scratch_mark *mark)
+{
+    struct lyxp_scratch *scratch;
+
+    scratch = scratch_get();
+    if (scratch && scratch->block) {
+        mark->block = scratch->block;
+        mark->used = scratch->block->used;
+    } else {
+        mark->block = NULL;
+        mark->used = 0;
+    }
+}
+
+/**
+ * @brief Free all the scratch memory allocated after a position. No string allocated
+ *        since then can still be referenced.
+ *
+ * @param[in] mark Position remembered by scratch_mark().
+ */
+static void
+scratch_rewind(const struct lyxp_scratch_mark *mark)
+{
+    struct lyxp_scratch *scratch;
+
+    scratch = scratch_get();
+    if (!scratch) {
+        return;
+    }
+
+    scratch_free_blocks(scratch, mark->block);
+    if (scratch->block) {
+        scratch->block->used = mark->used;
+    }
+}
+
+/**
+ * @brief Allocate memory for a string in the scratch memory. It is freed with the scratch memory.
+ *
+ * @param[in] size Size of the memory.
+ *
+ * @return Allocated memory, NULL on memory allocation failure.
+ */
+static char *
+scratch_alloc(size_t size)
+{
+    struct lyxp_scratch *scratch;
+    struct lyxp_scratch_block *block;
+    size_t block_size;
+    char *ptr;
+
+    scratch = scratch_get();
+    if (!scratch) {
+        return NULL;
+    }
+
+    block = scratch->block;
+    if (!block || (block->size - block->used < size)) {
+        block_size = (size > LYXP_SCRATCH_BLOCK_SIZE ? size : LYXP_SCRATCH_BLOCK_SIZE);
+        block = malloc(sizeof *block + block_size);
+        if (!block) {
+            LOGMEM;
+            return NULL;
+        }
+        block->prev = scratch->block;
+        block->size = block_size;
+        block->used = 0;
+        scratch->block = block;
+    }
+
+    ptr = (char *)(block + 1) + block->used;
+    block->used += size;
+    return ptr;
+}
+
+/**
+ * @brief Copy a string into the scratch memory.
+ *
+ * @param[in] str String to copy.
+ * @param[in] str_len Length of \p str.
+ *
+ * @return Terminated copy of \p str, NULL on memory allocation failure.
+ */
+static const char *
+scratch_strndup(const char *str, uint32_t str_len)
+{
+    char *ptr;
+
+    ptr = scratch_alloc(str_len + 1);
+    if (!ptr) {
+        return NULL;
+    }
+    memcpy(ptr, str, str_len);
+    ptr[str_len] = '\0';
+
+    return ptr;
+}
+
+/*
+ * cast functions
+ */
+
 /**
  * @brief Realloc the string \p str.
  *
@@ -188,11 +447,11 @@ print_expr_struct_debug(struct lyxp_expr *exp)
  * @param[in,out] size Allocated bytes in \p str.
  */
 static void
-cast_string_realloc(uint16_t needed, char **str, uint16_t *used, uint16_t *size)
+cast_string_realloc(uint32_t needed, char **str, uint32_t *used, uint32_t *size)
 {
     if (*size - *used < needed) {
         do {
-            *size += LYXP_STRING_CAST_SIZE_STEP;
+            *size *= 2;
         } while (*size - *used < needed);
         *str = ly_realloc(*str, *size * sizeof(char));
         if (!(*str)) {
@@ -213,8 +472,8 @@ cast_string_realloc(uint16_t needed, char **str, uint16_t *used, uint16_t *size)
  * @param[in,out] size Allocated bytes in \p str.
  */
 static void
-cast_string_recursive(struct lyd_node *node, int fake_cont, enum lyxp_node_type root_type, uint16_t indent, char **str,
-                      uint16_t *used, uint16_t *size)
+cast_string_recursive(struct lyd_node *node, int fake_cont, enum lyxp_node_type root_type, uint32_t indent, char **str,
+                      uint32_t *used, uint32_t *size)
 {
     char *buf, *line, *ptr;
     const char *value_str;
@@ -253,7 +512,7 @@ cast_string_recursive(struct lyd_node *node, int fake_cont, enum lyxp_node_type
 
     case LYS_LEAF:
     case LYS_LEAFLIST:
-        value_str = ((struct lyd_node_leaf_list *)node)->value_str;
+        value_str = lyd_value_str((struct lyd_node_leaf_list *)node);
         if (!value_str) {
             value_str = "";
         }
@@ -312,15 +571,23 @@ cast_string_recursive(struct lyd_node *node, int fake_cont, enum lyxp_node_type
  * @param[in] node Node to cast.
  * @param[in] fake_cont Whether to put the data into a "fake" container.
  * @param[in] root_type Type of the XPath root.
- * @param[in] ctx libyang context to use.
  *
- * @return Element cast to string in the dictionary.
+ * @return Element cast to string in the scratch memory (or the value of a leaf), NULL on error.
  */
 static const char *
-cast_string_elem(struct lyd_node *node, int fake_cont, enum lyxp_node_type root_type, struct ly_ctx *ctx)
+cast_string_elem(struct lyd_node *node, int fake_cont, enum lyxp_node_type root_type)
 {
     char *str;
-    uint16_t used, size;
+    const char *ret;
+    uint32_t used, size;
+
+    if (!fake_cont && (node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST))
+            && ((root_type != LYXP_NODE_ROOT_CONFIG) || !(node->schema->flags & LYS_CONFIG_R))
+            && ((root_type != LYXP_NODE_ROOT_OUTPUT) || (node->schema->parent->nodetype != LYS_INPUT))) {
+        /* the value itself, it does not change during the evaluation */
+        ret = lyd_value_str((struct lyd_node_leaf_list *)node);
+        return (ret ? ret : "");
+    }
 
     str = malloc(LYXP_STRING_CAST_SIZE_START * sizeof(char));
     if (!str) {
@@ -332,15 +599,13 @@ cast_string_elem(struct lyd_node *node, int fake_cont, enum lyxp_node_type root_
     size = LYXP_STRING_CAST_SIZE_START;
 
     cast_string_recursive(node, fake_cont, root_type, 0, &str, &used, &size);
-
-    if (size > used) {
-        str = ly_realloc(str, used * sizeof(char));
-        if (!str) {
-            LOGMEM;
-            return NULL;
-        }
+    if (!str) {
+        return NULL;
     }
-    return lydict_insert_zc(ctx, str);
+
+    ret = scratch_strndup(str, used - 1);
+    free(str);
+    return ret;
 }
 
 /**
@@ -351,16 +616,14 @@ cast_string_elem(struct lyd_node *node, int fake_cont, enum lyxp_node_type root_
  * @param[in] cur_node Original context node.
  * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
  *
- * @return Cast string in the dictionary.
+ * @return Cast string in the scratch memory (or the value of a leaf or an attribute), NULL on error.
  */
 static const char *
 cast_node_set_to_string(struct lyxp_set *set, struct lyd_node *cur_node, int when_must_eval)
 {
-    uint16_t pos;
-    struct ly_ctx *ctx;
+    uint32_t pos;
     enum lyxp_node_type root_type;
 
-    ctx = cur_node->schema->module->ctx;
     moveto_get_root(cur_node, when_must_eval, &root_type);
 
     if (set->pos) {
@@ -373,14 +636,14 @@ cast_node_set_to_string(struct lyxp_set *set, struct lyd_node *cur_node, int whe
     case LYXP_NODE_ROOT_STATE:
     case LYXP_NODE_ROOT_NOTIF:
     case LYXP_NODE_ROOT_RPC:
-        return cast_string_elem(set->value.nodes[pos], 1, root_type, ctx);
+        return cast_string_elem(set->value.nodes[pos], 1, root_type);
     case LYXP_NODE_ROOT_OUTPUT:
-        return cast_string_elem(set->value.nodes[pos]->child, 1, root_type, ctx);
+        return cast_string_elem(set->value.nodes[pos]->child, 1, root_type);
     case LYXP_NODE_ELEM:
     case LYXP_NODE_TEXT:
-        return cast_string_elem(set->value.nodes[pos], 0, root_type, ctx);
+        return cast_string_elem(set->value.nodes[pos], 0, root_type);
     case LYXP_NODE_ATTR:
-        return lydict_insert(ctx, set->value.attrs[pos]->value, 0);
+        return set->value.attrs[pos]->value;
     }
 
     LOGINT;
@@ -408,122 +671,524 @@ cast_string_to_number(const char *str)
     return num;
 }
 
-/*
- * lyxp_set manipulation functions
- */
-
 /**
- * @brief Create a deep copy of a \p set.
+ * @brief Cast a string into an XPath number if it is a plain integer
+ *        that can be computed with exactly.
  *
- * @param[in] set Set to copy.
- * @param[in] ctx libyang context to use.
+ * @param[in] str String to use.
+ * @param[in] str_len Length of \p str.
+ * @param[out] inum Cast integer.
  *
- * @return Copy of \p set.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if \p str must be cast using cast_string_to_number().
  */
-static struct lyxp_set *
-set_copy(struct lyxp_set *set, struct ly_ctx *ctx)
+static int
+cast_string_to_int(const char *str, size_t str_len, int64_t *inum)
 {
-    struct lyxp_set *ret;
+    int64_t num = 0;
+    size_t i = 0;
 
-    if (!set) {
-        return NULL;
+    if (str_len && (str[0] == '-')) {
+        i = 1;
     }
-
-    ret = malloc(sizeof *ret);
-    if (!ret) {
-        LOGMEM;
-        return NULL;
+    /* at most 18 digits always fit */
+    if ((i == str_len) || (str_len - i > 18)) {
+        return EXIT_FAILURE;
     }
-    if (set->type == LYXP_SET_NODE_SET) {
-        ret->type = set->type;
-        ret->value.nodes = malloc(set->used * sizeof *ret->value.nodes);
-        if (!ret->value.nodes) {
-            LOGMEM;
-            free(ret);
-            return NULL;
-        }
-        memcpy(ret->value.nodes, set->value.nodes, set->used * sizeof *ret->value.nodes);
-        ret->node_type = malloc(set->used * sizeof *ret->node_type);
-        if (!ret->node_type) {
-            LOGMEM;
-            free(ret->value.nodes);
-            free(ret);
-            return NULL;
+    for (; i < str_len; ++i) {
+        if ((str[i] < '0') || (str[i] > '9')) {
+            return EXIT_FAILURE;
         }
-        memcpy(ret->node_type, set->node_type, set->used * sizeof *ret->node_type);
-        ret->used = ret->size = set->used;
-    } else {
-       memcpy(ret, set, sizeof *ret);
-       if (set->type == LYXP_SET_STRING) {
-           ret->value.str = lydict_insert(ctx, set->value.str, 0);
-       }
+        num = num * 10 + (str[i] - '0');
     }
 
-    return ret;
+    if (str[0] == '-') {
+        if (!num) {
+            /* negative zero */
+            return EXIT_FAILURE;
+        }
+        num = -num;
+    }
+    *inum = num;
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief Fill XPath set with a string. Any current data are disposed of.
+ * @brief Cast a LYXP_SET_NODE_SET set into a number. The parsed value
+ *        of a leaf is used directly, other nodes are cast into a string first.
+ *        Context position aware.
  *
- * @param[in] set Set to fill.
- * @param[in] string String to fill into \p set.
- * @param[in] str_len Length of \p string. 0 is a valid value!
- * @param[in] ctx libyang context to use.
+ * @param[in] set Set to cast.
+ * @param[in] cur_node Original context node.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[out] num Cast number.
+ * @param[out] inum Cast number as an integer, set only if 1 is returned.
+ *
+ * @return 1 if the number is an integer, 0 if it is not, -1 on error.
  */
-static void
-set_fill_string(struct lyxp_set *set, const char *string, uint16_t str_len, struct ly_ctx *ctx)
+static int
+cast_node_set_to_number(struct lyxp_set *set, struct lyd_node *cur_node, int when_must_eval, long double *num,
+                        int64_t *inum)
 {
-    if (set->type == LYXP_SET_NODE_SET) {
-        free(set->value.nodes);
-        free(set->node_type);
-    } else if (set->type == LYXP_SET_STRING) {
-        lydict_remove(ctx, set->value.str);
+    struct lyd_node_leaf_list *leaf;
+    const char *str;
+    uint32_t pos, i;
+    int64_t div;
+
+    if (set->pos) {
+        pos = set->pos - 1;
+    } else {
+        pos = 0;
+    }
+    if ((set->node_type[pos] != LYXP_NODE_ELEM) && (set->node_type[pos] != LYXP_NODE_TEXT)) {
+        goto cast_string;
     }
 
-    set->type = LYXP_SET_STRING;
-    if ((str_len == 0) && (string[0] != '\0')) {
-        string = "";
+    leaf = (struct lyd_node_leaf_list *)set->value.nodes[pos];
+    /* no restrictions of the XPath root can apply to the value (see cast_string_elem()) */
+    if (!(leaf->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) || (leaf->schema->flags & LYS_CONFIG_R)
+            || (leaf->schema->parent && (leaf->schema->parent->nodetype == LYS_INPUT))) {
+        goto cast_string;
+    }
+
+    switch (leaf->value_type) {
+    case LY_TYPE_INT8:
+        *inum = leaf->value.int8;
+        break;
+    case LY_TYPE_INT16:
+        *inum = leaf->value.int16;
+        break;
+    case LY_TYPE_INT32:
+        *inum = leaf->value.int32;
+        break;
+    case LY_TYPE_INT64:
+        *inum = leaf->value.int64;
+        break;
+    case LY_TYPE_UINT8:
+        *inum = leaf->value.uint8;
+        break;
+    case LY_TYPE_UINT16:
+        *inum = leaf->value.uint16;
+        break;
+    case LY_TYPE_UINT32:
+        *inum = leaf->value.uint32;
+        break;
+    case LY_TYPE_UINT64:
+        if (leaf->value.uint64 > INT64_MAX) {
+            *num = leaf->value.uint64;
+            return 0;
+        }
+        *inum = leaf->value.uint64;
+        break;
+    case LY_TYPE_DEC64:
+        if (((struct lys_node_leaf *)leaf->schema)->type.base == LY_TYPE_UNION) {
+            /* the fraction-digits of the matching member type are not known */
+            goto cast_string;
+        }
+        for (div = 1, i = 0; i < ((struct lys_node_leaf *)leaf->schema)->type.ctype->dig; ++i) {
+            div *= 10;
+        }
+        if (!(leaf->value.dec64 % div)) {
+            *inum = leaf->value.dec64 / div;
+            break;
+        }
+        *num = (long double)leaf->value.dec64 / div;
+        return 0;
+    default:
+        goto cast_string;
+    }
+
+    *num = *inum;
+    return 1;
+
+cast_string:
+    str = cast_node_set_to_string(set, cur_node, when_must_eval);
+    if (!str) {
+        return -1;
+    }
+    if (!cast_string_to_int(str, strlen(str), inum)) {
+        *num = *inum;
+        return 1;
     }
-    set->value.str = lydict_insert(ctx, string, str_len);
+    *num = cast_string_to_number(str);
+    return 0;
 }
 
+/*
+ * lyxp_set manipulation functions
+ */
+
 /**
- * @brief Fill XPath set with a number. Any current data are disposed of.
+ * @brief Compute the hash of a node in a node set.
  *
- * @param[in] set Set to fill.
- * @param[in] number Number to fill into \p set.
- * @param[in] ctx libyang context to use.
+ * @param[in] node Node.
+ * @param[in] node_type Type of \p node.
+ *
+ * @return Hash of \p node with \p node_type.
  */
-static void
-set_fill_number(struct lyxp_set *set, long double number, struct ly_ctx *ctx)
+static uint32_t
+set_hash_node(void *node, enum lyxp_node_type node_type)
 {
-    if (set->type == LYXP_SET_NODE_SET) {
-        free(set->value.nodes);
-        free(set->node_type);
-    } else if (set->type == LYXP_SET_STRING) {
-        lydict_remove(ctx, set->value.str);
-    }
+    uint32_t hash;
 
-    set->type = LYXP_SET_NUMBER;
-    set->value.num = number;
+    hash = dict_hash_multi(0, (const char *)&node, sizeof node);
+    hash = dict_hash_multi(hash, (const char *)&node_type, sizeof node_type);
+    return dict_hash_multi(hash, NULL, 0);
 }
 
 /**
- * @brief Fill XPath set with a boolean. Any current data are disposed of.
+ * @brief Free the auxiliary hash table of a set.
  *
- * @param[in] set Set to fill.
- * @param[in] boolean Boolean to fill into \p set.
- * @param[in] ctx libyang context to use.
+ * @param[in] set Set to use.
  */
 static void
-set_fill_boolean(struct lyxp_set *set, int boolean, struct ly_ctx *ctx)
+set_hash_free(struct lyxp_set *set)
 {
-    if (set->type == LYXP_SET_NODE_SET) {
-        free(set->value.nodes);
-        free(set->node_type);
-    } else if (set->type == LYXP_SET_STRING) {
-        lydict_remove(ctx, set->value.str);
-    }
+    free(set->ht);
+    set->ht = NULL;
+    set->ht_size = set->ht_used = 0;
+}
+
+/**
+ * @brief Add a node into the auxiliary hash table of a set. The same node can be
+ *        added several times, it is then also stored several times.
+ *
+ * @param[in] set Set to use.
+ * @param[in] node Node to add.
+ * @param[in] node_type Type of \p node.
+ *
+ * @return EXIT_SUCCESS on success, -1 on memory allocation failure (the hash table is freed).
+ */
+static int
+set_hash_insert(struct lyxp_set *set, void *node, enum lyxp_node_type node_type)
+{
+    struct lyxp_set_hash_rec *old;
+    uint32_t i, j, old_size;
+
+    /* keep the table at most half full */
+    if ((set->ht_used + 1) * 2 > set->ht_size) {
+        old = set->ht;
+        old_size = set->ht_size;
+
+        set->ht_size = (old_size ? old_size * 2 : LYXP_SET_HASH_MIN * 2);
+        set->ht = calloc(set->ht_size, sizeof *set->ht);
+        if (!set->ht) {
+            LOGMEM;
+            free(old);
+            set->ht_size = set->ht_used = 0;
+            return -1;
+        }
+
+        for (i = 0; i < old_size; ++i) {
+            if (!old[i].used) {
+                continue;
+            }
+            for (j = set_hash_node(old[i].node, old[i].type) & (set->ht_size - 1); set->ht[j].used;
+                    j = (j + 1) & (set->ht_size - 1));
+            set->ht[j] = old[i];
+        }
+        free(old);
+    }
+
+    for (i = set_hash_node(node, node_type) & (set->ht_size - 1); set->ht[i].used; i = (i + 1) & (set->ht_size - 1));
+    set->ht[i].node = node;
+    set->ht[i].type = node_type;
+    set->ht[i].used = 1;
+    ++set->ht_used;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Remove one occurence of a node from the auxiliary hash table of a set.
+ *
+ * @param[in] set Set to use.
+ * @param[in] node Node to remove.
+ * @param[in] node_type Type of \p node.
+ */
+static void
+set_hash_remove(struct lyxp_set *set, void *node, enum lyxp_node_type node_type)
+{
+    uint32_t i, j, k, mask;
+
+    mask = set->ht_size - 1;
+    for (i = set_hash_node(node, node_type) & mask; set->ht[i].used; i = (i + 1) & mask) {
+        if ((set->ht[i].node == node) && (set->ht[i].type == node_type)) {
+            break;
+        }
+    }
+    if (!set->ht[i].used) {
+        LOGINT;
+        return;
+    }
+
+    /* backward shift deletion, move back every following record of the cluster
+     * whose home position does not lie cyclically in (i, j] */
+    for (j = (i + 1) & mask; set->ht[j].used; j = (j + 1) & mask) {
+        k = set_hash_node(set->ht[j].node, set->ht[j].type) & mask;
+        if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) {
+            continue;
+        }
+        set->ht[i] = set->ht[j];
+        i = j;
+    }
+    set->ht[i].used = 0;
+    --set->ht_used;
+}
+
+/**
+ * @brief Create the auxiliary hash table of a set from all its nodes.
+ *
+ * @param[in] set Set to use.
+ */
+static void
+set_hash_build(struct lyxp_set *set)
+{
+    uint32_t i;
+
+    assert(!set->ht);
+
+    for (i = 0; i < set->used; ++i) {
+        if (set_hash_insert(set, set->value.nodes[i], set->node_type[i])) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Count the occurences of a node in the auxiliary hash table of a set.
+ *
+ * @param[in] set Set to use.
+ * @param[in] node Node to look for.
+ * @param[in] node_type Type of \p node.
+ *
+ * @return Number of the occurences of \p node in \p set.
+ */
+static uint32_t
+set_hash_count(struct lyxp_set *set, void *node, enum lyxp_node_type node_type)
+{
+    uint32_t i, count = 0;
+
+    for (i = set_hash_node(node, node_type) & (set->ht_size - 1); set->ht[i].used; i = (i + 1) & (set->ht_size - 1)) {
+        if ((set->ht[i].node == node) && (set->ht[i].type == node_type)) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Allocate the node arrays of a set, the ones pooled in the scratch memory are reused if possible.
+ *
+ * @param[in] set Set to fill the arrays and their size into.
+ * @param[in] size Minimal number of the items.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on memory allocation failure.
+ */
+static int
+set_nodes_alloc(struct lyxp_set *set, uint32_t size)
+{
+    struct lyxp_scratch *scratch;
+    uint32_t i;
+
+    scratch = scratch_get();
+    if (scratch && scratch->depth) {
+        /* the most recently released arrays are tried first */
+        for (i = scratch->buf_count; i; --i) {
+            if (scratch->bufs[i - 1].size >= size) {
+                set->value.nodes = scratch->bufs[i - 1].nodes;
+                set->node_type = scratch->bufs[i - 1].node_type;
+                set->size = scratch->bufs[i - 1].size;
+                scratch->bufs[i - 1] = scratch->bufs[--scratch->buf_count];
+                return EXIT_SUCCESS;
+            }
+        }
+    }
+
+    set->value.nodes = malloc(size * sizeof *set->value.nodes);
+    if (!set->value.nodes) {
+        LOGMEM;
+        return EXIT_FAILURE;
+    }
+    set->node_type = malloc(size * sizeof *set->node_type);
+    if (!set->node_type) {
+        LOGMEM;
+        free(set->value.nodes);
+        return EXIT_FAILURE;
+    }
+    set->size = size;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Dispose of the node arrays and the hash table of an LYXP_SET_NODE_SET set. During an evaluation
+ *        the arrays are kept in the scratch memory for the next set.
+ *
+ * @param[in] set Set to use.
+ */
+static void
+set_nodes_free(struct lyxp_set *set)
+{
+    struct lyxp_scratch *scratch;
+
+    scratch = scratch_get();
+    if (scratch && scratch->depth && (scratch->buf_count < LYXP_SCRATCH_SET_BUFS)) {
+        scratch->bufs[scratch->buf_count].nodes = set->value.nodes;
+        scratch->bufs[scratch->buf_count].node_type = set->node_type;
+        scratch->bufs[scratch->buf_count].size = set->size;
+        ++scratch->buf_count;
+    } else {
+        free(set->value.nodes);
+        free(set->node_type);
+    }
+    set_hash_free(set);
+}
+
+/**
+ * @brief Create a deep copy of a \p set.
+ *
+ * @param[in] set Set to copy.
+ *
+ * @return Copy of \p set.
+ */
+static struct lyxp_set *
+set_copy(struct lyxp_set *set)
+{
+    struct lyxp_scratch *scratch;
+    struct lyxp_set *ret;
+
+    if (!set) {
+        return NULL;
+    }
+
+    scratch = scratch_get();
+    if (scratch && scratch->depth && scratch->set_count) {
+        ret = scratch->sets[--scratch->set_count];
+    } else {
+        ret = malloc(sizeof *ret);
+        if (!ret) {
+            LOGMEM;
+            return NULL;
+        }
+    }
+    if (set->type == LYXP_SET_NODE_SET) {
+        ret->type = set->type;
+        if (set_nodes_alloc(ret, set->used)) {
+            free(ret);
+            return NULL;
+        }
+        memcpy(ret->value.nodes, set->value.nodes, set->used * sizeof *ret->value.nodes);
+        memcpy(ret->node_type, set->node_type, set->used * sizeof *ret->node_type);
+        ret->used = set->used;
+        ret->pos = set->pos;
+        ret->ht = NULL;
+        ret->ht_size = ret->ht_used = 0;
+    } else {
+       /* a string in the scratch memory can be shared */
+       memcpy(ret, set, sizeof *ret);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Free an XPath \p set created during the evaluation.
+ *
+ * @param[in] set Set to free.
+ */
+static void
+set_free(struct lyxp_set *set)
+{
+    struct lyxp_scratch *scratch;
+
+    if (!set) {
+        return;
+    }
+
+    if (set->type == LYXP_SET_NODE_SET) {
+        set_nodes_free(set);
+    }
+
+    scratch = scratch_get();
+    if (scratch && scratch->depth && (scratch->set_count < LYXP_SCRATCH_SET_BUFS)) {
+        scratch->sets[scratch->set_count++] = set;
+    } else {
+        free(set);
+    }
+}
+
+/**
+ * @brief Fill XPath set with a string. Any current data are disposed of.
+ *
+ * @param[in] set Set to fill.
+ * @param[in] string String to fill into \p set, it is copied into the scratch memory.
+ * @param[in] str_len Length of \p string. 0 is a valid value!
+ */
+static void
+set_fill_string(struct lyxp_set *set, const char *string, uint32_t str_len)
+{
+    if (set->type == LYXP_SET_NODE_SET) {
+        set_nodes_free(set);
+    }
+
+    set->type = LYXP_SET_STRING;
+    set->value.str = scratch_strndup(string, str_len);
+    if (!set->value.str) {
+        /* memory allocation failure, logged */
+        set->value.str = "";
+    }
+}
+
+/**
+ * @brief Fill XPath set with a number. Any current data are disposed of.
+ *
+ * @param[in] set Set to fill.
+ * @param[in] number Number to fill into \p set.
+ */
+static void
+set_fill_number(struct lyxp_set *set, long double number)
+{
+    if (set->type == LYXP_SET_NODE_SET) {
+        set_nodes_free(set);
+    }
+
+    set->type = LYXP_SET_NUMBER;
+    set->value.num = number;
+    set->is_int = 0;
+}
+
+/**
+ * @brief Fill XPath set with an integer number. Any current data are disposed of.
+ *
+ * @param[in] set Set to fill.
+ * @param[in] number Number to fill into \p set.
+ */
+static void
+set_fill_int(struct lyxp_set *set, int64_t number)
+{
+    if (set->type == LYXP_SET_NODE_SET) {
+        set_nodes_free(set);
+    }
+
+    set->type = LYXP_SET_NUMBER;
+    set->value.num = number;
+    set->inum = number;
+    set->is_int = 1;
+}
+
+/**
+ * @brief Fill XPath set with a boolean. Any current data are disposed of.
+ *
+ * @param[in] set Set to fill.
+ * @param[in] boolean Boolean to fill into \p set.
+ */
+static void
+set_fill_boolean(struct lyxp_set *set, int boolean)
+{
+    if (set->type == LYXP_SET_NODE_SET) {
+        set_nodes_free(set);
+    }
 
     set->type = LYXP_SET_BOOLEAN;
     set->value.bool = boolean;
@@ -535,27 +1200,31 @@ set_fill_boolean(struct lyxp_set *set, int boolean, struct ly_ctx *ctx)
  *
  * @param[in] set Set to fill.
  * @param[in] src Source set to copy into \p set.
- * @param[in] ctx libyang context to use.
  */
 static void
-set_fill_set(struct lyxp_set *set, struct lyxp_set *src, struct ly_ctx *ctx)
+set_fill_set(struct lyxp_set *set, struct lyxp_set *src)
 {
     if (!set || !src) {
         return;
     }
 
     if (src->type == LYXP_SET_BOOLEAN) {
-        set_fill_boolean(set, src->value.bool, ctx);
-    } else if (src->type ==  LYXP_SET_NUMBER) {
-        set_fill_number(set, src->value.num, ctx);
+        set_fill_boolean(set, src->value.bool);
+    } else if ((src->type == LYXP_SET_NUMBER) && src->is_int) {
+        set_fill_int(set, src->inum);
+    } else if (src->type == LYXP_SET_NUMBER) {
+        set_fill_number(set, src->value.num);
     } else if (src->type == LYXP_SET_STRING) {
-        set_fill_string(set, src->value.str, strlen(src->value.str), ctx);
+        if (set->type == LYXP_SET_NODE_SET) {
+            set_nodes_free(set);
+        }
+
+        /* a string in the scratch memory can be shared */
+        set->type = LYXP_SET_STRING;
+        set->value.str = src->value.str;
     } else {
         if (set->type == LYXP_SET_NODE_SET) {
-            free(set->value.nodes);
-            free(set->node_type);
-        } else if (set->type == LYXP_SET_STRING) {
-            lydict_remove(ctx, set->value.str);
+            set_nodes_free(set);
         }
 
         if (src->type == LYXP_SET_EMPTY) {
@@ -565,19 +1234,11 @@ set_fill_set(struct lyxp_set *set, struct lyxp_set *src, struct ly_ctx *ctx)
 
             set->type = LYXP_SET_NODE_SET;
             set->used = src->used;
-            set->size = src->size;
             set->pos = src->pos;
+            set->ht = NULL;
+            set->ht_size = set->ht_used = 0;
 
-            set->value.nodes = malloc(set->used * sizeof *set->value.nodes);
-            if (!set->value.nodes) {
-                LOGMEM;
-                memset(set, 0, sizeof *set);
-                return;
-            }
-            set->node_type = malloc(set->used * sizeof *set->node_type);
-            if (!set->node_type) {
-                LOGMEM;
-                free(set->value.nodes);
+            if (set_nodes_alloc(set, set->used)) {
                 memset(set, 0, sizeof *set);
                 return;
             }
@@ -598,11 +1259,15 @@ set_fill_set(struct lyxp_set *set, struct lyxp_set *src, struct ly_ctx *ctx)
  * @param[in] idx Index from \p set of the node to be removed.
  */
 static void
-set_remove_node(struct lyxp_set *set, uint16_t idx)
+set_remove_node(struct lyxp_set *set, uint32_t idx)
 {
     assert(set && (set->type == LYXP_SET_NODE_SET));
     assert(idx < set->used);
 
+    if (set->ht) {
+        set_hash_remove(set, set->value.nodes[idx], set->node_type[idx]);
+    }
+
     --set->used;
     if (set->used && (set->pos != idx + 1)) {
         memmove(&set->value.nodes[idx], &set->value.nodes[idx + 1],
@@ -613,27 +1278,39 @@ set_remove_node(struct lyxp_set *set, uint16_t idx)
             --set->pos;
         }
     } else {
-        free(set->value.nodes);
-        free(set->node_type);
+        set_nodes_free(set);
         /* this changes it to LYXP_SET_EMPTY */
         memset(set, 0, sizeof *set);
     }
 }
 
 /**
- * @brief Check for duplicates in a node set.
+ * @brief Check for duplicates in a node set. Larger sets are checked
+ *        using their auxiliary hash table, which is created if needed.
  *
  * @param[in] set Set to check.
  * @param[in] node Node to look for in \p set.
  * @param[in] node_type Type of \p node.
  * @param[in] skip_idx Index from \p set to skip.
  *
- * @return Position of the duplicate or -1 if there is none.
+ * @return 1 if there is a duplicate, -1 if there is none.
  */
 static int
 set_dup_node_check(struct lyxp_set *set, void *node, enum lyxp_node_type node_type, int skip_idx)
 {
-    uint16_t i;
+    uint32_t i, count;
+
+    if (!set->ht && (set->used >= LYXP_SET_HASH_MIN)) {
+        set_hash_build(set);
+    }
+
+    if (set->ht) {
+        count = set_hash_count(set, node, node_type);
+        if ((skip_idx > -1) && (set->value.nodes[skip_idx] == node) && (set->node_type[skip_idx] == node_type)) {
+            --count;
+        }
+        return (count ? 1 : -1);
+    }
 
     for (i = 0; i < set->used; ++i) {
         if ((skip_idx > -1) && (i == (unsigned)skip_idx)) {
@@ -641,13 +1318,38 @@ set_dup_node_check(struct lyxp_set *set, void *node, enum lyxp_node_type node_ty
         }
 
         if ((set->value.nodes[i] == node) && (set->node_type[i] == node_type)) {
-            return i;
+            return 1;
         }
     }
 
     return -1;
 }
 
+/**
+ * @brief Replace a node in a set.
+ *
+ * @param[in] set Set to use.
+ * @param[in] node Node to store in \p set.
+ * @param[in] node_type Node type of \p node.
+ * @param[in] idx Index in \p set of the node to replace.
+ */
+static void
+set_replace_node(struct lyxp_set *set, void *node, enum lyxp_node_type node_type, uint32_t idx)
+{
+    assert(set && (set->type == LYXP_SET_NODE_SET) && (idx < set->used));
+
+    if (set->ht) {
+        set_hash_remove(set, set->value.nodes[idx], set->node_type[idx]);
+        if (set_hash_insert(set, node, node_type)) {
+            /* it will be built again when needed */
+            set_hash_free(set);
+        }
+    }
+
+    set->value.nodes[idx] = node;
+    set->node_type[idx] = node_type;
+}
+
 /**
  * @brief Remove duplicate entries in a sorted node set.
  *
@@ -659,10 +1361,10 @@ set_dup_node_check(struct lyxp_set *set, void *node, enum lyxp_node_type node_ty
 static int
 set_sorted_dup_node_clean(struct lyxp_set *set)
 {
-    uint16_t i = 0;
+    uint32_t i = 0;
     int ret = EXIT_SUCCESS;
 
-    while (i < set->used - 1) {
+    while (i + 1 < set->used) {
         if ((set->value.nodes[i] == set->value.nodes[i + 1])
                 && (set->node_type[i] == set->node_type[i + 1])) {
             set_remove_node(set, i + 1);
@@ -684,7 +1386,7 @@ set_sorted_dup_node_clean(struct lyxp_set *set)
  * @param[in] idx Index in \p set to insert into.
  */
 static void
-set_insert_node(struct lyxp_set *set, void *node, enum lyxp_node_type node_type, uint16_t idx)
+set_insert_node(struct lyxp_set *set, void *node, enum lyxp_node_type node_type, uint32_t idx)
 {
     assert(set && ((set->type == LYXP_SET_NODE_SET) || (set->type == LYXP_SET_EMPTY)));
 
@@ -694,42 +1396,38 @@ set_insert_node(struct lyxp_set *set, void *node, enum lyxp_node_type node_type,
             /* no real harm done, but it is a bug */
             LOGINT;
         }
-        set->value.nodes = calloc(LYXP_SET_SIZE_START, sizeof *set->value.nodes);
-        if (!set->value.nodes) {
-            LOGMEM;
+        if (set_nodes_alloc(set, LYXP_SET_SIZE_START)) {
             return;
         }
         set->value.nodes[0] = node;
-        set->node_type = malloc(LYXP_SET_SIZE_START * sizeof *set->node_type);
-        if (!set->node_type) {
-            LOGMEM;
-            free(set->value.nodes);
-            return;
-        }
         set->node_type[0] = node_type;
         set->type = LYXP_SET_NODE_SET;
         set->used = 1;
-        set->size = LYXP_SET_SIZE_START;
         set->pos = 0;
+        set->ht = NULL;
+        set->ht_size = set->ht_used = 0;
     } else {
         /* not an empty set */
         if (set->used == set->size) {
 
             /* set is full */
-            set->value.nodes = ly_realloc(set->value.nodes, (set->size + LYXP_SET_SIZE_STEP) * sizeof *set->value.nodes);
+            set->value.nodes = ly_realloc(set->value.nodes, set->size * 2 * sizeof *set->value.nodes);
             if (!set->value.nodes) {
                 LOGMEM;
+                free(set->node_type);
+                set_hash_free(set);
                 memset(set, 0, sizeof *set);
                 return;
             }
-            set->node_type = ly_realloc(set->node_type, (set->size + LYXP_SET_SIZE_STEP) * sizeof *set->node_type);
+            set->node_type = ly_realloc(set->node_type, set->size * 2 * sizeof *set->node_type);
             if (!set->node_type) {
                 LOGMEM;
                 free(set->value.nodes);
+                set_hash_free(set);
                 memset(set, 0, sizeof *set);
                 return;
             }
-            set->size += LYXP_SET_SIZE_STEP;
+            set->size *= 2;
         }
 
         if (idx > set->used) {
@@ -750,6 +1448,11 @@ set_insert_node(struct lyxp_set *set, void *node, enum lyxp_node_type node_type,
         set->value.nodes[idx] = node;
         set->node_type[idx] = node_type;
         ++set->used;
+
+        if (set->ht && set_hash_insert(set, node, node_type)) {
+            /* it will be built again when needed */
+            set_hash_free(set);
+        }
     }
 }
 
@@ -761,7 +1464,7 @@ set_insert_node(struct lyxp_set *set, void *node, enum lyxp_node_type node_type,
 static void
 print_set_debug(struct lyxp_set *set)
 {
-    uint16_t i;
+    uint32_t i;
     char *str_num;
 
     switch (set->type) {
@@ -788,10 +1491,10 @@ print_set_debug(struct lyxp_set *set)
                 if ((set->value.nodes[i]->schema->nodetype == LYS_LIST)
                         && (set->value.nodes[i]->child->schema->nodetype == LYS_LEAF)) {
                     LOGDBG("XPATH:\t%d: ELEM %s (1st child val: %s)", i + 1, set->value.nodes[i]->schema->name,
-                           ((struct lyd_node_leaf_list *)set->value.nodes[i]->child)->value_str);
+                           lyd_value_str((struct lyd_node_leaf_list *)set->value.nodes[i]->child));
                 } else if (set->value.nodes[i]->schema->nodetype == LYS_LEAFLIST) {
                     LOGDBG("XPATH:\t%d: ELEM %s (val: %s)", i + 1, set->value.nodes[i]->schema->name,
-                           ((struct lyd_node_leaf_list *)set->value.nodes[i])->value_str);
+                           lyd_value_str((struct lyd_node_leaf_list *)set->value.nodes[i]));
                 } else {
                     LOGDBG("XPATH:\t%d: ELEM %s", i + 1, set->value.nodes[i]->schema->name);
                 }
@@ -800,7 +1503,7 @@ print_set_debug(struct lyxp_set *set)
                 if (set->value.nodes[i]->schema->nodetype == LYS_ANYXML) {
                     LOGDBG("XPATH:\t%d: TEXT <anyxml>", i + 1);
                 } else {
-                    LOGDBG("XPATH:\t%d: TEXT %s", i + 1, ((struct lyd_node_leaf_list *)set->value.nodes[i])->value_str);
+                    LOGDBG("XPATH:\t%d: TEXT %s", i + 1, lyd_value_str((struct lyd_node_leaf_list *)set->value.nodes[i]));
                 }
                 break;
             case LYXP_NODE_ATTR:
@@ -852,32 +1555,43 @@ print_set_debug(struct lyxp_set *set)
 }
 
 /**
- * @brief Get unique \p node position in the data.
+ * @brief Hash a node (attribute) pointer for the document order sort.
  *
- * @param[in] node Node to find.
- * @param[in] node_type Node type of \p node.
- * @param[in] root Root node.
- * @param[in] root_type Type of the XPath \p root node.
+ * @param[in] ptr Node or attribute.
  *
- * @return Node position.
+ * @return Hash of \p ptr.
  */
-static uint16_t
-get_node_pos(struct lyd_node *node, enum lyxp_node_type node_type, struct lyd_node *root, enum lyxp_node_type root_type)
+static uint32_t
+set_sort_hash(void *ptr)
 {
-    struct lyd_node *next, *elem;
-    uint16_t pos = 1;
+    return dict_hash((const char *)&ptr, sizeof ptr);
+}
 
-    if ((node_type == LYXP_NODE_ROOT_CONFIG) || (node_type == LYXP_NODE_ROOT_STATE) || (node_type == LYXP_NODE_ROOT_NOTIF)
-            || (node_type == LYXP_NODE_ROOT_RPC) || (node_type == LYXP_NODE_ROOT_OUTPUT)) {
-        return 0;
-    }
+/**
+ * @brief Assign document order keys to node set items in a single DFS pass over the data.
+ *        The traversal stops once all the items get their key.
+ *
+ * @param[in] ht Hash table of the items, keys are their node (attribute) pointers.
+ * @param[in] count Number of items in \p ht.
+ * @param[in] root Root node.
+ * @param[in] root_type Type of the XPath \p root node.
+ *
+ * @return Number of the items that were found in the data.
+ */
+static uint32_t
+set_sort_assign_keys(struct ly_ht *ht, uint32_t count, struct lyd_node *root, enum lyxp_node_type root_type)
+{
+    struct lyd_node *next, *elem;
+    struct lyd_attr *attr;
+    struct lyxp_sort_item *item;
+    uint32_t pos = 1, attr_pos, iter, found = 0;
 
     if (root_type == LYXP_NODE_ROOT_OUTPUT) {
         root = root->child;
     }
 
     /* TREE DFS */
-    for (elem = next = root; elem; elem = next) {
+    for (elem = next = root; elem && (found < count); elem = next) {
         if ((root_type == LYXP_NODE_ROOT_CONFIG) && (elem->schema->flags & LYS_CONFIG_R)) {
             goto skip_children;
         }
@@ -885,8 +1599,24 @@ get_node_pos(struct lyd_node *node, enum lyxp_node_type node_type, struct lyd_no
             goto skip_children;
         }
 
-        if (elem == node) {
-            break;
+        /* the node itself and its text node */
+        iter = 0;
+        while ((item = ly_ht_find(ht, set_sort_hash(elem), &iter))) {
+            if (item->node == elem) {
+                item->key = ((uint64_t)pos << 32) | ((item->type == LYXP_NODE_TEXT) ? UINT32_MAX : 0);
+                ++found;
+            }
+        }
+
+        /* its attributes, they are between them */
+        for (attr = elem->attr, attr_pos = 1; attr; attr = attr->next, ++attr_pos) {
+            iter = 0;
+            while ((item = ly_ht_find(ht, set_sort_hash(attr), &iter))) {
+                if (item->node == attr) {
+                    item->key = ((uint64_t)pos << 32) | attr_pos;
+                    ++found;
+                }
+            }
         }
         ++pos;
 
@@ -914,122 +1644,50 @@ skip_children:
         }
     }
 
-    if (!elem) {
-        LOGINT;
-    }
-
-    return pos;
-}
-
-/**
- * @brief Get unique \p attr position in the parent attributes.
- *
- * @param[in] attr Attr to use.
- * @param[in] parent Parent of \p attr.
- *
- * @return Attribute position.
- */
-static uint16_t
-get_attr_pos(struct lyd_attr *attr, struct lyd_node *parent)
-{
-    uint16_t pos = 0;
-    struct lyd_attr *attr2;
-
-    for (attr2 = parent->attr; attr2 && (attr2 != attr); attr2 = attr2->next) {
-        ++pos;
-    }
-
-    assert(attr2);
-    return pos;
+    return found;
 }
 
 /**
- * @brief Compare 2 nodes in respect to XPath document order.
+ * @brief Compare 2 node set items in respect to XPath document order, callback for qsort(3).
  *
- * @param[in] first_node_pos 1st node position.
- * @param[in] first_attr_pos 1st attribute node position.
- * @param[in] second_node_pos 2nd node position.
- * @param[in] second_attr_pos 2nd attribute node position.
- * @param[in] first_idx Index of the 1st node in \p set.
- * @param[in] second_idx Index of the 2nd node in \p set.
- * @param[in] set Set with the nodes.
+ * @param[in] item1 1st item.
+ * @param[in] item2 2nd item.
  *
  * @return If 1st > 2nd returns 1, 1st == 2nd returns 0, and 1st < 2nd returns -1.
  */
 static int
-set_sort_compare(uint16_t first_node_pos, uint16_t first_attr_pos, uint16_t second_node_pos, uint16_t second_attr_pos,
-                 uint16_t first_idx, uint16_t second_idx, struct lyxp_set *set)
+set_sort_compare(const void *item1, const void *item2)
 {
-    if (first_node_pos < second_node_pos) {
-        return -1;
-    }
-
-    if (first_node_pos > second_node_pos) {
-        return 1;
-    }
-
-    /* node positions are equal, the fun case */
-
-    /* 1st ELEM - == - 2nd TEXT, 1st TEXT - == - 2nd ELEM */
-    /* special case since text nodes are actually saved as their parents */
-    if ((set->value.nodes[first_idx] == set->value.nodes[second_idx])
-            && (set->node_type[first_idx] != set->node_type[second_idx])) {
-        if (set->node_type[first_idx] == LYXP_NODE_ELEM) {
-            assert(set->node_type[second_idx] == LYXP_NODE_TEXT);
-            return -1;
-        } else {
-            assert((set->node_type[first_idx] == LYXP_NODE_TEXT) && (set->node_type[second_idx] == LYXP_NODE_ELEM));
-            return 1;
-        }
-    }
-
-    /* 1st ROOT - 2nd ROOT, 1st ELEM - 2nd ELEM, 1st TEXT - 2nd TEXT, 1st ATTR - =pos= - 2nd ATTR */
-    /* check for duplicates */
-    if (set->value.nodes[first_idx] == set->value.nodes[second_idx]) {
-        assert((set->node_type[first_idx] == set->node_type[second_idx])
-                && ((set->node_type[first_idx] != LYXP_NODE_ATTR) || (first_attr_pos == second_attr_pos)));
-        return 0;
-    }
+    const struct lyxp_sort_item *i1 = item1, *i2 = item2;
 
-    /* 1st ELEM - 2nd TEXT, 1st ELEM - any pos - 2nd ATTR */
-    /* elem is always first, 2nd node is after it */
-    if (set->node_type[first_idx] == LYXP_NODE_ELEM) {
-        assert(set->node_type[second_idx] != LYXP_NODE_ELEM);
+    if (i1->key < i2->key) {
         return -1;
-    }
-
-    /* 1st TEXT - 2nd ELEM, 1st TEXT - any pos - 2nd ATTR, 1st ATTR - any pos - 2nd ELEM, 1st ATTR - >pos> - 2nd ATTR */
-    /* 2nd is before 1st */
-    if (((set->node_type[first_idx] == LYXP_NODE_TEXT)
-            && ((set->node_type[second_idx] == LYXP_NODE_ELEM) || (set->node_type[second_idx] == LYXP_NODE_ATTR)))
-            || ((set->node_type[first_idx] == LYXP_NODE_ATTR) && (set->node_type[second_idx] == LYXP_NODE_ELEM))
-            || (((set->node_type[first_idx] == LYXP_NODE_ATTR) && (set->node_type[second_idx] == LYXP_NODE_ATTR))
-            && (first_attr_pos > second_attr_pos))) {
+    } else if (i1->key > i2->key) {
         return 1;
     }
-
-    /* 1st ATTR - any pos - 2nd TEXT, 1st ATTR <pos< - 2nd ATTR */
-    /* 2nd is after 1st */
-    return -1;
+    return 0;
 }
 
 /**
- * @brief Bubble sort \p set into XPath document order.
+ * @brief Sort \p set into XPath document order. Every node gets its DFS position
+ *        in a single pass over the data and then the positions are sorted.
  *        Context position aware.
  *
  * @param[in] set Set to sort.
  * @param[in] cur_node Original context node.
  * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
  *
- * @return How many times the whole set was traversed.
+ * @return 0 if \p set was already sorted, 1 if it was reordered, -1 on error.
  */
 static int
 set_sort(struct lyxp_set *set, struct lyd_node *cur_node, int when_must_eval)
 {
-    uint16_t i, j, node_pos1 = 0, node_pos2 = 0, attr_pos1 = 0, attr_pos2 = 0;
-    int ret = 0, cmp, inverted, change;
-    struct lyd_node *tmp_node, *root = NULL;
-    enum lyxp_node_type tmp_type, root_type;
+    uint32_t i, count = 0;
+    int ret = 0;
+    struct lyd_node *root;
+    struct lyxp_sort_item *items;
+    struct ly_ht ht;
+    enum lyxp_node_type root_type;
 
     if ((set->type != LYXP_SET_NODE_SET) || (set->used == 1)) {
         return ret;
@@ -1041,89 +1699,65 @@ set_sort(struct lyxp_set *set, struct lyd_node *cur_node, int when_must_eval)
     LOGDBG("XPATH: SORT BEGIN");
     print_set_debug(set);
 
+    items = malloc(set->used * sizeof *items);
+    if (!items) {
+        LOGMEM;
+        return -1;
+    }
+    memset(&ht, 0, sizeof ht);
+
     for (i = 0; i < set->used; ++i) {
-        inverted = 0;
-        change = 0;
+        items[i].node = set->value.nodes[i];
+        items[i].type = set->node_type[i];
+        items[i].idx = i;
 
-        /* first node position */
-        if (set->node_type[0] == LYXP_NODE_ATTR) {
-            tmp_node = lyd_attr_parent(root, set->value.attrs[0]);
-            if (!tmp_node) {
-                LOGINT;
-                return -1;
+        switch (set->node_type[i]) {
+        case LYXP_NODE_ROOT_CONFIG:
+        case LYXP_NODE_ROOT_STATE:
+        case LYXP_NODE_ROOT_NOTIF:
+        case LYXP_NODE_ROOT_RPC:
+        case LYXP_NODE_ROOT_OUTPUT:
+            /* the root is always first */
+            items[i].key = 0;
+            break;
+        default:
+            /* not found nodes are last */
+            items[i].key = UINT64_MAX;
+            if (ly_ht_insert(&ht, set_sort_hash(items[i].node), &items[i])) {
+                ret = -1;
+                goto cleanup;
             }
-            node_pos1 = get_node_pos(tmp_node, set->node_type[0], root, root_type);
-            attr_pos1 = get_attr_pos(set->value.attrs[0], tmp_node);
-        } else {
-            node_pos1 = get_node_pos(set->value.nodes[0], set->node_type[0], root, root_type);
+            ++count;
+            break;
         }
+    }
 
-        for (j = 1; j < set->used - i; ++j) {
-            /* another node position */
-            if (set->node_type[j] == LYXP_NODE_ATTR) {
-                tmp_node = lyd_attr_parent(root, set->value.attrs[j]);
-                if (!tmp_node) {
-                    LOGINT;
-                    return -1;
-                }
-
-                if (inverted) {
-                    node_pos1 = get_node_pos(tmp_node, set->node_type[j], root, root_type);
-                    attr_pos1 = get_attr_pos(set->value.attrs[j], tmp_node);
-                } else {
-                    node_pos2 = get_node_pos(tmp_node, set->node_type[j], root, root_type);
-                    attr_pos2 = get_attr_pos(set->value.attrs[j], tmp_node);
-                }
-            } else {
-                if (inverted) {
-                    node_pos1 = get_node_pos(set->value.nodes[j], set->node_type[j], root, root_type);
-                } else {
-                    node_pos2 = get_node_pos(set->value.nodes[j], set->node_type[j], root, root_type);
-                }
-            }
-
-            /* compare node positions */
-            if (inverted) {
-                cmp = set_sort_compare(node_pos1, attr_pos1, node_pos2, attr_pos2, j, j - 1, set);
-            } else {
-                cmp = set_sort_compare(node_pos1, attr_pos1, node_pos2, attr_pos2, j - 1, j, set);
-            }
-
-            /* swap if needed */
-            if ((inverted && (cmp < 0)) || (!inverted && (cmp > 0))) {
-                change = 1;
-
-                tmp_node = set->value.nodes[j - 1];
-                tmp_type = set->node_type[j - 1];
-
-                set->value.nodes[j - 1] = set->value.nodes[j];
-                set->node_type[j - 1] = set->node_type[j];
+    if (set_sort_assign_keys(&ht, count, root, root_type) < count) {
+        LOGINT;
+    }
 
-                set->value.nodes[j] = tmp_node;
-                set->node_type[j] = tmp_type;
+    /* sort only if not sorted already */
+    for (i = 1; (i < set->used) && (items[i - 1].key <= items[i].key); ++i);
+    if (i < set->used) {
+        qsort(items, set->used, sizeof *items, set_sort_compare);
 
-                /* pos == index + 1 */
-                if (set->pos == j + 1) {
-                    set->pos = j;
-                } else if (set->pos == j) {
-                    set->pos = j + 1;
-                }
-            } else {
-                /* whether node_pos1 should be smaller than node_pos2 or the other way around */
-                inverted = !inverted;
+        for (i = 0; i < set->used; ++i) {
+            set->value.nodes[i] = items[i].node;
+            set->node_type[i] = items[i].type;
+            /* pos == index + 1 */
+            if (set->pos && (items[i].idx == set->pos - 1)) {
+                set->pos = i + 1;
             }
         }
-
-        ++ret;
-
-        if (!change) {
-            break;
-        }
+        ret = 1;
     }
 
     LOGDBG("XPATH: SORT END %d", ret);
     print_set_debug(set);
 
+cleanup:
+    ly_ht_clean(&ht);
+    free(items);
     return ret;
 }
 
@@ -1147,10 +1781,10 @@ set_sort(struct lyxp_set *set, struct lyd_node *cur_node, int when_must_eval)
  * @param[in] tok_len Token length in the XPath expression.
  */
 static void
-exp_add_token(struct lyxp_expr *exp, enum lyxp_token token, uint16_t expr_pos, uint16_t tok_len)
+exp_add_token(struct lyxp_expr *exp, enum lyxp_token token, uint32_t expr_pos, uint32_t tok_len)
 {
     if (exp->used == exp->size) {
-        exp->size += LYXP_EXPR_SIZE_STEP;
+        exp->size *= 2;
         exp->tokens = ly_realloc(exp->tokens, exp->size * sizeof *exp->tokens);
         if (!exp->tokens) {
             LOGMEM;
@@ -1186,16 +1820,21 @@ exp_add_token(struct lyxp_expr *exp, enum lyxp_token token, uint16_t expr_pos, u
  *         -1 otherwise.
  */
 static int
-exp_check_token(struct lyxp_expr *exp, uint16_t exp_idx, enum lyxp_token want_tok, uint32_t line)
+exp_check_token(struct lyxp_expr *exp, uint32_t exp_idx, enum lyxp_token want_tok, uint32_t line)
 {
     if (exp->used == exp_idx) {
-        LOGVAL(LYE_XPATH_EOF, line, 0, NULL);
+        if (line != UINT_MAX) {
+            LOGVAL(LYE_XPATH_EOF, line, 0, NULL);
+        }
         return -1;
     }
 
     if (want_tok && (exp->tokens[exp_idx] != want_tok)) {
-        LOGVAL(LYE_XPATH_INTOK, line, 0, NULL,
-               print_token(exp->tokens[exp_idx]), &exp->expr[exp->expr_pos[exp_idx]]);
+        /* only probing, do not waste time on the error message */
+        if (line != UINT_MAX) {
+            LOGVAL(LYE_XPATH_INTOK, line, 0, NULL,
+                   print_token(exp->tokens[exp_idx]), &exp->expr[exp->expr_pos[exp_idx]]);
+        }
         return -1;
     }
 
@@ -1203,46 +1842,38 @@ exp_check_token(struct lyxp_expr *exp, uint16_t exp_idx, enum lyxp_token want_to
 }
 
 /**
- * @brief Stack operation peek on the repeat array.
+ * @brief Find an operator in the repeat array. Every rule pushes at most one operator for
+ * a position, so the array is only searched and never modified during evaluation.
  *
  * @param[in] exp Expression to use.
  * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in] op_tok Token of the searched operator.
+ * @param[in] op_chars First characters of the searched operators, NULL if not checked.
+ * @param[in] op_len Length of the searched operators, 0 if not checked.
  *
- * @return Last repeat or 0.
+ * @return Index of the operator or 0.
  */
-static uint16_t
-exp_repeat_peek(struct lyxp_expr *exp, uint16_t exp_idx)
+static uint32_t
+exp_repeat_find(struct lyxp_expr *exp, uint32_t exp_idx, enum lyxp_token op_tok, const char *op_chars, uint32_t op_len)
 {
-    uint16_t i;
+    uint32_t i, op;
 
     if (!exp->repeat[exp_idx]) {
         return 0;
     }
 
-    for (i = 0; exp->repeat[exp_idx][i + 1]; ++i);
-
-    return exp->repeat[exp_idx][i];
-}
-
-/**
- * @brief Stack operation pop on the repeat array.
- *
- * @param[in] exp Expression to use.
- * @param[in] exp_idx Position in the expression \p exp.
- */
-static void
-exp_repeat_pop(struct lyxp_expr *exp, uint16_t exp_idx)
-{
-    uint16_t i;
-
-    if (!exp->repeat[exp_idx]) {
-        LOGINT;
-        return;
+    for (i = 0; exp->repeat[exp_idx][i]; ++i) {
+        op = exp->repeat[exp_idx][i];
+        if (exp->tokens[op] != op_tok) {
+            continue;
+        }
+        if ((!op_chars && !op_len) || (op_chars && strchr(op_chars, exp->expr[exp->expr_pos[op]]))
+                || (op_len && (exp->tok_len[op] == op_len))) {
+            return op;
+        }
     }
 
-    for (i = 0; exp->repeat[exp_idx][i + 1]; ++i);
-
-    exp->repeat[exp_idx][i] = 0;
+    return 0;
 }
 
 /**
@@ -1253,9 +1884,9 @@ exp_repeat_pop(struct lyxp_expr *exp, uint16_t exp_idx)
  * @param[in] repeat_op_idx Index from \p exp of the operator token. This value is pushed.
  */
 static void
-exp_repeat_push(struct lyxp_expr *exp, uint16_t exp_idx, uint16_t repeat_op_idx)
+exp_repeat_push(struct lyxp_expr *exp, uint32_t exp_idx, uint32_t repeat_op_idx)
 {
-    uint16_t i;
+    uint32_t i;
 
     if (exp->repeat[exp_idx]) {
         for (i = 0; exp->repeat[exp_idx][i]; ++i);
@@ -1288,7 +1919,7 @@ exp_repeat_push(struct lyxp_expr *exp, uint16_t exp_idx, uint16_t repeat_op_idx)
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-reparse_predicate(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_predicate(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
     if (exp_check_token(exp, *exp_idx, LYXP_TOKEN_BRACK1, line)) {
         return -1;
@@ -1321,7 +1952,7 @@ reparse_predicate(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on forward reference, -1 on error.
  */
 static int
-reparse_relative_location_path(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_relative_location_path(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
     if (exp_check_token(exp, *exp_idx, LYXP_TOKEN_NONE, line)) {
         return -1;
@@ -1408,7 +2039,7 @@ reparse_predicate:
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-reparse_absolute_location_path(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_absolute_location_path(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
     if (exp_check_token(exp, *exp_idx, LYXP_TOKEN_OPERATOR_PATH, line)) {
         return -1;
@@ -1461,7 +2092,7 @@ reparse_absolute_location_path(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-reparse_function_call(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_function_call(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
     if (exp_check_token(exp, *exp_idx, LYXP_TOKEN_FUNCNAME, line)) {
         return -1;
@@ -1516,7 +2147,7 @@ reparse_function_call(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-reparse_path_expr(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_path_expr(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
     if (exp_check_token(exp, *exp_idx, LYXP_TOKEN_NONE, line)) {
         return -1;
@@ -1613,9 +2244,9 @@ predicate:
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-reparse_unary_expr(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_unary_expr(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
-    uint16_t prev_exp;
+    uint32_t prev_exp;
 
     /* ('-')* */
     while (!exp_check_token(exp, *exp_idx, LYXP_TOKEN_OPERATOR_MATH, UINT_MAX)
@@ -1662,9 +2293,9 @@ reparse_unary_expr(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-reparse_additive_expr(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_additive_expr(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
-    uint16_t prev_add_exp, prev_mul_exp;
+    uint32_t prev_add_exp, prev_mul_exp;
 
     goto reparse_multiplicative_expr;
 
@@ -1717,9 +2348,9 @@ reparse_multiplicative_expr:
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-reparse_equality_expr(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_equality_expr(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
-    uint16_t prev_eq_exp, prev_rel_exp;
+    uint32_t prev_eq_exp, prev_rel_exp;
 
     goto reparse_additive_expr;
 
@@ -1767,9 +2398,9 @@ reparse_additive_expr:
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-reparse_expr(struct lyxp_expr *exp, uint16_t *exp_idx, uint32_t line)
+reparse_expr(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t line)
 {
-    uint16_t prev_or_exp, prev_and_exp;
+    uint32_t prev_or_exp, prev_and_exp;
 
     goto reparse_equality_expr;
 
@@ -1802,6 +2433,95 @@ reparse_equality_expr:
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Check whether there is an "NameTest = Literal|Number" or "Literal|Number = NameTest"
+ *        condition at the position.
+ *
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ *
+ * @return 1 if there is, 0 otherwise.
+ */
+static int
+reparse_is_eq_cond(struct lyxp_expr *exp, uint32_t exp_idx)
+{
+    uint32_t name_idx, val_idx;
+
+    if (exp_idx + 2 >= exp->used) {
+        return 0;
+    }
+
+    if (exp->tokens[exp_idx] == LYXP_TOKEN_NAMETEST) {
+        name_idx = exp_idx;
+        val_idx = exp_idx + 2;
+    } else {
+        name_idx = exp_idx + 2;
+        val_idx = exp_idx;
+    }
+
+    if ((exp->tokens[name_idx] != LYXP_TOKEN_NAMETEST)
+            || (exp->expr[exp->expr_pos[name_idx] + exp->tok_len[name_idx] - 1] == '*')) {
+        return 0;
+    }
+    if ((exp->tokens[exp_idx + 1] != LYXP_TOKEN_OPERATOR_COMP) || (exp->tok_len[exp_idx + 1] != 1)
+            || (exp->expr[exp->expr_pos[exp_idx + 1]] != '=')) {
+        return 0;
+    }
+    if ((exp->tokens[val_idx] != LYXP_TOKEN_LITERAL) && (exp->tokens[val_idx] != LYXP_TOKEN_NUMBER)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Find all the predicates consisting only of "NameTest = Literal|Number" conditions
+ *        joined by 'and', these are usually list key predicates. Fills lyxp_expr::eq_pred.
+ *
+ * @param[in] exp Parsed and reparsed XPath expression.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+static int
+reparse_eq_predicates(struct lyxp_expr *exp)
+{
+    uint32_t i, j, count;
+
+    for (i = 0; i < exp->used; ++i) {
+        if (exp->tokens[i] != LYXP_TOKEN_BRACK1) {
+            continue;
+        }
+
+        count = 0;
+        j = i + 1;
+        while ((count < UINT8_MAX) && reparse_is_eq_cond(exp, j)) {
+            ++count;
+            j += 3;
+            if ((j < exp->used) && (exp->tokens[j] == LYXP_TOKEN_OPERATOR_LOG) && (exp->tok_len[j] == 3)) {
+                /* 'and' */
+                ++j;
+                continue;
+            }
+            break;
+        }
+
+        if (!count || (j >= exp->used) || (exp->tokens[j] != LYXP_TOKEN_BRACK2)) {
+            continue;
+        }
+
+        if (!exp->eq_pred) {
+            exp->eq_pred = calloc(exp->used, sizeof *exp->eq_pred);
+            if (!exp->eq_pred) {
+                LOGMEM;
+                return -1;
+            }
+        }
+        exp->eq_pred[i] = count;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 /**
  * @brief Parse NCName.
  *
@@ -1809,10 +2529,10 @@ reparse_equality_expr:
  *
  * @return Length of \p ncname valid characters.
  */
-static uint16_t
+static uint32_t
 parse_ncname(const char *ncname)
 {
-    uint16_t parsed = 0;
+    uint32_t parsed = 0;
     int uc;
     unsigned int size;
 
@@ -1847,7 +2567,7 @@ static struct lyxp_expr *
 parse_expr(const char *expr, uint32_t line)
 {
     struct lyxp_expr *ret;
-    uint16_t parsed = 0, tok_len, ncname_len;
+    uint32_t parsed = 0, tok_len, ncname_len;
     enum lyxp_token tok_type;
     int prev_function_check = 0;
 
@@ -1860,6 +2580,7 @@ parse_expr(const char *expr, uint32_t line)
     ret->expr = expr;
     ret->used = 0;
     ret->size = LYXP_EXPR_SIZE_START;
+    ret->eq_pred = NULL;
     ret->tokens = malloc(ret->size * sizeof *ret->tokens);
     if (!ret->tokens) {
         LOGMEM;
@@ -2105,381 +2826,622 @@ error:
 }
 
 /*
- * XPath functions
- */
-
-/**
- * @brief Execute the XPath boolean(object) function. Returns LYXP_SET_BOOLEAN
- *        with the argument converted to boolean.
- *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
- *
- * @return EXIT_SUCCESS on success, -1 on error.
+ * constant folding functions
  */
-static int
-xpath_boolean(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-              int when_must_eval, uint32_t line)
-{
-    struct ly_ctx *ctx;
-
-    if (arg_count != 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "boolean(object)");
-        return -1;
-    }
-
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(args, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
-    set_fill_set(set, args, ctx);
-
-    return EXIT_SUCCESS;
-}
 
 /**
- * @brief Execute the XPath ceiling(number) function. Returns LYXP_SET_NUMBER
- *        with the first argument rounded up to the nearest integer.
+ * @brief Cast a constant value the same way set_cast() casts a set.
  *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
+ * @param[in,out] val Constant value to cast.
+ * @param[in] target Target type, LYXP_SET_BOOLEAN or LYXP_SET_NUMBER.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_ceiling(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-              int when_must_eval, uint32_t line)
+fold_val_cast(struct lyxp_fold_val *val, enum lyxp_set_type target)
 {
-    struct ly_ctx *ctx;
+    char *str;
 
-    if (arg_count != 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "ceiling(number)");
-        return -1;
+    if (val->type == target) {
+        return EXIT_SUCCESS;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(args, LYXP_SET_NUMBER, cur_node, when_must_eval);
-    if ((long long)args->value.num != args->value.num) {
-        set_fill_number(set, ((long long)args->value.num) + 1, ctx);
+    if (target == LYXP_SET_BOOLEAN) {
+        if (val->type == LYXP_SET_NUMBER) {
+            val->bool = ((val->num == 0) || isnan(val->num)) ? 0 : 1;
+        } else {
+            val->bool = val->str_len ? 1 : 0;
+        }
     } else {
-        set_fill_number(set, args->value.num, ctx);
+        if (val->type == LYXP_SET_BOOLEAN) {
+            val->num = val->bool ? 1 : 0;
+        } else {
+            str = strndup(val->str, val->str_len);
+            if (!str) {
+                LOGMEM;
+                return -1;
+            }
+            val->num = cast_string_to_number(str);
+            free(str);
+        }
     }
+    val->type = target;
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath concat(string, string, string*) function.
- *        Returns LYXP_SET_STRING with the concatenation of all the arguments.
+ * @brief Apply a binary operator on 2 constant values the same way moveto_op_log(),
+ *        moveto_op_comp(), and moveto_op_math() do.
  *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
+ * @param[in] exp Parsed XPath expression.
+ * @param[in,out] val1 First operand, result.
+ * @param[in] op Index of the operator in \p exp.
+ * @param[in] val2 Second operand, may be cast.
  *
- * @return EXIT_SUCCESS on success, -1 on error.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the result cannot be computed now, -1 on error.
  */
 static int
-xpath_concat(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-             int when_must_eval, uint32_t line)
+fold_val_op(struct lyxp_expr *exp, struct lyxp_fold_val *val1, uint32_t op, struct lyxp_fold_val *val2)
 {
-    uint16_t i;
-    char *str = NULL;
-    size_t used = 1;
-    struct ly_ctx *ctx;
-
-    if (arg_count < 2) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "concat(string, string, string*)");
-        return -1;
-    }
-
-    ctx = cur_node->schema->module->ctx;
+    const char *op_str;
+    long double num1, num2;
+    int result;
 
-    for (i = 0; i < arg_count; ++i) {
-        lyxp_set_cast(&args[i], LYXP_SET_STRING, cur_node, when_must_eval);
+    op_str = &exp->expr[exp->expr_pos[op]];
 
-        str = ly_realloc(str, (used + strlen(args[i].value.str)) * sizeof(char));
-        if (!str) {
-            LOGMEM;
+    switch (exp->tokens[op]) {
+    case LYXP_TOKEN_OPERATOR_LOG:
+        if (fold_val_cast(val1, LYXP_SET_BOOLEAN) || fold_val_cast(val2, LYXP_SET_BOOLEAN)) {
             return -1;
         }
-        strcpy(str + used - 1, args[i].value.str);
-        used += strlen(args[i].value.str);
-    }
-
-    /* free, kind of */
-    lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    set->type = LYXP_SET_STRING;
-    set->value.str = lydict_insert_zc(ctx, str);
+        if (exp->tok_len[op] == 2) {
+            val1->bool = (val1->bool || val2->bool);
+        } else {
+            val1->bool = (val1->bool && val2->bool);
+        }
+        break;
 
-    return EXIT_SUCCESS;
+    case LYXP_TOKEN_OPERATOR_COMP:
+        if ((op_str[0] == '=') || (op_str[0] == '!')) {
+            if ((val1->type != val2->type) && ((val1->type == LYXP_SET_BOOLEAN) || (val2->type == LYXP_SET_BOOLEAN))) {
+                if (fold_val_cast(val1, LYXP_SET_BOOLEAN) || fold_val_cast(val2, LYXP_SET_BOOLEAN)) {
+                    return -1;
+                }
+            } else if (val1->type != val2->type) {
+                if (fold_val_cast(val1, LYXP_SET_NUMBER) || fold_val_cast(val2, LYXP_SET_NUMBER)) {
+                    return -1;
+                }
+            }
+
+            if (val1->type == LYXP_SET_BOOLEAN) {
+                result = (val1->bool == val2->bool);
+            } else if (val1->type == LYXP_SET_NUMBER) {
+                result = (val1->num == val2->num);
+            } else {
+                result = ((val1->str_len == val2->str_len) && !strncmp(val1->str, val2->str, val1->str_len));
+            }
+            if (op_str[0] == '!') {
+                result = !result;
+            }
+        } else {
+            if (fold_val_cast(val1, LYXP_SET_NUMBER) || fold_val_cast(val2, LYXP_SET_NUMBER)) {
+                return -1;
+            }
+
+            if (op_str[0] == '<') {
+                result = (op_str[1] == '=') ? (val1->num <= val2->num) : (val1->num < val2->num);
+            } else {
+                result = (op_str[1] == '=') ? (val1->num >= val2->num) : (val1->num > val2->num);
+            }
+        }
+        val1->type = LYXP_SET_BOOLEAN;
+        val1->bool = result;
+        break;
+
+    case LYXP_TOKEN_OPERATOR_MATH:
+        if (fold_val_cast(val1, LYXP_SET_NUMBER) || fold_val_cast(val2, LYXP_SET_NUMBER)) {
+            return -1;
+        }
+        num1 = val1->num;
+        num2 = val2->num;
+
+        switch (op_str[0]) {
+        case '+':
+            val1->num = num1 + num2;
+            break;
+        case '-':
+            val1->num = num1 - num2;
+            break;
+        case '*':
+            val1->num = num1 * num2;
+            break;
+        case 'd':
+            val1->num = num1 / num2;
+            break;
+        case 'm':
+            /* leave anything undefined to the evaluation */
+            if (!isfinite(num1) || !isfinite(num2) || (fabsl(num1) >= LLONG_MAX) || (fabsl(num2) >= LLONG_MAX)
+                    || !(long long)num2) {
+                return EXIT_FAILURE;
+            }
+            val1->num = ((long long)num1) % ((long long)num2);
+            break;
+        default:
+            LOGINT;
+            return -1;
+        }
+        break;
+
+    default:
+        LOGINT;
+        return -1;
+    }
+
+    val1->ops += val2->ops + 1;
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath contains(string, string) function.
- *        Returns LYXP_SET_BOOLEAN whether the second argument can
- *        be found in the first or not.
+ * @brief Remember a constant subexpression to be replaced by its value, if it is worth it.
  *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
+ * @param[in] fold Constant subexpressions found so far.
+ * @param[in] val Value of the subexpression.
+ * @param[in] start Index of the first token of the subexpression.
+ * @param[in] end Index of the token following the subexpression.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_contains(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-               int when_must_eval, uint32_t line)
+fold_add(struct lyxp_fold *fold, struct lyxp_fold_val *val, uint32_t start, uint32_t end)
 {
-    struct ly_ctx *ctx;
-
-    if (arg_count != 2) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "contains(string, string)");
-        return -1;
+    /* literals are never the result of an operation */
+    if ((val->type != LYXP_SET_BOOLEAN) && (val->type != LYXP_SET_NUMBER)) {
+        return EXIT_SUCCESS;
+    }
+    if (!val->ops) {
+        return EXIT_SUCCESS;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
-    lyxp_set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
-
-    if (strstr(args[0].value.str, args[1].value.str)) {
-        set_fill_boolean(set, 1, ctx);
-    } else {
-        set_fill_boolean(set, 0, ctx);
+    if (fold->used == fold->size) {
+        fold->size = fold->size ? fold->size * 2 : LYXP_EXPR_SIZE_START;
+        fold->recs = ly_realloc(fold->recs, fold->size * sizeof *fold->recs);
+        if (!fold->recs) {
+            LOGMEM;
+            return -1;
+        }
     }
 
+    fold->recs[fold->used].start = start;
+    fold->recs[fold->used].end = end;
+    fold->recs[fold->used].val = *val;
+    ++fold->used;
+
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath count(node-set) function. Returns LYXP_SET_NUMBER
- *        with the size of the node-set from the argument.
+ * @brief Apply a binary operator on the value of a subexpression and an operand if both are constants,
+ *        otherwise remember the constant ones to be folded separately.
  *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] fold Constant subexpressions found so far.
+ * @param[in,out] val Value of the subexpression so far, EMPTY once it is not a constant.
+ * @param[in] start Index of the first token of the subexpression.
+ * @param[in] op Index of the operator.
+ * @param[in] operand Value of the operand.
+ * @param[in] end Index of the token following the operand.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_count(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-            int UNUSED(when_must_eval), uint32_t line)
+fold_operand(struct lyxp_expr *exp, struct lyxp_fold *fold, struct lyxp_fold_val *val, uint32_t start, uint32_t op,
+             struct lyxp_fold_val *operand, uint32_t end)
 {
-    struct ly_ctx *ctx;
-
-    if (arg_count != 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "count(node-set)");
-        return -1;
-    }
+    int ret;
 
-    ctx = cur_node->schema->module->ctx;
-
-    if (args->type == LYXP_SET_EMPTY) {
-        set_fill_number(set, 0, ctx);
-        return EXIT_SUCCESS;
+    if (val->type && operand->type) {
+        ret = fold_val_op(exp, val, op, operand);
+        if (ret < 1) {
+            return ret;
+        }
     }
 
-    if (args->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INARGTYPE, line, 0, NULL, 1, print_set_type(args), "count(node-set)");
+    if (fold_add(fold, val, start, op) || fold_add(fold, operand, op + 1, end)) {
         return -1;
     }
+    val->type = LYXP_SET_EMPTY;
 
-    set_fill_number(set, args->used, ctx);
     return EXIT_SUCCESS;
 }
 
+static int fold_expr(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t level, struct lyxp_fold *fold,
+                     struct lyxp_fold_val *val);
+
 /**
- * @brief Execute the XPath current() function. Returns LYXP_SET_NODE_SET
- *        with the context with the intial node.
+ * @brief Find constant subexpressions in PathExpr. It is a constant only if it is a Literal, a Number,
+ *        true(), false(), or '(' Expr ')' with a constant Expr.
  *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
+ * @param[in] exp Parsed and reparsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in] fold Constant subexpressions found so far.
+ * @param[out] val Value of the PathExpr.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_current(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-              int when_must_eval, uint32_t line)
+fold_path_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_fold *fold, struct lyxp_fold_val *val)
 {
-    if (arg_count || args) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "current()");
-        return -1;
+    struct lyxp_fold_val arg;
+    uint32_t start, par_start = 0;
+    char *ptr;
+
+    memset(val, 0, sizeof *val);
+
+    switch (exp->tokens[*exp_idx]) {
+    case LYXP_TOKEN_PAR1:
+        /* '(' Expr ')' */
+        ++(*exp_idx);
+        par_start = *exp_idx;
+        if (fold_expr(exp, exp_idx, 0, fold, val)) {
+            return -1;
+        }
+        ++(*exp_idx);
+        break;
+    case LYXP_TOKEN_LITERAL:
+        val->type = LYXP_SET_STRING;
+        val->str = &exp->expr[exp->expr_pos[*exp_idx] + 1];
+        val->str_len = exp->tok_len[*exp_idx] - 2;
+        ++(*exp_idx);
+        break;
+    case LYXP_TOKEN_NUMBER:
+        errno = 0;
+        val->num = strtold(&exp->expr[exp->expr_pos[*exp_idx]], &ptr);
+        if (!errno && (ptr - &exp->expr[exp->expr_pos[*exp_idx]] == exp->tok_len[*exp_idx])) {
+            val->type = LYXP_SET_NUMBER;
+        }
+        ++(*exp_idx);
+        break;
+    case LYXP_TOKEN_FUNCNAME:
+        if ((exp->tokens[*exp_idx + 2] == LYXP_TOKEN_PAR2)
+                && (((exp->tok_len[*exp_idx] == 4) && !strncmp(&exp->expr[exp->expr_pos[*exp_idx]], "true", 4))
+                || ((exp->tok_len[*exp_idx] == 5) && !strncmp(&exp->expr[exp->expr_pos[*exp_idx]], "false", 5)))) {
+            val->type = LYXP_SET_BOOLEAN;
+            val->bool = (exp->tok_len[*exp_idx] == 4);
+            *exp_idx += 3;
+            break;
+        }
+
+        /* FunctionName '(' (Expr (',' Expr)*)? ')' */
+        *exp_idx += 2;
+        while (exp->tokens[*exp_idx] != LYXP_TOKEN_PAR2) {
+            start = *exp_idx;
+            if (fold_expr(exp, exp_idx, 0, fold, &arg) || fold_add(fold, &arg, start, *exp_idx)) {
+                return -1;
+            }
+            if (exp->tokens[*exp_idx] == LYXP_TOKEN_COMMA) {
+                ++(*exp_idx);
+            }
+        }
+        ++(*exp_idx);
+        break;
+    default:
+        /* LocationPath */
+        break;
+    }
+
+    if (val->type && (exp->used > *exp_idx)
+            && ((exp->tokens[*exp_idx] == LYXP_TOKEN_BRACK1) || (exp->tokens[*exp_idx] == LYXP_TOKEN_OPERATOR_PATH))) {
+        /* FilterExpr, only the inner Expr can be a constant */
+        if (par_start && fold_add(fold, val, par_start, *exp_idx - 1)) {
+            return -1;
+        }
+        val->type = LYXP_SET_EMPTY;
+    }
+
+    /* Predicate* and (the rest of) LocationPath */
+    while (exp->used > *exp_idx) {
+        switch (exp->tokens[*exp_idx]) {
+        case LYXP_TOKEN_BRACK1:
+            ++(*exp_idx);
+            start = *exp_idx;
+            if (fold_expr(exp, exp_idx, 0, fold, &arg) || fold_add(fold, &arg, start, *exp_idx)) {
+                return -1;
+            }
+            ++(*exp_idx);
+            break;
+        case LYXP_TOKEN_OPERATOR_PATH:
+        case LYXP_TOKEN_NAMETEST:
+        case LYXP_TOKEN_DOT:
+        case LYXP_TOKEN_DDOT:
+        case LYXP_TOKEN_AT:
+            ++(*exp_idx);
+            break;
+        case LYXP_TOKEN_NODETYPE:
+            /* NodeType '(' ')' */
+            *exp_idx += 3;
+            break;
+        default:
+            return EXIT_SUCCESS;
+        }
     }
 
-    lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    set_insert_node(set, cur_node, LYXP_NODE_ELEM, 0);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath false() function. Returns LYXP_SET_BOOLEAN
- *        with false value.
+ * @brief Find constant subexpressions in UnaryExpr. A union is never a constant.
  *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
+ * @param[in] exp Parsed and reparsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in] fold Constant subexpressions found so far.
+ * @param[out] val Value of the UnaryExpr.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_false(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-            int UNUSED(when_must_eval), uint32_t line)
+fold_unary_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_fold *fold, struct lyxp_fold_val *val)
 {
-    struct ly_ctx *ctx;
+    struct lyxp_fold_val path;
+    uint32_t minus = 0, start;
 
-    if (arg_count || args) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "false()");
+    /* ('-')* */
+    while ((exp->tokens[*exp_idx] == LYXP_TOKEN_OPERATOR_MATH) && (exp->expr[exp->expr_pos[*exp_idx]] == '-')) {
+        ++minus;
+        ++(*exp_idx);
+    }
+
+    /* PathExpr */
+    start = *exp_idx;
+    if (fold_path_expr(exp, exp_idx, fold, val)) {
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
+    /* ('|' PathExpr)*, constant operands with an operator are always in parentheses */
+    while ((exp->used > *exp_idx) && (exp->tokens[*exp_idx] == LYXP_TOKEN_OPERATOR_UNI)) {
+        if (fold_add(fold, val, start + 1, *exp_idx - 1)) {
+            return -1;
+        }
+        val->type = LYXP_SET_EMPTY;
+        ++(*exp_idx);
+
+        start = *exp_idx;
+        if (fold_path_expr(exp, exp_idx, fold, &path) || fold_add(fold, &path, start + 1, *exp_idx - 1)) {
+            return -1;
+        }
+    }
+
+    if (val->type && minus) {
+        /* double '-' makes '+' */
+        if ((minus % 2) && fold_val_cast(val, LYXP_SET_NUMBER)) {
+            return -1;
+        }
+        if (minus % 2) {
+            val->num *= -1;
+        }
+        ++val->ops;
+    }
 
-    set_fill_boolean(set, 0, ctx);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath floor(number) function. Returns LYXP_SET_NUMBER
- *        with the first argument floored (truncated).
+ * @brief Check whether there is an operator of a binary operator rule at the position.
  *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
+ * @param[in] exp Parsed and reparsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in] level Rule, 0 for Expr ('or') up to 5 for MultiplicativeExpr ('*', 'div', 'mod').
  *
- * @return EXIT_SUCCESS on success, -1 on error.
+ * @return 1 if there is, 0 otherwise.
  */
 static int
-xpath_floor(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-            int when_must_eval, uint32_t line)
+fold_is_operator(struct lyxp_expr *exp, uint32_t exp_idx, uint32_t level)
 {
-    struct ly_ctx *ctx;
+    char c;
 
-    if (arg_count != 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "floor(number)");
-        return -1;
+    if (exp->used == exp_idx) {
+        return 0;
     }
+    c = exp->expr[exp->expr_pos[exp_idx]];
 
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(args, LYXP_SET_NUMBER, cur_node, when_must_eval);
-    if (isfinite(args->value.num)) {
-        set_fill_number(set, (long long)args->value.num, ctx);
+    switch (level) {
+    case 0:
+        return (exp->tokens[exp_idx] == LYXP_TOKEN_OPERATOR_LOG) && (exp->tok_len[exp_idx] == 2);
+    case 1:
+        return (exp->tokens[exp_idx] == LYXP_TOKEN_OPERATOR_LOG) && (exp->tok_len[exp_idx] == 3);
+    case 2:
+        return (exp->tokens[exp_idx] == LYXP_TOKEN_OPERATOR_COMP) && ((c == '=') || (c == '!'));
+    case 3:
+        return (exp->tokens[exp_idx] == LYXP_TOKEN_OPERATOR_COMP) && ((c == '<') || (c == '>'));
+    case 4:
+        return (exp->tokens[exp_idx] == LYXP_TOKEN_OPERATOR_MATH) && ((c == '+') || (c == '-'));
+    case 5:
+        return (exp->tokens[exp_idx] == LYXP_TOKEN_OPERATOR_MATH) && ((c == '*') || (exp->tok_len[exp_idx] == 3));
     }
 
-    return EXIT_SUCCESS;
+    return 0;
 }
 
 /**
- * @brief Execute the XPath lang(string) function. Returns LYXP_SET_BOOLEAN
- *        whether the language of the text matches the one from the argument.
+ * @brief Find constant subexpressions in a binary operator rule, from Expr to MultiplicativeExpr.
+ *        The operators are left-associative so only a prefix of the operands can be folded together.
  *
- * @param[in] args Array of arguments.
- * @param[in] arg_count Count of elements in \p args.
- * @param[in] cur_node Original context node.
- * @param[in,out] set Context and result set at the same time.
- * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[in] line Line in the input file.
+ * @param[in] exp Parsed and reparsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in] level Rule, 0 for Expr up to 5 for MultiplicativeExpr, see fold_is_operator().
+ * @param[in] fold Constant subexpressions found so far.
+ * @param[out] val Value of the expression.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_lang(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-           int when_must_eval, uint32_t line)
+fold_expr(struct lyxp_expr *exp, uint32_t *exp_idx, uint32_t level, struct lyxp_fold *fold, struct lyxp_fold_val *val)
 {
-    struct lyd_node *node;
-    struct lyd_attr *attr = NULL;
-    int i;
-    struct ly_ctx *ctx;
+    struct lyxp_fold_val operand;
+    uint32_t start, op;
 
-    if (arg_count != 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "lang(string)");
+    start = *exp_idx;
+    if ((level < 5 ? fold_expr(exp, exp_idx, level + 1, fold, val) : fold_unary_expr(exp, exp_idx, fold, val))) {
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
+    while (fold_is_operator(exp, *exp_idx, level)) {
+        op = *exp_idx;
+        ++(*exp_idx);
+
+        if ((level < 5 ? fold_expr(exp, exp_idx, level + 1, fold, &operand)
+                : fold_unary_expr(exp, exp_idx, fold, &operand))) {
+            return -1;
+        }
+        if (fold_operand(exp, fold, val, start, op, &operand, *exp_idx)) {
+            return -1;
+        }
+    }
 
-    lyxp_set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
+    return EXIT_SUCCESS;
+}
 
-    if (set->type == LYXP_SET_EMPTY) {
-        set_fill_boolean(set, 0, ctx);
+/**
+ * @brief Print the value of a constant subexpression as an XPath expression.
+ *
+ * @param[in] val Value to print.
+ * @param[out] buf Buffer for the expression.
+ * @param[out] tok_count Number of tokens of the expression.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the value cannot be exactly expressed.
+ */
+static int
+fold_val_print(struct lyxp_fold_val *val, char buf[64], uint32_t *tok_count)
+{
+    if (val->type == LYXP_SET_BOOLEAN) {
+        strcpy(buf, val->bool ? "true()" : "false()");
+        *tok_count = 3;
         return EXIT_SUCCESS;
     }
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "lang(string)");
-        return -1;
-    }
 
-    /* assign the context node */
-    if (set->pos) {
-        node = set->value.nodes[set->pos - 1];
+    /* there are no NaN, infinity, or negative zero literals */
+    if (!isfinite(val->num) || ((val->num == 0) && signbit(val->num))) {
+        return EXIT_FAILURE;
+    }
+    if ((val->num == truncl(val->num)) && (fabsl(val->num) < 1e18)) {
+        sprintf(buf, "%lld", (long long)val->num);
     } else {
-        node = set->value.nodes[0];
+        sprintf(buf, "%.21Lg", val->num);
+        if (strchr(buf, 'e') || (strtold(buf, NULL) != val->num)) {
+            return EXIT_FAILURE;
+        }
     }
+    *tok_count = (val->num < 0) ? 2 : 1;
 
-    /* find lang sttribute */
-    for (; node; node = node->parent) {
-        for (attr = node->attr; attr; attr = attr->next) {
-            if (attr->name && !strcmp(attr->name, "lang") && !strcmp(attr->module->name, "xml")) {
-                break;
-            }
-        }
+    return EXIT_SUCCESS;
+}
 
-        if (attr) {
-            break;
-        }
+/**
+ * @brief Compare the constant subexpressions by their position in the expression.
+ */
+static int
+fold_rec_compare(const void *ptr1, const void *ptr2)
+{
+    const struct lyxp_fold_rec *rec1 = ptr1, *rec2 = ptr2;
+
+    if (rec1->start < rec2->start) {
+        return -1;
     }
+    return (rec1->start > rec2->start) ? 1 : 0;
+}
 
-    /* compare languages */
-    if (!attr) {
-        set_fill_boolean(set, 0, ctx);
-    } else {
-        for (i = 0; args->value.str[i]; ++i) {
-            if (tolower(args->value.str[i]) != tolower(attr->value[i])) {
-                set_fill_boolean(set, 0, ctx);
-                break;
-            }
+/**
+ * @brief Fold constant subexpressions of an expression, which means they are rewritten into their values
+ *        and the expression is parsed again.
+ *
+ * @param[in] exp Parsed and reparsed XPath expression, freed if folded.
+ *
+ * @return Expression to use, NULL on error (\p exp freed).
+ */
+static struct lyxp_expr *
+exp_fold(struct lyxp_expr *exp)
+{
+    struct lyxp_fold fold;
+    struct lyxp_fold_val val;
+    struct lyxp_expr *folded = NULL;
+    uint32_t i, exp_idx = 0, tok_count, start, end, prev = 0, used = 0;
+    char buf[64], *expr = NULL;
+
+    memset(&fold, 0, sizeof fold);
+    if (fold_expr(exp, &exp_idx, 0, &fold, &val) || fold_add(&fold, &val, 0, exp->used)) {
+        goto error;
+    }
+    if (!fold.used) {
+        return exp;
+    }
+    qsort(fold.recs, fold.used, sizeof *fold.recs, fold_rec_compare);
+
+    /* at most 64 bytes instead of every subexpression, which has at least 2 tokens */
+    expr = malloc(strlen(exp->expr) + fold.used * 64 + 1);
+    if (!expr) {
+        LOGMEM;
+        goto error;
+    }
+
+    for (i = 0; i < fold.used; ++i) {
+        if (fold_val_print(&fold.recs[i].val, buf, &tok_count)
+                || (tok_count >= fold.recs[i].end - fold.recs[i].start)) {
+            continue;
         }
-        if (!args->value.str[i]) {
-            if (!attr->value[i] || (attr->value[i] == '-')) {
-                set_fill_boolean(set, 1, ctx);
-            } else {
-                set_fill_boolean(set, 0, ctx);
-            }
+
+        start = exp->expr_pos[fold.recs[i].start];
+        end = exp->expr_pos[fold.recs[i].end - 1] + exp->tok_len[fold.recs[i].end - 1];
+        if (start < prev) {
+            LOGINT;
+            goto error;
         }
+
+        memcpy(expr + used, exp->expr + prev, start - prev);
+        used += start - prev;
+        used += sprintf(expr + used, " %s ", buf);
+        prev = end;
+    }
+    if (!prev) {
+        /* nothing worth folding */
+        free(expr);
+        free(fold.recs);
+        return exp;
     }
+    strcpy(expr + used, exp->expr + prev);
 
-    return EXIT_SUCCESS;
+    folded = parse_expr(expr, UINT_MAX);
+    if (!folded) {
+        LOGINT;
+        goto error;
+    }
+    exp_idx = 0;
+    if (reparse_expr(folded, &exp_idx, UINT_MAX) || (folded->used > exp_idx)) {
+        LOGINT;
+        goto error;
+    }
+
+    free(fold.recs);
+    lyxp_expr_free(exp);
+    return folded;
+
+error:
+    free(fold.recs);
+    if (folded) {
+        lyxp_expr_free(folded);
+    } else {
+        free(expr);
+    }
+    lyxp_expr_free(exp);
+    return NULL;
 }
 
+/*
+ * XPath functions
+ */
+
 /**
- * @brief Execute the XPath last() function. Returns LYXP_SET_NUMBER
- *        with the context size.
+ * @brief Execute the XPath boolean(object) function. Returns LYXP_SET_BOOLEAN
+ *        with the argument converted to boolean.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2491,34 +3453,23 @@ xpath_lang(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node,
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_last(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-           int UNUSED(when_must_eval), uint32_t line)
+xpath_boolean(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+              int when_must_eval, uint32_t line)
 {
-    struct ly_ctx *ctx;
-
-    if (arg_count || args) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "last()");
+    if (arg_count != 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "boolean(object)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    if (set->type == LYXP_SET_EMPTY) {
-        set_fill_number(set, 0, ctx);
-        return EXIT_SUCCESS;
-    }
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "last()");
-        return -1;
-    }
+    set_cast(args, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+    set_fill_set(set, args);
 
-    set_fill_number(set, set->used, ctx);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath local-name(node-set?) function. Returns LYXP_SET_STRING
- *        with the node name without namespace from the argument or the context.
+ * @brief Execute the XPath ceiling(number) function. Returns LYXP_SET_NUMBER
+ *        with the first argument rounded up to the nearest integer.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2530,74 +3481,29 @@ xpath_last(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node,
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_local_name(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                 int UNUSED(when_must_eval), uint32_t line)
+xpath_ceiling(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+              int when_must_eval, uint32_t line)
 {
-    struct lyd_node *node;
-    enum lyxp_node_type type;
-    struct ly_ctx *ctx;
-
-    if (arg_count > 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "local-name(node-set?)");
+    if (arg_count != 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "ceiling(number)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    if (arg_count) {
-        if (args->type == LYXP_SET_EMPTY) {
-            set_fill_string(set, "", 0, ctx);
-            return EXIT_SUCCESS;
-        }
-        if (args->type != LYXP_SET_NODE_SET) {
-            LOGVAL(LYE_XPATH_INARGTYPE, line, 0, NULL, 1, print_set_type(args), "local-name(node-set?)");
-            return -1;
-        }
-
-        node = args->value.nodes[0];
-        type = args->node_type[0];
+    set_cast(args, LYXP_SET_NUMBER, cur_node, when_must_eval);
+    if (args->is_int) {
+        set_fill_int(set, args->inum);
+    } else if ((long long)args->value.num != args->value.num) {
+        set_fill_number(set, ((long long)args->value.num) + 1);
     } else {
-        if (set->type == LYXP_SET_EMPTY) {
-            set_fill_string(set, "", 0, ctx);
-            return EXIT_SUCCESS;
-        }
-        if (set->type != LYXP_SET_NODE_SET) {
-            LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "local-name(node-set?)");
-            return -1;
-        }
-
-        if (set->pos) {
-            node = set->value.nodes[set->pos - 1];
-            type = set->node_type[set->pos - 1];
-        } else {
-            node = set->value.nodes[0];
-            type = set->node_type[0];
-        }
-    }
-
-    switch (type) {
-    case LYXP_NODE_ROOT_CONFIG:
-    case LYXP_NODE_ROOT_STATE:
-    case LYXP_NODE_ROOT_NOTIF:
-    case LYXP_NODE_ROOT_RPC:
-    case LYXP_NODE_ROOT_OUTPUT:
-    case LYXP_NODE_TEXT:
-        set_fill_string(set, "", 0, ctx);
-        break;
-    case LYXP_NODE_ELEM:
-        set_fill_string(set, node->schema->name, strlen(node->schema->name), ctx);
-        break;
-    case LYXP_NODE_ATTR:
-        set_fill_string(set, ((struct lyd_attr *)node)->name, strlen(((struct lyd_attr *)node)->name), ctx);
-        break;
+        set_fill_number(set, args->value.num);
     }
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath namespace-uri(node-set?) function. Returns LYXP_SET_STRING
- *        with the namespace of the node from the argument or the context.
+ * @brief Execute the XPath concat(string, string, string*) function.
+ *        Returns LYXP_SET_STRING with the concatenation of all the arguments.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2609,82 +3515,45 @@ xpath_local_name(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_namespace_uri(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                    int UNUSED(when_must_eval), uint32_t line)
+xpath_concat(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+             int when_must_eval, uint32_t line)
 {
-    struct lyd_node *node;
-    struct lys_module *module;
-    enum lyxp_node_type type;
-    struct ly_ctx *ctx;
+    uint32_t i;
+    char *str;
+    size_t used = 1;
 
-    if (arg_count > 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "namespace-uri(node-set?)");
+    if (arg_count < 2) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "concat(string, string, string*)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    if (arg_count) {
-        if (args->type == LYXP_SET_EMPTY) {
-            set_fill_string(set, "", 0, ctx);
-            return EXIT_SUCCESS;
-        }
-        if (args->type != LYXP_SET_NODE_SET) {
-            LOGVAL(LYE_XPATH_INARGTYPE, line, 0, NULL, 1, print_set_type(args), "namespace-uri(node-set?)");
-            return -1;
-        }
-
-        node = args->value.nodes[0];
-        type = args->node_type[0];
-    } else {
-        if (set->type == LYXP_SET_EMPTY) {
-            set_fill_string(set, "", 0, ctx);
-            return EXIT_SUCCESS;
-        }
-        if (set->type != LYXP_SET_NODE_SET) {
-            LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "namespace-uri(node-set?)");
-            return -1;
-        }
-
-        if (set->pos) {
-            node = set->value.nodes[set->pos - 1];
-            type = set->node_type[set->pos - 1];
-        } else {
-            node = set->value.nodes[0];
-            type = set->node_type[0];
-        }
+    for (i = 0; i < arg_count; ++i) {
+        set_cast(&args[i], LYXP_SET_STRING, cur_node, when_must_eval);
+        used += strlen(args[i].value.str);
     }
 
-    switch (type) {
-    case LYXP_NODE_ROOT_CONFIG:
-    case LYXP_NODE_ROOT_STATE:
-    case LYXP_NODE_ROOT_NOTIF:
-    case LYXP_NODE_ROOT_RPC:
-    case LYXP_NODE_ROOT_OUTPUT:
-    case LYXP_NODE_TEXT:
-        set_fill_string(set, "", 0, ctx);
-        break;
-    case LYXP_NODE_ELEM:
-    case LYXP_NODE_ATTR:
-        if (type == LYXP_NODE_ELEM) {
-            module =  node->schema->module;
-        } else { /* LYXP_NODE_ATTR */
-            module = ((struct lyd_attr *)node)->module;
-        }
-
-        module = lys_module(module);
-
-        set_fill_string(set, module->ns, strlen(module->ns), ctx);
-        break;
+    str = scratch_alloc(used);
+    if (!str) {
+        return -1;
     }
+    used = 0;
+    for (i = 0; i < arg_count; ++i) {
+        strcpy(str + used, args[i].value.str);
+        used += strlen(args[i].value.str);
+    }
+
+    /* free, kind of */
+    set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set->type = LYXP_SET_STRING;
+    set->value.str = str;
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath node() function (node type). Returns LYXP_SET_NODE_SET
- *        with only nodes from the context. In practice it either leaves the context
- *        as it is or returns an empty node set.
+ * @brief Execute the XPath contains(string, string) function.
+ *        Returns LYXP_SET_BOOLEAN whether the second argument can
+ *        be found in the first or not.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2696,24 +3565,29 @@ xpath_namespace_uri(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_node(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-           int when_must_eval, uint32_t line)
+xpath_contains(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+               int when_must_eval, uint32_t line)
 {
-    if (arg_count || args) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "node()");
+    if (arg_count != 2) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "contains(string, string)");
         return -1;
     }
 
-    if (set->type != LYXP_SET_NODE_SET) {
-        lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
+    set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
+
+    if (strstr(args[0].value.str, args[1].value.str)) {
+        set_fill_boolean(set, 1);
+    } else {
+        set_fill_boolean(set, 0);
     }
+
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath normalize-space(string?) function. Returns LYXP_SET_STRING
- *        with normalized value (no leading, trailing, double white spaces) of the node
- *        from the argument or the context.
+ * @brief Execute the XPath count(node-set) function. Returns LYXP_SET_NUMBER
+ *        with the size of the node-set from the argument.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2725,88 +3599,31 @@ xpath_node(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node,
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_normalize_space(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                      int when_must_eval, uint32_t line)
+xpath_count(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
+            int UNUSED(when_must_eval), uint32_t line)
 {
-    uint16_t i, new_used;
-    char *new;
-    int have_spaces = 0, space_before = 0;
-    struct ly_ctx *ctx;
-
-    if (arg_count > 2) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "normalize-space(string?)");
+    if (arg_count != 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "count(node-set)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    if (arg_count) {
-        set_fill_set(set, args, ctx);
+    if (args->type == LYXP_SET_EMPTY) {
+        set_fill_int(set, 0);
+        return EXIT_SUCCESS;
     }
-    lyxp_set_cast(set, LYXP_SET_STRING, cur_node, when_must_eval);
 
-    /* is there any normalization necessary? */
-    for (i = 0; set->value.str[i]; ++i) {
-        if (is_xmlws(set->value.str[i])) {
-            if ((i == 0) || space_before || (!set->value.str[i + 1])) {
-                have_spaces = 1;
-                break;
-            }
-            space_before = 1;
-        } else {
-            space_before = 0;
-        }
-    }
-
-    /* yep, there is */
-    if (have_spaces) {
-        /* it's enough, at least one character will go, makes space for ending '\0' */
-        new = malloc(strlen(set->value.str) * sizeof(char));
-        if (!new) {
-            LOGMEM;
-            return -1;
-        }
-        new_used = 0;
-
-        space_before = 0;
-        for (i = 0; set->value.str[i]; ++i) {
-            if (is_xmlws(set->value.str[i])) {
-                if ((i == 0) || space_before) {
-                    space_before = 1;
-                    continue;
-                } else {
-                    space_before = 1;
-                }
-            } else {
-                space_before = 0;
-            }
-
-            new[new_used] = set->value.str[i];
-            ++new_used;
-        }
-
-        /* at worst there is one trailing space now */
-        if (new_used && is_xmlws(new[new_used - 1])) {
-            --new_used;
-        }
-
-        new = ly_realloc(new, (new_used + 1) * sizeof(char));
-        if (!new) {
-            LOGMEM;
-            return -1;
-        }
-        new[new_used] = '\0';
-
-        lydict_remove(ctx, set->value.str);
-        set->value.str = lydict_insert_zc(ctx, new);
+    if (args->type != LYXP_SET_NODE_SET) {
+        LOGVAL(LYE_XPATH_INARGTYPE, line, 0, NULL, 1, print_set_type(args), "count(node-set)");
+        return -1;
     }
 
+    set_fill_int(set, args->used);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath not(boolean) function. Returns LYXP_SET_BOOLEAN
- *        with the argument converted to boolean and logically inverted.
+ * @brief Execute the XPath current() function. Returns LYXP_SET_NODE_SET
+ *        with the context with the intial node.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2818,31 +3635,22 @@ xpath_normalize_space(struct lyxp_set *args, uint16_t arg_count, struct lyd_node
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_not(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-          int when_must_eval, uint32_t line)
+xpath_current(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+              int when_must_eval, uint32_t line)
 {
-    struct ly_ctx *ctx;
-
-    if (arg_count != 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "not(boolean)");
+    if (arg_count || args) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "current()");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(args, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
-    if (args->value.bool) {
-        set_fill_boolean(set, 0, ctx);
-    } else {
-        set_fill_boolean(set, 1, ctx);
-    }
-
+    set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_insert_node(set, cur_node, LYXP_NODE_ELEM, 0);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath bumber(object?) function. Returns LYXP_SET_NUMBER
- *        with the number representation of either the argument or the context.
+ * @brief Execute the XPath false() function. Returns LYXP_SET_BOOLEAN
+ *        with false value.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2854,31 +3662,21 @@ xpath_not(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node,
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_number(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-             int when_must_eval, uint32_t line)
+xpath_false(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
+            int UNUSED(when_must_eval), uint32_t line)
 {
-    struct ly_ctx *ctx;
-
-    if (arg_count > 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "number(object?)");
+    if (arg_count || args) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "false()");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    if (arg_count) {
-        lyxp_set_cast(args, LYXP_SET_NUMBER, cur_node, when_must_eval);
-        set_fill_set(set, args, ctx);
-    } else {
-        lyxp_set_cast(set, LYXP_SET_NUMBER, cur_node, when_must_eval);
-    }
-
+    set_fill_boolean(set, 0);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath position() function. Returns LYXP_SET_NUMBER
- *        with the context position.
+ * @brief Execute the XPath floor(number) function. Returns LYXP_SET_NUMBER
+ *        with the first argument floored (truncated).
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2890,35 +3688,27 @@ xpath_number(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_nod
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_position(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-               int UNUSED(when_must_eval), uint32_t line)
+xpath_floor(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+            int when_must_eval, uint32_t line)
 {
-    struct ly_ctx *ctx;
-
-    if (arg_count || args) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "position()");
+    if (arg_count != 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "floor(number)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    if (set->type == LYXP_SET_EMPTY) {
-        set_fill_number(set, 0, ctx);
-        return EXIT_SUCCESS;
-    }
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "position()");
-        return -1;
+    set_cast(args, LYXP_SET_NUMBER, cur_node, when_must_eval);
+    if (args->is_int) {
+        set_fill_int(set, args->inum);
+    } else if (isfinite(args->value.num)) {
+        set_fill_number(set, (long long)args->value.num);
     }
 
-    set_fill_number(set, set->pos, ctx);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath round(number) function. Returns LYXP_SET_NUMBER
- *        with the rounded first argument. For details refer to
- *        http://www.w3.org/TR/1999/REC-xpath-19991116/#function-round.
+ * @brief Execute the XPath lang(string) function. Returns LYXP_SET_BOOLEAN
+ *        whether the language of the text matches the one from the argument.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2930,38 +3720,74 @@ xpath_position(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_n
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_round(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-            int when_must_eval, uint32_t line)
+xpath_lang(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+           int when_must_eval, uint32_t line)
 {
-    struct ly_ctx *ctx;
+    struct lyd_node *node;
+    struct lyd_attr *attr = NULL;
+    int i;
 
     if (arg_count != 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "round(number)");
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "lang(string)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
+    set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
+
+    if (set->type == LYXP_SET_EMPTY) {
+        set_fill_boolean(set, 0);
+        return EXIT_SUCCESS;
+    }
+    if (set->type != LYXP_SET_NODE_SET) {
+        LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "lang(string)");
+        return -1;
+    }
 
-    lyxp_set_cast(args, LYXP_SET_NUMBER, cur_node, when_must_eval);
+    /* assign the context node */
+    if (set->pos) {
+        node = set->value.nodes[set->pos - 1];
+    } else {
+        node = set->value.nodes[0];
+    }
 
-    /* cover only the cases where floor can't be used */
-    if ((args->value.num == -0) || ((args->value.num < 0) && (args->value.num >= -0.5))) {
-        set_fill_number(set, -0, ctx);
+    /* find lang sttribute */
+    for (; node; node = node->parent) {
+        for (attr = node->attr; attr; attr = attr->next) {
+            if (attr->name && !strcmp(attr->name, "lang") && !strcmp(attr->module->name, "xml")) {
+                break;
+            }
+        }
+
+        if (attr) {
+            break;
+        }
+    }
+
+    /* compare languages */
+    if (!attr) {
+        set_fill_boolean(set, 0);
     } else {
-        args->value.num += 0.5;
-        if (xpath_floor(args, 1, cur_node, args, when_must_eval, line)) {
-            return -1;
+        for (i = 0; args->value.str[i]; ++i) {
+            if (tolower(args->value.str[i]) != tolower(attr->value[i])) {
+                set_fill_boolean(set, 0);
+                break;
+            }
+        }
+        if (!args->value.str[i]) {
+            if (!attr->value[i] || (attr->value[i] == '-')) {
+                set_fill_boolean(set, 1);
+            } else {
+                set_fill_boolean(set, 0);
+            }
         }
-        set_fill_number(set, args->value.num, ctx);
     }
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath starts-with(string, string) function.
- *        Returns LYXP_SET_BOOLEAN whether the second argument is
- *        the prefix of the first or not.
+ * @brief Execute the XPath last() function. Returns LYXP_SET_NUMBER
+ *        with the context size.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -2973,33 +3799,30 @@ xpath_round(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_starts_with(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                  int when_must_eval, uint32_t line)
+xpath_last(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
+           int UNUSED(when_must_eval), uint32_t line)
 {
-    struct ly_ctx *ctx;
-
-    if (arg_count != 2) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "starts-with(string, string)");
+    if (arg_count || args) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "last()");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
-    lyxp_set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
-
-    if (strncmp(args[0].value.str, args[1].value.str, strlen(args[1].value.str))) {
-        set_fill_boolean(set, 0, ctx);
-    } else {
-        set_fill_boolean(set, 1, ctx);
+    if (set->type == LYXP_SET_EMPTY) {
+        set_fill_int(set, 0);
+        return EXIT_SUCCESS;
+    }
+    if (set->type != LYXP_SET_NODE_SET) {
+        LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "last()");
+        return -1;
     }
 
+    set_fill_int(set, set->used);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath string(object?) function. Returns LYXP_SET_STRING
- *        with the string representation of either the argument or the context.
+ * @brief Execute the XPath local-name(node-set?) function. Returns LYXP_SET_STRING
+ *        with the node name without namespace from the argument or the context.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3011,31 +3834,71 @@ xpath_starts_with(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cu
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_string(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-             int when_must_eval, uint32_t line)
+xpath_local_name(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
+                 int UNUSED(when_must_eval), uint32_t line)
 {
-    struct ly_ctx *ctx;
+    struct lyd_node *node;
+    enum lyxp_node_type type;
 
     if (arg_count > 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "string(object?)");
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "local-name(node-set?)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
     if (arg_count) {
-        lyxp_set_cast(args, LYXP_SET_STRING, cur_node, when_must_eval);
-        set_fill_set(set, args, ctx);
+        if (args->type == LYXP_SET_EMPTY) {
+            set_fill_string(set, "", 0);
+            return EXIT_SUCCESS;
+        }
+        if (args->type != LYXP_SET_NODE_SET) {
+            LOGVAL(LYE_XPATH_INARGTYPE, line, 0, NULL, 1, print_set_type(args), "local-name(node-set?)");
+            return -1;
+        }
+
+        node = args->value.nodes[0];
+        type = args->node_type[0];
     } else {
-        lyxp_set_cast(set, LYXP_SET_STRING, cur_node, when_must_eval);
+        if (set->type == LYXP_SET_EMPTY) {
+            set_fill_string(set, "", 0);
+            return EXIT_SUCCESS;
+        }
+        if (set->type != LYXP_SET_NODE_SET) {
+            LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "local-name(node-set?)");
+            return -1;
+        }
+
+        if (set->pos) {
+            node = set->value.nodes[set->pos - 1];
+            type = set->node_type[set->pos - 1];
+        } else {
+            node = set->value.nodes[0];
+            type = set->node_type[0];
+        }
+    }
+
+    switch (type) {
+    case LYXP_NODE_ROOT_CONFIG:
+    case LYXP_NODE_ROOT_STATE:
+    case LYXP_NODE_ROOT_NOTIF:
+    case LYXP_NODE_ROOT_RPC:
+    case LYXP_NODE_ROOT_OUTPUT:
+    case LYXP_NODE_TEXT:
+        set_fill_string(set, "", 0);
+        break;
+    case LYXP_NODE_ELEM:
+        set_fill_string(set, node->schema->name, strlen(node->schema->name));
+        break;
+    case LYXP_NODE_ATTR:
+        set_fill_string(set, ((struct lyd_attr *)node)->name, strlen(((struct lyd_attr *)node)->name));
+        break;
     }
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath string-length(string?) function. Returns LYXP_SET_NUMBER
- *        with the length of the string in either the argument or the context.
+ * @brief Execute the XPath namespace-uri(node-set?) function. Returns LYXP_SET_STRING
+ *        with the namespace of the node from the argument or the context.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3047,35 +3910,79 @@ xpath_string(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_nod
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_string_length(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                    int when_must_eval, uint32_t line)
+xpath_namespace_uri(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
+                    int UNUSED(when_must_eval), uint32_t line)
 {
-    struct ly_ctx *ctx;
+    struct lyd_node *node;
+    struct lys_module *module;
+    enum lyxp_node_type type;
 
-    if (arg_count > 2) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "string-length(string?)");
+    if (arg_count > 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "namespace-uri(node-set?)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
     if (arg_count) {
-        lyxp_set_cast(args, LYXP_SET_STRING, cur_node, when_must_eval);
-        set_fill_number(set, strlen(args->value.str), ctx);
+        if (args->type == LYXP_SET_EMPTY) {
+            set_fill_string(set, "", 0);
+            return EXIT_SUCCESS;
+        }
+        if (args->type != LYXP_SET_NODE_SET) {
+            LOGVAL(LYE_XPATH_INARGTYPE, line, 0, NULL, 1, print_set_type(args), "namespace-uri(node-set?)");
+            return -1;
+        }
+
+        node = args->value.nodes[0];
+        type = args->node_type[0];
     } else {
-        lyxp_set_cast(set, LYXP_SET_STRING, cur_node, when_must_eval);
-        set_fill_number(set, strlen(set->value.str), ctx);
+        if (set->type == LYXP_SET_EMPTY) {
+            set_fill_string(set, "", 0);
+            return EXIT_SUCCESS;
+        }
+        if (set->type != LYXP_SET_NODE_SET) {
+            LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "namespace-uri(node-set?)");
+            return -1;
+        }
+
+        if (set->pos) {
+            node = set->value.nodes[set->pos - 1];
+            type = set->node_type[set->pos - 1];
+        } else {
+            node = set->value.nodes[0];
+            type = set->node_type[0];
+        }
+    }
+
+    switch (type) {
+    case LYXP_NODE_ROOT_CONFIG:
+    case LYXP_NODE_ROOT_STATE:
+    case LYXP_NODE_ROOT_NOTIF:
+    case LYXP_NODE_ROOT_RPC:
+    case LYXP_NODE_ROOT_OUTPUT:
+    case LYXP_NODE_TEXT:
+        set_fill_string(set, "", 0);
+        break;
+    case LYXP_NODE_ELEM:
+    case LYXP_NODE_ATTR:
+        if (type == LYXP_NODE_ELEM) {
+            module =  node->schema->module;
+        } else { /* LYXP_NODE_ATTR */
+            module = ((struct lyd_attr *)node)->module;
+        }
+
+        module = lys_module(module);
+
+        set_fill_string(set, module->ns, strlen(module->ns));
+        break;
     }
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath substring(string, number, number?) function.
- *        Returns LYXP_SET_STRING substring of the first argument starting
- *        on the second argument index ending on the third argument index,
- *        indexed from 1. For exact definition refer to
- *        http://www.w3.org/TR/1999/REC-xpath-19991116/#function-substring.
+ * @brief Execute the XPath node() function (node type). Returns LYXP_SET_NODE_SET
+ *        with only nodes from the context. In practice it either leaves the context
+ *        as it is or returns an empty node set.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3087,71 +3994,107 @@ xpath_string_length(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_substring(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                int when_must_eval, uint32_t line)
+xpath_node(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+           int when_must_eval, uint32_t line)
 {
-    int start, len;
-    uint16_t str_start, str_len, pos;
-    struct ly_ctx *ctx;
-
-    if ((arg_count < 2) || (arg_count > 3)) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "substring(string, number, number?)");
+    if (arg_count || args) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "node()");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
+    if (set->type != LYXP_SET_NODE_SET) {
+        set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    }
+    return EXIT_SUCCESS;
+}
 
-    lyxp_set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
+/**
+ * @brief Execute the XPath normalize-space(string?) function. Returns LYXP_SET_STRING
+ *        with normalized value (no leading, trailing, double white spaces) of the node
+ *        from the argument or the context.
+ *
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
+ * @param[in] cur_node Original context node.
+ * @param[in,out] set Context and result set at the same time.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+static int
+xpath_normalize_space(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+                      int when_must_eval, uint32_t line)
+{
+    uint32_t i, new_used;
+    char *new;
+    int have_spaces = 0, space_before = 0;
 
-    /* start */
-    if (xpath_round(&args[1], 1, cur_node, &args[1], when_must_eval, line)) {
+    if (arg_count > 2) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "normalize-space(string?)");
         return -1;
     }
-    if (isfinite(args[1].value.num)) {
-        start = args[1].value.num - 1;
-    } else if (isinf(args[1].value.num) && signbit(args[1].value.num)) {
-        start = INT_MIN;
-    } else {
-        start = INT_MAX;
+
+    if (arg_count) {
+        set_fill_set(set, args);
     }
+    set_cast(set, LYXP_SET_STRING, cur_node, when_must_eval);
 
-    /* len */
-    if (arg_count == 3) {
-        if (xpath_round(&args[2], 1, cur_node, &args[2], when_must_eval, line)) {
-            return -1;
-        }
-        if (isfinite(args[2].value.num)) {
-            len = args[2].value.num;
-        } else if (isnan(args[2].value.num) || signbit(args[2].value.num)) {
-            len = 0;
+    /* is there any normalization necessary? */
+    for (i = 0; set->value.str[i]; ++i) {
+        if (is_xmlws(set->value.str[i])) {
+            if ((i == 0) || space_before || (!set->value.str[i + 1])) {
+                have_spaces = 1;
+                break;
+            }
+            space_before = 1;
         } else {
-            len = INT_MAX;
+            space_before = 0;
         }
-    } else {
-        len = INT_MAX;
     }
 
-    /* find matching character positions */
-    str_start = 0;
-    str_len = 0;
-    for (pos = 0; args[0].value.str[pos]; ++pos) {
-        if (pos < start) {
-            ++str_start;
-        } else if (pos < start + len) {
-            ++str_len;
-        } else {
-            break;
+    /* yep, there is */
+    if (have_spaces) {
+        /* it's enough, at least one character will go, makes space for ending '\0' */
+        new = scratch_alloc(strlen(set->value.str) * sizeof(char));
+        if (!new) {
+            return -1;
+        }
+        new_used = 0;
+
+        space_before = 0;
+        for (i = 0; set->value.str[i]; ++i) {
+            if (is_xmlws(set->value.str[i])) {
+                if ((i == 0) || space_before) {
+                    space_before = 1;
+                    continue;
+                } else {
+                    space_before = 1;
+                }
+            } else {
+                space_before = 0;
+            }
+
+            new[new_used] = set->value.str[i];
+            ++new_used;
         }
+
+        /* at worst there is one trailing space now */
+        if (new_used && is_xmlws(new[new_used - 1])) {
+            --new_used;
+        }
+
+        new[new_used] = '\0';
+
+        set->value.str = new;
     }
 
-    set_fill_string(set, args[0].value.str + str_start, str_len, ctx);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath substring-after(string, string) function.
- *        Returns LYXP_SET_STRING with the string succeeding the occurance
- *        of the second argument in the first or an empty string.
+ * @brief Execute the XPath not(boolean) function. Returns LYXP_SET_BOOLEAN
+ *        with the argument converted to boolean and logically inverted.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3163,36 +4106,27 @@ xpath_substring(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_substring_after(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                      int when_must_eval, uint32_t line)
+xpath_not(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+          int when_must_eval, uint32_t line)
 {
-    char *ptr;
-    struct ly_ctx *ctx;
-
-    if (arg_count != 2) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "substring-after(string, string)");
+    if (arg_count != 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "not(boolean)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
-    lyxp_set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
-
-    ptr = strstr(args[0].value.str, args[1].value.str);
-    if (ptr) {
-        set_fill_string(set, ptr + strlen(args[1].value.str), strlen(ptr + strlen(args[1].value.str)), ctx);
+    set_cast(args, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+    if (args->value.bool) {
+        set_fill_boolean(set, 0);
     } else {
-        set_fill_string(set, "", 0, ctx);
+        set_fill_boolean(set, 1);
     }
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath substring-before(string, string) function.
- *        Returns LYXP_SET_STRING with the string preceding the occurance
- *        of the second argument in the first or an empty string.
+ * @brief Execute the XPath bumber(object?) function. Returns LYXP_SET_NUMBER
+ *        with the number representation of either the argument or the context.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3204,35 +4138,27 @@ xpath_substring_after(struct lyxp_set *args, uint16_t arg_count, struct lyd_node
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_substring_before(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                       int when_must_eval, uint32_t line)
+xpath_number(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+             int when_must_eval, uint32_t line)
 {
-    char *ptr;
-    struct ly_ctx *ctx;
-
-    if (arg_count != 2) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "substring-before(string, string)");
+    if (arg_count > 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "number(object?)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
-    lyxp_set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
-
-    ptr = strstr(args[0].value.str, args[1].value.str);
-    if (ptr) {
-        set_fill_string(set, args[0].value.str, ptr - args[0].value.str, ctx);
+    if (arg_count) {
+        set_cast(args, LYXP_SET_NUMBER, cur_node, when_must_eval);
+        set_fill_set(set, args);
     } else {
-        set_fill_string(set, "", 0, ctx);
+        set_cast(set, LYXP_SET_NUMBER, cur_node, when_must_eval);
     }
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath sum(node-set) function. Returns LYXP_SET_NUMBER
- *        with the sum of all the nodes in the context.
+ * @brief Execute the XPath position() function. Returns LYXP_SET_NUMBER
+ *        with the context position.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3244,67 +4170,31 @@ xpath_substring_before(struct lyxp_set *args, uint16_t arg_count, struct lyd_nod
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_sum(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-          int when_must_eval, uint32_t line)
+xpath_position(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
+               int UNUSED(when_must_eval), uint32_t line)
 {
-    long double num;
-    const char *str;
-    uint16_t i;
-    struct lyxp_set set_item;
-    struct ly_ctx *ctx;
-
-    if (arg_count != 1) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "sum(node-set)");
+    if (arg_count || args) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "position()");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
-    set_fill_number(set, 0, ctx);
-    if (args->type == LYXP_SET_EMPTY) {
+    if (set->type == LYXP_SET_EMPTY) {
+        set_fill_int(set, 0);
         return EXIT_SUCCESS;
     }
-
-    if (args->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INARGTYPE, line, 0, NULL, 1, print_set_type(args), "sum(node-set)");
-        return -1;
-    }
-
-    set_item.type = LYXP_SET_NODE_SET;
-    set_item.value.nodes = malloc(sizeof *set_item.value.nodes);
-    if (!set_item.value.nodes) {
-        LOGMEM;
-        return -1;
-    }
-    set_item.node_type = malloc(sizeof *set_item.node_type);
-    if (!set_item.node_type) {
-        LOGMEM;
-        free(set_item.value.nodes);
+    if (set->type != LYXP_SET_NODE_SET) {
+        LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "position()");
         return -1;
     }
-    set_item.used = 1;
-    set_item.size = 1;
-    set_item.pos = 0;
-
-    for (i = 0; i < args->used; ++i) {
-        set_item.value.nodes[0] = args->value.nodes[i];
-        set_item.node_type[0] = args->node_type[i];
-
-        str = cast_node_set_to_string(&set_item, cur_node, when_must_eval);
-        num = cast_string_to_number(str);
-        lydict_remove(ctx, str);
-        set->value.num += num;
-    }
-
-    free(set_item.value.nodes);
-    free(set_item.node_type);
 
+    set_fill_int(set, set->pos);
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath text() function (node type). Returns LYXP_SET_NODE_SET
- *        with the text content of the nodes in the context.
+ * @brief Execute the XPath round(number) function. Returns LYXP_SET_NUMBER
+ *        with the rounded first argument. For details refer to
+ *        http://www.w3.org/TR/1999/REC-xpath-19991116/#function-round.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3316,53 +4206,36 @@ xpath_sum(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node,
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_text(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
-           int UNUSED(when_must_eval), uint32_t line)
+xpath_round(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+            int when_must_eval, uint32_t line)
 {
-    uint16_t i;
-
-    if (arg_count || args) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "text()");
-        return -1;
-    }
-    if (set->type == LYXP_SET_EMPTY) {
-        return EXIT_SUCCESS;
-    }
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "text()");
+    if (arg_count != 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "round(number)");
         return -1;
     }
 
-    for (i = 0; i < set->used;) {
-        switch (set->node_type[i]) {
-        case LYXP_NODE_ELEM:
-            if ((set->value.nodes[i]->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST))
-                    && ((struct lyd_node_leaf_list *)set->value.nodes[i])->value_str) {
-                set->node_type[i] = LYXP_NODE_TEXT;
-                ++i;
-                break;
-            }
-            /* fall through */
-        case LYXP_NODE_ROOT_CONFIG:
-        case LYXP_NODE_ROOT_STATE:
-        case LYXP_NODE_ROOT_NOTIF:
-        case LYXP_NODE_ROOT_RPC:
-        case LYXP_NODE_ROOT_OUTPUT:
-        case LYXP_NODE_TEXT:
-        case LYXP_NODE_ATTR:
-            set_remove_node(set, i);
-            break;
+    set_cast(args, LYXP_SET_NUMBER, cur_node, when_must_eval);
+
+    /* cover only the cases where floor can't be used */
+    if (args->is_int) {
+        set_fill_int(set, args->inum);
+    } else if ((args->value.num == -0) || ((args->value.num < 0) && (args->value.num >= -0.5))) {
+        set_fill_number(set, -0);
+    } else {
+        args->value.num += 0.5;
+        if (xpath_floor(args, 1, cur_node, args, when_must_eval, line)) {
+            return -1;
         }
+        set_fill_number(set, args->value.num);
     }
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath translate(string, string, string) function.
- *        Returns LYXP_SET_STRING with the first argument with the characters
- *        from the second argument replaced by those on the corresponding
- *        positions in the third argument.
+ * @brief Execute the XPath starts-with(string, string) function.
+ *        Returns LYXP_SET_BOOLEAN whether the second argument is
+ *        the prefix of the first or not.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3374,78 +4247,29 @@ xpath_text(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *UNUSED(cu
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_translate(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-                int when_must_eval, uint32_t line)
+xpath_starts_with(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+                  int when_must_eval, uint32_t line)
 {
-    uint16_t i, j, new_used;
-    char *new;
-    int found, have_removed;
-    struct ly_ctx *ctx;
-
-    if (arg_count != 3) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "translate(string, string, string)");
-        return -1;
-    }
-
-    ctx = cur_node->schema->module->ctx;
-
-    lyxp_set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
-    lyxp_set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
-    lyxp_set_cast(&args[2], LYXP_SET_STRING, cur_node, when_must_eval);
-
-    new = malloc((strlen(args[0].value.str) + 1) * sizeof(char));
-    if (!new) {
-        LOGMEM;
+    if (arg_count != 2) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "starts-with(string, string)");
         return -1;
     }
-    new_used = 0;
-
-    have_removed = 0;
-    for (i = 0; args[0].value.str[i]; ++i) {
-        found = 0;
 
-        for (j = 0; args[1].value.str[j]; ++j) {
-            if (args[0].value.str[i] == args[1].value.str[j]) {
-                /* removing this char */
-                if (j >= strlen(args[2].value.str)) {
-                    have_removed = 1;
-                    found = 1;
-                    break;
-                }
-                /* replacing this char */
-                new[new_used] = args[2].value.str[j];
-                ++new_used;
-                found = 1;
-                break;
-            }
-        }
-
-        /* copying this char */
-        if (!found) {
-            new[new_used] = args[0].value.str[i];
-            ++new_used;
-        }
-    }
+    set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
+    set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
 
-    if (have_removed) {
-        new = ly_realloc(new, (new_used + 1) * sizeof(char));
-        if (!new) {
-            LOGMEM;
-            return -1;
-        }
+    if (strncmp(args[0].value.str, args[1].value.str, strlen(args[1].value.str))) {
+        set_fill_boolean(set, 0);
+    } else {
+        set_fill_boolean(set, 1);
     }
-    new[new_used] = '\0';
-
-    lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    set->type = LYXP_SET_STRING;
-    set->value.str = lydict_insert_zc(ctx, new);
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Execute the XPath true() function. Returns LYXP_SET_BOOLEAN
- *        with true value.
+ * @brief Execute the XPath string(object?) function. Returns LYXP_SET_STRING
+ *        with the string representation of either the argument or the context.
  *
  * @param[in] args Array of arguments.
  * @param[in] arg_count Count of elements in \p args.
@@ -3457,353 +4281,800 @@ xpath_translate(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-xpath_true(struct lyxp_set *args, uint16_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
-           int UNUSED(when_must_eval), uint32_t line)
+xpath_string(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+             int when_must_eval, uint32_t line)
 {
-    struct ly_ctx *ctx;
-
-    if (arg_count || args) {
-        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "true()");
+    if (arg_count > 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "string(object?)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
+    if (arg_count) {
+        set_cast(args, LYXP_SET_STRING, cur_node, when_must_eval);
+        set_fill_set(set, args);
+    } else {
+        set_cast(set, LYXP_SET_STRING, cur_node, when_must_eval);
+    }
 
-    set_fill_boolean(set, 1, ctx);
     return EXIT_SUCCESS;
 }
 
-/*
- * moveto functions
- *
- * They and only they actually change the context (set).
- */
-
 /**
- * @brief Resolve and find a specific model.
+ * @brief Execute the XPath string-length(string?) function. Returns LYXP_SET_NUMBER
+ *        with the length of the string in either the argument or the context.
  *
- * @param[in] mod_name_ns Either module name or namespace.
- * @param[in] mon_nam_ns_len Length of \p mod_name_ns.
- * @param[in] ctx libyang context.
- * @param[in] is_name Whether \p mod_name_ns is module name (1) or namespace (0).
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
+ * @param[in] cur_node Original context node.
+ * @param[in,out] set Context and result set at the same time.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
  *
- * @return Corresponding module or NULL on error.
+ * @return EXIT_SUCCESS on success, -1 on error.
  */
-static struct lys_module *
-moveto_resolve_model(const char *mod_name_ns, uint16_t mod_nam_ns_len, struct ly_ctx *ctx, int is_name)
+static int
+xpath_string_length(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+                    int when_must_eval, uint32_t line)
 {
-    uint16_t i;
-    const char *str;
+    if (arg_count > 2) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "string-length(string?)");
+        return -1;
+    }
 
-    for (i = 0; i < ctx->models.used; ++i) {
-        str = (is_name ? ctx->models.list[i]->name : ctx->models.list[i]->ns);
-        if (!strncmp(str, mod_name_ns, mod_nam_ns_len) && !str[mod_nam_ns_len]) {
-            return ctx->models.list[i];
-        }
+    if (arg_count) {
+        set_cast(args, LYXP_SET_STRING, cur_node, when_must_eval);
+        set_fill_int(set, strlen(args->value.str));
+    } else {
+        set_cast(set, LYXP_SET_STRING, cur_node, when_must_eval);
+        set_fill_int(set, strlen(set->value.str));
     }
 
-    LOGINT;
-    return NULL;
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief Get the context root.
+ * @brief Execute the XPath substring(string, number, number?) function.
+ *        Returns LYXP_SET_STRING substring of the first argument starting
+ *        on the second argument index ending on the third argument index,
+ *        indexed from 1. For exact definition refer to
+ *        http://www.w3.org/TR/1999/REC-xpath-19991116/#function-substring.
  *
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
  * @param[in] cur_node Original context node.
+ * @param[in,out] set Context and result set at the same time.
  * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
- * @param[out] root_type Root type, differs only in when, must evaluation.
+ * @param[in] line Line in the input file.
  *
- * @return Context root.
+ * @return EXIT_SUCCESS on success, -1 on error.
  */
-static struct lyd_node *
-moveto_get_root(struct lyd_node *cur_node, int when_must_eval, enum lyxp_node_type *root_type)
+static int
+xpath_substring(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+                int when_must_eval, uint32_t line)
 {
-    struct lyd_node *root, *prev;
-    int is_output = 0;
-
-    assert(cur_node && root_type);
+    long long start, len;
+    uint32_t str_start, str_len, pos;
 
-    if (!when_must_eval) {
-        /* only one kind of root that can access everything */
-        for (root = cur_node; root->parent; root = root->parent);
-        *root_type = LYXP_NODE_ROOT_STATE;
-        return root;
+    if ((arg_count < 2) || (arg_count > 3)) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "substring(string, number, number?)");
+        return -1;
     }
 
-    /* handle all kinds of special XPath roots */
-    root = cur_node;
-    if (root->parent) {
-        do {
-            prev = root;
-            root = root->parent;
+    set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
 
-            if ((root->schema->nodetype == LYS_RPC) || (root->schema->nodetype == LYS_NOTIF)) {
-                if (prev->schema->parent->nodetype == LYS_OUTPUT) {
-                    is_output = 1;
-                }
-                break;
-            }
-        } while (root->parent);
+    /* start */
+    if (xpath_round(&args[1], 1, cur_node, &args[1], when_must_eval, line)) {
+        return -1;
+    }
+    if (isfinite(args[1].value.num)) {
+        start = args[1].value.num - 1;
+    } else if (isinf(args[1].value.num) && signbit(args[1].value.num)) {
+        start = INT_MIN;
+    } else {
+        start = INT_MAX;
     }
 
-    if (root->schema->nodetype == LYS_NOTIF) {
-        *root_type = LYXP_NODE_ROOT_NOTIF;
-    } else if (root->schema->nodetype == LYS_RPC) {
-        if (is_output) {
-            *root_type = LYXP_NODE_ROOT_OUTPUT;
+    /* len */
+    if (arg_count == 3) {
+        if (xpath_round(&args[2], 1, cur_node, &args[2], when_must_eval, line)) {
+            return -1;
+        }
+        if (isfinite(args[2].value.num)) {
+            len = args[2].value.num;
+        } else if (isnan(args[2].value.num) || signbit(args[2].value.num)) {
+            len = 0;
         } else {
-            *root_type = LYXP_NODE_ROOT_RPC;
+            len = INT_MAX;
         }
     } else {
-        if (cur_node->schema->flags & LYS_CONFIG_W) {
-            *root_type = LYXP_NODE_ROOT_CONFIG;
+        len = INT_MAX;
+    }
+
+    /* find matching character positions */
+    str_start = 0;
+    str_len = 0;
+    for (pos = 0; args[0].value.str[pos]; ++pos) {
+        if ((long long)pos < start) {
+            ++str_start;
+        } else if ((long long)pos < start + len) {
+            ++str_len;
         } else {
-            assert(cur_node->schema->flags & LYS_CONFIG_R);
-            *root_type = LYXP_NODE_ROOT_STATE;
+            break;
         }
-
-        for (; root->prev->next; root = root->prev);
     }
 
-    return root;
+    set_fill_string(set, args[0].value.str + str_start, str_len);
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief Move context \p set to the root. Handles absolute path.
- *        Result is LYXP_SET_NODE_SET.
+ * @brief Execute the XPath substring-after(string, string) function.
+ *        Returns LYXP_SET_STRING with the string succeeding the occurance
+ *        of the second argument in the first or an empty string.
  *
- * @param[in,out] set Set to use.
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
  * @param[in] cur_node Original context node.
+ * @param[in,out] set Context and result set at the same time.
  * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
  */
-static void
-moveto_root(struct lyxp_set *set, struct lyd_node *cur_node, int when_must_eval)
+static int
+xpath_substring_after(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+                      int when_must_eval, uint32_t line)
 {
-    struct lyd_node *root;
-    enum lyxp_node_type root_type;
+    char *ptr;
 
-    if (!set) {
-        return;
+    if (arg_count != 2) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "substring-after(string, string)");
+        return -1;
     }
 
-    if (!cur_node) {
-        LOGINT;
-        return;
-    }
+    set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
+    set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
 
-    root = moveto_get_root(cur_node, when_must_eval, &root_type);
+    ptr = strstr(args[0].value.str, args[1].value.str);
+    if (ptr) {
+        set_fill_string(set, ptr + strlen(args[1].value.str), strlen(ptr + strlen(args[1].value.str)));
+    } else {
+        set_fill_string(set, "", 0);
+    }
 
-    lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    set_insert_node(set, root, root_type, 0);
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief Check (process) \p node as a part of NameTest processing.
+ * @brief Execute the XPath substring-before(string, string) function.
+ *        Returns LYXP_SET_STRING with the string preceding the occurance
+ *        of the second argument in the first or an empty string.
  *
- * @param[in] node Node to use.
- * @param[in,out] set Set to use.
- * @param[in] i Current index in \p set.
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
  * @param[in] cur_node Original context node.
- * @param[in] qname Qualified node name to move to.
- * @param[in] qname_len Length of \p qname.
- * @param[in] moveto_mod Expected module of the node.
- * @param[in,out] replaced Whether the node in \p set has already been replaced.
+ * @param[in,out] set Context and result set at the same time.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
-static void
-moveto_node_check(struct lyd_node *node, struct lyxp_set *set, uint16_t i, enum lyxp_node_type root_type,
-                  const char *qname, uint16_t qname_len, struct lys_module *moveto_mod, int *replaced)
+static int
+xpath_substring_before(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+                       int when_must_eval, uint32_t line)
 {
-    /* module check */
-    if (moveto_mod) {
-        if (lys_node_module(node->schema) != moveto_mod) {
-            return;
-        }
-    }
+    char *ptr;
 
-    /* context check */
-    if (((root_type == LYXP_NODE_ROOT_CONFIG) && (node->schema->flags & LYS_CONFIG_R))
-            || ((root_type == LYXP_NODE_ROOT_OUTPUT) && (node->schema->parent->nodetype == LYS_INPUT))
-            || ((root_type != LYXP_NODE_ROOT_NOTIF) && (node->schema->nodetype == LYS_NOTIF))
-            || ((root_type != LYXP_NODE_ROOT_RPC) && (node->schema->nodetype == LYS_RPC))) {
-        return;
+    if (arg_count != 2) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "substring-before(string, string)");
+        return -1;
     }
 
-    /* name check */
-    if (((qname_len == 1) && (qname[0] == '*'))
-            || (!strncmp(node->schema->name, qname, qname_len) && !node->schema->name[qname_len])) {
-        if (!(*replaced)) {
-            set->value.nodes[i] = node;
-            set->node_type[i] = LYXP_NODE_ELEM;
-            *replaced = 1;
-        } else {
-            set_insert_node(set, node, LYXP_NODE_ELEM, set->used);
-        }
+    set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
+    set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
+
+    ptr = strstr(args[0].value.str, args[1].value.str);
+    if (ptr) {
+        set_fill_string(set, args[0].value.str, ptr - args[0].value.str);
+    } else {
+        set_fill_string(set, "", 0);
     }
+
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief Move context \p set to a node. Handles '/' and '*', 'NAME', 'PREFIX:*', or 'PREFIX:NAME'.
- *        Result is LYXP_SET_NODE_SET (or LYXP_SET_EMPTY). Indirectly context position aware.
+ * @brief Execute the XPath sum(node-set) function. Returns LYXP_SET_NUMBER
+ *        with the sum of all the nodes in the context.
  *
- * @param[in,out] set Set to use.
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
  * @param[in] cur_node Original context node.
- * @param[in] qname Qualified node name to move to.
- * @param[in] qname_len Length of \p qname.
+ * @param[in,out] set Context and result set at the same time.
  * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
  * @param[in] line Line in the input file.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-moveto_node(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname, uint16_t qname_len, int when_must_eval,
-            uint32_t line)
+xpath_sum(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+          int when_must_eval, uint32_t line)
 {
-    uint16_t i, orig_used;
-    int replaced, pref_len;
-    struct lys_module *moveto_mod;
-    struct lyd_node *sub;
-    struct ly_ctx *ctx;
-    enum lyxp_node_type root_type;
+    long double num;
+    int64_t inum;
+    int is_int;
+    uint32_t i;
+    struct lyxp_set set_item;
 
-    if (!set || (set->type == LYXP_SET_EMPTY)) {
+    if (arg_count != 1) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "sum(node-set)");
+        return -1;
+    }
+
+    set_fill_int(set, 0);
+    if (args->type == LYXP_SET_EMPTY) {
         return EXIT_SUCCESS;
     }
 
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INOP_1, line, 0, NULL, "path operator", print_set_type(set));
+    if (args->type != LYXP_SET_NODE_SET) {
+        LOGVAL(LYE_XPATH_INARGTYPE, line, 0, NULL, 1, print_set_type(args), "sum(node-set)");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-    moveto_get_root(cur_node, when_must_eval, &root_type);
-
-    /* prefix */
-    if (strnchr(qname, ':', qname_len)) {
-        pref_len = strnchr(qname, ':', qname_len) - qname;
-        moveto_mod = moveto_resolve_model(qname, pref_len, ctx, 1);
-        if (!moveto_mod) {
-            return -1;
-        }
-        qname += pref_len + 1;
-        qname_len -= pref_len + 1;
-    } else {
-        moveto_mod = NULL;
+    memset(&set_item, 0, sizeof set_item);
+    set_item.type = LYXP_SET_NODE_SET;
+    set_item.value.nodes = malloc(sizeof *set_item.value.nodes);
+    if (!set_item.value.nodes) {
+        LOGMEM;
+        return -1;
     }
+    set_item.node_type = malloc(sizeof *set_item.node_type);
+    if (!set_item.node_type) {
+        LOGMEM;
+        free(set_item.value.nodes);
+        return -1;
+    }
+    set_item.used = 1;
+    set_item.size = 1;
+    set_item.pos = 0;
 
-    orig_used = set->used;
-    for (i = 0; (i < orig_used) && (set->type == LYXP_SET_NODE_SET); ) {
-        replaced = 0;
-
-        if ((set->node_type[i] == LYXP_NODE_ROOT_NOTIF) || (set->node_type[i] == LYXP_NODE_ROOT_RPC)) {
-            moveto_node_check(set->value.nodes[i], set, i, root_type, qname, qname_len, moveto_mod, &replaced);
-
-        } else if ((set->node_type[i] == LYXP_NODE_ROOT_CONFIG) || (set->node_type[i] == LYXP_NODE_ROOT_STATE)) {
-            LY_TREE_FOR(set->value.nodes[i], sub) {
-                moveto_node_check(sub, set, i, root_type, qname, qname_len, moveto_mod, &replaced);
-            }
+    for (i = 0; i < args->used; ++i) {
+        set_item.value.nodes[0] = args->value.nodes[i];
+        set_item.node_type[0] = args->node_type[i];
 
-        /* skip nodes without children - leaves, leaflists, and anyxmls (ouput root will eval to true) */
-        } else if (!(set->value.nodes[i]->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML))) {
-            LY_TREE_FOR(set->value.nodes[i]->child, sub) {
-                moveto_node_check(sub, set, i, root_type, qname, qname_len, moveto_mod, &replaced);
-            }
+        is_int = cast_node_set_to_number(&set_item, cur_node, when_must_eval, &num, &inum);
+        if (is_int == -1) {
+            free(set_item.value.nodes);
+            free(set_item.node_type);
+            return -1;
         }
 
-        if (!replaced) {
-            /* no match */
-            set_remove_node(set, i);
-            --orig_used;
+        if (set->is_int && is_int && (((inum >= 0) && (set->inum <= INT64_MAX - inum))
+                || ((inum < 0) && (set->inum >= INT64_MIN - inum)))) {
+            set_fill_int(set, set->inum + inum);
         } else {
-            ++i;
+            set->value.num += num;
+            set->is_int = 0;
         }
     }
 
-    set_sort(set, cur_node, when_must_eval);
-    assert(!set_sorted_dup_node_clean(set));
+    free(set_item.value.nodes);
+    free(set_item.node_type);
 
     return EXIT_SUCCESS;
 }
 
 /**
- * @brief Move context \p set to a node and all its descendants. Handles '//' and '*', 'NAME',
- *        'PREFIX:*', or 'PREFIX:NAME'. Result is LYXP_SET_NODE_SET (or LYXP_SET_EMPTY).
- *        Indirectly context position aware.
+ * @brief Execute the XPath text() function (node type). Returns LYXP_SET_NODE_SET
+ *        with the text content of the nodes in the context.
  *
- * @param[in] set Set to use.
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
  * @param[in] cur_node Original context node.
- * @param[in] qname Qualified node name to move to.
- * @param[in] qname_len Length of \p qname.
+ * @param[in,out] set Context and result set at the same time.
  * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
  * @param[in] line Line in the input file.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-moveto_node_alldesc(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname, uint16_t qname_len,
-                    int when_must_eval, uint32_t line)
+xpath_text(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
+           int UNUSED(when_must_eval), uint32_t line)
 {
-    uint16_t i;
-    int pref_len, all = 0, replace, match;
-    struct lyd_node *next, *elem, *start;
-    struct lys_module *moveto_mod;
-    struct ly_ctx *ctx;
-    enum lyxp_node_type root_type;
+    uint32_t i;
 
-    if (!set || (set->type == LYXP_SET_EMPTY)) {
+    if (arg_count || args) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "text()");
+        return -1;
+    }
+    if (set->type == LYXP_SET_EMPTY) {
         return EXIT_SUCCESS;
     }
-
     if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INOP_1, line, 0, NULL, "path operator", print_set_type(set));
+        LOGVAL(LYE_XPATH_INCTX, line, 0, NULL, print_set_type(set), "text()");
         return -1;
     }
 
-    ctx = cur_node->schema->module->ctx;
-    moveto_get_root(cur_node, when_must_eval, &root_type);
-
-    /* prefix */
-    if (strnchr(qname, ':', qname_len)) {
-        pref_len = strnchr(qname, ':', qname_len) - qname;
-        moveto_mod = moveto_resolve_model(qname, pref_len, ctx, 1);
-        if (!moveto_mod) {
-            return -1;
+    for (i = 0; i < set->used;) {
+        switch (set->node_type[i]) {
+        case LYXP_NODE_ELEM:
+            if ((set->value.nodes[i]->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST))
+                    && lyd_value_str((struct lyd_node_leaf_list *)set->value.nodes[i])) {
+                set_replace_node(set, set->value.nodes[i], LYXP_NODE_TEXT, i);
+                ++i;
+                break;
+            }
+            /* fall through */
+        case LYXP_NODE_ROOT_CONFIG:
+        case LYXP_NODE_ROOT_STATE:
+        case LYXP_NODE_ROOT_NOTIF:
+        case LYXP_NODE_ROOT_RPC:
+        case LYXP_NODE_ROOT_OUTPUT:
+        case LYXP_NODE_TEXT:
+        case LYXP_NODE_ATTR:
+            set_remove_node(set, i);
+            break;
         }
-        qname += pref_len + 1;
-        qname_len -= pref_len + 1;
-    } else {
-        moveto_mod = 0;
     }
 
-    /* replace the original nodes (and throws away all text and attr nodes, root is replaced by a child) */
-    if (moveto_node(set, cur_node, "*", 1, when_must_eval, line)) {
-        return -1;
-    }
+    return EXIT_SUCCESS;
+}
 
-    if ((qname_len == 1) && (qname[0] == '*')) {
-        all = 1;
+/**
+ * @brief Execute the XPath translate(string, string, string) function.
+ *        Returns LYXP_SET_STRING with the first argument with the characters
+ *        from the second argument replaced by those on the corresponding
+ *        positions in the third argument.
+ *
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
+ * @param[in] cur_node Original context node.
+ * @param[in,out] set Context and result set at the same time.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+static int
+xpath_translate(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *cur_node, struct lyxp_set *set,
+                int when_must_eval, uint32_t line)
+{
+    uint32_t i, j, new_used;
+    char *new;
+    int found;
+
+    if (arg_count != 3) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "translate(string, string, string)");
+        return -1;
     }
 
-    /* this loop traverses all the nodes in the set and addds/keeps only
-     * those that match qname */
-    for (i = 0; i < set->used; ) {
-        /* TREE DFS */
-        start = set->value.nodes[i];
-        replace = 0;
-        for (elem = next = start; elem; elem = next) {
+    set_cast(&args[0], LYXP_SET_STRING, cur_node, when_must_eval);
+    set_cast(&args[1], LYXP_SET_STRING, cur_node, when_must_eval);
+    set_cast(&args[2], LYXP_SET_STRING, cur_node, when_must_eval);
 
-            /* context check */
-            if (((root_type == LYXP_NODE_ROOT_CONFIG) && (elem->schema->flags & LYS_CONFIG_R))
-                    || ((root_type == LYXP_NODE_ROOT_OUTPUT) && (elem->schema->parent->nodetype == LYS_INPUT))
-                    || ((root_type != LYXP_NODE_ROOT_NOTIF) && (elem->schema->nodetype == LYS_NOTIF))
-                    || ((root_type != LYXP_NODE_ROOT_RPC) && (elem->schema->nodetype == LYS_RPC))) {
-                goto skip_children;
-            }
+    new = scratch_alloc((strlen(args[0].value.str) + 1) * sizeof(char));
+    if (!new) {
+        return -1;
+    }
+    new_used = 0;
 
-            match = 1;
+    for (i = 0; args[0].value.str[i]; ++i) {
+        found = 0;
 
-            /* module check */
+        for (j = 0; args[1].value.str[j]; ++j) {
+            if (args[0].value.str[i] == args[1].value.str[j]) {
+                /* removing this char */
+                if (j >= strlen(args[2].value.str)) {
+                    found = 1;
+                    break;
+                }
+                /* replacing this char */
+                new[new_used] = args[2].value.str[j];
+                ++new_used;
+                found = 1;
+                break;
+            }
+        }
+
+        /* copying this char */
+        if (!found) {
+            new[new_used] = args[0].value.str[i];
+            ++new_used;
+        }
+    }
+
+    new[new_used] = '\0';
+
+    set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set->type = LYXP_SET_STRING;
+    set->value.str = new;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Execute the XPath true() function. Returns LYXP_SET_BOOLEAN
+ *        with true value.
+ *
+ * @param[in] args Array of arguments.
+ * @param[in] arg_count Count of elements in \p args.
+ * @param[in] cur_node Original context node.
+ * @param[in,out] set Context and result set at the same time.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+static int
+xpath_true(struct lyxp_set *args, uint32_t arg_count, struct lyd_node *UNUSED(cur_node), struct lyxp_set *set,
+           int UNUSED(when_must_eval), uint32_t line)
+{
+    if (arg_count || args) {
+        LOGVAL(LYE_XPATH_INARGCOUNT, line, 0, NULL, arg_count, "true()");
+        return -1;
+    }
+
+    set_fill_boolean(set, 1);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * moveto functions
+ *
+ * They and only they actually change the context (set).
+ */
+
+/**
+ * @brief Resolve and find a specific model.
+ *
+ * @param[in] mod_name_ns Either module name or namespace.
+ * @param[in] mon_nam_ns_len Length of \p mod_name_ns.
+ * @param[in] ctx libyang context.
+ * @param[in] is_name Whether \p mod_name_ns is module name (1) or namespace (0).
+ *
+ * @return Corresponding module or NULL on error.
+ */
+static struct lys_module *
+moveto_resolve_model(const char *mod_name_ns, uint32_t mod_nam_ns_len, struct ly_ctx *ctx, int is_name)
+{
+    int i;
+    const char *str;
+
+    for (i = 0; i < ctx->models.used; ++i) {
+        str = (is_name ? ctx->models.list[i]->name : ctx->models.list[i]->ns);
+        if (!strncmp(str, mod_name_ns, mod_nam_ns_len) && !str[mod_nam_ns_len]) {
+            return ctx->models.list[i];
+        }
+    }
+
+    LOGINT;
+    return NULL;
+}
+
+/**
+ * @brief Get the context root.
+ *
+ * @param[in] cur_node Original context node.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[out] root_type Root type, differs only in when, must evaluation.
+ *
+ * @return Context root.
+ */
+static struct lyd_node *
+moveto_get_root(struct lyd_node *cur_node, int when_must_eval, enum lyxp_node_type *root_type)
+{
+    struct lyd_node *root, *prev;
+    int is_output = 0;
+
+    assert(cur_node && root_type);
+
+    if (!when_must_eval) {
+        /* only one kind of root that can access everything */
+        for (root = cur_node; root->parent; root = root->parent);
+        *root_type = LYXP_NODE_ROOT_STATE;
+        return root;
+    }
+
+    /* handle all kinds of special XPath roots */
+    root = cur_node;
+    if (root->parent) {
+        do {
+            prev = root;
+            root = root->parent;
+
+            if ((root->schema->nodetype == LYS_RPC) || (root->schema->nodetype == LYS_NOTIF)) {
+                if (prev->schema->parent->nodetype == LYS_OUTPUT) {
+                    is_output = 1;
+                }
+                break;
+            }
+        } while (root->parent);
+    }
+
+    if (root->schema->nodetype == LYS_NOTIF) {
+        *root_type = LYXP_NODE_ROOT_NOTIF;
+    } else if (root->schema->nodetype == LYS_RPC) {
+        if (is_output) {
+            *root_type = LYXP_NODE_ROOT_OUTPUT;
+        } else {
+            *root_type = LYXP_NODE_ROOT_RPC;
+        }
+    } else {
+        if (cur_node->schema->flags & LYS_CONFIG_W) {
+            *root_type = LYXP_NODE_ROOT_CONFIG;
+        } else {
+            assert(cur_node->schema->flags & LYS_CONFIG_R);
+            *root_type = LYXP_NODE_ROOT_STATE;
+        }
+
+        for (; root->prev->next; root = root->prev);
+    }
+
+    return root;
+}
+
+/**
+ * @brief Move context \p set to the root. Handles absolute path.
+ *        Result is LYXP_SET_NODE_SET.
+ *
+ * @param[in,out] set Set to use.
+ * @param[in] cur_node Original context node.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ */
+static void
+moveto_root(struct lyxp_set *set, struct lyd_node *cur_node, int when_must_eval)
+{
+    struct lyd_node *root;
+    enum lyxp_node_type root_type;
+
+    if (!set) {
+        return;
+    }
+
+    if (!cur_node) {
+        LOGINT;
+        return;
+    }
+
+    root = moveto_get_root(cur_node, when_must_eval, &root_type);
+
+    set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_insert_node(set, root, root_type, 0);
+}
+
+/**
+ * @brief Check whether \p node matches a NameTest.
+ *
+ * @param[in] node Node to check.
+ * @param[in] root_type Type of the context root.
+ * @param[in] qname Node name without the prefix.
+ * @param[in] qname_len Length of \p qname.
+ * @param[in] moveto_mod Expected module of the node, NULL for any.
+ *
+ * @return 1 if matches, 0 otherwise.
+ */
+static int
+moveto_node_match(const struct lyd_node *node, enum lyxp_node_type root_type, const char *qname, uint32_t qname_len,
+                  const struct lys_module *moveto_mod)
+{
+    /* module check */
+    if (moveto_mod) {
+        if (lys_node_module(node->schema) != moveto_mod) {
+            return 0;
+        }
+    }
+
+    /* context check */
+    if (((root_type == LYXP_NODE_ROOT_CONFIG) && (node->schema->flags & LYS_CONFIG_R))
+            || ((root_type == LYXP_NODE_ROOT_OUTPUT) && (node->schema->parent->nodetype == LYS_INPUT))
+            || ((root_type != LYXP_NODE_ROOT_NOTIF) && (node->schema->nodetype == LYS_NOTIF))
+            || ((root_type != LYXP_NODE_ROOT_RPC) && (node->schema->nodetype == LYS_RPC))) {
+        return 0;
+    }
+
+    /* name check */
+    return ((qname_len == 1) && (qname[0] == '*'))
+            || (!strncmp(node->schema->name, qname, qname_len) && !node->schema->name[qname_len]);
+}
+
+/**
+ * @brief Check (process) \p node as a part of NameTest processing.
+ *
+ * @param[in] node Node to use.
+ * @param[in,out] set Set to use.
+ * @param[in] i Current index in \p set.
+ * @param[in] cur_node Original context node.
+ * @param[in] qname Qualified node name to move to.
+ * @param[in] qname_len Length of \p qname.
+ * @param[in] moveto_mod Expected module of the node.
+ * @param[in,out] replaced Whether the node in \p set has already been replaced.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+static void
+moveto_node_check(struct lyd_node *node, struct lyxp_set *set, uint32_t i, enum lyxp_node_type root_type,
+                  const char *qname, uint32_t qname_len, struct lys_module *moveto_mod, int *replaced)
+{
+    if (moveto_node_match(node, root_type, qname, qname_len, moveto_mod)) {
+        if (!(*replaced)) {
+            set_replace_node(set, node, LYXP_NODE_ELEM, i);
+            *replaced = 1;
+        } else {
+            set_insert_node(set, node, LYXP_NODE_ELEM, set->used);
+        }
+    }
+}
+
+/**
+ * @brief Move context \p set to a node. Handles '/' and '*', 'NAME', 'PREFIX:*', or 'PREFIX:NAME'.
+ *        Result is LYXP_SET_NODE_SET (or LYXP_SET_EMPTY). Indirectly context position aware.
+ *
+ * @param[in,out] set Set to use.
+ * @param[in] cur_node Original context node.
+ * @param[in] qname Qualified node name to move to.
+ * @param[in] qname_len Length of \p qname.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+static int
+moveto_node(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname, uint32_t qname_len, int when_must_eval,
+            uint32_t line)
+{
+    uint32_t i, orig_used;
+    int replaced, pref_len;
+    struct lys_module *moveto_mod;
+    struct lyd_node *sub;
+    struct ly_ctx *ctx;
+    enum lyxp_node_type root_type;
+
+    if (!set || (set->type == LYXP_SET_EMPTY)) {
+        return EXIT_SUCCESS;
+    }
+
+    if (set->type != LYXP_SET_NODE_SET) {
+        LOGVAL(LYE_XPATH_INOP_1, line, 0, NULL, "path operator", print_set_type(set));
+        return -1;
+    }
+
+    ctx = cur_node->schema->module->ctx;
+    moveto_get_root(cur_node, when_must_eval, &root_type);
+
+    /* prefix */
+    if (strnchr(qname, ':', qname_len)) {
+        pref_len = strnchr(qname, ':', qname_len) - qname;
+        moveto_mod = moveto_resolve_model(qname, pref_len, ctx, 1);
+        if (!moveto_mod) {
+            return -1;
+        }
+        qname += pref_len + 1;
+        qname_len -= pref_len + 1;
+    } else {
+        moveto_mod = NULL;
+    }
+
+    orig_used = set->used;
+    for (i = 0; (i < orig_used) && (set->type == LYXP_SET_NODE_SET); ) {
+        replaced = 0;
+
+        if ((set->node_type[i] == LYXP_NODE_ROOT_NOTIF) || (set->node_type[i] == LYXP_NODE_ROOT_RPC)) {
+            moveto_node_check(set->value.nodes[i], set, i, root_type, qname, qname_len, moveto_mod, &replaced);
+
+        } else if ((set->node_type[i] == LYXP_NODE_ROOT_CONFIG) || (set->node_type[i] == LYXP_NODE_ROOT_STATE)) {
+            LY_TREE_FOR(set->value.nodes[i], sub) {
+                moveto_node_check(sub, set, i, root_type, qname, qname_len, moveto_mod, &replaced);
+            }
+
+        /* skip nodes without children - leaves, leaflists, and anyxmls (ouput root will eval to true) */
+        } else if (!(set->value.nodes[i]->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML))) {
+            LY_TREE_FOR(set->value.nodes[i]->child, sub) {
+                moveto_node_check(sub, set, i, root_type, qname, qname_len, moveto_mod, &replaced);
+            }
+        }
+
+        if (!replaced) {
+            /* no match */
+            set_remove_node(set, i);
+            --orig_used;
+        } else {
+            ++i;
+        }
+    }
+
+    set_sort(set, cur_node, when_must_eval);
+    assert(!set_sorted_dup_node_clean(set));
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Move context \p set to a node and all its descendants. Handles '//' and '*', 'NAME',
+ *        'PREFIX:*', or 'PREFIX:NAME'. Result is LYXP_SET_NODE_SET (or LYXP_SET_EMPTY).
+ *        Indirectly context position aware.
+ *
+ * @param[in] set Set to use.
+ * @param[in] cur_node Original context node.
+ * @param[in] qname Qualified node name to move to.
+ * @param[in] qname_len Length of \p qname.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+static int
+moveto_node_alldesc(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname, uint32_t qname_len,
+                    int when_must_eval, uint32_t line)
+{
+    uint32_t i, orig_used;
+    int pref_len, all = 0, match, sorted = 1;
+    struct lyd_node *next, *elem, *start;
+    struct lyxp_set ret_set;
+    struct lys_module *moveto_mod;
+    struct ly_ctx *ctx;
+    enum lyxp_node_type root_type;
+
+    if (!set || (set->type == LYXP_SET_EMPTY)) {
+        return EXIT_SUCCESS;
+    }
+
+    if (set->type != LYXP_SET_NODE_SET) {
+        LOGVAL(LYE_XPATH_INOP_1, line, 0, NULL, "path operator", print_set_type(set));
+        return -1;
+    }
+
+    ctx = cur_node->schema->module->ctx;
+    moveto_get_root(cur_node, when_must_eval, &root_type);
+
+    /* prefix */
+    if (strnchr(qname, ':', qname_len)) {
+        pref_len = strnchr(qname, ':', qname_len) - qname;
+        moveto_mod = moveto_resolve_model(qname, pref_len, ctx, 1);
+        if (!moveto_mod) {
+            return -1;
+        }
+        qname += pref_len + 1;
+        qname_len -= pref_len + 1;
+    } else {
+        moveto_mod = 0;
+    }
+
+    /* replace the original nodes (and throws away all text and attr nodes, root is replaced by a child) */
+    if (moveto_node(set, cur_node, "*", 1, when_must_eval, line)) {
+        return -1;
+    }
+
+    if ((qname_len == 1) && (qname[0] == '*')) {
+        all = 1;
+    }
+
+    /* this loop traverses all the nodes in the set and adds those that match qname
+     * into a new set, right after their matching ancestor so that they are in the DFS order */
+    memset(&ret_set, 0, sizeof ret_set);
+    for (i = 0; i < set->used; ++i) {
+        start = set->value.nodes[i];
+        orig_used = ret_set.used;
+
+        /* TREE DFS */
+        for (elem = next = start; elem; elem = next) {
+
+            /* context check */
+            if (((root_type == LYXP_NODE_ROOT_CONFIG) && (elem->schema->flags & LYS_CONFIG_R))
+                    || ((root_type == LYXP_NODE_ROOT_OUTPUT) && (elem->schema->parent->nodetype == LYS_INPUT))
+                    || ((root_type != LYXP_NODE_ROOT_NOTIF) && (elem->schema->nodetype == LYS_NOTIF))
+                    || ((root_type != LYXP_NODE_ROOT_RPC) && (elem->schema->nodetype == LYS_RPC))) {
+                goto skip_children;
+            }
+
+            if ((elem != start) && (set_dup_node_check(set, elem, LYXP_NODE_ELEM, i) > -1)) {
+                /* we'll process it later, but its descendants will not follow it */
+                sorted = 0;
+                goto skip_children;
+            }
+
+            match = 1;
+
+            /* module check */
             if (moveto_mod) {
                 if (lys_node_module(elem->schema) != moveto_mod) {
                     /* no match */
@@ -3817,21 +5088,8 @@ moveto_node_alldesc(struct lyxp_set *set, struct lyd_node *cur_node, const char
                 match = 0;
             }
 
-            if (match && (elem != start)) {
-                if (set_dup_node_check(set, elem, LYXP_NODE_ELEM, i) > -1) {
-                    /* we'll process it later */
-                    goto skip_children;
-                } else if (replace) {
-                    set->value.nodes[i] = elem;
-                    assert(set->node_type[i] == LYXP_NODE_ELEM);
-                    replace = 0;
-                } else {
-                    set_insert_node(set, elem, LYXP_NODE_ELEM, i + 1);
-                    ++i;
-                }
-            } else if (!match && (elem == start)) {
-                /* we need to replace a node that is already in the set */
-                replace = 1;
+            if (match) {
+                set_insert_node(&ret_set, elem, LYXP_NODE_ELEM, ret_set.used);
             }
 
             /* TREE DFS NEXT ELEM */
@@ -3862,14 +5120,27 @@ skip_children:
             }
         }
 
-        if (replace) {
-            set_remove_node(set, i);
-        } else {
-            ++i;
+        if (set->pos == i + 1) {
+            if (ret_set.used == orig_used) {
+                /* the context node was removed, it changes the whole set into LYXP_SET_EMPTY */
+                set_cast(&ret_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+                memset(&ret_set, 0, sizeof ret_set);
+                break;
+            }
+            /* the first node that replaced the context node */
+            ret_set.pos = orig_used + 1;
         }
     }
 
-    set_sort(set, cur_node, when_must_eval);
+    set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    memcpy(set, &ret_set, sizeof *set);
+
+    if (sorted) {
+        /* descendants were added right after their ancestor in the DFS order */
+        assert(!set_sort(set, cur_node, when_must_eval));
+    } else {
+        set_sort(set, cur_node, when_must_eval);
+    }
     assert(!set_sorted_dup_node_clean(set));
 
     return EXIT_SUCCESS;
@@ -3889,10 +5160,10 @@ skip_children:
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-moveto_attr(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname, uint16_t qname_len, int when_must_eval,
+moveto_attr(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname, uint32_t qname_len, int when_must_eval,
             uint32_t line)
 {
-    uint16_t i;
+    uint32_t i;
     int replaced, all = 0, pref_len;
     struct lys_module *moveto_mod;
     struct lyd_attr *sub;
@@ -3943,8 +5214,7 @@ moveto_attr(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname,
                 if (all || (!strncmp(sub->name, qname, qname_len) && !sub->name[qname_len])) {
                     /* match */
                     if (!replaced) {
-                        set->value.attrs[i] = sub;
-                        set->node_type[i] = LYXP_NODE_ATTR;
+                        set_replace_node(set, sub, LYXP_NODE_ATTR, i);
                         replaced = 1;
                     } else {
                         set_insert_node(set, (struct lyd_node *)sub, LYXP_NODE_ATTR, i + 1);
@@ -3986,6 +5256,8 @@ static int
 moveto_union(struct lyxp_set *set1, struct lyxp_set *set2, struct lyd_node *cur_node, int when_must_eval,
              uint32_t line)
 {
+    uint32_t i;
+
     if (((set1->type != LYXP_SET_NODE_SET) && (set1->type != LYXP_SET_EMPTY))
             || ((set2->type != LYXP_SET_NODE_SET) && (set2->type != LYXP_SET_EMPTY))) {
         LOGVAL(LYE_XPATH_INOP_2, line, 0, NULL, "union", print_set_type(set1), print_set_type(set2));
@@ -4013,12 +5285,14 @@ moveto_union(struct lyxp_set *set1, struct lyxp_set *set2, struct lyd_node *cur_
             set1->node_type[0] = set1->node_type[set1->pos - 1];
         }
         set1->used = 1;
+        set_hash_free(set1);
 
         if (set2->pos > 1) {
             set2->value.nodes[0] = set2->value.nodes[set2->pos - 1];
             set2->node_type[0] = set2->node_type[set2->pos - 1];
         }
         set2->used = 1;
+        set_hash_free(set2);
     }
 
     /* make sure there is enough memory */
@@ -4028,16 +5302,17 @@ moveto_union(struct lyxp_set *set1, struct lyxp_set *set2, struct lyd_node *cur_
         set1->node_type = realloc(set1->node_type, set1->size * sizeof *set1->node_type);
     }
 
-    /* copy nodes */
-    memcpy(&set1->value.nodes[set1->used], set2->value.nodes, set2->used * sizeof *set2->value.nodes);
-    memcpy(&set1->node_type[set1->used], set2->node_type, set2->used * sizeof *set2->node_type);
-    set1->used += set2->used;
+    /* copy nodes that are not in set1 yet */
+    for (i = 0; i < set2->used; ++i) {
+        if (set_dup_node_check(set1, set2->value.nodes[i], set2->node_type[i], -1) == -1) {
+            set_insert_node(set1, set2->value.nodes[i], set2->node_type[i], set1->used);
+        }
+    }
 
-    lyxp_set_cast(set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
 
-    /* sort, remove duplicates */
     set_sort(set1, cur_node, when_must_eval);
-    set_sorted_dup_node_clean(set1);
+    assert(!set_sorted_dup_node_clean(set1));
 
     return EXIT_SUCCESS;
 }
@@ -4057,10 +5332,10 @@ moveto_union(struct lyxp_set *set1, struct lyxp_set *set2, struct lyd_node *cur_
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-moveto_attr_alldesc(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname, uint16_t qname_len,
+moveto_attr_alldesc(struct lyxp_set *set, struct lyd_node *cur_node, const char *qname, uint32_t qname_len,
                     int when_must_eval, uint32_t line)
 {
-    uint16_t i;
+    uint32_t i;
     int pref_len, replaced, all = 0;
     struct lyd_attr *sub;
     struct lys_module *moveto_mod;
@@ -4094,18 +5369,18 @@ moveto_attr_alldesc(struct lyxp_set *set, struct lyd_node *cur_node, const char
     /* can be optimized similarly to moveto_node_alldesc() and save considerable amount of memory,
      * but it likely won't be used much, so it's a waste of time */
     /* copy the context */
-    set_all_desc = set_copy(set, ctx);
+    set_all_desc = set_copy(set);
     /* get all descendant nodes (the original context nodes are removed) */
     if (moveto_node_alldesc(set_all_desc, cur_node, "*", 1, when_must_eval, line)) {
-        lyxp_set_free(set_all_desc, ctx);
+        set_free(set_all_desc);
         return -1;
     }
     /* prepend the original context nodes */
     if (moveto_union(set, set_all_desc, cur_node, when_must_eval, line)) {
-        lyxp_set_free(set_all_desc, ctx);
+        set_free(set_all_desc);
         return -1;
     }
-    lyxp_set_free(set_all_desc, ctx);
+    set_free(set_all_desc);
 
     if ((qname_len == 1) && (qname[0] == '*')) {
         all = 1;
@@ -4127,8 +5402,7 @@ moveto_attr_alldesc(struct lyxp_set *set, struct lyd_node *cur_node, const char
                 if (all || (!strncmp(sub->name, qname, qname_len) && !sub->name[qname_len])) {
                     /* match */
                     if (!replaced) {
-                        set->value.attrs[i] = sub;
-                        set->node_type[i] = LYXP_NODE_ATTR;
+                        set_replace_node(set, sub, LYXP_NODE_ATTR, i);
                         replaced = 1;
                     } else {
                         set_insert_node(set, (struct lyd_node *)sub, LYXP_NODE_ATTR, i + 1);
@@ -4169,7 +5443,8 @@ static int
 moveto_self(struct lyxp_set *set, struct lyd_node *cur_node, int all_desc, int when_must_eval, uint32_t line)
 {
     struct lyd_node *sub;
-    uint16_t i, cont_i;
+    uint32_t i, cont_i;
+    int sorted = 1;
     enum lyxp_node_type root_type;
 
     if (!set || (set->type == LYXP_SET_EMPTY)) {
@@ -4194,6 +5469,10 @@ moveto_self(struct lyxp_set *set, struct lyd_node *cur_node, int all_desc, int w
 
         /* do not touch attributes and text nodes */
         if ((set->node_type[i] == LYXP_NODE_TEXT) || (set->node_type[i] == LYXP_NODE_ATTR)) {
+            if (set->node_type[i] == LYXP_NODE_ATTR) {
+                /* attributes precede the children added after their parent */
+                sorted = 0;
+            }
             continue;
         }
 
@@ -4216,6 +5495,9 @@ moveto_self(struct lyxp_set *set, struct lyd_node *cur_node, int all_desc, int w
                 if (set_dup_node_check(set, sub, LYXP_NODE_ELEM, -1) == -1) {
                     set_insert_node(set, sub, LYXP_NODE_ELEM, i + cont_i + 1);
                     ++cont_i;
+                } else {
+                    /* it is somewhere further in the set, not right after its parent */
+                    sorted = 0;
                 }
             }
 
@@ -4223,15 +5505,23 @@ moveto_self(struct lyxp_set *set, struct lyd_node *cur_node, int all_desc, int w
         } else {
             /* ... but only non-empty */
             sub = set->value.nodes[i];
-            if (((struct lyd_node_leaf_list *)sub)->value_str) {
+            if (lyd_value_str((struct lyd_node_leaf_list *)sub)) {
                 if (set_dup_node_check(set, sub, LYXP_NODE_TEXT, -1) == -1) {
                     set_insert_node(set, sub, LYXP_NODE_TEXT, i + 1);
+                } else if ((i + 1 == set->used) || (set->value.nodes[i + 1] != sub)
+                        || (set->node_type[i + 1] != LYXP_NODE_TEXT)) {
+                    sorted = 0;
                 }
             }
         }
     }
 
-    set_sort(set, cur_node, when_must_eval);
+    if (sorted) {
+        /* children were added right after their parent, the set is in the DFS order */
+        assert(!set_sort(set, cur_node, when_must_eval));
+    } else {
+        set_sort(set, cur_node, when_must_eval);
+    }
     assert(!set_sorted_dup_node_clean(set));
     return EXIT_SUCCESS;
 }
@@ -4251,7 +5541,7 @@ moveto_self(struct lyxp_set *set, struct lyd_node *cur_node, int all_desc, int w
 static int
 moveto_parent(struct lyxp_set *set, struct lyd_node *cur_node, int all_desc, int when_must_eval, uint32_t line)
 {
-    uint16_t i;
+    uint32_t i;
     struct lyd_node *node, *new_node, *root;
     enum lyxp_node_type root_type, new_type;
 
@@ -4339,8 +5629,7 @@ moveto_parent(struct lyxp_set *set, struct lyd_node *cur_node, int all_desc, int
         if (set_dup_node_check(set, new_node, new_type, -1) > -1) {
             set_remove_node(set, i);
         } else {
-            set->node_type[i] = new_type;
-            set->value.nodes[i] = new_node;
+            set_replace_node(set, new_node, new_type, i);
 
             ++i;
         }
@@ -4396,9 +5685,6 @@ moveto_op_comp(struct lyxp_set *set1, struct lyxp_set *set2, const char *op, str
      * STRING + BOOLEAN = NUMBER + NUMBER     /(1 NUMBER) 2 NUMBER
      */
     int result;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     /* we can evaluate it immediately */
     if ((set1->type == set2->type) && (set1->type != LYXP_SET_EMPTY) && (set1->type != LYXP_SET_NODE_SET)
@@ -4409,17 +5695,19 @@ moveto_op_comp(struct lyxp_set *set1, struct lyxp_set *set2, const char *op, str
             if (set1->type == LYXP_SET_BOOLEAN) {
                 result = (set1->value.bool == set2->value.bool);
             } else if (set1->type == LYXP_SET_NUMBER) {
-                result = (set1->value.num == set2->value.num);
+                result = (set1->is_int && set2->is_int) ? (set1->inum == set2->inum)
+                                                        : (set1->value.num == set2->value.num);
             } else {
-                result = (ly_strequal(set1->value.str, set2->value.str, 1));
+                result = !strcmp(set1->value.str, set2->value.str);
             }
         } else if (op[0] == '!') {
             if (set1->type == LYXP_SET_BOOLEAN) {
                 result = (set1->value.bool != set2->value.bool);
             } else if (set1->type == LYXP_SET_NUMBER) {
-                result = (set1->value.num != set2->value.num);
+                result = (set1->is_int && set2->is_int) ? (set1->inum != set2->inum)
+                                                        : (set1->value.num != set2->value.num);
             } else {
-                result = (!ly_strequal(set1->value.str, set2->value.str, 1));
+                result = (strcmp(set1->value.str, set2->value.str) != 0);
             }
         } else {
             if (set1->type != LYXP_SET_NUMBER) {
@@ -4429,24 +5717,28 @@ moveto_op_comp(struct lyxp_set *set1, struct lyxp_set *set2, const char *op, str
 
             if (op[0] == '<') {
                 if (op[1] == '=') {
-                    result = (set1->value.num <= set2->value.num);
+                    result = (set1->is_int && set2->is_int) ? (set1->inum <= set2->inum)
+                                                        : (set1->value.num <= set2->value.num);
                 } else {
-                    result = (set1->value.num < set2->value.num);
+                    result = (set1->is_int && set2->is_int) ? (set1->inum < set2->inum)
+                                                        : (set1->value.num < set2->value.num);
                 }
             } else {
                 if (op[1] == '=') {
-                    result = (set1->value.num >= set2->value.num);
+                    result = (set1->is_int && set2->is_int) ? (set1->inum >= set2->inum)
+                                                        : (set1->value.num >= set2->value.num);
                 } else {
-                    result = (set1->value.num > set2->value.num);
+                    result = (set1->is_int && set2->is_int) ? (set1->inum > set2->inum)
+                                                        : (set1->value.num > set2->value.num);
                 }
             }
         }
 
         /* assign result */
         if (result) {
-            set_fill_boolean(set1, 1, ctx);
+            set_fill_boolean(set1, 1);
         } else {
-            set_fill_boolean(set1, 0, ctx);
+            set_fill_boolean(set1, 0);
         }
 
         return;
@@ -4456,24 +5748,87 @@ moveto_op_comp(struct lyxp_set *set1, struct lyxp_set *set2, const char *op, str
     if (((set1->type == LYXP_SET_NODE_SET) || (set1->type == LYXP_SET_EMPTY) || (set1->type == LYXP_SET_STRING))
             && ((set2->type == LYXP_SET_NODE_SET) || (set2->type == LYXP_SET_EMPTY) || (set2->type == LYXP_SET_STRING))
             && ((set1->type != LYXP_SET_STRING) || (set2->type != LYXP_SET_STRING))) {
-        lyxp_set_cast(set1, LYXP_SET_STRING, cur_node, when_must_eval);
-        lyxp_set_cast(set2, LYXP_SET_STRING, cur_node, when_must_eval);
+        set_cast(set1, LYXP_SET_STRING, cur_node, when_must_eval);
+        set_cast(set2, LYXP_SET_STRING, cur_node, when_must_eval);
 
     } else if ((((set1->type == LYXP_SET_NODE_SET) || (set1->type == LYXP_SET_EMPTY) || (set1->type == LYXP_SET_BOOLEAN))
             && ((set2->type == LYXP_SET_NODE_SET) || (set2->type == LYXP_SET_EMPTY) || (set2->type == LYXP_SET_BOOLEAN)))
             || (((op[0] == '=') || (op[0] == '!')) && ((set1->type == LYXP_SET_BOOLEAN) || (set2->type == LYXP_SET_BOOLEAN)))) {
-        lyxp_set_cast(set1, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
-        lyxp_set_cast(set2, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+        set_cast(set1, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+        set_cast(set2, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
 
     } else {
-        lyxp_set_cast(set1, LYXP_SET_NUMBER, cur_node, when_must_eval);
-        lyxp_set_cast(set2, LYXP_SET_NUMBER, cur_node, when_must_eval);
+        set_cast(set1, LYXP_SET_NUMBER, cur_node, when_must_eval);
+        set_cast(set2, LYXP_SET_NUMBER, cur_node, when_must_eval);
     }
 
     /* now we can evaluate */
     moveto_op_comp(set1, set2, op, cur_node, when_must_eval);
 }
 
+/**
+ * @brief Compute a basic operation on two integers. Handles '+', '-', '*', 'div', or 'mod'.
+ *
+ * @param[in] i1 First operand.
+ * @param[in] i2 Second operand.
+ * @param[in] op Operator to process.
+ * @param[out] result Result of the operation.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the result is not an integer,
+ *         it overflows, or it is a negative zero.
+ */
+static int
+moveto_op_math_int(int64_t i1, int64_t i2, const char *op, int64_t *result)
+{
+    switch (op[0]) {
+    /* '+' */
+    case '+':
+        if (((i2 > 0) && (i1 > INT64_MAX - i2)) || ((i2 < 0) && (i1 < INT64_MIN - i2))) {
+            return EXIT_FAILURE;
+        }
+        *result = i1 + i2;
+        break;
+
+    /* '-' */
+    case '-':
+        if (((i2 < 0) && (i1 > INT64_MAX + i2)) || ((i2 > 0) && (i1 < INT64_MIN + i2))) {
+            return EXIT_FAILURE;
+        }
+        *result = i1 - i2;
+        break;
+
+    /* '*' */
+    case '*':
+        if ((i1 > INT32_MAX) || (i1 < INT32_MIN) || (i2 > INT32_MAX) || (i2 < INT32_MIN)
+                || (!i1 && (i2 < 0)) || ((i1 < 0) && !i2)) {
+            return EXIT_FAILURE;
+        }
+        *result = i1 * i2;
+        break;
+
+    /* 'div' */
+    case 'd':
+        if (!i2 || (!i1 && (i2 < 0)) || ((i1 == INT64_MIN) && (i2 == -1)) || (i1 % i2)) {
+            return EXIT_FAILURE;
+        }
+        *result = i1 / i2;
+        break;
+
+    /* 'mod' */
+    case 'm':
+        if (!i2 || ((i1 == INT64_MIN) && (i2 == -1))) {
+            return EXIT_FAILURE;
+        }
+        *result = i1 % i2;
+        break;
+
+    default:
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 /**
  * @brief Move context \p set to the result of a basic operation. Handles '+', '-', unary '-', '*', 'div',
  *        or 'mod'. Result is LYXP_SET_NUMBER. Indirectly context position aware.
@@ -4487,22 +5842,30 @@ static void
 moveto_op_math(struct lyxp_set *set1, struct lyxp_set *set2, const char *op, struct lyd_node *cur_node,
                int when_must_eval)
 {
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
+    int64_t result;
 
     /* unary '-' */
     if (!set2 && (op[0] == '-')) {
-        lyxp_set_cast(set1, LYXP_SET_NUMBER, cur_node, when_must_eval);
-        set1->value.num *= -1;
-        lyxp_set_free(set2, ctx);
+        set_cast(set1, LYXP_SET_NUMBER, cur_node, when_must_eval);
+        if (set1->is_int && set1->inum && (set1->inum != INT64_MIN)) {
+            set_fill_int(set1, -set1->inum);
+        } else {
+            set_fill_number(set1, -set1->value.num);
+        }
         return;
     }
 
     assert(set1 && set2);
 
-    lyxp_set_cast(set1, LYXP_SET_NUMBER, cur_node, when_must_eval);
-    lyxp_set_cast(set2, LYXP_SET_NUMBER, cur_node, when_must_eval);
+    set_cast(set1, LYXP_SET_NUMBER, cur_node, when_must_eval);
+    set_cast(set2, LYXP_SET_NUMBER, cur_node, when_must_eval);
+
+    /* stay exact with integers, if possible */
+    if (set1->is_int && set2->is_int && !moveto_op_math_int(set1->inum, set2->inum, op, &result)) {
+        set_fill_int(set1, result);
+        return;
+    }
+    set1->is_int = 0;
 
     switch (op[0]) {
     /* '+' */
@@ -4524,543 +5887,652 @@ moveto_op_math(struct lyxp_set *set1, struct lyxp_set *set2, const char *op, str
     case 'd':
         set1->value.num /= set2->value.num;
         break;
-
-    /* 'mod' */
-    case 'm':
-        set1->value.num = ((long long)set1->value.num) % ((long long)set2->value.num);
+
+    /* 'mod' */
+    case 'm':
+        set1->value.num = ((long long)set1->value.num) % ((long long)set2->value.num);
+        break;
+
+    default:
+        LOGINT;
+        break;
+    }
+}
+
+/*
+ * dependency functions
+ *
+ * They walk a parsed XPath expression on the schema tree and collect
+ * the schema nodes whose data instances the expression can access.
+ * Schema nodes are stored in the standard sets, which are never sorted.
+ */
+
+/**
+ * @brief Dependency analysis of an expression.
+ */
+struct lyxp_deps {
+    struct lys_node *cur_snode;      /* schema node of the context node */
+    struct lys_node *root;           /* context root, NULL for the whole data tree */
+    enum lyxp_node_type root_type;   /* context root type */
+    struct ly_ctx *ctx;              /* libyang context */
+    struct lyxp_set nodes;           /* collected schema nodes */
+    int imprecise;                   /* whether any node can be accessed */
+    int open;                        /* whether the schema nodes added later can be accessed, too */
+};
+
+/**
+ * @brief Add a schema node into a set, if it is not there yet.
+ *
+ * @param[in] set Set to use.
+ * @param[in] node Schema node to add.
+ * @param[in] node_type Node type of \p node.
+ */
+static void
+deps_set_add(struct lyxp_set *set, struct lys_node *node, enum lyxp_node_type node_type)
+{
+    if ((set->type == LYXP_SET_EMPTY) || (set_dup_node_check(set, node, node_type, -1) == -1)) {
+        set_insert_node(set, node, node_type, set->used);
+    }
+}
+
+/**
+ * @brief Add all the schema nodes from one set into another.
+ *
+ * @param[in] set Set to add to.
+ * @param[in] src Set with the nodes to add.
+ */
+static void
+deps_set_merge(struct lyxp_set *set, struct lyxp_set *src)
+{
+    uint32_t i;
+
+    for (i = 0; i < src->used; ++i) {
+        deps_set_add(set, (struct lys_node *)src->value.nodes[i], src->node_type[i]);
+    }
+}
+
+/**
+ * @brief Empty a schema node set.
+ *
+ * @param[in] set Set to empty.
+ */
+static void
+deps_set_clean(struct lyxp_set *set)
+{
+    if (set->type == LYXP_SET_NODE_SET) {
+        set_nodes_free(set);
+    }
+    memset(set, 0, sizeof *set);
+}
+
+/**
+ * @brief Replace a schema node set with another one, which becomes empty.
+ *
+ * @param[in] set Set to replace.
+ * @param[in] src Set to move into \p set.
+ */
+static void
+deps_set_move(struct lyxp_set *set, struct lyxp_set *src)
+{
+    deps_set_clean(set);
+    memcpy(set, src, sizeof *set);
+    memset(src, 0, sizeof *src);
+}
+
+/**
+ * @brief Get the context root of a schema node, the one moveto_get_root() finds
+ *        for its data instances in when and must evaluation.
+ *
+ * @param[in] cur_snode Schema node of the context node.
+ * @param[out] root_type Root type.
+ *
+ * @return Context root, NULL for the whole data tree.
+ */
+static struct lys_node *
+deps_get_root(struct lys_node *cur_snode, enum lyxp_node_type *root_type)
+{
+    struct lys_node *root, *prev = NULL;
+
+    for (root = cur_snode; root && !(root->nodetype & (LYS_RPC | LYS_NOTIF)); root = lys_parent(root)) {
+        prev = root;
+    }
+
+    if (!root) {
+        *root_type = ((cur_snode->flags & LYS_CONFIG_W) ? LYXP_NODE_ROOT_CONFIG : LYXP_NODE_ROOT_STATE);
+    } else if (root->nodetype == LYS_NOTIF) {
+        *root_type = LYXP_NODE_ROOT_NOTIF;
+    } else if (prev && (prev->nodetype == LYS_OUTPUT)) {
+        *root_type = LYXP_NODE_ROOT_OUTPUT;
+    } else {
+        *root_type = LYXP_NODE_ROOT_RPC;
+    }
+
+    return root;
+}
+
+/**
+ * @brief Check (process) a schema node as a possible data child, schema-only
+ *        nodes are processed transparently. Mirrors moveto_node_check().
+ *
+ * @param[in] node Schema node to check.
+ * @param[in] root_type Context root type.
+ * @param[in,out] set Set to add the data nodes to.
+ */
+static void
+deps_child_check(struct lys_node *node, enum lyxp_node_type root_type, struct lyxp_set *set)
+{
+    struct lys_node *child;
+
+    if ((node->nodetype == LYS_GROUPING)
+            || ((root_type == LYXP_NODE_ROOT_OUTPUT) && (node->nodetype == LYS_INPUT))
+            || ((root_type != LYXP_NODE_ROOT_OUTPUT) && (node->nodetype == LYS_OUTPUT))) {
+        return;
+    }
+
+    if (node->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE | LYS_INPUT | LYS_OUTPUT)) {
+        LY_TREE_FOR(node->child, child) {
+            deps_child_check(child, root_type, set);
+        }
+        return;
+    }
+
+    /* context check */
+    if (((root_type == LYXP_NODE_ROOT_CONFIG) && (node->flags & LYS_CONFIG_R))
+            || ((root_type != LYXP_NODE_ROOT_NOTIF) && (node->nodetype == LYS_NOTIF))
+            || ((root_type != LYXP_NODE_ROOT_RPC) && (node->nodetype == LYS_RPC))) {
+        return;
+    }
+
+    deps_set_add(set, node, LYXP_NODE_ELEM);
+}
+
+/**
+ * @brief Add all the data children of a set item into a set.
+ *
+ * @param[in] node Schema node of the item.
+ * @param[in] node_type Node type of the item.
+ * @param[in] deps Dependency analysis.
+ * @param[in,out] children Set to add the children to.
+ */
+static void
+deps_item_children(struct lys_node *node, enum lyxp_node_type node_type, struct lyxp_deps *deps,
+                   struct lyxp_set *children)
+{
+    struct lys_node *sub;
+    int i;
+
+    switch (node_type) {
+    case LYXP_NODE_ROOT_CONFIG:
+    case LYXP_NODE_ROOT_STATE:
+        /* top-level nodes of all the modules */
+        deps->open = 1;
+        for (i = 0; i < deps->ctx->models.used; ++i) {
+            LY_TREE_FOR(deps->ctx->models.list[i]->data, sub) {
+                deps_child_check(sub, deps->root_type, children);
+            }
+        }
+        break;
+    case LYXP_NODE_ROOT_NOTIF:
+    case LYXP_NODE_ROOT_RPC:
+        deps_child_check(node, deps->root_type, children);
+        break;
+    case LYXP_NODE_ROOT_OUTPUT:
+    case LYXP_NODE_ELEM:
+        /* leaf child is not a data node */
+        if (!(node->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYXML))) {
+            LY_TREE_FOR(node->child, sub) {
+                deps_child_check(sub, deps->root_type, children);
+            }
+        }
         break;
-
     default:
-        LOGINT;
+        /* no other node types in schema sets */
         break;
     }
 }
 
-/* MAY BE REIMPLEMENTED ONCE
- * moveto_schema functions
+/**
+ * @brief Add all the data children of the nodes in a set into another set.
  *
-
-static struct lys_node *
-moveto_schema_get_root(struct lys_node *cur_node)
+ * @param[in] set Set to use.
+ * @param[in] deps Dependency analysis.
+ * @param[in,out] children Set to add the children to.
+ */
+static void
+deps_moveto_child(struct lyxp_set *set, struct lyxp_deps *deps, struct lyxp_set *children)
 {
-    for (; cur_node; cur_node = cur_node->parent) {
-        if (cur_node->nodetype & (LYS_NOTIF | LYS_RPC | LYS_OUTPUT)) {
-            break;
-        }
-    }
+    uint32_t i;
 
-    return cur_node;
+    for (i = 0; i < set->used; ++i) {
+        deps_item_children((struct lys_node *)set->value.nodes[i], set->node_type[i], deps, children);
+    }
 }
 
+/**
+ * @brief Add all the data descendants of the nodes in a set into another (empty) set.
+ *
+ * @param[in] set Set to use.
+ * @param[in] deps Dependency analysis.
+ * @param[out] desc Set to add the descendants to.
+ */
 static void
-moveto_schema_root(struct lyxp_set *set, struct lys_node *cur_node)
+deps_moveto_desc(struct lyxp_set *set, struct lyxp_deps *deps, struct lyxp_set *desc)
 {
-    struct lys_node *root;
-    int is_output;
-
-    if (!set) {
-        return;
-    }
-
-    if (!cur_node) {
-        LOGINT;
-        return;
-    }
+    uint32_t i;
 
-    lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node->module->ctx);
+    deps_moveto_child(set, deps, desc);
 
-    root = moveto_schema_get_root(cur_node, &is_output);
-
-    if (!root) {
-        set_insert_node(set, root, LYXP_NODE_ROOT_TOP, 0);
-    } else if (root->nodetype == LYS_NOTIF) {
-        set_insert_node(set, root, LYXP_NODE_ROOT_NOTIF, 0);
-    } else if (root->nodetype == LYS_RPC) {
-        set_insert_node(set, root, LYXP_NODE_ROOT_RPC, 0);
-    } else {
-        assert(root->nodetype == LYS_OUTPUT);
-        set_insert_node(set, root, LYXP_NODE_ROOT_OUTPUT, 0);
+    /* the set grows while it is being traversed, every node is expanded once */
+    for (i = 0; i < desc->used; ++i) {
+        deps_item_children((struct lys_node *)desc->value.nodes[i], LYXP_NODE_ELEM, deps, desc);
     }
 }
 
+/**
+ * @brief Add the data parents of the nodes in a set into another set.
+ *
+ * @param[in] set Set to use.
+ * @param[in] deps Dependency analysis.
+ * @param[in,out] parents Set to add the parents to.
+ */
 static void
-moveto_schema_node_check(struct lys_node *node, struct lyxp_set *set, uint16_t i, struct lys_node *cur_node,
-                         const char *qname, uint16_t qname_len, struct lys_module *moveto_mod, int *replaced)
+deps_moveto_parent(struct lyxp_set *set, struct lyxp_deps *deps, struct lyxp_set *parents)
 {
-    struct lys_module *cur_mod;
-    struct lys_node *child;
-
-    if (node->nodetype & (LYS_GROUPING | LYS_AUGMENT)) {
-        return;
-    }
-
-    if (node->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE | LYS_INPUT | LYS_OUTPUT)) {
-        LY_TREE_FOR(node->child, child) {
-            moveto_schema_node_check(child, set, i, cur_node, qname, qname_len, moveto_mod, replaced);
-        }
-        return;
-    }
+    uint32_t i;
+    struct lys_node *parent;
 
-    * module check *
-    if (moveto_mod) {
-        cur_mod = node->module;
-        if (cur_mod->type) {
-            cur_mod = ((struct lys_submodule *)cur_mod)->belongsto;
-        }
-        if (cur_mod != moveto_mod) {
-            return;
+    for (i = 0; i < set->used; ++i) {
+        if (set->node_type[i] != LYXP_NODE_ELEM) {
+            /* root does not have a parent */
+            continue;
         }
-    }
 
-    * context check *
-    if ((cur_node->flags & LYS_CONFIG_W) && (node->flags & LYS_CONFIG_R)) {
-        return;
-    }
+        for (parent = lys_parent((struct lys_node *)set->value.nodes[i]);
+             parent && (parent->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE | LYS_INPUT | LYS_OUTPUT));
+             parent = lys_parent(parent));
 
-    * name check *
-    if (((qname[0] == '*') && (qname_len == 1))
-            || (!strncmp(node->name, qname, qname_len) && !node->name[qname_len])) {
-        if (!(*replaced)) {
-            set->value.nodes[i] = (struct lyd_node *)node;
-            set->node_type[i] = LYXP_NODE_ELEM;
-            *replaced = 1;
+        if (!parent || ((deps->root_type == LYXP_NODE_ROOT_OUTPUT) && (parent == deps->root))) {
+            deps_set_add(parents, deps->root, deps->root_type);
         } else {
-            set_insert_node(set, node, LYXP_NODE_ELEM, set->used);
+            deps_set_add(parents, parent, LYXP_NODE_ELEM);
         }
     }
 }
 
-static int
-moveto_schema_node(struct lyxp_set *set, struct lys_node *cur_node, const char *qname, uint16_t qname_len,
-                   uint32_t line)
+/**
+ * @brief Record the nodes in a set as dependencies.
+ *
+ * @param[in] set Set with the accessed nodes.
+ * @param[in] value Whether the values of the nodes are used, which includes all their descendants.
+ * @param[in,out] deps Dependency analysis.
+ */
+static void
+deps_record(struct lyxp_set *set, int value, struct lyxp_deps *deps)
 {
-    uint16_t i, orig_used, j;
-    int replaced, pref_len;
-    struct lys_module *moveto_mod;
-    struct lys_node *sub;
-    struct ly_ctx *ctx;
+    uint32_t i;
+    struct lyxp_set desc;
 
-    if (!set || (set->type == LYXP_SET_EMPTY)) {
-        return EXIT_SUCCESS;
+    for (i = 0; i < set->used; ++i) {
+        if (set->node_type[i] == LYXP_NODE_ELEM) {
+            deps_set_add(&deps->nodes, (struct lys_node *)set->value.nodes[i], LYXP_NODE_ELEM);
+        } else if (value) {
+            /* value of the whole data tree */
+            deps->imprecise = 1;
+            return;
+        }
     }
 
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INOP_1, line, "path operator", print_set_type(set));
-        return -1;
+    if (value) {
+        memset(&desc, 0, sizeof desc);
+        deps_moveto_desc(set, deps, &desc);
+        deps_record(&desc, 0, deps);
+        deps_set_clean(&desc);
     }
+}
 
-    ctx = cur_node->module->ctx;
+static int deps_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_set *ctx_set, struct lyxp_set *result,
+                     struct lyxp_deps *deps);
 
-    * prefix *
-    if (strnchr(qname, ':', qname_len)) {
-        pref_len = strnchr(qname, ':', qname_len) - qname;
-        moveto_mod = moveto_resolve_model(qname, pref_len, ctx, 1);
-        if (!moveto_mod) {
+/**
+ * @brief Walk Predicate* on the schema.
+ *
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in] set Context set of the predicates.
+ * @param[in,out] deps Dependency analysis.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+static int
+deps_predicates(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_set *set, struct lyxp_deps *deps)
+{
+    while ((*exp_idx < exp->used) && (exp->tokens[*exp_idx] == LYXP_TOKEN_BRACK1)) {
+        ++(*exp_idx);
+        if (deps_expr(exp, exp_idx, set, NULL, deps) == -1) {
             return -1;
         }
-        qname += pref_len + 1;
-        qname_len -= pref_len + 1;
-    } else {
-        moveto_mod = NULL;
-    }
-
-    orig_used = set->used;
-    for (i = 0; i < orig_used; ) {
-        replaced = 0;
-
-        if (set->node_type[i] == LYXP_NODE_ROOT_TOP) {
-            for (j = 0; j < ctx->models.used; ++j) {
-                LY_TREE_FOR(ctx->models.list[j]->data, sub) {
-                    * LYS_GROUPING and LYS_USES handled inside *
-                    moveto_schema_node_check(sub, set, i, cur_node, qname, qname_len, moveto_mod, &replaced);
-                }
-            }
-        } else if ((set->node_type[i] == LYXP_NODE_ROOT_NOTIF) || (set->node_type[i] == LYXP_NODE_ROOT_RPC)) {
-            LY_TREE_FOR((struct lys_node *)set->value.nodes[i], sub) {
-                moveto_schema_node_check(sub, set, i, cur_node, qname, qname_len, moveto_mod, &replaced);
-            }
-        } else if ((set->node_type[i] == LYXP_NODE_ROOT_OUTPUT) || (set->node_type[i] == LYXP_NODE_ELEM)) {
-            LY_TREE_FOR(((struct lys_node *)set->value.nodes[i])->child, sub) {
-                moveto_schema_node_check(sub, set, i, cur_node, qname, qname_len, moveto_mod, &replaced);
-            }
-        }
-        * LYXP_NODE_TEXT gets removed *
-
-        if (!replaced) {
-            * no match *
-            set_remove_node(set, i);
-            --orig_used;
-        } else {
-            ++i;
-        }
+        /* ']' */
+        ++(*exp_idx);
     }
 
-    set_sort(set, 1);
-    assert(!set_sorted_dup_node_clean(set));
-
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Walk RelativeLocationPath on the schema, including the '/' or '//' before it, if any.
+ *
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in,out] set Context and result set.
+ * @param[in,out] deps Dependency analysis.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
 static int
-moveto_schema_node_alldesc(struct lyxp_set *set, struct lys_node *cur_node, const char *qname, uint16_t qname_len,
-                           uint32_t line)
+deps_location_path(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_set *set, struct lyxp_deps *deps)
 {
-    uint16_t i;
-    int pref_len, all = 0, replace, match;
-    struct lys_node *next, *elem, *start;
-    struct lys_module *moveto_mod, *cur_mod;
-    struct ly_ctx *ctx;
-
-    if (!set || (set->type == LYXP_SET_EMPTY)) {
-        return EXIT_SUCCESS;
-    }
+    int all_desc, pref_len;
+    uint32_t i, qname_len;
+    const char *qname;
+    struct lys_module *moveto_mod;
+    struct lys_node *node;
+    struct lyxp_set cands, res;
 
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INOP_1, line, "path operator", print_set_type(set));
-        return -1;
-    }
+    memset(&cands, 0, sizeof cands);
+    memset(&res, 0, sizeof res);
 
-    ctx = cur_node->module->ctx;
+    while (1) {
+        all_desc = 0;
+        if (exp->tokens[*exp_idx] == LYXP_TOKEN_OPERATOR_PATH) {
+            all_desc = (exp->tok_len[*exp_idx] == 2);
+            ++(*exp_idx);
 
-    * prefix *
-    if (strnchr(qname, ':', qname_len)) {
-        pref_len = strnchr(qname, ':', qname_len) - qname;
-        moveto_mod = moveto_resolve_model(qname, pref_len, ctx, 1);
-        if (!moveto_mod) {
-            return -1;
+            if ((*exp_idx == exp->used) || ((exp->tokens[*exp_idx] != LYXP_TOKEN_DOT)
+                    && (exp->tokens[*exp_idx] != LYXP_TOKEN_DDOT) && (exp->tokens[*exp_idx] != LYXP_TOKEN_AT)
+                    && (exp->tokens[*exp_idx] != LYXP_TOKEN_NAMETEST) && (exp->tokens[*exp_idx] != LYXP_TOKEN_NODETYPE))) {
+                /* only the root */
+                return EXIT_SUCCESS;
+            }
         }
-        qname += pref_len + 1;
-        qname_len -= pref_len + 1;
-    } else {
-        pref_len = 0;
-    }
 
-    * replace the original nodes (and throw away all text nodes, root nodes are replaced by their children) *
-    if (moveto_schema_node(set, cur_node, "*", 1, line)) {
-        return -1;
-    }
+        if (all_desc && (exp->tokens[*exp_idx] != LYXP_TOKEN_NAMETEST) && (exp->tokens[*exp_idx] != LYXP_TOKEN_AT)
+                && ((exp->tokens[*exp_idx] != LYXP_TOKEN_NODETYPE) || (exp->tok_len[*exp_idx] != 4)
+                || strncmp(&exp->expr[exp->expr_pos[*exp_idx]], "node", 4))) {
+            /* <path>//. == <path>//./., the node itself and all its descendants */
+            deps->open = 1;
+            deps_moveto_desc(set, deps, &res);
+            deps_set_merge(set, &res);
+            deps_set_clean(&res);
+            all_desc = 0;
+        }
 
-    if ((qname_len == 1) && (qname[0] == '*')) {
-        all = 1;
-    }
+        switch (exp->tokens[*exp_idx]) {
+        case LYXP_TOKEN_DOT:
+            ++(*exp_idx);
+            break;
 
-    * this loop traverses all the nodes in the set and addds/keeps only
-     * those that match qname *
-    for (i = 0; i < set->used; ) {
-        * TREE DFS *
-        start = (struct lys_node *)set->value.nodes[i];
-        replace = 0;
-        for (elem = next = start; elem; elem = next) {
-            * it should not be possible to find them here *
-            assert(!(elem->nodetype & (LYS_NOTIF | LYS_RPC)));
+        case LYXP_TOKEN_DDOT:
+            deps_moveto_parent(set, deps, &res);
+            deps_set_move(set, &res);
+            ++(*exp_idx);
+            break;
 
-            * duplicated nodes skipped, context check *
-            if ((elem->nodetype & (LYS_GROUPING | LYS_AUGMENT))
-                    || ((cur_node->flags & LYS_CONFIG_W) && (elem->flags & LYS_CONFIG_R))){
-                goto skip_children;
-            }
+        case LYXP_TOKEN_AT:
+            /* attributes are not schema nodes */
+            ++(*exp_idx);
+            *exp_idx += (exp->tokens[*exp_idx] == LYXP_TOKEN_NODETYPE ? 3 : 1);
+            deps_set_clean(set);
+            break;
 
-            * schema-only (not data) elements are skipped this way *
-            if (elem->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE | LYS_INPUT | LYS_OUTPUT)) {
-                match = 0;
+        case LYXP_TOKEN_NAMETEST:
+        case LYXP_TOKEN_NODETYPE:
+            qname = &exp->expr[exp->expr_pos[*exp_idx]];
+            qname_len = exp->tok_len[*exp_idx];
+            if (exp->tokens[*exp_idx] == LYXP_TOKEN_NODETYPE) {
+                /* '(' ')' */
+                *exp_idx += 3;
+                if ((qname_len == 4) && !strncmp(qname, "text", 4)) {
+                    /* values of the leaves */
+                    for (i = 0; i < set->used; ++i) {
+                        node = (struct lys_node *)set->value.nodes[i];
+                        if ((set->node_type[i] == LYXP_NODE_ELEM) && (node->nodetype & (LYS_LEAF | LYS_LEAFLIST))) {
+                            deps_set_add(&res, node, LYXP_NODE_ELEM);
+                        }
+                    }
+                    deps_set_move(set, &res);
+                    break;
+                }
+                /* node() */
+                qname = "*";
+                qname_len = 1;
             } else {
-                match = 1;
+                ++(*exp_idx);
             }
 
-            * module check *
-            if (pref_len) {
-                cur_mod = elem->module;
-                if (cur_mod->type) {
-                    cur_mod = ((struct lys_submodule *)cur_mod)->belongsto;
-                }
-                if (cur_mod != moveto_mod) {
-                    * no match *
-                    match = 0;
+            /* prefix */
+            if (strnchr(qname, ':', qname_len)) {
+                pref_len = strnchr(qname, ':', qname_len) - qname;
+                moveto_mod = moveto_resolve_model(qname, pref_len, deps->ctx, 1);
+                if (!moveto_mod) {
+                    deps_set_clean(&cands);
+                    return -1;
                 }
+                qname += pref_len + 1;
+                qname_len -= pref_len + 1;
+            } else {
+                moveto_mod = NULL;
             }
 
-            * name check *
-            if (!all && (strncmp(elem->name, qname, qname_len) || elem->name[qname_len])) {
-                * no match *
-                match = 0;
-            }
-
-            if (match && (elem != start)) {
-                if (set_dup_node_check(set, elem, LYXP_NODE_ELEM, i) > -1) {
-                    * we'll process it later *
-                    goto skip_children;
-                } else if (replace) {
-                    set->value.nodes[i] = (struct lyd_node *)elem;
-                    assert(set->node_type[i] == LYXP_NODE_ELEM);
-                    replace = 0;
-                } else {
-                    set_insert_node(set, elem, LYXP_NODE_ELEM, i + 1);
-                    ++i;
-                }
-            } else if (!match && (elem == start)) {
-                * we need to replace a node that is already in the set *
-                replace = 1;
+            if (all_desc) {
+                deps->open = 1;
+                deps_moveto_desc(set, deps, &cands);
+            } else {
+                deps_moveto_child(set, deps, &cands);
             }
 
-            * TREE DFS NEXT ELEM *
-            * select element for the next run - children first *
-            next = elem->child;
-            if (!next) {
-skip_children:
-                * no children, so try siblings, but only if it's not the start,
-                 * that is considered to be the root and it's siblings are not traversed *
-                if (elem != start) {
-                    next = elem->next;
-                } else {
-                    break;
-                }
-            }
-            while (!next) {
-                * no siblings, go back through the parents *
-                if (elem->parent == start) {
-                    * we are done, no next element to process *
-                    break;
+            for (i = 0; i < cands.used; ++i) {
+                node = (struct lys_node *)cands.value.nodes[i];
+                if (moveto_mod && (lys_node_module(node) != moveto_mod)) {
+                    continue;
                 }
-                * parent is already processed, go to its sibling *
-                elem = elem->parent;
-                * this was an augment, behave accordingly *
-                if (elem->nodetype == LYS_AUGMENT) {
-                    elem = ((struct lys_node_augment *)elem)->target;
+                if (((qname_len == 1) && (qname[0] == '*'))
+                        || (!strncmp(node->name, qname, qname_len) && !node->name[qname_len])) {
+                    deps_set_add(&res, node, LYXP_NODE_ELEM);
                 }
-                next = elem->next;
             }
-        }
-
-        if (replace) {
-            set_remove_node(set, i);
-        } else {
-            ++i;
-        }
-    }
-
-    set_sort(set, 1);
-    assert(!set_sorted_dup_node_clean(set));
-
-    return EXIT_SUCCESS;
-}
-
-static int
-moveto_schema_union(struct lyxp_set *set1, struct lyxp_set *set2, uint32_t line)
-{
-    if (((set1->type != LYXP_SET_NODE_SET) && (set1->type != LYXP_SET_EMPTY))
-            || ((set2->type != LYXP_SET_NODE_SET) && (set2->type != LYXP_SET_EMPTY))) {
-        LOGVAL(LYE_XPATH_INOP_2, line, "union", print_set_type(set1), print_set_type(set2));
-        return -1;
-    }
-
-    * set2 is empty or both set1 and set2 *
-    if (set2->type == LYXP_SET_EMPTY) {
-        return EXIT_SUCCESS;
-    }
-
-    if (set1->type == LYXP_SET_EMPTY) {
-        memcpy(set1, set2, sizeof *set1);
-        * dynamic memory belongs to set1 now, do not free *
-        set2->type = LYXP_SET_EMPTY;
-        return EXIT_SUCCESS;
-    }
-
-    * remove all other nodes *
-    if (set1->pos || set2->pos) {
-        assert(set1->pos && set2->pos);
-
-        if (set1->pos > 1) {
-            set1->value.nodes[0] = set1->value.nodes[set1->pos - 1];
-            set1->node_type[0] = set1->node_type[set1->pos - 1];
-        }
-        set1->used = 1;
-
-        if (set2->pos > 1) {
-            set2->value.nodes[0] = set2->value.nodes[set2->pos - 1];
-            set2->node_type[0] = set2->node_type[set2->pos - 1];
-        }
-        set2->used = 1;
-    }
+            deps_set_clean(&cands);
+            deps_set_move(set, &res);
+            break;
 
-    * make sure there is enough memory *
-    if (set1->size - set1->used < set2->used) {
-        set1->size = set1->used + set2->used;
-        set1->value.nodes = realloc(set1->value.nodes, set1->size * sizeof *set1->value.nodes);
-        set1->node_type = realloc(set1->node_type, set1->size * sizeof *set1->node_type);
-    }
+        default:
+            LOGINT;
+            return -1;
+        }
 
-    * copy nodes *
-    memcpy(&set1->value.nodes[set1->used], set2->value.nodes, set2->used * sizeof *set2->value.nodes);
-    memcpy(&set1->node_type[set1->used], set2->node_type, set2->used * sizeof *set2->node_type);
-    set1->used += set2->used;
+        deps_record(set, 0, deps);
 
-    * empty set2, NULL ctx is fine *
-    lyxp_set_cast(set2, LYXP_SET_EMPTY, NULL);
+        if (deps_predicates(exp, exp_idx, set, deps)) {
+            return -1;
+        }
 
-    * sort, remove duplicates *
-    set_sort(set1, 1);
-    set_sorted_dup_node_clean(set1);
+        if ((*exp_idx == exp->used) || (exp->tokens[*exp_idx] != LYXP_TOKEN_OPERATOR_PATH)) {
+            break;
+        }
+    }
 
     return EXIT_SUCCESS;
 }
 
-static void
-moveto_schema_self_check(struct lys_node *node, struct lyxp_set *set, uint16_t i, struct lys_node *cur_node,
-                         uint16_t *cur_i)
+/**
+ * @brief Walk FunctionCall on the schema.
+ *
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in] ctx_set Context set.
+ * @param[out] result Set to add the result node set to.
+ * @param[in,out] deps Dependency analysis.
+ *
+ * @return EXIT_SUCCESS if the result is a node set, EXIT_FAILURE if it is not, -1 on error.
+ */
+static int
+deps_function_call(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_set *ctx_set, struct lyxp_set *result,
+                   struct lyxp_deps *deps)
 {
-    struct lys_node *child;
+    const char *name;
+    uint32_t name_len, arg_count = 0;
 
-    if (node->nodetype & (LYS_GROUPING | LYS_AUGMENT)) {
-        return;
-    }
+    name = &exp->expr[exp->expr_pos[*exp_idx]];
+    name_len = exp->tok_len[*exp_idx];
 
-    if (node->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE | LYS_INPUT | LYS_OUTPUT)) {
-        LY_TREE_FOR(node->child, child) {
-            moveto_schema_self_check(child, set, i, cur_node, cur_i);
+    /* '(' */
+    *exp_idx += 2;
+    while (exp->tokens[*exp_idx] != LYXP_TOKEN_PAR2) {
+        if (exp->tokens[*exp_idx] == LYXP_TOKEN_COMMA) {
+            ++(*exp_idx);
         }
-        return;
+        if (deps_expr(exp, exp_idx, ctx_set, NULL, deps) == -1) {
+            return -1;
+        }
+        ++arg_count;
     }
+    /* ')' */
+    ++(*exp_idx);
 
-    if ((cur_node->flags & LYS_CONFIG_W) && (node->flags & LYS_CONFIG_R)) {
-        return;
+    if ((name_len == 7) && !strncmp(name, "current", 7)) {
+        deps_set_add(result, deps->cur_snode, LYXP_NODE_ELEM);
+        return EXIT_SUCCESS;
     }
 
-    if (set_dup_node_check(set, node, LYXP_NODE_ELEM, -1) == -1) {
-        set_insert_node(set, node, LYXP_NODE_ELEM, i + (*cur_i) + 1);
-        ++cur_i;
+    if (!arg_count && !((name_len == 4) && (!strncmp(name, "true", 4) || !strncmp(name, "last", 4)))
+            && !((name_len == 5) && !strncmp(name, "false", 5))
+            && !((name_len == 8) && !strncmp(name, "position", 8))) {
+        /* the function works with the value of the context node */
+        deps_record(ctx_set, 1, deps);
     }
+
+    return EXIT_FAILURE;
 }
 
+/**
+ * @brief Walk Expr on the schema. The walk ends with the end of the expression
+ *        or on an unmatched ']', ')', or ','.
+ *
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp.
+ * @param[in] ctx_set Context set.
+ * @param[out] result Optional set to add the result node set to, if the result is a node set.
+ * @param[in,out] deps Dependency analysis.
+ *
+ * @return EXIT_SUCCESS if the result is a node set, EXIT_FAILURE if it is not, -1 on error.
+ */
 static int
-moveto_schema_self(struct lyxp_set *set, struct lys_node *cur_node, int all_desc, uint32_t line)
+deps_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_set *ctx_set, struct lyxp_set *result,
+          struct lyxp_deps *deps)
 {
-    struct lys_node *sub;
-    struct ly_ctx *ctx;
-    uint16_t i, cur_i, j;
-
-    if (!set || (set->type == LYXP_SET_EMPTY)) {
-        return EXIT_SUCCESS;
-    }
+    int rc, is_set = 1, primary;
+    struct lyxp_set op;
 
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INOP_1, line, "path operator", print_set_type(set));
-        return -1;
-    }
+    memset(&op, 0, sizeof op);
 
-    * nothing to do *
-    if (!all_desc) {
-        return EXIT_SUCCESS;
-    }
+    while (*exp_idx < exp->used) {
+        primary = 0;
+        switch (exp->tokens[*exp_idx]) {
+        case LYXP_TOKEN_BRACK2:
+        case LYXP_TOKEN_PAR2:
+        case LYXP_TOKEN_COMMA:
+            /* end of this Expr */
+            goto finish;
 
-    * add all the children, they get added recursively *
-    for (i = 0; i < set->used; ++i) {
-        cur_i = 0;
+        case LYXP_TOKEN_OPERATOR_UNI:
+            ++(*exp_idx);
+            continue;
 
-        if (set->node_type[i] == LYXP_NODE_ROOT_TOP) {
-            for (j = 0; j < ctx->models.used; ++j) {
-                LY_TREE_FOR(ctx->models.list[j]->data, sub) {
-                    * LYS_GROUPING and LYS_USES handled inside *
-                    moveto_schema_self_check(sub, set, i, cur_node, &cur_i);
-                }
-            }
-        } else if ((set->node_type[i] == LYXP_NODE_ROOT_NOTIF) || (set->node_type[i] == LYXP_NODE_ROOT_RPC)) {
-            LY_TREE_FOR((struct lys_node *)set->value.nodes[i], sub) {
-                moveto_schema_self_check(sub, set, i, cur_node, &cur_i);
-            }
-        } else if ((set->node_type[i] == LYXP_NODE_ROOT_OUTPUT) || (set->node_type[i] == LYXP_NODE_ELEM)) {
-            if (((struct lys_node *)set->value.nodes[i])->nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
-                sub = (struct lys_node *)set->value.nodes[i];
-                if (set_dup_node_check(set, sub, LYXP_NODE_TEXT, -1) == -1) {
-                    set_insert_node(set, sub, LYXP_NODE_TEXT, i + 1);
-                }
-            } else { * LYS_ANYXML can go here, it has no children anyway *
-                LY_TREE_FOR(((struct lys_node *)set->value.nodes[i])->child, sub) {
-                    moveto_schema_self_check(sub, set, i, cur_node, &cur_i);
-                }
-            }
-        }
-    }
+        case LYXP_TOKEN_OPERATOR_LOG:
+        case LYXP_TOKEN_OPERATOR_COMP:
+        case LYXP_TOKEN_OPERATOR_MATH:
+        case LYXP_TOKEN_LITERAL:
+        case LYXP_TOKEN_NUMBER:
+            is_set = 0;
+            ++(*exp_idx);
+            continue;
 
-    set_sort(set, 1);
-    assert(!set_sorted_dup_node_clean(set));
-    return EXIT_SUCCESS;
-}
+        case LYXP_TOKEN_PAR1:
+            ++(*exp_idx);
+            rc = deps_expr(exp, exp_idx, ctx_set, &op, deps);
+            /* ')' */
+            ++(*exp_idx);
+            primary = 1;
+            break;
 
-static int
-moveto_schema_parent(struct lyxp_set *set, struct lys_node *cur_node, int all_desc, uint32_t line)
-{
-    uint16_t i;
-    int is_output;
-    struct lys_node *new_node, *root;
+        case LYXP_TOKEN_FUNCNAME:
+            rc = deps_function_call(exp, exp_idx, ctx_set, &op, deps);
+            primary = 1;
+            break;
 
-    if (!set || (set->type == LYXP_SET_EMPTY)) {
-        return EXIT_SUCCESS;
-    }
+        case LYXP_TOKEN_OPERATOR_PATH:
+            deps_set_add(&op, deps->root, deps->root_type);
+            rc = deps_location_path(exp, exp_idx, &op, deps);
+            break;
 
-    if (set->type != LYXP_SET_NODE_SET) {
-        LOGVAL(LYE_XPATH_INOP_1, line, "path operator", print_set_type(set));
-        return -1;
-    }
+        case LYXP_TOKEN_DOT:
+        case LYXP_TOKEN_DDOT:
+        case LYXP_TOKEN_AT:
+        case LYXP_TOKEN_NAMETEST:
+        case LYXP_TOKEN_NODETYPE:
+            deps_set_merge(&op, ctx_set);
+            rc = deps_location_path(exp, exp_idx, &op, deps);
+            break;
 
-    if (all_desc) {
-        * <path>//.. == <path>//./.. *
-        if (moveto_schema_self(set, cur_node, 1, line)) {
-            return -1;
+        default:
+            LOGINT;
+            rc = -1;
+            break;
         }
-    }
-
-    for (i = 0; i < set->used; ) {
-        if ((set->node_type[i] == LYXP_NODE_ROOT_TOP) || (set->node_type[i] == LYXP_NODE_ROOT_NOTIF)
-                || (set->node_type[i] == LYXP_NODE_ROOT_RPC) || (set->node_type[i] == LYXP_NODE_ROOT_OUTPUT)) {
-            * root does not have a parent *
-            set_remove_node(set, i);
-            continue;
-        } else if (set->node_type[i] == LYXP_NODE_ELEM) {
-            new_node = lys_parent((struct lys_node *)set->value.nodes[i]);
-        } else { * LYXP_NODE_TEXT *
-            set->node_type[i] = LYXP_NODE_ELEM;
-            continue;
+        if (rc == -1) {
+            goto error;
         }
 
-        * check for duplicate *
-        if ((set_dup_node_check(set, new_node, LYXP_NODE_ELEM, -1) > -1)
-                || (!new_node && (set_dup_node_check(set, new_node, LYXP_NODE_ROOT, -1) > -1))) {
-            set_remove_node(set, i);
-            continue;
+        if (primary && (*exp_idx < exp->used) && ((exp->tokens[*exp_idx] == LYXP_TOKEN_BRACK1)
+                || (exp->tokens[*exp_idx] == LYXP_TOKEN_OPERATOR_PATH))) {
+            /* filter expression */
+            if (rc == EXIT_FAILURE) {
+                /* not a node set, the result is unknown */
+                deps->imprecise = 1;
+                deps_set_clean(&op);
+            }
+            if (deps_predicates(exp, exp_idx, &op, deps)) {
+                goto error;
+            }
+            if ((*exp_idx < exp->used) && (exp->tokens[*exp_idx] == LYXP_TOKEN_OPERATOR_PATH)) {
+                if (deps_location_path(exp, exp_idx, &op, deps)) {
+                    goto error;
+                }
+            }
+            rc = EXIT_SUCCESS;
         }
 
-        * update it (but first decide what kind of root it is) *
-        root = moveto_schema_get_root(cur_node);
-        if (root == (struct lys_node *)set->value.nodes[i]) {
-            if (((struct lys_node *)set->value.nodes[i])->nodetype == LYS_NOTIF) {
-                set->node_type[i] = LYXP_NODE_ROOT_NOTIF;
-            } else {
-                assert(((struct lys_node *)set->value.nodes[i])->nodetype == LYS_RPC);
-                set->node_type[i] = LYXP_NODE_ROOT_RPC;
-            }
-        } else if (!new_node) {
-            assert(!root);
-            set->node_type[i] = LYXP_NODE_ROOT_TOP;
-            set->value.nodes[i] = NULL;
-        } else if (new_node->nodetype == LYS_OUTPUT) {
-            assert(root && root->nodetype == LYS_OUTPUT);
-            set->node_type[i] = LYXP_NODE_ROOT_OUTPUT;
-            set->value.nodes[i] = (struct lyd_node *)new_node;
+        if (rc == EXIT_FAILURE) {
+            is_set = 0;
         } else {
-            set->node_type[i] = LYXP_NODE_ELEM;
-            set->value.nodes[i] = (struct lyd_node *)new_node;
+            deps_record(&op, 1, deps);
+            if (result) {
+                deps_set_merge(result, &op);
+            }
         }
+        deps_set_clean(&op);
+    }
 
-        ++i;
+finish:
+    if (!is_set && result) {
+        deps_set_clean(result);
     }
+    return (is_set ? EXIT_SUCCESS : EXIT_FAILURE);
 
-    set_sort(set, 1);
-    assert(!set_sorted_dup_node_clean(set));
-    return EXIT_SUCCESS;
+error:
+    deps_set_clean(&op);
+    return -1;
 }
 
-*/
-
 /*
  * eval functions
  *
@@ -5073,18 +6545,17 @@ moveto_schema_parent(struct lyxp_set *set, struct lys_node *cur_node, int all_de
  * @param[in] exp Parsed XPath expression.
  * @param[in] exp_idx Position in the expression \p exp.
  * @param[in,out] set Context and result set. On NULL the rule is only parsed.
- * @param[in] ctx libyang context with the dictionary.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static void
-eval_literal(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyxp_set *set, struct ly_ctx *ctx)
+eval_literal(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_set *set)
 {
     if (set) {
         if (exp->tok_len[*exp_idx] == 2) {
-            set_fill_string(set, "", 0, ctx);
+            set_fill_string(set, "", 0);
         } else {
-            set_fill_string(set, &exp->expr[exp->expr_pos[*exp_idx] + 1], exp->tok_len[*exp_idx] - 2, ctx);
+            set_fill_string(set, &exp->expr[exp->expr_pos[*exp_idx] + 1], exp->tok_len[*exp_idx] - 2);
         }
     }
     LOGDBG("XPATH: %-27s %s %s[%u]", __func__, (set ? "parsed" : "skipped"),
@@ -5109,7 +6580,7 @@ eval_literal(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyxp_set *set, str
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_node_test(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, int attr_axis, int all_desc,
+eval_node_test(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, int attr_axis, int all_desc,
                struct lyxp_set *set, int when_must_eval, uint32_t line)
 {
     int rc = 0;
@@ -5179,6 +6650,188 @@ eval_node_test(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_no
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Find the key of a key predicate condition in a list instance.
+ *
+ * @param[in] node List instance.
+ * @param[in] cond Key condition.
+ *
+ * @return Key data node, NULL if the instance has none.
+ */
+static struct lyd_node *
+eval_predicate_key_node(struct lyd_node *node, const struct lyxp_key_cond *cond)
+{
+    struct lyd_node *child;
+    uint8_t i;
+
+    /* the keys are usually the first children in the order of their definition */
+    for (i = 0, child = node->child; child && (i < cond->key_idx); ++i, child = child->next);
+    if (child && (child->schema == (struct lys_node *)cond->key)) {
+        return child;
+    }
+
+    /* keys out of order, for example in an edit */
+    LY_TREE_FOR(node->child, child) {
+        if (child->schema == (struct lys_node *)cond->key) {
+            return child;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Evaluate a list key predicate (see reparse_eq_predicates()) directly by comparing the key values
+ *        of every list instance in \p set. Context position aware.
+ *
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] exp_idx Position in the expression \p exp, the first token after '['.
+ * @param[in] cond_count Number of the conditions of the predicate.
+ * @param[in] cur_node Original context node.
+ * @param[in,out] set Context and result set.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the predicate must be evaluated generally
+ *         (\p set was not modified), -1 on error.
+ */
+static int
+eval_predicate_keys(struct lyxp_expr *exp, uint32_t exp_idx, uint8_t cond_count, struct lyd_node *cur_node,
+                    struct lyxp_set *set, int when_must_eval)
+{
+    struct lys_node_list *slist;
+    struct lys_node_leaf *key;
+    struct lyxp_key_cond *conds;
+    struct lyd_node *node, *child;
+    enum lyxp_node_type root_type;
+    const char *name, *mod_name, *value_str;
+    char *ptr;
+    uint32_t i, j, k, name_idx, val_idx, name_len, pref_len, pos = 0;
+    int match;
+
+    /* all the nodes must be instances of the same list */
+    for (i = 0; i < set->used; ++i) {
+        if ((set->node_type[i] != LYXP_NODE_ELEM) || (set->value.nodes[i]->schema != set->value.nodes[0]->schema)) {
+            return EXIT_FAILURE;
+        }
+    }
+    if (set->value.nodes[0]->schema->nodetype != LYS_LIST) {
+        return EXIT_FAILURE;
+    }
+    slist = (struct lys_node_list *)set->value.nodes[0]->schema;
+
+    conds = malloc(cond_count * sizeof *conds);
+    if (!conds) {
+        LOGMEM;
+        return -1;
+    }
+
+    /* map the conditions to the keys */
+    for (k = 0; k < cond_count; ++k, exp_idx += 4) {
+        if (exp->tokens[exp_idx] == LYXP_TOKEN_NAMETEST) {
+            name_idx = exp_idx;
+            val_idx = exp_idx + 2;
+        } else {
+            name_idx = exp_idx + 2;
+            val_idx = exp_idx;
+        }
+
+        name = &exp->expr[exp->expr_pos[name_idx]];
+        name_len = exp->tok_len[name_idx];
+        mod_name = NULL;
+        pref_len = 0;
+        if ((ptr = strnchr(name, ':', name_len))) {
+            mod_name = name;
+            pref_len = ptr - name;
+            name += pref_len + 1;
+            name_len -= pref_len + 1;
+        }
+
+        for (j = 0; j < slist->keys_size; ++j) {
+            key = slist->keys[j];
+            if (strncmp(key->name, name, name_len) || key->name[name_len]) {
+                continue;
+            }
+            if (mod_name && (strncmp(lys_node_module((struct lys_node *)key)->name, mod_name, pref_len)
+                    || lys_node_module((struct lys_node *)key)->name[pref_len])) {
+                continue;
+            }
+            break;
+        }
+        if (j == slist->keys_size) {
+            /* not a key, also the generic evaluation reports an unknown module */
+            free(conds);
+            return EXIT_FAILURE;
+        }
+        conds[k].key = key;
+        conds[k].key_idx = j;
+
+        if (exp->tokens[val_idx] == LYXP_TOKEN_LITERAL) {
+            /* skip the quotes */
+            conds[k].value = &exp->expr[exp->expr_pos[val_idx] + 1];
+            conds[k].value_len = exp->tok_len[val_idx] - 2;
+        } else {
+            conds[k].value = NULL;
+            errno = 0;
+            conds[k].num = strtold(&exp->expr[exp->expr_pos[val_idx]], &ptr);
+            if (errno || (ptr - &exp->expr[exp->expr_pos[val_idx]] != exp->tok_len[val_idx])) {
+                free(conds);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    moveto_get_root(cur_node, when_must_eval, &root_type);
+
+    /* filter the list instances, the order is kept */
+    for (i = 0, j = 0; i < set->used; ++i) {
+        node = set->value.nodes[i];
+
+        match = 1;
+        for (k = 0; match && (k < cond_count); ++k) {
+            child = eval_predicate_key_node(node, &conds[k]);
+            if (!child || ((root_type == LYXP_NODE_ROOT_CONFIG) && (child->schema->flags & LYS_CONFIG_R))) {
+                /* an empty node-set is not equal to anything */
+                match = 0;
+                break;
+            }
+
+            value_str = lyd_value_str((struct lyd_node_leaf_list *)child);
+            if (!value_str) {
+                value_str = "";
+            }
+
+            if (conds[k].value) {
+                match = !strncmp(value_str, conds[k].value, conds[k].value_len) && !value_str[conds[k].value_len];
+            } else {
+                match = (cast_string_to_number(value_str) == conds[k].num);
+            }
+        }
+
+        if (match) {
+            if (set->pos == i + 1) {
+                pos = j + 1;
+            }
+            set->value.nodes[j] = set->value.nodes[i];
+            set->node_type[j] = set->node_type[i];
+            ++j;
+        }
+    }
+    free(conds);
+
+    if (!j || (set->pos && !pos)) {
+        /* no nodes left or the context node was removed, this changes it to LYXP_SET_EMPTY */
+        set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+        memset(set, 0, sizeof *set);
+    } else if (j < set->used) {
+        set->used = j;
+        set->pos = pos;
+        /* rebuilt when needed */
+        set_hash_free(set);
+    }
+
+    return EXIT_SUCCESS;
+}
+
 /**
  * @brief Evaluate Predicate. Logs directly on error.
  *
@@ -5194,91 +6847,63 @@ eval_node_test(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_no
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_predicate(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_predicate(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                int when_must_eval, uint32_t line)
 {
-    uint16_t i, j, orig_i, orig_exp, brack2_exp;
-    uint8_t **pred_repeat, rep_size;
+    uint32_t i, orig_i, orig_exp;
+    uint8_t cond_count;
     struct lyxp_set *set2, *orig_set;
-    struct ly_ctx *ctx;
+    struct lyxp_scratch_mark mark;
+    int ret;
 
-    ctx = cur_node->schema->module->ctx;
+    cond_count = (exp->eq_pred ? exp->eq_pred[*exp_idx] : 0);
 
     /* '[' */
     LOGDBG("XPATH: %-27s %s %s[%u]", __func__, (set ? "parsed" : "skipped"),
            print_token(exp->tokens[*exp_idx]), exp->expr_pos[*exp_idx]);
     ++(*exp_idx);
 
-    if (!set) {
-        if (eval_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
+    ret = EXIT_FAILURE;
+    if (set && (set->type == LYXP_SET_NODE_SET) && cond_count) {
+        ret = eval_predicate_keys(exp, *exp_idx, cond_count, cur_node, set, when_must_eval);
+        if (ret == -1) {
             return -1;
         }
-    } else if (set->type == LYXP_SET_NODE_SET) {
-        orig_set = set_copy(set, ctx);
-        orig_exp = *exp_idx;
-
-        /* find the predicate end */
-        for (brack2_exp = orig_exp; exp->tokens[brack2_exp] != LYXP_TOKEN_BRACK2; ++brack2_exp);
+    }
 
-        /* copy predicate repeats, since they get deleted each time (probably not an ideal solution) */
-        pred_repeat = calloc(brack2_exp - orig_exp, sizeof *pred_repeat);
-        if (!pred_repeat) {
-            LOGMEM;
-            lyxp_set_free(orig_set, ctx);
+    if (!ret) {
+        /* list key predicate evaluated, move to ']' */
+        *exp_idx += cond_count * 4 - 1;
+    } else if (!set) {
+        if (eval_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
             return -1;
         }
-        for (j = 0; j < brack2_exp - orig_exp; ++j) {
-            if (exp->repeat[orig_exp + j]) {
-                for (rep_size = 0; exp->repeat[orig_exp + j][rep_size]; ++rep_size);
-                ++rep_size;
-                pred_repeat[j] = malloc(rep_size * sizeof **pred_repeat);
-                if (!pred_repeat[j]) {
-                    LOGMEM;
-                    for (i = 0; i < j; ++i) {
-                        free(pred_repeat[j]);
-                    }
-                    free(pred_repeat);
-                    lyxp_set_free(orig_set, ctx);
-                    return -1;
-                }
-                memcpy(pred_repeat[j], exp->repeat[orig_exp + j], rep_size * sizeof **pred_repeat);
-            }
-        }
+    } else if (set->type == LYXP_SET_NODE_SET) {
+        orig_set = set_copy(set);
+        orig_exp = *exp_idx;
+        scratch_mark(&mark);
 
         i = 0;
         for (orig_i = 0; orig_i < orig_set->used; ++orig_i) {
-            set2 = set_copy(orig_set, ctx);
+            set2 = set_copy(orig_set);
             set2->pos = orig_i + 1;
             *exp_idx = orig_exp;
 
-            /* replace repeats */
-            for (j = 0; j < brack2_exp - orig_exp; ++j) {
-                if (pred_repeat[j]) {
-                    for (rep_size = 0; pred_repeat[j][rep_size]; ++rep_size);
-                    ++rep_size;
-                    memcpy(exp->repeat[orig_exp + j], pred_repeat[j], rep_size * sizeof **pred_repeat);
-                }
-            }
-
             if (eval_expr(exp, exp_idx, cur_node, set2, when_must_eval, line)) {
-                for (j = 0; j < brack2_exp - orig_exp; ++j) {
-                    free(pred_repeat[j]);
-                }
-                free(pred_repeat);
-                lyxp_set_free(set2, ctx);
-                lyxp_set_free(orig_set, ctx);
+                set_free(set2);
+                set_free(orig_set);
                 return -1;
             }
 
             /* number is a position */
             if (set2->type == LYXP_SET_NUMBER) {
                 if ((long long)set2->value.num == orig_i + 1) {
-                    set2->value.num = 1;
+                    set_fill_number(set2, 1);
                 } else {
-                    set2->value.num = 0;
+                    set_fill_number(set2, 0);
                 }
             }
-            lyxp_set_cast(set2, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+            set_cast(set2, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
 
             /* predicate satisfied or not? */
             if (set2->value.bool) {
@@ -5286,29 +6911,26 @@ eval_predicate(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_no
             } else {
                 set_remove_node(set, i);
             }
-            lyxp_set_free(set2, ctx);
-        }
+            set_free(set2);
 
-        /* free predicate repeats */
-        for (j = 0; j < brack2_exp - orig_exp; ++j) {
-            free(pred_repeat[j]);
+            /* no string of this context node is needed anymore */
+            scratch_rewind(&mark);
         }
-        free(pred_repeat);
 
-        lyxp_set_free(orig_set, ctx);
+        set_free(orig_set);
     } else {
-        set2 = set_copy(set, ctx);
+        set2 = set_copy(set);
 
         if (eval_expr(exp, exp_idx, cur_node, set2, when_must_eval, line)) {
-            lyxp_set_free(set2, ctx);
+            set_free(set2);
             return -1;
         }
 
-        lyxp_set_cast(set2, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+        set_cast(set2, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
         if (!set2->value.bool) {
-            lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
         }
-        lyxp_set_free(set2, ctx);
+        set_free(set2);
     }
 
     /* ']' */
@@ -5336,7 +6958,7 @@ eval_predicate(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_no
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on forward reference, -1 on error.
  */
 static int
-eval_relative_location_path(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, int all_desc,
+eval_relative_location_path(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, int all_desc,
                             struct lyxp_set *set, int when_must_eval, uint32_t line)
 {
     int attr_axis;
@@ -5420,7 +7042,7 @@ step:
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_absolute_location_path(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node,
+eval_absolute_location_path(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node,
                             struct lyxp_set *set, int when_must_eval, uint32_t line)
 {
     int all_desc;
@@ -5485,12 +7107,12 @@ eval_absolute_location_path(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_function_call(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_function_call(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                    int when_must_eval, uint32_t line)
 {
     int rc = EXIT_FAILURE;
-    int (*xpath_func)(struct lyxp_set *, uint16_t, struct lyd_node *, struct lyxp_set *, int, uint32_t) = NULL;
-    uint16_t arg_count = 0, i;
+    int (*xpath_func)(struct lyxp_set *, uint32_t, struct lyd_node *, struct lyxp_set *, int, uint32_t) = NULL;
+    uint32_t arg_count = 0, i;
     struct lyxp_set *args = NULL;
 
     if (set) {
@@ -5654,7 +7276,7 @@ eval_function_call(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
 
 cleanup:
     for (i = 0; i < arg_count; ++i) {
-        lyxp_set_cast(&args[i], LYXP_SET_EMPTY, cur_node, when_must_eval);
+        set_cast(&args[i], LYXP_SET_EMPTY, cur_node, when_must_eval);
     }
     free(args);
 
@@ -5666,19 +7288,21 @@ cleanup:
  *
  * @param[in] exp Parsed XPath expression.
  * @param[in] exp_idx Position in the expression \p exp.
- * @param[in] any_node Any node from the data.
  * @param[in,out] set Context and result set. On NULL the rule is only parsed.
  * @param[in] line Line in the input file.
  *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_number(struct lyxp_expr *exp, uint16_t *exp_idx, struct ly_ctx *ctx, struct lyxp_set *set, uint32_t line)
+eval_number(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyxp_set *set, uint32_t line)
 {
     long double num;
+    int64_t inum;
     char *endptr;
 
-    if (set) {
+    if (set && !cast_string_to_int(&exp->expr[exp->expr_pos[*exp_idx]], exp->tok_len[*exp_idx], &inum)) {
+        set_fill_int(set, inum);
+    } else if (set) {
         errno = 0;
         num = strtold(&exp->expr[exp->expr_pos[*exp_idx]], &endptr);
         if (errno) {
@@ -5691,7 +7315,7 @@ eval_number(struct lyxp_expr *exp, uint16_t *exp_idx, struct ly_ctx *ctx, struct
             return -1;
         }
 
-        set_fill_number(set, num, ctx);
+        set_fill_number(set, num);
     }
 
     LOGDBG("XPATH: %-27s %s %s[%u]", __func__, (set ? "parsed" : "skipped"),
@@ -5719,13 +7343,10 @@ eval_number(struct lyxp_expr *exp, uint16_t *exp_idx, struct ly_ctx *ctx, struct
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_path_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_path_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                int when_must_eval, uint32_t line)
 {
     int all_desc;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     switch (exp->tokens[*exp_idx]) {
     case LYXP_TOKEN_PAR1:
@@ -5778,14 +7399,14 @@ eval_path_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_no
 
     case LYXP_TOKEN_LITERAL:
         /* Literal */
-        eval_literal(exp, exp_idx, set, ctx);
+        eval_literal(exp, exp_idx, set);
 
         goto predicate;
         break;
 
     case LYXP_TOKEN_NUMBER:
         /* Number */
-        if (eval_number(exp, exp_idx, ctx, set, line)) {
+        if (eval_number(exp, exp_idx, set, line)) {
             return -1;
         }
 
@@ -5847,15 +7468,12 @@ predicate:
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_unary_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_unary_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                 int when_must_eval, uint32_t line)
 {
     int unary_minus;
-    uint16_t op_exp;
+    uint32_t op_exp;
     struct lyxp_set orig_set, set2;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     /* ('-')* */
     unary_minus = -1;
@@ -5875,18 +7493,15 @@ eval_unary_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_n
     orig_set.type = LYXP_SET_EMPTY;
     set2.type = LYXP_SET_EMPTY;
 
-    op_exp = exp_repeat_peek(exp, *exp_idx);
-    if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_UNI)) {
+    op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_UNI, NULL, 0);
+    if (op_exp) {
         /* there is an operator */
-        exp_repeat_pop(exp, *exp_idx);
-        set_fill_set(&orig_set, set, ctx);
-    } else {
-        op_exp = 0;
+        set_fill_set(&orig_set, set);
     }
 
     /* PathExpr */
     if (eval_path_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-        lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+        set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
         return -1;
     }
 
@@ -5896,13 +7511,7 @@ eval_unary_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_n
                print_token(exp->tokens[*exp_idx]), exp->expr_pos[*exp_idx]);
         ++(*exp_idx);
 
-        op_exp = exp_repeat_peek(exp, *exp_idx);
-        if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_UNI)) {
-            /* there is another operator */
-            exp_repeat_pop(exp, *exp_idx);
-        } else {
-            op_exp = 0;
-        }
+        op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_UNI, NULL, 0);
 
         if (!set) {
             if (eval_path_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
@@ -5911,29 +7520,97 @@ eval_unary_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_n
             continue;
         }
 
-        set_fill_set(&set2, &orig_set, ctx);
-        if (eval_path_expr(exp, exp_idx, cur_node, &set2, when_must_eval, line)) {
-            lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-            lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
-            return -1;
-        }
+        set_fill_set(&set2, &orig_set);
+        if (eval_path_expr(exp, exp_idx, cur_node, &set2, when_must_eval, line)) {
+            set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            return -1;
+        }
+
+        /* eval */
+        if (moveto_union(set, &set2, cur_node, when_must_eval, line)) {
+            set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            return -1;
+        }
+    }
+
+    set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    /* now we have all the unions in set and no other memory allocated */
+
+    if (set && (unary_minus > -1)) {
+        moveto_op_math(set, NULL, &exp->expr[exp->expr_pos[unary_minus]], cur_node, when_must_eval);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Check whether an operand of a binary operator rule is a single Literal or Number,
+ *        which does not need the context set to be evaluated.
+ *
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] exp_idx Position of the operand in the expression \p exp.
+ * @param[in] level Rule of the operand, 3 for RelationalExpr up to 6 for UnaryExpr, see fold_is_operator().
+ *
+ * @return 1 if it is, 0 otherwise.
+ */
+static int
+exp_const_operand(struct lyxp_expr *exp, uint32_t exp_idx, uint32_t level)
+{
+    if ((exp->tokens[exp_idx] != LYXP_TOKEN_LITERAL) && (exp->tokens[exp_idx] != LYXP_TOKEN_NUMBER)) {
+        return 0;
+    }
+
+    ++exp_idx;
+    if (exp->used == exp_idx) {
+        return 1;
+    }
 
-        /* eval */
-        if (moveto_union(set, &set2, cur_node, when_must_eval, line)) {
-            lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-            lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
-            return -1;
+    switch (exp->tokens[exp_idx]) {
+    case LYXP_TOKEN_BRACK1:
+    case LYXP_TOKEN_OPERATOR_PATH:
+    case LYXP_TOKEN_OPERATOR_UNI:
+        /* FilterExpr or PathExpr */
+        return 0;
+    default:
+        break;
+    }
+
+    /* the operand continues with an operator of a higher precedence */
+    for (; level < 6; ++level) {
+        if (fold_is_operator(exp, exp_idx, level)) {
+            return 0;
         }
     }
 
-    lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    /* now we have all the unions in set and no other memory allocated */
+    return 1;
+}
 
-    if (set && (unary_minus > -1)) {
-        moveto_op_math(set, NULL, &exp->expr[exp->expr_pos[unary_minus]], cur_node, when_must_eval);
+/**
+ * @brief Check whether all the right operands of an operator chain are constant, see exp_const_operand().
+ *
+ * @param[in] exp Parsed XPath expression.
+ * @param[in] op_exp Index of the first operator of the chain.
+ * @param[in] op_tok Token of the chain operators.
+ * @param[in] op_chars First characters of the chain operators, NULL if not checked.
+ * @param[in] op_len Length of the chain operators, 0 if not checked.
+ * @param[in] level Rule of the operands.
+ *
+ * @return 1 if they are, 0 otherwise.
+ */
+static int
+exp_const_operands(struct lyxp_expr *exp, uint32_t op_exp, enum lyxp_token op_tok, const char *op_chars, uint32_t op_len,
+                   uint32_t level)
+{
+    while (op_exp) {
+        if (!exp_const_operand(exp, op_exp + 1, level)) {
+            return 0;
+        }
+        op_exp = exp_repeat_find(exp, op_exp + 1, op_tok, op_chars, op_len);
     }
 
-    return EXIT_SUCCESS;
+    return 1;
 }
 
 /**
@@ -5954,31 +7631,24 @@ eval_unary_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_n
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_multiplicative_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_multiplicative_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                          int when_must_eval, uint32_t line)
 {
-    uint16_t this_op, op_exp;
+    uint32_t this_op, op_exp;
     struct lyxp_set orig_set, set2;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     orig_set.type = LYXP_SET_EMPTY;
     set2.type = LYXP_SET_EMPTY;
 
-    op_exp = exp_repeat_peek(exp, *exp_idx);
-    if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_MATH)
-            && ((exp->expr[exp->expr_pos[op_exp]] == '*') || (exp->tok_len[op_exp] == 3))) {
-        /* there is an operator */
-        exp_repeat_pop(exp, *exp_idx);
-        set_fill_set(&orig_set, set, ctx);
-    } else {
-        op_exp = 0;
+    op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_MATH, "*", 3);
+    if (op_exp && !exp_const_operands(exp, op_exp, LYXP_TOKEN_OPERATOR_MATH, "*", 3, 6)) {
+        /* there is an operator with an operand depending on the context */
+        set_fill_set(&orig_set, set);
     }
 
     /* UnaryExpr */
     if (eval_unary_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-        lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+        set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
         return -1;
     }
 
@@ -5990,14 +7660,7 @@ eval_multiplicative_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_no
                print_token(exp->tokens[*exp_idx]), exp->expr_pos[*exp_idx]);
         ++(*exp_idx);
 
-        op_exp = exp_repeat_peek(exp, *exp_idx);
-        if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_MATH)
-                && ((exp->expr[exp->expr_pos[op_exp]] == '*') || (exp->tok_len[op_exp] == 3))) {
-            /* there is another operator */
-            exp_repeat_pop(exp, *exp_idx);
-        } else {
-            op_exp = 0;
-        }
+        op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_MATH, "*", 3);
 
         if (!set) {
             if (eval_unary_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
@@ -6006,10 +7669,12 @@ eval_multiplicative_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_no
             continue;
         }
 
-        set_fill_set(&set2, &orig_set, ctx);
+        if (!exp_const_operand(exp, *exp_idx, 6)) {
+            set_fill_set(&set2, &orig_set);
+        }
         if (eval_unary_expr(exp, exp_idx, cur_node, &set2, when_must_eval, line)) {
-            lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-            lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
             return -1;
         }
 
@@ -6017,8 +7682,8 @@ eval_multiplicative_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_no
         moveto_op_math(set, &set2, &exp->expr[exp->expr_pos[this_op]], cur_node, when_must_eval);
     }
 
-    lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
     return EXIT_SUCCESS;
 }
 
@@ -6039,31 +7704,24 @@ eval_multiplicative_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_no
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_additive_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_additive_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                    int when_must_eval, uint32_t line)
 {
-    uint16_t this_op, op_exp;
+    uint32_t this_op, op_exp;
     struct lyxp_set orig_set, set2;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     orig_set.type = LYXP_SET_EMPTY;
     set2.type = LYXP_SET_EMPTY;
 
-    op_exp = exp_repeat_peek(exp, *exp_idx);
-    if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_MATH)
-            && ((exp->expr[exp->expr_pos[op_exp]] == '+') || (exp->expr[exp->expr_pos[op_exp]] == '-'))) {
-        /* there is an operator */
-        exp_repeat_pop(exp, *exp_idx);
-        set_fill_set(&orig_set, set, ctx);
-    } else {
-        op_exp = 0;
+    op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_MATH, "+-", 0);
+    if (op_exp && !exp_const_operands(exp, op_exp, LYXP_TOKEN_OPERATOR_MATH, "+-", 0, 5)) {
+        /* there is an operator with an operand depending on the context */
+        set_fill_set(&orig_set, set);
     }
 
     /* MultiplicativeExpr */
     if (eval_multiplicative_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-        lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+        set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
         return -1;
     }
 
@@ -6075,14 +7733,7 @@ eval_additive_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
                print_token(exp->tokens[*exp_idx]), exp->expr_pos[*exp_idx]);
         ++(*exp_idx);
 
-        op_exp = exp_repeat_peek(exp, *exp_idx);
-        if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_MATH)
-                && ((exp->expr[exp->expr_pos[op_exp]] == '+') || (exp->expr[exp->expr_pos[op_exp]] == '-'))) {
-            /* there is another operator */
-            exp_repeat_pop(exp, *exp_idx);
-        } else {
-            op_exp = 0;
-        }
+        op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_MATH, "+-", 0);
 
         if (!set) {
             if (eval_multiplicative_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
@@ -6091,10 +7742,12 @@ eval_additive_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
             continue;
         }
 
-        set_fill_set(&set2, &orig_set, ctx);
+        if (!exp_const_operand(exp, *exp_idx, 5)) {
+            set_fill_set(&set2, &orig_set);
+        }
         if (eval_multiplicative_expr(exp, exp_idx, cur_node, &set2, when_must_eval, line)) {
-            lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-            lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
             return -1;
         }
 
@@ -6102,8 +7755,8 @@ eval_additive_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
         moveto_op_math(set, &set2, &exp->expr[exp->expr_pos[this_op]], cur_node, when_must_eval);
     }
 
-    lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
     return EXIT_SUCCESS;
 }
 
@@ -6126,31 +7779,24 @@ eval_additive_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_relational_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_relational_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                      int when_must_eval, uint32_t line)
 {
-    uint16_t this_op, op_exp;
+    uint32_t this_op, op_exp;
     struct lyxp_set orig_set, set2;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     orig_set.type = LYXP_SET_EMPTY;
     set2.type = LYXP_SET_EMPTY;
 
-    op_exp = exp_repeat_peek(exp, *exp_idx);
-    if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_COMP)
-            && ((exp->expr[exp->expr_pos[op_exp]] == '<') || (exp->expr[exp->expr_pos[op_exp]] == '>'))) {
-        /* there is an operator */
-        exp_repeat_pop(exp, *exp_idx);
-        set_fill_set(&orig_set, set, ctx);
-    } else {
-        op_exp = 0;
+    op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_COMP, "<>", 0);
+    if (op_exp && !exp_const_operands(exp, op_exp, LYXP_TOKEN_OPERATOR_COMP, "<>", 0, 4)) {
+        /* there is an operator with an operand depending on the context */
+        set_fill_set(&orig_set, set);
     }
 
     /* AdditiveExpr */
     if (eval_additive_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-        lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+        set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
         return -1;
     }
 
@@ -6162,14 +7808,7 @@ eval_relational_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *
                print_token(exp->tokens[*exp_idx]), exp->expr_pos[*exp_idx]);
         ++(*exp_idx);
 
-        op_exp = exp_repeat_peek(exp, *exp_idx);
-        if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_COMP)
-                && ((exp->expr[exp->expr_pos[op_exp]] == '<') || (exp->expr[exp->expr_pos[op_exp]] == '>'))) {
-            /* there is another operator */
-            exp_repeat_pop(exp, *exp_idx);
-        } else {
-            op_exp = 0;
-        }
+        op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_COMP, "<>", 0);
 
         if (!set) {
             if (eval_relational_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
@@ -6178,10 +7817,12 @@ eval_relational_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *
             continue;
         }
 
-        set_fill_set(&set2, &orig_set, ctx);
+        if (!exp_const_operand(exp, *exp_idx, 4)) {
+            set_fill_set(&set2, &orig_set);
+        }
         if (eval_additive_expr(exp, exp_idx, cur_node, &set2, when_must_eval, line)) {
-            lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-            lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
             return -1;
         }
 
@@ -6189,8 +7830,8 @@ eval_relational_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *
         moveto_op_comp(set, &set2, &exp->expr[exp->expr_pos[this_op]], cur_node, when_must_eval);
     }
 
-    lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
     return EXIT_SUCCESS;
 }
 
@@ -6210,31 +7851,24 @@ eval_relational_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_equality_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_equality_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
                    int when_must_eval, uint32_t line)
 {
-    uint16_t this_op, op_exp;
+    uint32_t this_op, op_exp;
     struct lyxp_set orig_set, set2;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     orig_set.type = LYXP_SET_EMPTY;
     set2.type = LYXP_SET_EMPTY;
 
-    op_exp = exp_repeat_peek(exp, *exp_idx);
-    if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_COMP)
-            && ((exp->expr[exp->expr_pos[op_exp]] == '=') || (exp->expr[exp->expr_pos[op_exp]] == '!'))) {
-        /* there is an operator */
-        exp_repeat_pop(exp, *exp_idx);
-        set_fill_set(&orig_set, set, ctx);
-    } else {
-        op_exp = 0;
+    op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_COMP, "=!", 0);
+    if (op_exp && !exp_const_operands(exp, op_exp, LYXP_TOKEN_OPERATOR_COMP, "=!", 0, 3)) {
+        /* there is an operator with an operand depending on the context */
+        set_fill_set(&orig_set, set);
     }
 
     /* RelationalExpr */
     if (eval_relational_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-        lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+        set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
         return -1;
     }
 
@@ -6246,14 +7880,7 @@ eval_equality_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
                print_token(exp->tokens[*exp_idx]), exp->expr_pos[*exp_idx]);
         ++(*exp_idx);
 
-        op_exp = exp_repeat_peek(exp, *exp_idx);
-        if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_COMP)
-                && ((exp->expr[exp->expr_pos[op_exp]] == '=') || (exp->expr[exp->expr_pos[op_exp]] == '!'))) {
-            /* there is another operator */
-            exp_repeat_pop(exp, *exp_idx);
-        } else {
-            op_exp = 0;
-        }
+        op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_COMP, "=!", 0);
 
         if (!set) {
             if (eval_relational_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
@@ -6262,10 +7889,12 @@ eval_equality_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
             continue;
         }
 
-        set_fill_set(&set2, &orig_set, ctx);
+        if (!exp_const_operand(exp, *exp_idx, 3)) {
+            set_fill_set(&set2, &orig_set);
+        }
         if (eval_relational_expr(exp, exp_idx, cur_node, &set2, when_must_eval, line)) {
-            lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-            lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
             return -1;
         }
 
@@ -6273,8 +7902,8 @@ eval_equality_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
         moveto_op_comp(set, &set2, &exp->expr[exp->expr_pos[this_op]], cur_node, when_must_eval);
     }
 
-    lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-    lyxp_set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&set2, LYXP_SET_EMPTY, cur_node, when_must_eval);
     return EXIT_SUCCESS;
 }
 
@@ -6293,36 +7922,30 @@ eval_equality_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cu
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_and_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
+eval_and_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set,
               int when_must_eval, uint32_t line)
 {
     int is_false = 0;
-    uint16_t op_exp;
+    uint32_t op_exp;
     struct lyxp_set orig_set;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     orig_set.type = LYXP_SET_EMPTY;
 
-    op_exp = exp_repeat_peek(exp, *exp_idx);
-    if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_LOG) && (exp->tok_len[op_exp] == 3)) {
+    op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_LOG, NULL, 3);
+    if (op_exp) {
         /* there is an operator */
-        exp_repeat_pop(exp, *exp_idx);
-        set_fill_set(&orig_set, set, ctx);
-    } else {
-        op_exp = 0;
+        set_fill_set(&orig_set, set);
     }
 
     /* EqualityExpr */
     if (eval_equality_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-        lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+        set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
         return -1;
     }
 
     /* cast to boolean, we know that will be the final result */
-    if (op_exp) {
-        lyxp_set_cast(set, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+    if (set && op_exp) {
+        set_cast(set, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
         if (!set->value.bool) {
             is_false = 1;
         }
@@ -6334,33 +7957,31 @@ eval_and_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_nod
                print_token(exp->tokens[*exp_idx]), exp->expr_pos[*exp_idx]);
         ++(*exp_idx);
 
-        op_exp = exp_repeat_peek(exp, *exp_idx);
-        if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_LOG) && (exp->tok_len[op_exp] == 3)) {
-            /* there is another operator */
-            exp_repeat_pop(exp, *exp_idx);
-        } else {
-            op_exp = 0;
-        }
+        op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_LOG, NULL, 3);
 
-        /* lazy evaluation */
-        if (is_false) {
+        /* lazy evaluation, only skip the operand */
+        if (!set || is_false) {
+            if (eval_equality_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
+                set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+                return -1;
+            }
             continue;
         }
 
-        set_fill_set(set, &orig_set, ctx);
+        set_fill_set(set, &orig_set);
         if (eval_equality_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-            lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
             return -1;
         }
 
         /* eval - just get boolean value actually */
-        lyxp_set_cast(set, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+        set_cast(set, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
         if (!set->value.bool) {
             is_false = 1;
         }
     }
 
-    lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
     return EXIT_SUCCESS;
 }
 
@@ -6379,36 +8000,30 @@ eval_and_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_nod
  * @return EXIT_SUCCESS on success, -1 on error.
  */
 static int
-eval_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set, int when_must_eval,
+eval_expr(struct lyxp_expr *exp, uint32_t *exp_idx, struct lyd_node *cur_node, struct lyxp_set *set, int when_must_eval,
           uint32_t line)
 {
     int is_true = 0;
-    uint16_t op_exp;
+    uint32_t op_exp;
     struct lyxp_set orig_set;
-    struct ly_ctx *ctx;
-
-    ctx = cur_node->schema->module->ctx;
 
     orig_set.type = LYXP_SET_EMPTY;
 
-    op_exp = exp_repeat_peek(exp, *exp_idx);
-    if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_LOG) && (exp->tok_len[op_exp] == 2)) {
+    op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_LOG, NULL, 2);
+    if (op_exp) {
         /* there is an operator */
-        exp_repeat_pop(exp, *exp_idx);
-        set_fill_set(&orig_set, set, ctx);
-    } else {
-        op_exp = 0;
+        set_fill_set(&orig_set, set);
     }
 
     /* AndExpr */
     if (eval_and_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-        lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+        set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
         return -1;
     }
 
     /* cast to boolean, we know that will be the final result */
-    if (op_exp) {
-        lyxp_set_cast(set, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+    if (set && op_exp) {
+        set_cast(set, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
         if (set->value.bool) {
             is_true = 1;
         }
@@ -6420,76 +8035,160 @@ eval_expr(struct lyxp_expr *exp, uint16_t *exp_idx, struct lyd_node *cur_node, s
                print_token(exp->tokens[*exp_idx]), exp->expr_pos[*exp_idx]);
         ++(*exp_idx);
 
-        op_exp = exp_repeat_peek(exp, *exp_idx);
-        if (op_exp && (exp->tokens[op_exp] == LYXP_TOKEN_OPERATOR_LOG) && (exp->tok_len[op_exp] == 2)) {
-            /* there is another operator */
-            exp_repeat_pop(exp, *exp_idx);
-        } else {
-            op_exp = 0;
-        }
+        op_exp = exp_repeat_find(exp, *exp_idx, LYXP_TOKEN_OPERATOR_LOG, NULL, 2);
 
-        /* lazy evaluation */
-        if (is_true) {
+        /* lazy evaluation, only skip the operand */
+        if (!set || is_true) {
+            if (eval_and_expr(exp, exp_idx, cur_node, NULL, when_must_eval, line)) {
+                set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+                return -1;
+            }
             continue;
         }
 
-        set_fill_set(set, &orig_set, ctx);
+        set_fill_set(set, &orig_set);
         if (eval_and_expr(exp, exp_idx, cur_node, set, when_must_eval, line)) {
-            lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+            set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
             return -1;
         }
 
         /* eval - just get boolean value actually */
-        lyxp_set_cast(set, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
+        set_cast(set, LYXP_SET_BOOLEAN, cur_node, when_must_eval);
         if (set->value.bool) {
             is_true = 1;
         }
     }
 
-    lyxp_set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+    set_cast(&orig_set, LYXP_SET_EMPTY, cur_node, when_must_eval);
     return EXIT_SUCCESS;
 }
 
-int
-lyxp_eval(const char *expr, const struct lyd_node *cur_node, struct lyxp_set *set, int when_must_eval, uint32_t line)
+struct lyxp_expr *
+lyxp_compile(const char *expr, uint32_t line)
 {
     struct lyxp_expr *exp;
-    uint16_t exp_idx;
-    int rc = -1;
+    char *dup;
+    uint32_t exp_idx;
 
-    if (!expr || !cur_node || !set) {
+    if (!expr) {
         ly_errno = LY_EINVAL;
-        return EXIT_FAILURE;
+        return NULL;
+    }
+
+    /* the expression keeps its own copy of the string */
+    dup = strdup(expr);
+    if (!dup) {
+        LOGMEM;
+        return NULL;
+    }
+
+    exp = parse_expr(dup, line);
+    if (!exp) {
+        free(dup);
+        return NULL;
+    }
+
+    exp_idx = 0;
+    if (reparse_expr(exp, &exp_idx, line)) {
+        lyxp_expr_free(exp);
+        return NULL;
+    }
+    if (exp->used > exp_idx) {
+        LOGVAL(LYE_SPEC, line, 0, NULL, "Unparsed characters \"%s\" left at the end of an XPath expression.",
+               &exp->expr[exp->expr_pos[exp_idx]]);
+        lyxp_expr_free(exp);
+        return NULL;
     }
+    exp = exp_fold(exp);
+    if (!exp) {
+        return NULL;
+    }
+    if (reparse_eq_predicates(exp)) {
+        lyxp_expr_free(exp);
+        return NULL;
+    }
+
+    print_expr_struct_debug(exp);
+
+    return exp;
+}
 
-    exp = parse_expr(expr, line);
+struct lyxp_expr *
+lyxp_compile_cached(struct lyxp_expr **cache, const char *expr, uint32_t line)
+{
+    struct lyxp_expr *exp;
+
+    exp = *cache;
     if (exp) {
-        exp_idx = 0;
-        rc = reparse_expr(exp, &exp_idx, line);
-        if (!rc && (exp->used > exp_idx)) {
-            LOGVAL(LYE_SPEC, line, 0, NULL, "Unparsed characters \"%s\" left at the end of an XPath expression.",
-                   &exp->expr[exp->expr_pos[exp_idx]]);
-            rc = -1;
-        }
-        if (rc) {
-            exp_free(exp);
-        }
+        return exp;
+    }
+
+    exp = lyxp_compile(expr, line);
+    if (!exp) {
+        return NULL;
+    }
+
+    /* another thread may have been faster, use its expression then */
+    if (!__sync_bool_compare_and_swap(cache, NULL, exp)) {
+        lyxp_expr_free(exp);
+        exp = *cache;
+    }
+
+    return exp;
+}
+
+int
+lyxp_eval_compiled(struct lyxp_expr *exp, const struct lyd_node *cur_node, struct lyxp_set *set, int when_must_eval,
+                   uint32_t line)
+{
+    uint32_t exp_idx = 0;
+    int rc;
+
+    if (!exp || !cur_node || !set) {
+        ly_errno = LY_EINVAL;
+        return EXIT_FAILURE;
+    }
+
+    lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
+
+    scratch_enter();
+    set_insert_node(set, (struct lyd_node *)cur_node, LYXP_NODE_ELEM, 0);
+    rc = eval_expr(exp, &exp_idx, (struct lyd_node *)cur_node, set, when_must_eval, line);
+    if (rc) {
+        LOGVAL(LYE_PATH, 0, LY_VLOG_LYD, cur_node);
     }
-    if (!rc && exp) {
-        print_expr_struct_debug(exp);
+    if ((set->type == LYXP_SET_STRING) && rc) {
+        /* the scratch memory is freed and the set is not expected to be freed on error */
+        set->type = LYXP_SET_EMPTY;
+    } else if (set->type == LYXP_SET_STRING) {
+        /* only the result leaves the scratch memory */
+        set->value.str = lydict_insert(cur_node->schema->module->ctx, set->value.str, 0);
+    }
+    scratch_leave();
+
+    return rc;
+}
 
-        exp_idx = 0;
-        lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, when_must_eval);
-        set_insert_node(set, (struct lyd_node *)cur_node, LYXP_NODE_ELEM, 0);
-        rc = eval_expr(exp, &exp_idx, (struct lyd_node *)cur_node, set, when_must_eval, line);
+int
+lyxp_eval(const char *expr, const struct lyd_node *cur_node, struct lyxp_set *set, int when_must_eval, uint32_t line)
+{
+    struct lyxp_expr *exp;
+    int rc;
 
-        exp_free(exp);
+    if (!expr || !cur_node || !set) {
+        ly_errno = LY_EINVAL;
+        return EXIT_FAILURE;
     }
 
-    if (exp && rc) {
+    exp = lyxp_compile(expr, line);
+    if (!exp) {
         LOGVAL(LYE_PATH, 0, LY_VLOG_LYD, cur_node);
+        return -1;
     }
 
+    rc = lyxp_eval_compiled(exp, cur_node, set, when_must_eval, line);
+    lyxp_expr_free(exp);
+
     return rc;
 }
 
@@ -6497,35 +8196,131 @@ int
 lyxp_syntax_check(const char *expr, uint32_t line)
 {
     struct lyxp_expr *exp;
-    uint16_t exp_idx;
-    int rc = -1;
 
     if (!expr) {
         ly_errno = LY_EINVAL;
         return -1;
     }
 
-    exp = parse_expr(expr, line);
-    if (exp) {
-        exp_idx = 0;
-        rc = reparse_expr(exp, &exp_idx, line);
-        if (!rc && (exp->used > exp_idx)) {
-            LOGVAL(LYE_SPEC, line, 0, NULL, "Unparsed characters \"%s\" left at the end of an XPath expression.",
-                   &exp->expr[exp->expr_pos[exp_idx]]);
-            rc = -1;
+    exp = lyxp_compile(expr, line);
+    if (!exp) {
+        return -1;
+    }
+    lyxp_expr_free(exp);
+
+    return EXIT_SUCCESS;
+}
+
+int
+lyxp_node_deps(struct lyxp_expr *exp, struct lys_node *cur_snode, struct ly_set *snodes, int *open)
+{
+    struct lyxp_deps deps;
+    struct lyxp_set ctx_set;
+    uint32_t exp_idx = 0, i;
+    int rc;
+
+    if (!exp || !cur_snode || !snodes || !open) {
+        ly_errno = LY_EINVAL;
+        return -1;
+    }
+
+    memset(&deps, 0, sizeof deps);
+    memset(&ctx_set, 0, sizeof ctx_set);
+    deps.cur_snode = cur_snode;
+    deps.ctx = cur_snode->module->ctx;
+    deps.root = deps_get_root(cur_snode, &deps.root_type);
+
+    deps_set_add(&ctx_set, cur_snode, LYXP_NODE_ELEM);
+    rc = deps_expr(exp, &exp_idx, &ctx_set, NULL, &deps);
+    if (rc > -1) {
+        rc = (deps.imprecise ? EXIT_FAILURE : EXIT_SUCCESS);
+        *open = deps.open;
+        for (i = 0; i < deps.nodes.used; ++i) {
+            if (ly_set_add(snodes, deps.nodes.value.nodes[i])) {
+                rc = -1;
+                break;
+            }
         }
-        exp_free(exp);
     }
 
+    deps_set_clean(&ctx_set);
+    deps_set_clean(&deps.nodes);
     return rc;
 }
 
+int
+lyxp_path_steps(struct lyxp_expr *exp, struct ly_ctx *ctx, int *absolute, struct lyxp_path_step **steps)
+{
+    uint32_t i, count;
+    const char *qname, *colon;
+
+    if (!exp || !ctx || !absolute || !steps) {
+        ly_errno = LY_EINVAL;
+        return -1;
+    }
+
+    /* optional leading '/' followed by NameTests joined by '/' */
+    i = 0;
+    *absolute = 0;
+    if (exp->used && (exp->tokens[0] == LYXP_TOKEN_OPERATOR_PATH)) {
+        if (exp->tok_len[0] != 1) {
+            return 0;
+        }
+        *absolute = 1;
+        i = 1;
+    }
+    for (count = 0; i < exp->used; i += 2, ++count) {
+        if ((exp->tokens[i] != LYXP_TOKEN_NAMETEST) || ((i + 1 < exp->used)
+                && ((exp->tokens[i + 1] != LYXP_TOKEN_OPERATOR_PATH) || (exp->tok_len[i + 1] != 1)))) {
+            return 0;
+        }
+    }
+    if (!count) {
+        return 0;
+    }
+
+    *steps = malloc(count * sizeof **steps);
+    if (!*steps) {
+        LOGMEM;
+        return -1;
+    }
+
+    for (i = 0; i < count; ++i) {
+        qname = &exp->expr[exp->expr_pos[*absolute + 2 * i]];
+        (*steps)[i].name_len = exp->tok_len[*absolute + 2 * i];
+
+        colon = strnchr(qname, ':', (*steps)[i].name_len);
+        if (colon) {
+            (*steps)[i].mod = moveto_resolve_model(qname, colon - qname, ctx, 1);
+            if (!(*steps)[i].mod) {
+                free(*steps);
+                *steps = NULL;
+                return -1;
+            }
+            (*steps)[i].name_len -= colon - qname + 1;
+            qname = colon + 1;
+        } else {
+            (*steps)[i].mod = NULL;
+        }
+        (*steps)[i].name = qname;
+    }
+
+    return count;
+}
+
+int
+lyxp_path_step_match(const struct lyxp_path_step *step, const struct lyd_node *node)
+{
+    /* the same context as lyxp_eval_compiled() without the when and must restrictions uses */
+    return moveto_node_match(node, LYXP_NODE_ROOT_STATE, step->name, step->name_len, step->mod);
+}
+
 void xml_print_node(struct lyout *out, int level, struct lyd_node *node, int toplevel);
 
 void
 lyxp_set_print_xml(FILE *f, struct lyxp_set *set)
 {
-    uint16_t i;
+    uint32_t i;
     char *str_num;
     struct lyout out;
 
@@ -6594,7 +8389,7 @@ lyxp_set_print_xml(FILE *f, struct lyxp_set *set)
                 ly_print(&out, "\n");
                 break;
             case LYXP_NODE_TEXT:
-                ly_print(&out, "TEXT \"%s\"\n\n", ((struct lyd_node_leaf_list *)set->value.nodes[i])->value_str);
+                ly_print(&out, "TEXT \"%s\"\n\n", lyd_value_str((struct lyd_node_leaf_list *)set->value.nodes[i]));
                 break;
             case LYXP_NODE_ATTR:
                 ly_print(&out, "ATTR \"%s\" = \"%s\"\n\n", set->value.attrs[i]->name, set->value.attrs[i]->value);
@@ -6605,13 +8400,22 @@ lyxp_set_print_xml(FILE *f, struct lyxp_set *set)
     }
 }
 
-void
-lyxp_set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_node *cur_node, int when_must_eval)
+/**
+ * @brief Cast XPath set to another type, a string value is in the scratch memory.
+ *        Indirectly context position aware.
+ *
+ * @param[in] set Set to cast.
+ * @param[in] target Target type to cast \p set into.
+ * @param[in] cur_node Current (context) data node.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ */
+static void
+set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_node *cur_node, int when_must_eval)
 {
-    char *str_num;
+    char *str_num, buf[32];
     long double num;
+    int64_t inum;
     const char *str;
-    struct ly_ctx *ctx;
 
     if (!set || (set->type == target)) {
         return;
@@ -6623,46 +8427,49 @@ lyxp_set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_
         return;
     }
 
-    ctx = cur_node->schema->module->ctx;
-
     /* to STRING */
-    if ((target == LYXP_SET_STRING) || ((target == LYXP_SET_NUMBER)
-            && ((set->type == LYXP_SET_NODE_SET) || (set->type == LYXP_SET_EMPTY)))) {
+    if ((target == LYXP_SET_STRING) || ((target == LYXP_SET_NUMBER) && (set->type == LYXP_SET_EMPTY))) {
         switch (set->type) {
         case LYXP_SET_NUMBER:
+            /* constant strings need not be in the scratch memory */
             if (isnan(set->value.num)) {
-                set->value.str = lydict_insert(ctx, "NaN", 0);
+                set->value.str = "NaN";
             } else if ((set->value.num == 0) || (set->value.num == -0)) {
-                set->value.str = lydict_insert(ctx, "0", 0);
+                set->value.str = "0";
             } else if (isinf(set->value.num) && !signbit(set->value.num)) {
-                set->value.str = lydict_insert(ctx, "Infinity", 0);
+                set->value.str = "Infinity";
             } else if (isinf(set->value.num) && signbit(set->value.num)) {
-                set->value.str = lydict_insert(ctx, "-Infinity", 0);
+                set->value.str = "-Infinity";
             } else if ((long long)set->value.num == set->value.num) {
-                asprintf(&str_num, "%lld", (long long)set->value.num);
-                set->value.str = lydict_insert_zc(ctx, str_num);
+                sprintf(buf, "%lld", (long long)set->value.num);
+                set->value.str = scratch_strndup(buf, strlen(buf));
+            } else if (asprintf(&str_num, "%03.1Lf", set->value.num) > -1) {
+                set->value.str = scratch_strndup(str_num, strlen(str_num));
+                free(str_num);
             } else {
-                asprintf(&str_num, "%03.1Lf", set->value.num);
-                set->value.str = lydict_insert_zc(ctx, str_num);
+                LOGMEM;
+                set->value.str = NULL;
+            }
+            if (!set->value.str) {
+                set->value.str = "";
             }
             break;
         case LYXP_SET_BOOLEAN:
             if (set->value.bool) {
-                set->value.str = lydict_insert(ctx, "true", 0);
+                set->value.str = "true";
             } else {
-                set->value.str = lydict_insert(ctx, "false", 0);
+                set->value.str = "false";
             }
             break;
         case LYXP_SET_NODE_SET:
             assert(set->used);
 
             str = cast_node_set_to_string(set, (struct lyd_node *)cur_node, when_must_eval);
-            free(set->value.nodes);
-            free(set->node_type);
-            set->value.str = str;
+            set_nodes_free(set);
+            set->value.str = (str ? str : "");
             break;
         case LYXP_SET_EMPTY:
-            set->value.str = lydict_insert(ctx, "", 0);
+            set->value.str = "";
             break;
         default:
             LOGINT;
@@ -6675,22 +8482,34 @@ lyxp_set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_
     if (target == LYXP_SET_NUMBER) {
         switch (set->type) {
         case LYXP_SET_STRING:
-            num = cast_string_to_number(set->value.str);
-            lydict_remove(ctx, set->value.str);
-            set->value.num = num;
-            break;
-        case LYXP_SET_BOOLEAN:
-            if (set->value.bool) {
-                set->value.num = 1;
+            if (!cast_string_to_int(set->value.str, strlen(set->value.str), &inum)) {
+                set_fill_int(set, inum);
             } else {
-                set->value.num = 0;
+                set_fill_number(set, cast_string_to_number(set->value.str));
+            }
+            break;
+        case LYXP_SET_NODE_SET:
+            assert(set->used);
+
+            switch (cast_node_set_to_number(set, (struct lyd_node *)cur_node, when_must_eval, &num, &inum)) {
+            case 1:
+                set_fill_int(set, inum);
+                break;
+            case 0:
+                set_fill_number(set, num);
+                break;
+            default:
+                set_fill_number(set, 0);
+                break;
             }
             break;
+        case LYXP_SET_BOOLEAN:
+            set_fill_int(set, set->value.bool ? 1 : 0);
+            break;
         default:
             LOGINT;
             break;
         }
-        set->type = LYXP_SET_NUMBER;
     }
 
     /* to BOOLEAN */
@@ -6711,8 +8530,7 @@ lyxp_set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_
             }
             break;
         case LYXP_SET_NODE_SET:
-            free(set->value.nodes);
-            free(set->node_type);
+            set_nodes_free(set);
 
             assert(set->used);
             set->value.bool = 1;
@@ -6732,14 +8550,11 @@ lyxp_set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_
         switch (set->type) {
         case LYXP_SET_NUMBER:
         case LYXP_SET_BOOLEAN:
-            /* nothing to do */
-            break;
         case LYXP_SET_STRING:
-            lydict_remove(ctx, set->value.str);
+            /* nothing to do */
             break;
         case LYXP_SET_NODE_SET:
-            free(set->value.nodes);
-            free(set->node_type);
+            set_nodes_free(set);
             break;
         default:
             LOGINT;
@@ -6749,6 +8564,34 @@ lyxp_set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_
     }
 }
 
+void
+lyxp_set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_node *cur_node, int when_must_eval)
+{
+    const char *str = NULL;
+    struct ly_ctx *ctx;
+
+    if (!set || (set->type == target)) {
+        return;
+    }
+
+    ctx = cur_node->schema->module->ctx;
+    if (set->type == LYXP_SET_STRING) {
+        str = set->value.str;
+    }
+
+    scratch_enter();
+    set_cast(set, target, cur_node, when_must_eval);
+    if (set->type == LYXP_SET_STRING) {
+        /* returned to the caller */
+        set->value.str = lydict_insert(ctx, set->value.str, 0);
+    }
+    scratch_leave();
+
+    if (str) {
+        lydict_remove(ctx, str);
+    }
+}
+
 void
 lyxp_set_free(struct lyxp_set *set, struct ly_ctx *ctx)
 {
@@ -6757,8 +8600,7 @@ lyxp_set_free(struct lyxp_set *set, struct ly_ctx *ctx)
     }
 
     if (set->type == LYXP_SET_NODE_SET) {
-        free(set->value.nodes);
-        free(set->node_type);
+        set_nodes_free(set);
     } else if (set->type == LYXP_SET_STRING) {
         lydict_remove(ctx, set->value.str);
     }
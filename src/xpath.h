@@ -72,17 +72,17 @@
  * [17] UnionExpr ::= PathExpr | UnionExpr '|' PathExpr
  */
 
-/* expression tokens allocation */
+/* expression tokens allocation, the size is doubled when full */
 #define LYXP_EXPR_SIZE_START 10
-#define LYXP_EXPR_SIZE_STEP 5
 
-/* XPath matches allocation */
+/* XPath matches allocation, the size is doubled when full */
 #define LYXP_SET_SIZE_START 2
-#define LYXP_SET_SIZE_STEP 2
 
-/* building string when casting */
+/* node sets with at least this many nodes get an auxiliary hash table of their nodes */
+#define LYXP_SET_HASH_MIN 16
+
+/* building string when casting, the size is doubled when full */
 #define LYXP_STRING_CAST_SIZE_START 64
-#define LYXP_STRING_CAST_SIZE_STEP 16
 
 /**
  * @brief Tokens that can be in an XPath expression.
@@ -116,12 +116,15 @@ enum lyxp_token {
  */
 struct lyxp_expr {
     enum lyxp_token *tokens; /* array of tokens */
-    uint16_t *expr_pos;      /* array of pointers to the expression in expr (idx of the beginning) */
-    uint8_t *tok_len;        /* array of token lengths in expr */
-    uint8_t **repeat;        /* array of the operator token indices that succeed this expression ended with 0,
+    uint32_t *expr_pos;      /* array of pointers to the expression in expr (idx of the beginning) */
+    uint32_t *tok_len;        /* array of token lengths in expr */
+    uint32_t **repeat;        /* array of the operator token indices that succeed this expression ended with 0,
                                 more in the comment after this declaration */
-    uint16_t used;           /* used array items */
-    uint16_t size;           /* allocated array items */
+    uint32_t used;           /* used array items */
+    uint32_t size;           /* allocated array items */
+    uint8_t *eq_pred;        /* array with the number of "NameTest = Literal|Number" conditions joined by 'and'
+                                for every '[' token of a predicate consisting only of them (list key predicate),
+                                0 for all the other tokens, NULL if there are no such predicates */
 
     const char *expr;        /* the original XPath expression */
 };
@@ -172,11 +175,21 @@ struct lyxp_set {
         int bool;
     } value;
 
+    /* this is valid only for type == LYXP_SET_NUMBER, value.num is always valid */
+    int64_t inum;                    /* the number as an integer if is_int is set */
+    uint8_t is_int;                  /* whether the number is an integer and it is stored in inum, too */
+
     /* this is valid only for type == LYXP_NODE_SET */
     enum lyxp_node_type *node_type;  /* item with this index is of this node type */
-    uint16_t used;
-    uint16_t size;
-    uint16_t pos;                    /* current context position, indexed from 1, relevant only for predicates */
+    uint32_t used;
+    uint32_t size;
+    uint32_t pos;                    /* current context position, indexed from 1, relevant only for predicates */
+
+    /* auxiliary hash table of the nodes for duplicate checks, valid only for type == LYXP_NODE_SET,
+     * created on demand once the set has at least LYXP_SET_HASH_MIN nodes */
+    struct lyxp_set_hash_rec *ht;
+    uint32_t ht_size;                /* number of records, always a power of 2 (or 0) */
+    uint32_t ht_used;                /* number of used records */
 };
 
 /**
@@ -194,13 +207,180 @@ enum lyxp_node_type {
     LYXP_NODE_ATTR
 };
 
+/**
+ * @brief Record of the auxiliary hash table of an LYXP_SET_NODE_SET XPath set.
+ */
+struct lyxp_set_hash_rec {
+    void *node;                      /* node (or attribute) in the set */
+    enum lyxp_node_type type;        /* type of the node */
+    uint8_t used;                    /* whether the record is used */
+};
+
+/**
+ * @brief Condition of a list key predicate being evaluated.
+ */
+struct lyxp_key_cond {
+    struct lys_node_leaf *key;       /* compared key */
+    uint8_t key_idx;                 /* index of the key in the list keys */
+    const char *value;               /* compared literal (not terminated), NULL if a number is compared */
+    uint32_t value_len;              /* length of the literal */
+    long double num;                 /* compared number */
+};
+
+/**
+ * @brief Value of a constant (sub)expression found when folding an expression.
+ */
+struct lyxp_fold_val {
+    enum lyxp_set_type type;         /* LYXP_SET_EMPTY if not a constant, otherwise LYXP_SET_BOOLEAN,
+                                      * LYXP_SET_NUMBER, or LYXP_SET_STRING (literal) */
+    long double num;                 /* number value */
+    int bool;                        /* boolean value */
+    const char *str;                 /* literal value (not terminated) */
+    uint32_t str_len;                /* length of the literal */
+    uint32_t ops;                    /* number of the operators applied to get the value */
+};
+
+/**
+ * @brief Constant subexpression to be replaced by its value.
+ */
+struct lyxp_fold_rec {
+    uint32_t start;                  /* index of the first token */
+    uint32_t end;                    /* index of the token following the last one */
+    struct lyxp_fold_val val;        /* value of the subexpression */
+};
+
+/**
+ * @brief Constant subexpressions found in an expression.
+ */
+struct lyxp_fold {
+    struct lyxp_fold_rec *recs;
+    uint32_t used;
+    uint32_t size;
+};
+
+/**
+ * @brief Block of the XPath scratch memory, the data follow the header.
+ */
+struct lyxp_scratch_block {
+    struct lyxp_scratch_block *prev; /* previously filled block */
+    size_t size;                     /* size of the data */
+    size_t used;                     /* used bytes of the data */
+};
+
+/* number of the node set buffers kept in the scratch memory for reuse */
+#define LYXP_SCRATCH_SET_BUFS 16
+
+/**
+ * @brief Node arrays of a disposed LYXP_SET_NODE_SET set kept for the next one.
+ */
+struct lyxp_scratch_set_buf {
+    struct lyd_node **nodes;
+    enum lyxp_node_type *node_type;
+    uint32_t size;                   /* number of items both the arrays can hold */
+};
+
+/**
+ * @brief Scratch memory of one thread holding the strings of LYXP_SET_STRING sets during an evaluation.
+ *        The strings are never freed separately, all the blocks are freed once the outermost
+ *        evaluation finishes. The node arrays and the sets disposed of during the evaluation are
+ *        pooled in the same way so that the sets created for every context node do not allocate.
+ */
+struct lyxp_scratch {
+    struct lyxp_scratch_block *block; /* block being filled, NULL if none */
+    uint32_t depth;                  /* number of the nested evaluations using the memory */
+
+    struct lyxp_scratch_set_buf bufs[LYXP_SCRATCH_SET_BUFS];
+    uint32_t buf_count;              /* number of the pooled node arrays */
+    struct lyxp_set *sets[LYXP_SCRATCH_SET_BUFS];
+    uint32_t set_count;              /* number of the pooled set structures */
+};
+
+/**
+ * @brief Position in the XPath scratch memory to free the later allocations up to.
+ */
+struct lyxp_scratch_mark {
+    struct lyxp_scratch_block *block;
+    size_t used;
+};
+
+/**
+ * @brief Item of an LYXP_SET_NODE_SET XPath set being sorted into the document order.
+ */
+struct lyxp_sort_item {
+    uint64_t key;                    /* DFS position of the node (of the parent for attributes) in the upper 32 bits,
+                                      * position among the node, its attributes, and its text node in the lower 32 bits */
+    void *node;                      /* node (or attribute) in the set */
+    enum lyxp_node_type type;        /* type of the node */
+    uint32_t idx;                    /* index of the node in the set before sorting */
+};
+
+/**
+ * @brief Step of a simple location path, see lyxp_path_steps().
+ */
+struct lyxp_path_step {
+    struct lys_module *mod;          /* module of the matching nodes, NULL for any */
+    const char *name;                /* name of the matching nodes (not terminated, points into the expression),
+                                      * "*" for any */
+    uint32_t name_len;               /* length of the name */
+};
+
+/**
+ * @brief Parse and check the syntax of the XPath expression \p expr so that it can be evaluated
+ * repeatedly by lyxp_eval_compiled(). Since the check is only syntactic, node and function names may
+ * still be invalid. Logs directly.
+ *
+ * @param[in] expr XPath expression to compile. Must be in JSON format (prefixes are model names).
+ * The expression keeps its own copy of it.
+ * @param[in] line Line in the input file.
+ *
+ * @return Compiled expression to be freed with lyxp_expr_free(), NULL on error.
+ */
+struct lyxp_expr *lyxp_compile(const char *expr, uint32_t line);
+
+/**
+ * @brief Get the compiled expression \p expr stored in \p cache, compile and store it on the first use.
+ * Safe to be called from several threads for the same \p cache. Logs directly.
+ *
+ * @param[in,out] cache Pointer to the cached expression (NULL if not yet compiled), usually a member
+ * of a schema structure which then owns the expression.
+ * @param[in] expr XPath expression to compile if not yet cached.
+ * @param[in] line Line in the input file.
+ *
+ * @return Compiled expression (do not free), NULL on error.
+ */
+struct lyxp_expr *lyxp_compile_cached(struct lyxp_expr **cache, const char *expr, uint32_t line);
+
+/**
+ * @brief Free a compiled XPath expression.
+ *
+ * @param[in] exp Expression to free, can be NULL.
+ */
+void lyxp_expr_free(struct lyxp_expr *exp);
+
+/**
+ * @brief Evaluate the compiled XPath expression \p exp on data. The expression is not modified,
+ * so it can be shared by several concurrent evaluations.
+ *
+ * @param[in] exp Compiled XPath expression, see lyxp_compile().
+ * @param[in] cur_node Current (context) data node.
+ * @param[out] set Result set. Must be valid (zeroed usually). A string result is stored in the dictionary,
+ * free the set with lyxp_set_cast() to LYXP_SET_EMPTY.
+ * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
+ * @param[in] line Line in the input file.
+ *
+ * @return EXIT_SUCCESS on success, -1 on error.
+ */
+int lyxp_eval_compiled(struct lyxp_expr *exp, const struct lyd_node *cur_node, struct lyxp_set *set, int when_must_eval,
+                       uint32_t line);
+
 /**
  * @brief Evaluate the XPath expression \p expr on data. Be careful when using this function, the result can often
  * be confusing without thorough understanding of XPath evaluation rules defined in RFC 6020.
  *
  * @param[in] expr XPath expression to evaluate. Must be in JSON format (prefixes are model names).
  * @param[in] cur_node Current (context) data node.
- * @param[out] set Result set. Must be valid (zeroed usually).
+ * @param[out] set Result set. Must be valid (zeroed usually). A string result is stored in the dictionary,
+ * free the set with lyxp_set_cast() to LYXP_SET_EMPTY.
  * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
  * @param[in] line Line in the input file.
  *
@@ -219,6 +399,44 @@ int lyxp_eval(const char *expr, const struct lyd_node *cur_node, struct lyxp_set
  */
 int lyxp_syntax_check(const char *expr, uint32_t line);
 
+/**
+ * @brief Walk a compiled when or must expression on the schema tree and get all the schema
+ * nodes whose data instances its evaluation can access. The same access restrictions as
+ * in lyxp_eval_compiled() with \p when_must_eval are applied. Values of the accessed nodes
+ * include all their descendants. Logs directly.
+ *
+ * @param[in] exp Compiled expression.
+ * @param[in] cur_snode Schema node of the context node of the evaluation.
+ * @param[in,out] snodes Set to add the accessed schema nodes to.
+ * @param[out] open Set to 1 if the expression walks the top-level nodes or the descendants, so it can also
+ * access schema nodes of the modules added later, 0 otherwise.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the accessed nodes could not be determined
+ * (any data node may be accessed), -1 on error.
+ */
+int lyxp_node_deps(struct lyxp_expr *exp, struct lys_node *cur_snode, struct ly_set *snodes, int *open);
+
+/**
+ * @brief Get the steps of a simple location path \p exp, which consists only of NameTests joined by '/',
+ * optionally preceded by '/'. Such a path selects the same nodes as when evaluated by lyxp_eval_compiled()
+ * without the when and must restrictions, but the nodes can be matched one by one with lyxp_path_step_match().
+ * Logs directly.
+ * @param[in] exp Compiled expression, the steps point into it.
+ * @param[in] ctx libyang context to resolve the prefixes in.
+ * @param[out] absolute Whether the path is absolute.
+ * @param[out] steps Array of the steps to be freed by the caller.
+ * @return Number of the steps, 0 if \p exp is not a simple location path, -1 on error.
+ */
+int lyxp_path_steps(struct lyxp_expr *exp, struct ly_ctx *ctx, int *absolute, struct lyxp_path_step **steps);
+
+/**
+ * @brief Check whether a data node matches a step of a simple location path.
+ * @param[in] step Step from lyxp_path_steps().
+ * @param[in] node Data node to check.
+ * @return 1 if matches, 0 otherwise.
+ */
+int lyxp_path_step_match(const struct lyxp_path_step *step, const struct lyd_node *node);
+
 /**
  * @brief Print \p set contents.
  *
@@ -228,10 +446,10 @@ int lyxp_syntax_check(const char *expr, uint32_t line);
 void lyxp_set_print_xml(FILE *f, struct lyxp_set *set);
 
 /**
- * @brief Cast XPath set to another type.
+ * @brief Cast XPath set returned by lyxp_eval() to another type.
  *        Indirectly context position aware.
  *
- * @param[in] set Set to cast.
+ * @param[in] set Set to cast, a string value is in the dictionary.
  * @param[in] target Target type to cast \p set into.
  * @param[in] cur_node Current (context) data node.
  * @param[in] when_must_eval Whether to apply data node access restrictions defined for 'when' and 'must' evaluation.
@@ -239,9 +457,9 @@ void lyxp_set_print_xml(FILE *f, struct lyxp_set *set);
 void lyxp_set_cast(struct lyxp_set *set, enum lyxp_set_type target, const struct lyd_node *cur_node, int when_must_eval);
 
 /**
- * @brief Free contents of an XPath \p set.
+ * @brief Free an XPath \p set allocated by the caller and filled by lyxp_eval().
  *
- * @param[in] set Set to free.
+ * @param[in] set Set to free, a string value is in the dictionary.
  * @param[in] ctx libyang context to use.
  */
 void lyxp_set_free(struct lyxp_set *set, struct ly_ctx *ctx);
@@ -0,0 +1,199 @@
+/**
+ * @file test_diff.c
+ * @brief Cmocka tests for data tree differences.
+ *
+ * Copyright (c) 2015 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../config.h"
+#include "../../src/libyang.h"
+
+struct state {
+    struct ly_ctx *ctx;
+    struct lyd_node *first;
+    struct lyd_node *second;
+    struct lyd_difflist *diff;
+};
+
+static const char *diff_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  "<str>text</str>"
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>two</name></item>"
+"</values>";
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+    const char *schemafile = TESTS_DIR"/data/files/values.yin";
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    /* libyang context */
+    st->ctx = ly_ctx_new(NULL);
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return -1;
+    }
+
+    /* schema */
+    if (!lys_parse_path(st->ctx, schemafile, LYS_IN_YIN)) {
+        fprintf(stderr, "Failed to load data model \"%s\".\n", schemafile);
+        return -1;
+    }
+
+    /* data */
+    st->first = lyd_parse_mem(st->ctx, diff_data, LYD_XML, LYD_OPT_CONFIG);
+    st->second = lyd_parse_mem(st->ctx, diff_data, LYD_XML, LYD_OPT_CONFIG);
+    if (!st->first || !st->second) {
+        fprintf(stderr, "Failed to load initial data.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    lyd_free_diff(st->diff);
+    lyd_free_withsiblings(st->first);
+    lyd_free_withsiblings(st->second);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+static struct lyd_node *
+get_child(const struct lyd_node *root, const char *name)
+{
+    struct lyd_node *iter;
+
+    for (iter = root->child; iter; iter = iter->next) {
+        if (!strcmp(iter->schema->name, name)) {
+            return iter;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_diff(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *item;
+
+    st->diff = lyd_diff(st->first, st->second, 0);
+    assert_non_null(st->diff);
+    assert_int_equal(st->diff->type[0], LYD_DIFF_END);
+    lyd_free_diff(st->diff);
+
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)get_child(st->second, "int8"), "13"), 0);
+    item = get_child(st->second, "item");
+    lyd_free(item->next);
+    item = lyd_new(st->second, NULL, "item");
+    assert_non_null(lyd_new_leaf(item, NULL, "id", "3"));
+
+    st->diff = lyd_diff(st->first, st->second, 0);
+    assert_non_null(st->diff);
+    assert_int_equal(st->diff->type[0], LYD_DIFF_CHANGED);
+    assert_ptr_equal(st->diff->first[0], get_child(st->first, "int8"));
+    assert_int_equal(st->diff->type[1], LYD_DIFF_DELETED);
+    assert_ptr_equal(st->diff->first[1], get_child(st->first, "item")->next);
+    assert_int_equal(st->diff->type[2], LYD_DIFF_CREATED);
+    assert_ptr_equal(st->diff->first[2], st->first);
+    assert_ptr_equal(st->diff->second[2], item);
+    assert_int_equal(st->diff->type[3], LYD_DIFF_END);
+}
+
+static void
+test_diff_collision(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *leaf1, *leaf2;
+
+    leaf1 = get_child(st->first, "str");
+    leaf2 = get_child(st->second, "str");
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)leaf2, "other"), 0);
+
+    /* compute the hashes and make them collide */
+    st->diff = lyd_diff(st->first, st->second, 0);
+    assert_non_null(st->diff);
+    lyd_free_diff(st->diff);
+    assert_int_not_equal(leaf1->hash, 0);
+    leaf2->hash = leaf1->hash;
+    st->second->hash = st->first->hash;
+
+    /* the equal hashes alone do not hide the change */
+    st->diff = lyd_diff(st->first, st->second, 0);
+    assert_non_null(st->diff);
+    assert_int_equal(st->diff->type[0], LYD_DIFF_CHANGED);
+    assert_ptr_equal(st->diff->first[0], leaf1);
+    assert_ptr_equal(st->diff->second[0], leaf2);
+    assert_int_equal(st->diff->type[1], LYD_DIFF_END);
+}
+
+static void
+test_diff_snapshot(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_snapshot *snap;
+    struct lyd_node *root;
+
+    snap = lyd_snapshot_new(st->first);
+    assert_non_null(snap);
+    root = (struct lyd_node *)lyd_snapshot_data(snap);
+
+    /* the snapshot hashes are computed in advance, it is not modified */
+    assert_int_not_equal(root->hash, 0);
+    assert_int_not_equal(get_child(root, "str")->hash, 0);
+
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)get_child(st->second, "str"), "other"), 0);
+    st->diff = lyd_diff(root, st->second, 0);
+    assert_non_null(st->diff);
+    assert_int_equal(st->diff->type[0], LYD_DIFF_CHANGED);
+    assert_ptr_equal(st->diff->first[0], get_child(root, "str"));
+    assert_int_equal(st->diff->type[1], LYD_DIFF_END);
+
+    lyd_snapshot_unref(snap);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+                    cmocka_unit_test_setup_teardown(test_diff, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_diff_collision, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_diff_snapshot, setup_f, teardown_f), };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,321 @@
+/**
+ * @file test_edit.c
+ * @brief Cmocka tests for applying NETCONF edit-config content.
+ *
+ * Copyright (c) 2015 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../config.h"
+#include "../../src/libyang.h"
+
+struct state {
+    struct ly_ctx *ctx;
+    struct lyd_node *data;
+    struct lyd_node *edit;
+};
+
+/* anyxml is printed from its XML value, formatted */
+#define ANY_A "<any xmlns=\"urn:libyang:tests:values\">\n  <a>1</a>\n</any>\n"
+#define ANY_B "<any xmlns=\"urn:libyang:tests:values\">\n  <b>2</b>\n</any>\n"
+
+static const char *orig_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  "<str>text</str>"
+  ANY_A
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>two</name></item>"
+"</values>";
+
+#define EDIT_BEGIN "<values xmlns=\"urn:libyang:tests:values\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\">"
+#define EDIT_END "</values>"
+
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+    const char *schemafile = TESTS_DIR"/data/files/values.yin";
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    /* libyang context */
+    st->ctx = ly_ctx_new(TESTS_DIR"/schema/yin/ietf");
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return -1;
+    }
+
+    /* schemas, ietf-netconf defines the operation attribute */
+    if (!ly_ctx_load_module(st->ctx, "ietf-netconf", NULL)) {
+        fprintf(stderr, "Failed to load ietf-netconf data model.\n");
+        return -1;
+    }
+    if (!lys_parse_path(st->ctx, schemafile, LYS_IN_YIN)) {
+        fprintf(stderr, "Failed to load data model \"%s\".\n", schemafile);
+        return -1;
+    }
+
+    /* data */
+    st->data = lyd_parse_mem(st->ctx, orig_data, LYD_XML, LYD_OPT_CONFIG);
+    if (!st->data) {
+        fprintf(stderr, "Failed to load initial data.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    lyd_free_withsiblings(st->data);
+    lyd_free_withsiblings(st->edit);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+static int
+apply_edit(struct state *st, const char *edit, int options)
+{
+    lyd_free_withsiblings(st->edit);
+    st->edit = lyd_parse_mem(st->ctx, edit, LYD_XML, LYD_OPT_EDIT);
+    assert_non_null(st->edit);
+
+    return lyd_apply_edit(&st->data, st->edit, options);
+}
+
+static void
+check_data(struct lyd_node *root, const char *expected)
+{
+    char *str;
+
+    assert_int_equal(lyd_print_mem(&str, root, LYD_XML, 0), 0);
+    assert_string_equal(str, expected);
+    free(str);
+}
+
+static void
+test_edit_merge(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *item1;
+
+    item1 = st->data->child->prev->prev;
+
+    assert_int_equal(apply_edit(st, EDIT_BEGIN
+                                  "<int8>13</int8>"
+                                  "<any><b>2</b></any>"
+                                  "<item><id>1</id><name>ONE</name></item>"
+                                  "<item><id>3</id><name>three</name></item>"
+                                EDIT_END, 0), 0);
+    check_data(st->data,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>13</int8>"
+  "<str>text</str>"
+  ANY_B
+  "<item><id>1</id><name>ONE</name></item>"
+  "<item><id>2</id><name>two</name></item>"
+  "<item><id>3</id><name>three</name></item>"
+"</values>");
+
+    /* the matching instance is changed in place */
+    assert_ptr_equal(st->data->child->prev->prev->prev, item1);
+    assert_int_equal(lyd_validate(st->data, LYD_OPT_CONFIG), 0);
+
+    /* anyxml as the last child of its parent */
+    assert_int_equal(apply_edit(st, EDIT_BEGIN "<int8>14</int8><any><a>1</a></any>" EDIT_END, 0), 0);
+    assert_int_equal(((struct lyd_node_leaf_list *)st->data->child)->value.int8, 14);
+    assert_ptr_equal(st->data->child->next->next->schema, st->edit->child->next->schema);
+}
+
+static void
+test_edit_replace(void **state)
+{
+    struct state *st = (*state);
+
+    assert_int_equal(apply_edit(st, EDIT_BEGIN
+                                  "<item nc:operation=\"replace\"><id>2</id></item>"
+                                  "<item nc:operation=\"replace\"><id>4</id><name>four</name></item>"
+                                EDIT_END, 0), 0);
+    check_data(st->data,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  "<str>text</str>"
+  ANY_A
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id></item>"
+  "<item><id>4</id><name>four</name></item>"
+"</values>");
+
+    /* default operation */
+    assert_int_equal(apply_edit(st, EDIT_BEGIN "<int8>1</int8>" EDIT_END, LYD_EDITOPT_REPLACE), 0);
+    check_data(st->data,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>1</int8>"
+"</values>");
+}
+
+static void
+test_edit_create_delete(void **state)
+{
+    struct state *st = (*state);
+
+    assert_int_equal(apply_edit(st, EDIT_BEGIN
+                                  "<item nc:operation=\"create\"><id>3</id><name>three</name></item>"
+                                  "<item nc:operation=\"delete\"><id>1</id></item>"
+                                  "<str nc:operation=\"remove\"/>"
+                                  "<item nc:operation=\"remove\"><id>10</id></item>"
+                                EDIT_END, 0), 0);
+    check_data(st->data,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  ANY_A
+  "<item><id>2</id><name>two</name></item>"
+  "<item><id>3</id><name>three</name></item>"
+"</values>");
+
+    /* data-exists */
+    assert_int_not_equal(apply_edit(st, EDIT_BEGIN
+                                      "<item nc:operation=\"create\"><id>2</id></item>"
+                                    EDIT_END, 0), 0);
+    assert_int_equal(ly_errno, LY_EVALID);
+
+    /* data-missing */
+    assert_int_not_equal(apply_edit(st, EDIT_BEGIN
+                                      "<str nc:operation=\"delete\"/>"
+                                    EDIT_END, 0), 0);
+    assert_int_equal(ly_errno, LY_EVALID);
+
+    check_data(st->data,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  ANY_A
+  "<item><id>2</id><name>two</name></item>"
+  "<item><id>3</id><name>three</name></item>"
+"</values>");
+}
+
+static void
+test_edit_none(void **state)
+{
+    struct state *st = (*state);
+
+    /* only the nested operations are applied */
+    assert_int_equal(apply_edit(st, EDIT_BEGIN
+                                  "<int8>13</int8>"
+                                  "<item><id>1</id><name nc:operation=\"merge\">ONE</name></item>"
+                                  "<item><id>2</id><name nc:operation=\"delete\"/></item>"
+                                EDIT_END, LYD_EDITOPT_NONE), 0);
+    check_data(st->data,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  "<str>text</str>"
+  ANY_A
+  "<item><id>1</id><name>ONE</name></item>"
+  "<item><id>2</id></item>"
+"</values>");
+
+    /* delete under none of a missing node */
+    assert_int_not_equal(apply_edit(st, EDIT_BEGIN
+                                      "<item><id>2</id><name nc:operation=\"delete\"/></item>"
+                                    EDIT_END, LYD_EDITOPT_NONE), 0);
+}
+
+static void
+test_edit_rollback(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *nodes[8], *iter;
+    struct lyd_node_anyxml *any;
+    struct lyxml_elem *xml;
+    int i, count;
+
+    /* the original nodes in their order */
+    count = 0;
+    LY_TREE_FOR(st->data->child, iter) {
+        nodes[count++] = iter;
+    }
+    any = (struct lyd_node_anyxml *)nodes[2];
+    xml = any->value;
+
+    /* every operation applied, the last one fails */
+    assert_int_not_equal(apply_edit(st, EDIT_BEGIN
+                                      "<int8>13</int8>"
+                                      "<str nc:operation=\"delete\"/>"
+                                      "<any><b>2</b></any>"
+                                      "<item nc:operation=\"replace\"><id>1</id></item>"
+                                      "<item nc:operation=\"remove\"><id>2</id></item>"
+                                      "<item nc:operation=\"create\"><id>3</id></item>"
+                                      "<item nc:operation=\"delete\"><id>5</id></item>"
+                                    EDIT_END, 0), 0);
+
+    /* the exact tree is restored, the same nodes in the same order with the same values */
+    check_data(st->data, orig_data);
+    i = 0;
+    LY_TREE_FOR(st->data->child, iter) {
+        assert_true(i < count);
+        assert_ptr_equal(iter, nodes[i]);
+        assert_ptr_equal(iter->parent, st->data);
+        ++i;
+    }
+    assert_int_equal(i, count);
+    assert_ptr_equal(any->value, xml);
+    assert_int_equal(((struct lyd_node_leaf_list *)nodes[0])->value.int8, 12);
+
+    /* a failed edit of an empty tree leaves it empty */
+    lyd_free_withsiblings(st->data);
+    st->data = NULL;
+    assert_int_not_equal(apply_edit(st, EDIT_BEGIN
+                                      "<int8>13</int8>"
+                                      "<str nc:operation=\"delete\"/>"
+                                    EDIT_END, 0), 0);
+    assert_null(st->data);
+
+    /* and a successful one creates it */
+    assert_int_equal(apply_edit(st, EDIT_BEGIN "<int8>13</int8>" EDIT_END, 0), 0);
+    check_data(st->data,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>13</int8>"
+"</values>");
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+                    cmocka_unit_test_setup_teardown(test_edit_merge, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_edit_replace, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_edit_create_delete, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_edit_none, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_edit_rollback, setup_f, teardown_f), };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,307 @@
+/**
+ * @file test_lyb.c
+ * @brief Cmocka tests for the LYB (binary) data format.
+ *
+ * Copyright (c) 2015 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../config.h"
+#include "../../src/libyang.h"
+
+struct state {
+    struct ly_ctx *ctx;
+    struct lyd_node *data;
+    char *lyb;
+};
+
+static const char *lyb_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<small>a c</small>"
+  "<wide64>b0 b63</wide64>"
+  "<int8>-12</int8>"
+  "<uint64>18446744073709551615</uint64>"
+  "<dec64>-1.5</dec64>"
+  "<bool>true</bool>"
+  "<enum>two</enum>"
+  "<str>text</str>"
+  "<ref>-12</ref>"
+  "<inst xmlns:val=\"urn:libyang:tests:values\">/val:values/val:int8</inst>"
+  "<uinst>5</uinst>"
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>two</name></item>"
+"</values>";
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+    const char *schemafile = TESTS_DIR"/data/files/values.yin";
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    /* libyang context */
+    st->ctx = ly_ctx_new(NULL);
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return -1;
+    }
+
+    /* schema */
+    if (!lys_parse_path(st->ctx, schemafile, LYS_IN_YIN)) {
+        fprintf(stderr, "Failed to load data model \"%s\".\n", schemafile);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    free(st->lyb);
+    lyd_free_withsiblings(st->data);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+static int
+lyb_length(const char *lyb)
+{
+    return lyd_lyb_data_length(lyb, 9);
+}
+
+/* parse the data from a file of the given size, so the buffer is bounded */
+static struct lyd_node *
+parse_fd(struct ly_ctx *ctx, const char *lyb, int len, int options)
+{
+    struct lyd_node *data;
+    char path[] = "/tmp/libyang_lyb_XXXXXX";
+    int fd;
+
+    fd = mkstemp(path);
+    assert_int_not_equal(fd, -1);
+    unlink(path);
+    assert_int_equal(write(fd, lyb, len), len);
+
+    data = lyd_parse_fd(ctx, fd, LYD_LYB, options);
+    close(fd);
+
+    return data;
+}
+
+static void
+check_data(struct lyd_node *root, const char *expected)
+{
+    char *str;
+
+    assert_int_equal(lyd_print_mem(&str, root, LYD_XML, LYP_WITHSIBLINGS), 0);
+    assert_string_equal(str, expected);
+    free(str);
+}
+
+static void
+test_lyb_values(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *data, *iter;
+    struct lyd_node_leaf_list *leaf;
+    int i;
+
+    st->data = lyd_parse_mem(st->ctx, lyb_data, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+
+    /* native values, strings and the references */
+    for (i = 0; i < 2; ++i) {
+        assert_int_equal(lyd_print_mem(&st->lyb, st->data, LYD_LYB, i ? LYP_LYBSKIP : 0), 0);
+        data = parse_fd(st->ctx, st->lyb, lyb_length(st->lyb), LYD_OPT_CONFIG);
+        free(st->lyb);
+        st->lyb = NULL;
+        assert_non_null(data);
+        check_data(data, lyb_data);
+
+        LY_TREE_FOR(data->child, iter) {
+            leaf = (struct lyd_node_leaf_list *)iter;
+            if (!strcmp(leaf->schema->name, "ref")) {
+                assert_int_equal(leaf->value_type, LY_TYPE_LEAFREF);
+                assert_ptr_equal(leaf->value.leafref, data->child->next->next);
+            } else if (!strcmp(leaf->schema->name, "uinst")) {
+                assert_int_equal(leaf->value_type, LY_TYPE_INT8);
+                assert_int_equal(leaf->value.int8, 5);
+            } else if (!strcmp(leaf->schema->name, "uint64")) {
+                assert_true(leaf->value.uint64 == UINT64_MAX);
+            } else if (!strcmp(leaf->schema->name, "dec64")) {
+                assert_true(leaf->value.dec64 == -1500);
+            }
+        }
+        lyd_free_withsiblings(data);
+    }
+
+    /* no value, a selection node of a filter */
+    lyd_free_withsiblings(st->data);
+    st->data = lyd_parse_mem(st->ctx, "<values xmlns=\"urn:libyang:tests:values\"><int8/><str/></values>", LYD_XML,
+                             LYD_OPT_FILTER);
+    assert_non_null(st->data);
+    assert_int_equal(lyd_print_mem(&st->lyb, st->data, LYD_LYB, 0), 0);
+    data = parse_fd(st->ctx, st->lyb, lyb_length(st->lyb), LYD_OPT_FILTER);
+    assert_non_null(data);
+    leaf = (struct lyd_node_leaf_list *)data->child;
+    assert_non_null(leaf);
+    assert_null(leaf->value_str);
+    assert_non_null(leaf->next);
+    assert_null(((struct lyd_node_leaf_list *)leaf->next)->value_str);
+    lyd_free_withsiblings(data);
+}
+
+static void
+test_lyb_skip(void **state)
+{
+    struct state *st = (*state);
+    struct ly_ctx *ctx;
+    struct lyd_node *data;
+    const char *ext_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>1</int8>"
+  "<flag xmlns=\"urn:libyang:tests:values-ext\">true</flag>"
+  "<item><id>1</id><note xmlns=\"urn:libyang:tests:values-ext\">first</note><name>one</name></item>"
+  "<item><id>2</id><note xmlns=\"urn:libyang:tests:values-ext\">second</note><name>two</name></item>"
+"</values>"
+"<ext xmlns=\"urn:libyang:tests:values-ext\"><a>text</a></ext>";
+    const char *known_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>1</int8>"
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>two</name></item>"
+"</values>";
+
+    /* the data printed with a module the reader does not have */
+    ctx = ly_ctx_new(NULL);
+    assert_non_null(ctx);
+    assert_non_null(lys_parse_path(ctx, TESTS_DIR"/data/files/values.yin", LYS_IN_YIN));
+    assert_non_null(lys_parse_path(ctx, TESTS_DIR"/data/files/values-ext.yin", LYS_IN_YIN));
+    data = lyd_parse_mem(ctx, ext_data, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(data);
+    check_data(data, ext_data);
+
+    /* without the lengths the unknown nodes cannot be skipped */
+    assert_int_equal(lyd_print_mem(&st->lyb, data, LYD_LYB, LYP_WITHSIBLINGS), 0);
+    assert_null(parse_fd(st->ctx, st->lyb, lyb_length(st->lyb), LYD_OPT_CONFIG));
+    assert_int_not_equal(ly_errno, LY_SUCCESS);
+    free(st->lyb);
+
+    /* with them, the augments and the top-level node are skipped, the second item reuses the skipped ID */
+    assert_int_equal(lyd_print_mem(&st->lyb, data, LYD_LYB, LYP_WITHSIBLINGS | LYP_LYBSKIP), 0);
+    lyd_free_withsiblings(data);
+    ly_ctx_destroy(ctx, NULL);
+
+    st->data = parse_fd(st->ctx, st->lyb, lyb_length(st->lyb), LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+    check_data(st->data, known_data);
+
+    /* unless the data are strict */
+    assert_null(parse_fd(st->ctx, st->lyb, lyb_length(st->lyb), LYD_OPT_CONFIG | LYD_OPT_STRICT));
+    assert_int_not_equal(ly_errno, LY_SUCCESS);
+}
+
+static char *
+find_bytes(char *lyb, int len, const char *bytes, int count)
+{
+    int i;
+
+    for (i = 0; i + count <= len; ++i) {
+        if (!memcmp(lyb + i, bytes, count)) {
+            return lyb + i;
+        }
+    }
+    fail();
+    return NULL;
+}
+
+static void
+test_lyb_malformed(void **state)
+{
+    struct state *st = (*state);
+    char *pos;
+    int len, i;
+
+    st->data = lyd_parse_mem(st->ctx, "<values xmlns=\"urn:libyang:tests:values\">"
+                                        "<item><id>1</id></item><item><id>2</id></item>"
+                                      "</values>", LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+    assert_int_equal(lyd_print_mem(&st->lyb, st->data, LYD_LYB, 0), 0);
+    len = lyb_length(st->lyb);
+    assert_true(len > 9);
+
+    /* header */
+    assert_int_equal(lyd_lyb_data_length(st->lyb, 8), -1);
+    assert_int_equal(lyd_lyb_data_length("lyx\1\0\11\0\0\0", 9), -1);
+    assert_int_equal(lyd_lyb_data_length("lyb\1\0\10\0\0\0", 9), -1);
+
+    /* every truncation */
+    for (i = 0; i < len; ++i) {
+        assert_null(parse_fd(st->ctx, st->lyb, i, LYD_OPT_CONFIG));
+        assert_int_not_equal(ly_errno, LY_SUCCESS);
+    }
+    lyd_free_withsiblings(st->data);
+    st->data = parse_fd(st->ctx, st->lyb, len, LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+
+    /* unsupported version */
+    st->lyb[3] = 2;
+    assert_null(lyd_parse_mem(st->ctx, st->lyb, LYD_LYB, LYD_OPT_CONFIG));
+    st->lyb[3] = 1;
+
+    /* an ID never defined, "id" of the first item is defined with ID 4 instead of 3 */
+    pos = find_bytes(st->lyb, len, "\7\0\2id", 5);
+    pos[0] = 9;
+    assert_null(parse_fd(st->ctx, st->lyb, len, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EVALID);
+    pos[0] = 7;
+
+    /* a reused ID of a node that is not a child of its parent, "id" of the second item directly in "values" */
+    pos = find_bytes(st->lyb, len, "\4\0\6\0\0\2\0\0\0", 9);
+    assert_ptr_equal(pos + 9, st->lyb + len);
+    memmove(pos, pos + 2, 4);
+    memcpy(pos + 4, "\0\0", 2);
+    st->lyb[5] -= 3;
+    assert_null(lyd_parse_mem(st->ctx, st->lyb, LYD_LYB, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EVALID);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+                    cmocka_unit_test_setup_teardown(test_lyb_values, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_lyb_skip, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_lyb_malformed, setup_f, teardown_f), };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,237 @@
+/**
+ * @file test_merge.c
+ * @brief Cmocka tests for merging data trees.
+ *
+ * Copyright (c) 2015 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../config.h"
+#include "../../src/libyang.h"
+
+struct state {
+    struct ly_ctx *ctx;
+    struct lyd_node *target;
+    struct lyd_node *source;
+};
+
+static const char *target_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>two</name></item>"
+"</values>";
+
+static const char *source_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>13</int8>"
+  "<item><id>2</id><name>TWO</name></item>"
+  "<item><id>3</id><name>three</name></item>"
+  "<item><id>4</id></item>"
+"</values>";
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+    const char *schemafile = TESTS_DIR"/data/files/values.yin";
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    /* libyang context */
+    st->ctx = ly_ctx_new(NULL);
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return -1;
+    }
+
+    /* schema */
+    if (!lys_parse_path(st->ctx, schemafile, LYS_IN_YIN)) {
+        fprintf(stderr, "Failed to load data model \"%s\".\n", schemafile);
+        return -1;
+    }
+
+    /* data */
+    st->target = lyd_parse_mem(st->ctx, target_data, LYD_XML, LYD_OPT_CONFIG);
+    st->source = lyd_parse_mem(st->ctx, source_data, LYD_XML, LYD_OPT_CONFIG);
+    if (!st->target || !st->source) {
+        fprintf(stderr, "Failed to load initial data.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    lyd_free_withsiblings(st->target);
+    lyd_free_withsiblings(st->source);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+static void
+check_data(struct lyd_node *root, const char *expected)
+{
+    char *str;
+
+    assert_int_equal(lyd_print_mem(&str, root, LYD_XML, 0), 0);
+    assert_string_equal(str, expected);
+    free(str);
+}
+
+/* the list instance with the id */
+static struct lyd_node *
+get_item(const struct lyd_node *root, const char *id)
+{
+    struct lyd_node *iter;
+
+    for (iter = root->child; iter; iter = iter->next) {
+        if (!strcmp(iter->schema->name, "item")
+                && !strcmp(((struct lyd_node_leaf_list *)iter->child)->value_str, id)) {
+            return iter;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_merge(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *item;
+
+    item = get_item(st->target, "2");
+
+    /* the list instances are matched by their keys */
+    assert_int_equal(lyd_merge(st->target, st->source, 0), 0);
+    check_data(st->target,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>13</int8>"
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>TWO</name></item>"
+  "<item><id>3</id><name>three</name></item>"
+  "<item><id>4</id></item>"
+"</values>");
+    assert_ptr_equal(get_item(st->target, "2"), item);
+    assert_int_equal(lyd_validate(st->target, LYD_OPT_CONFIG), 0);
+
+    /* the source is not changed */
+    check_data(st->source, source_data);
+
+    /* merging it again changes nothing */
+    assert_int_equal(lyd_merge(st->target, st->source, 0), 0);
+    assert_ptr_equal(get_item(st->target, "4")->next, NULL);
+}
+
+static void
+test_merge_destruct(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *item;
+
+    item = get_item(st->source, "3");
+
+    assert_int_equal(lyd_merge(st->target, st->source, LYD_MERGEOPT_DESTRUCT), 0);
+    st->source = NULL;
+    check_data(st->target,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>13</int8>"
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>TWO</name></item>"
+  "<item><id>3</id><name>three</name></item>"
+  "<item><id>4</id></item>"
+"</values>");
+
+    /* the new instances are moved, not copied */
+    assert_ptr_equal(get_item(st->target, "3"), item);
+    assert_ptr_equal(item->parent, st->target);
+}
+
+static void
+test_merge_nosiblings(void **state)
+{
+    struct state *st = (*state);
+
+    /* merge the children of the target container, only the instance 3 */
+    assert_int_equal(lyd_merge(st->target, get_item(st->source, "3"), LYD_MERGEOPT_NOSIBLINGS), 0);
+    check_data(st->target,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>two</name></item>"
+  "<item><id>3</id><name>three</name></item>"
+"</values>");
+
+    /* the instance 2 with its siblings */
+    assert_int_equal(lyd_merge(st->target, get_item(st->source, "2"), 0), 0);
+    check_data(st->target,
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>13</int8>"
+  "<item><id>1</id><name>one</name></item>"
+  "<item><id>2</id><name>TWO</name></item>"
+  "<item><id>3</id><name>three</name></item>"
+  "<item><id>4</id></item>"
+"</values>");
+
+    /* destructive merge of a single node frees only it */
+    lyd_free_withsiblings(st->target);
+    st->target = lyd_parse_mem(st->ctx, target_data, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(st->target);
+    assert_int_equal(lyd_merge(st->target, get_item(st->source, "4"), LYD_MERGEOPT_DESTRUCT | LYD_MERGEOPT_NOSIBLINGS), 0);
+    assert_null(get_item(st->source, "4"));
+    assert_non_null(get_item(st->source, "3"));
+    assert_non_null(get_item(st->target, "4"));
+}
+
+static void
+test_merge_invalid(void **state)
+{
+    struct state *st = (*state);
+
+    /* the source is not a child or a sibling of the target */
+    assert_int_not_equal(lyd_merge(get_item(st->target, "1"), st->source, 0), 0);
+    check_data(st->target, target_data);
+    assert_int_not_equal(lyd_merge(NULL, st->source, 0), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+                    cmocka_unit_test_setup_teardown(test_merge, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_merge_destruct, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_merge_nosiblings, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_merge_invalid, setup_f, teardown_f), };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
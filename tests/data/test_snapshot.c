@@ -0,0 +1,418 @@
+/**
+ * @file test_snapshot.c
+ * @brief Cmocka tests for read-only data tree snapshots.
+ *
+ * Copyright (c) 2015 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../config.h"
+#include "../../src/libyang.h"
+
+struct state {
+    struct ly_ctx *ctx;
+    struct lyd_node *data;
+    struct lyd_snapshot *snap;
+};
+
+static const char *snap_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>12</int8>"
+  "<str>text</str>"
+  "<ref>12</ref>"
+  "<inst xmlns:v=\"urn:libyang:tests:values\">/v:values/v:int8</inst>"
+  "<uinst xmlns:v=\"urn:libyang:tests:values\">/v:values/v:str</uinst>"
+  "<item><id>1</id><name>one</name></item>"
+"</values>";
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+    const char *schemafile = TESTS_DIR"/data/files/values.yin";
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    /* libyang context */
+    st->ctx = ly_ctx_new(NULL);
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return -1;
+    }
+
+    /* schema */
+    if (!lys_parse_path(st->ctx, schemafile, LYS_IN_YIN)) {
+        fprintf(stderr, "Failed to load data model \"%s\".\n", schemafile);
+        return -1;
+    }
+
+    /* data */
+    st->data = lyd_parse_mem(st->ctx, snap_data, LYD_XML, LYD_OPT_CONFIG);
+    if (!st->data) {
+        fprintf(stderr, "Failed to load initial data.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    lyd_snapshot_unref(st->snap);
+    lyd_free_withsiblings(st->data);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+static struct lyd_node_leaf_list *
+get_leaf(const struct lyd_node *root, const char *name)
+{
+    struct lyd_node *iter;
+
+    for (iter = root->child; iter; iter = iter->next) {
+        if (!strcmp(iter->schema->name, name)) {
+            return (struct lyd_node_leaf_list *)iter;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_snapshot_refs(void **state)
+{
+    struct state *st = (*state);
+    const struct lyd_node *root;
+    struct lyd_node_leaf_list *leaf;
+
+    st->snap = lyd_snapshot_new(st->data);
+    assert_non_null(st->snap);
+
+    /* the references must not outlive the original tree */
+    lyd_free_withsiblings(st->data);
+    st->data = NULL;
+
+    root = lyd_snapshot_data(st->snap);
+    assert_non_null(root);
+    assert_true(root->flags & LYD_NODE_RDONLY);
+
+    leaf = get_leaf(root, "ref");
+    assert_int_equal(leaf->value_type, LY_TYPE_LEAFREF);
+    assert_ptr_equal(leaf->value.leafref, get_leaf(root, "int8"));
+
+    leaf = get_leaf(root, "inst");
+    assert_int_equal(leaf->value_type, LY_TYPE_INST);
+    assert_ptr_equal(leaf->value.instance, get_leaf(root, "int8"));
+
+    /* union member */
+    leaf = get_leaf(root, "uinst");
+    assert_int_equal(leaf->value_type, LY_TYPE_INST);
+    assert_ptr_equal(leaf->value.instance, get_leaf(root, "str"));
+}
+
+/* print the data into a temporary file for lyd_snapshot_load(), only len bytes of them if not -1 */
+static void
+write_file(char *path, const struct lyd_node *data, LYD_FORMAT format, int len)
+{
+    char *str;
+    int fd;
+
+    fd = mkstemp(path);
+    assert_int_not_equal(fd, -1);
+    assert_int_equal(lyd_print_mem(&str, data, format, LYP_WITHSIBLINGS), 0);
+    if (len == -1) {
+        len = (format == LYD_LYB) ? lyd_lyb_data_length(str, 9) : (int)strlen(str);
+    }
+    assert_int_equal(write(fd, str, len), len);
+    free(str);
+    close(fd);
+}
+
+static void
+check_data(const struct lyd_node *root, const char *expected)
+{
+    char *str;
+
+    assert_int_equal(lyd_print_mem(&str, root, LYD_XML, LYP_WITHSIBLINGS), 0);
+    assert_string_equal(str, expected);
+    free(str);
+}
+
+static void
+test_snapshot_load(void **state)
+{
+    struct state *st = (*state);
+    const struct lyd_node *root;
+    struct lyd_node *dup, *copy;
+    struct lyd_node_leaf_list *leaf;
+    char path[] = "/tmp/libyang_snap_XXXXXX", *expected, *str;
+    int options[] = {LYD_OPT_CONFIG, LYD_OPT_CONFIG | LYD_OPT_TRUSTED, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY,
+                     LYD_OPT_CONFIG | LYD_OPT_TYPED}, i;
+
+    assert_int_equal(lyd_print_mem(&expected, st->data, LYD_XML, LYP_WITHSIBLINGS), 0);
+    write_file(path, st->data, LYD_LYB, -1);
+
+    for (i = 0; i < 4; ++i) {
+        st->snap = lyd_snapshot_load(st->ctx, path, options[i]);
+        assert_non_null(st->snap);
+
+        root = lyd_snapshot_data(st->snap);
+        assert_non_null(root);
+        check_data(root, expected);
+
+        /* all the nodes are in the arena of the snapshot */
+        assert_true(root->flags & LYD_NODE_RDONLY);
+        assert_true(root->flags & LYD_NODE_ARENA);
+        leaf = get_leaf(root, "str");
+        assert_true(leaf->flags & LYD_NODE_RDONLY);
+        assert_true(leaf->flags & LYD_NODE_ARENA);
+        assert_true(root->child->prev->flags & LYD_NODE_ARENA);
+
+        /* the values are parsed and the references resolved */
+        assert_int_equal(get_leaf(root, "int8")->value_type, LY_TYPE_INT8);
+        assert_int_equal(get_leaf(root, "int8")->value.int8, 12);
+        assert_string_equal(lyd_value_str(get_leaf(root, "int8")), "12");
+        leaf = get_leaf(root, "ref");
+        assert_int_equal(leaf->value_type, LY_TYPE_LEAFREF);
+        assert_ptr_equal(leaf->value.leafref, get_leaf(root, "int8"));
+        leaf = get_leaf(root, "uinst");
+        assert_int_equal(leaf->value_type, LY_TYPE_INST);
+        assert_ptr_equal(leaf->value.instance, get_leaf(root, "str"));
+
+        /* a writable copy */
+        dup = lyd_dup(root, 1);
+        assert_non_null(dup);
+        assert_false(dup->flags & (LYD_NODE_RDONLY | LYD_NODE_ARENA));
+        assert_false(dup->child->flags & (LYD_NODE_RDONLY | LYD_NODE_ARENA));
+        check_data(dup, expected);
+        assert_int_equal(lyd_validate(dup, LYD_OPT_CONFIG), 0);
+        assert_ptr_equal(get_leaf(dup, "ref")->value.leafref, get_leaf(dup, "int8"));
+        assert_ptr_equal(get_leaf(dup, "uinst")->value.instance, get_leaf(dup, "str"));
+
+        /* a reference out of the copy is left unresolved, with its value */
+        copy = lyd_dup((struct lyd_node *)get_leaf(root, "ref"), 0);
+        assert_non_null(copy);
+        assert_null(((struct lyd_node_leaf_list *)copy)->value.leafref);
+        assert_int_equal(lyd_print_mem(&str, copy, LYD_XML, 0), 0);
+        assert_string_equal(str, "<ref xmlns=\"urn:libyang:tests:values\">12</ref>");
+        free(str);
+        lyd_free(copy);
+
+        /* shared by another reader, the data outlive the first reference */
+        assert_ptr_equal(lyd_snapshot_ref(st->snap), st->snap);
+        lyd_snapshot_unref(st->snap);
+        check_data(lyd_snapshot_data(st->snap), expected);
+        lyd_snapshot_unref(st->snap);
+        st->snap = NULL;
+
+        /* and the copy outlives the snapshot */
+        check_data(dup, expected);
+        lyd_free(dup);
+    }
+    unlink(path);
+    free(expected);
+}
+
+static void
+test_snapshot_load_invalid(void **state)
+{
+    struct state *st = (*state);
+    char path[] = "/tmp/libyang_snap_XXXXXX";
+    int len;
+    char *lyb;
+
+    /* missing file */
+    assert_null(lyd_snapshot_load(st->ctx, "/nonexistent/libyang_snap", LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_ESYS);
+
+    /* invalid arguments */
+    assert_null(lyd_snapshot_load(NULL, "/tmp", LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    assert_null(lyd_snapshot_load(st->ctx, NULL, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    assert_null(lyd_snapshot_load(st->ctx, "/tmp", LYD_OPT_RPCREPLY));
+    assert_int_equal(ly_errno, LY_EINVAL);
+
+    /* not LYB data */
+    write_file(path, st->data, LYD_XML, -1);
+    assert_null(lyd_snapshot_load(st->ctx, path, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    unlink(path);
+
+    /* truncated, in the header and in the data */
+    assert_int_equal(lyd_print_mem(&lyb, st->data, LYD_LYB, 0), 0);
+    len = lyd_lyb_data_length(lyb, 9);
+    free(lyb);
+    strcpy(path, "/tmp/libyang_snap_XXXXXX");
+    write_file(path, st->data, LYD_LYB, 5);
+    assert_null(lyd_snapshot_load(st->ctx, path, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    unlink(path);
+    strcpy(path, "/tmp/libyang_snap_XXXXXX");
+    write_file(path, st->data, LYD_LYB, len - 1);
+    assert_null(lyd_snapshot_load(st->ctx, path, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    unlink(path);
+
+    /* invalid data, a leafref without its target */
+    lyd_free_withsiblings(st->data);
+    st->data = lyd_parse_mem(st->ctx, "<values xmlns=\"urn:libyang:tests:values\"><ref>13</ref></values>", LYD_XML,
+                             LYD_OPT_EDIT);
+    assert_non_null(st->data);
+    strcpy(path, "/tmp/libyang_snap_XXXXXX");
+    write_file(path, st->data, LYD_LYB, -1);
+    assert_null(lyd_snapshot_load(st->ctx, path, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EVALID);
+    unlink(path);
+}
+
+/* every function modifying a data tree fails on a snapshot, leaving it intact */
+static void
+check_rdonly(struct ly_ctx *ctx, const struct lyd_snapshot *snap, const char *expected)
+{
+    struct lyd_node *root, *node, *copy, *copy_root;
+    struct lyd_node_leaf_list *leaf;
+
+    root = (struct lyd_node *)lyd_snapshot_data(snap);
+    leaf = get_leaf(root, "str");
+    assert_non_null(leaf->attr);
+    copy_root = lyd_dup(root, 1);
+    assert_non_null(copy_root);
+    copy = lyd_dup((struct lyd_node *)leaf, 0);
+    assert_non_null(copy);
+
+    ly_errno = LY_SUCCESS;
+    assert_null(lyd_new(root, NULL, "item"));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_null(lyd_new_leaf(root, NULL, "bool", "true"));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_null(lyd_new_anyxml(root, NULL, "any", "<a/>"));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_change_leaf(leaf, "other"), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+
+    /* inserting into the snapshot and the snapshot nodes elsewhere */
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_insert(root, copy), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_insert(copy_root, (struct lyd_node *)leaf), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_insert_before((struct lyd_node *)leaf, copy), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_insert_after((struct lyd_node *)leaf, copy), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_insert_after(copy_root->child, (struct lyd_node *)leaf), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_validate(root, LYD_OPT_CONFIG), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_merge(root, copy_root, 0), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_merge(copy_root, root, LYD_MERGEOPT_DESTRUCT), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    node = root;
+    assert_int_not_equal(lyd_apply_edit(&node, copy_root, 0), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    assert_ptr_equal(node, root);
+
+    ly_errno = LY_SUCCESS;
+    assert_int_not_equal(lyd_unlink((struct lyd_node *)leaf), 0);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    lyd_free((struct lyd_node *)leaf);
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    lyd_free_withsiblings(root);
+    assert_int_equal(ly_errno, LY_EINVAL);
+
+    ly_errno = LY_SUCCESS;
+    assert_null(lyd_insert_attr(root, "values:other", "1"));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_errno = LY_SUCCESS;
+    lyd_free_attr(ctx, (struct lyd_node *)leaf, leaf->attr, 1);
+    assert_int_equal(ly_errno, LY_EINVAL);
+
+    /* nothing changed */
+    check_data(root, expected);
+    assert_non_null(leaf->attr);
+
+    /* the copies are writable */
+    assert_int_equal(lyd_insert(copy_root, copy), 0);
+    lyd_free(copy_root);
+}
+
+static void
+test_snapshot_rdonly(void **state)
+{
+    struct state *st = (*state);
+    char path[] = "/tmp/libyang_snap_XXXXXX", *expected;
+
+    assert_non_null(lyd_insert_attr(st->data->child->next, "values:note", "x"));
+    assert_int_equal(lyd_print_mem(&expected, st->data, LYD_XML, LYP_WITHSIBLINGS), 0);
+
+    /* a copy */
+    st->snap = lyd_snapshot_new(st->data);
+    assert_non_null(st->snap);
+    check_rdonly(st->ctx, st->snap, expected);
+    lyd_snapshot_unref(st->snap);
+
+    /* and a loaded one */
+    write_file(path, st->data, LYD_LYB, -1);
+    st->snap = lyd_snapshot_load(st->ctx, path, LYD_OPT_CONFIG);
+    unlink(path);
+    assert_non_null(st->snap);
+    check_rdonly(st->ctx, st->snap, expected);
+
+    free(expected);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+                    cmocka_unit_test_setup_teardown(test_snapshot_refs, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_snapshot_load, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_snapshot_load_invalid, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_snapshot_rdonly, setup_f, teardown_f), };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
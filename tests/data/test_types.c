@@ -0,0 +1,437 @@
+/**
+ * @file test_types.c
+ * @brief Cmocka tests for the restrictions of the built-in and derived types.
+ *
+ * Copyright (c) 2016 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../config.h"
+#include "../../src/libyang.h"
+
+struct state {
+    struct ly_ctx *ctx;
+    struct lyd_node *data;
+};
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+    const char *schemafile = TESTS_DIR"/data/files/types.yin";
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    /* libyang context */
+    st->ctx = ly_ctx_new(NULL);
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return -1;
+    }
+
+    /* schema */
+    if (!lys_parse_path(st->ctx, schemafile, LYS_IN_YIN)) {
+        fprintf(stderr, "Failed to load data model \"%s\".\n", schemafile);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    lyd_free_withsiblings(st->data);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+/* parse a single leaf of the types container, NULL if the value is refused */
+static struct lyd_node_leaf_list *
+parse_leaf(struct state *st, const char *name, const char *value)
+{
+    char data[512];
+
+    lyd_free_withsiblings(st->data);
+    snprintf(data, sizeof data, "<types xmlns=\"urn:libyang:tests:types\" xmlns:t=\"urn:libyang:tests:types\" "
+             "xmlns:te=\"urn:libyang:tests:types-ext\"><%s>%s</%s></types>", name, value, name);
+    st->data = lyd_parse_mem(st->ctx, data, LYD_XML, LYD_OPT_CONFIG);
+    if (!st->data) {
+        return NULL;
+    }
+
+    assert_non_null(st->data->child);
+    assert_string_equal(st->data->child->schema->name, name);
+    return (struct lyd_node_leaf_list *)st->data->child;
+}
+
+static void
+test_range_edges(void **state)
+{
+    struct state *st = (*state);
+
+    /* min..10 | 250..max */
+    assert_non_null(parse_leaf(st, "u8", "0"));
+    assert_non_null(parse_leaf(st, "u8", "10"));
+    assert_null(parse_leaf(st, "u8", "11"));
+    assert_null(parse_leaf(st, "u8", "249"));
+    assert_non_null(parse_leaf(st, "u8", "250"));
+    assert_non_null(parse_leaf(st, "u8", "255"));
+    assert_null(parse_leaf(st, "u8", "256"));
+
+    /* 1..100 | 9223372036854775800..max */
+    assert_null(parse_leaf(st, "u64", "0"));
+    assert_non_null(parse_leaf(st, "u64", "1"));
+    assert_non_null(parse_leaf(st, "u64", "100"));
+    assert_null(parse_leaf(st, "u64", "101"));
+    assert_null(parse_leaf(st, "u64", "9223372036854775799"));
+    assert_non_null(parse_leaf(st, "u64", "9223372036854775800"));
+    assert_non_null(parse_leaf(st, "u64", "9223372036854775808"));
+    assert_non_null(parse_leaf(st, "u64", "18446744073709551615"));
+
+    /* min..-9223372036854775800 | 9223372036854775800..max */
+    assert_non_null(parse_leaf(st, "i64", "-9223372036854775808"));
+    assert_non_null(parse_leaf(st, "i64", "-9223372036854775800"));
+    assert_null(parse_leaf(st, "i64", "-9223372036854775799"));
+    assert_null(parse_leaf(st, "i64", "0"));
+    assert_null(parse_leaf(st, "i64", "9223372036854775799"));
+    assert_non_null(parse_leaf(st, "i64", "9223372036854775800"));
+    assert_non_null(parse_leaf(st, "i64", "9223372036854775807"));
+
+    /* -1..1 | 10..11 */
+    assert_null(parse_leaf(st, "dec", "-1.01"));
+    assert_non_null(parse_leaf(st, "dec", "-1"));
+    assert_non_null(parse_leaf(st, "dec", "-0.99"));
+    assert_non_null(parse_leaf(st, "dec", "1.00"));
+    assert_null(parse_leaf(st, "dec", "1.01"));
+    assert_null(parse_leaf(st, "dec", "9.99"));
+    assert_non_null(parse_leaf(st, "dec", "10"));
+    assert_non_null(parse_leaf(st, "dec", "11"));
+    assert_null(parse_leaf(st, "dec", "11.01"));
+}
+
+static void
+test_range_gaps(void **state)
+{
+    struct state *st = (*state);
+
+    /* -10..-5 | 0 | 10..20 | 30..40 */
+    assert_null(parse_leaf(st, "split", "-11"));
+    assert_non_null(parse_leaf(st, "split", "-10"));
+    assert_non_null(parse_leaf(st, "split", "-5"));
+    assert_null(parse_leaf(st, "split", "-4"));
+    assert_null(parse_leaf(st, "split", "-1"));
+    assert_non_null(parse_leaf(st, "split", "0"));
+    assert_null(parse_leaf(st, "split", "1"));
+    assert_null(parse_leaf(st, "split", "9"));
+    assert_non_null(parse_leaf(st, "split", "10"));
+    assert_non_null(parse_leaf(st, "split", "20"));
+    assert_null(parse_leaf(st, "split", "21"));
+    assert_null(parse_leaf(st, "split", "29"));
+    assert_non_null(parse_leaf(st, "split", "30"));
+    assert_non_null(parse_leaf(st, "split", "40"));
+    assert_null(parse_leaf(st, "split", "41"));
+}
+
+static void
+test_range_derived(void **state)
+{
+    struct state *st = (*state);
+
+    /* the typedef restricts -10..-5 | 0 | 10..20 | 30..40 to -7..-5 | 12..18 */
+    assert_null(parse_leaf(st, "narrow", "-10"));
+    assert_null(parse_leaf(st, "narrow", "-8"));
+    assert_non_null(parse_leaf(st, "narrow", "-7"));
+    assert_non_null(parse_leaf(st, "narrow", "-5"));
+    assert_null(parse_leaf(st, "narrow", "0"));
+    assert_null(parse_leaf(st, "narrow", "10"));
+    assert_null(parse_leaf(st, "narrow", "11"));
+    assert_non_null(parse_leaf(st, "narrow", "12"));
+    assert_non_null(parse_leaf(st, "narrow", "18"));
+    assert_null(parse_leaf(st, "narrow", "19"));
+    assert_null(parse_leaf(st, "narrow", "30"));
+}
+
+static void
+test_length_edges(void **state)
+{
+    struct state *st = (*state);
+
+    /* 2..4 | 8 */
+    assert_null(parse_leaf(st, "str", "a"));
+    assert_non_null(parse_leaf(st, "str", "ab"));
+    assert_non_null(parse_leaf(st, "str", "abcd"));
+    assert_null(parse_leaf(st, "str", "abcde"));
+    assert_null(parse_leaf(st, "str", "abcdefg"));
+    assert_non_null(parse_leaf(st, "str", "abcdefgh"));
+    assert_null(parse_leaf(st, "str", "abcdefghi"));
+
+    /* 4 | 8..12, checked on the encoded value */
+    assert_null(parse_leaf(st, "bin", "AQI"));
+    assert_non_null(parse_leaf(st, "bin", "AQI="));
+    assert_null(parse_leaf(st, "bin", "AQIDB"));
+    assert_null(parse_leaf(st, "bin", "AQIDBAU"));
+    assert_non_null(parse_leaf(st, "bin", "AQIDBAU="));
+    assert_non_null(parse_leaf(st, "bin", "AQIDBAUGBwgJ"));
+    assert_null(parse_leaf(st, "bin", "AQIDBAUGBwgJCg=="));
+}
+
+static void
+test_typedef_chain(void **state)
+{
+    struct state *st = (*state);
+
+    /* [a-z0-9]*, then length 1..6 and [a-z].*, then [^x]* */
+    assert_non_null(parse_leaf(st, "chain", "a"));
+    assert_non_null(parse_leaf(st, "chain", "abc123"));
+    assert_null(parse_leaf(st, "chain", ""));
+    assert_null(parse_leaf(st, "chain", "Abc"));
+    assert_null(parse_leaf(st, "chain", "1bc"));
+    assert_null(parse_leaf(st, "chain", "abx"));
+    assert_null(parse_leaf(st, "chain", "abcdefg"));
+
+    /* the leaf adds .*z to the patterns of the typedefs */
+    assert_non_null(parse_leaf(st, "chain-pat", "abz"));
+    assert_null(parse_leaf(st, "chain-pat", "abc"));
+    assert_null(parse_leaf(st, "chain-pat", "Abz"));
+    assert_null(parse_leaf(st, "chain-pat", "1bz"));
+    assert_null(parse_leaf(st, "chain-pat", "abcdefz"));
+}
+
+static void
+test_typedef_override(void **state)
+{
+    struct state *st = (*state);
+
+    /* length 1..6 of the typedef restricted to 2..3, the patterns still apply */
+    assert_null(parse_leaf(st, "chain-len", "a"));
+    assert_non_null(parse_leaf(st, "chain-len", "ab"));
+    assert_non_null(parse_leaf(st, "chain-len", "abc"));
+    assert_null(parse_leaf(st, "chain-len", "abcd"));
+    assert_null(parse_leaf(st, "chain-len", "1b"));
+    assert_null(parse_leaf(st, "chain-len", "ax"));
+
+    /* range 0..100 of the typedef restricted to 0..50 */
+    assert_non_null(parse_leaf(st, "half", "0"));
+    assert_non_null(parse_leaf(st, "half", "50"));
+    assert_null(parse_leaf(st, "half", "51"));
+    assert_null(parse_leaf(st, "half", "100"));
+}
+
+static void
+test_names_unknown(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node_leaf_list *leaf;
+
+    leaf = parse_leaf(st, "enm", "two");
+    assert_non_null(leaf);
+    assert_int_equal(leaf->value_type, LY_TYPE_ENUM);
+    assert_string_equal(leaf->value.enm->name, "two");
+    assert_null(parse_leaf(st, "enm", "three"));
+    assert_null(parse_leaf(st, "enm", "Two"));
+    assert_null(parse_leaf(st, "enm", "tw"));
+    assert_null(parse_leaf(st, "enm", "twoo"));
+
+    leaf = parse_leaf(st, "bts", "one two");
+    assert_non_null(leaf);
+    assert_true(lyd_bits_isset(leaf, 0));
+    assert_true(lyd_bits_isset(leaf, 1));
+    assert_null(parse_leaf(st, "bts", "one three"));
+    assert_null(parse_leaf(st, "bts", "on"));
+
+    leaf = parse_leaf(st, "ident", "t:local-id");
+    assert_non_null(leaf);
+    assert_int_equal(leaf->value_type, LY_TYPE_IDENT);
+    assert_string_equal(leaf->value.ident->name, "local-id");
+    assert_null(parse_leaf(st, "ident", "t:unknown"));
+    assert_null(parse_leaf(st, "ident", "t:local"));
+    assert_null(parse_leaf(st, "ident", "x:local-id"));
+}
+
+static void
+test_ident_modules(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node_leaf_list *leaf;
+    const char *schemafile = TESTS_DIR"/data/files/types-ext.yin";
+
+    /* the derived identities are not known yet */
+    assert_null(parse_leaf(st, "ident", "te:ext-id"));
+    assert_non_null(lys_parse_path(st->ctx, schemafile, LYS_IN_YIN));
+
+    leaf = parse_leaf(st, "ident", "te:ext-id");
+    assert_non_null(leaf);
+    assert_string_equal(leaf->value.ident->name, "ext-id");
+    assert_string_equal(leaf->value.ident->module->name, "types-ext");
+
+    /* derived from a derived identity */
+    leaf = parse_leaf(st, "ident", "te:ext-sub");
+    assert_non_null(leaf);
+    assert_string_equal(leaf->value.ident->name, "ext-sub");
+    assert_string_equal(leaf->value.ident->base->name, "ext-id");
+
+    /* the same name derived in both modules, told apart by the prefix */
+    leaf = parse_leaf(st, "ident", "t:twin");
+    assert_non_null(leaf);
+    assert_string_equal(leaf->value.ident->module->name, "types");
+    leaf = parse_leaf(st, "ident", "te:twin");
+    assert_non_null(leaf);
+    assert_string_equal(leaf->value.ident->module->name, "types-ext");
+
+    /* a known name with the prefix of the other module */
+    assert_null(parse_leaf(st, "ident", "te:local-id"));
+    assert_null(parse_leaf(st, "ident", "t:ext-id"));
+    assert_null(parse_leaf(st, "ident", "t:ext-sub"));
+}
+
+static void
+test_names_many(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node_leaf_list *leaf;
+    char *schema, *data;
+    int i, len;
+
+    /* enough members for the hash buckets to be shared */
+    schema = malloc(64 * 1024);
+    assert_non_null(schema);
+    len = sprintf(schema, "<module name=\"types-many\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\">"
+                  "<namespace uri=\"urn:libyang:tests:types-many\"/><prefix value=\"tm\"/>"
+                  "<container name=\"many\"><leaf name=\"enm\"><type name=\"enumeration\">");
+    for (i = 0; i < 500; ++i) {
+        len += sprintf(schema + len, "<enum name=\"n%d\"><value value=\"%d\"/></enum>", i, 1000 - i);
+    }
+    len += sprintf(schema + len, "</type></leaf><leaf name=\"bts\"><type name=\"bits\">");
+    for (i = 0; i < 500; ++i) {
+        len += sprintf(schema + len, "<bit name=\"n%d\"/>", i);
+    }
+    sprintf(schema + len, "</type></leaf></container></module>");
+    assert_non_null(lys_parse_mem(st->ctx, schema, LYS_IN_YIN));
+    free(schema);
+
+    data = malloc(128);
+    assert_non_null(data);
+    for (i = 0; i < 500; ++i) {
+        sprintf(data, "<many xmlns=\"urn:libyang:tests:types-many\"><enm>n%d</enm><bts>n%d n%d</bts></many>",
+                i, (i < 250) ? i : 499 - i, (i < 250) ? 499 - i : i);
+        lyd_free_withsiblings(st->data);
+        st->data = lyd_parse_mem(st->ctx, data, LYD_XML, LYD_OPT_CONFIG);
+        assert_non_null(st->data);
+
+        leaf = (struct lyd_node_leaf_list *)st->data->child;
+        assert_int_equal(leaf->value.enm->value, 1000 - i);
+        leaf = (struct lyd_node_leaf_list *)leaf->next;
+        assert_true(lyd_bits_isset(leaf, i));
+        assert_true(lyd_bits_isset(leaf, 499 - i));
+        assert_int_equal(lyd_bits_isset(leaf, (i + 1) % 500), ((i + 1) % 500) == 499 - i);
+    }
+
+    sprintf(data, "<many xmlns=\"urn:libyang:tests:types-many\"><enm>n500</enm></many>");
+    assert_null(lyd_parse_mem(st->ctx, data, LYD_XML, LYD_OPT_CONFIG));
+    sprintf(data, "<many xmlns=\"urn:libyang:tests:types-many\"><bts>n1 n500</bts></many>");
+    assert_null(lyd_parse_mem(st->ctx, data, LYD_XML, LYD_OPT_CONFIG));
+    free(data);
+}
+
+static void
+check_uni(struct state *st, const char *value, LY_DATA_TYPE type)
+{
+    struct lyd_node_leaf_list *leaf;
+
+    leaf = parse_leaf(st, "uni", value);
+    assert_non_null(leaf);
+    assert_int_equal(leaf->value_type, type);
+    assert_string_equal(leaf->value_str, value);
+}
+
+static void
+test_union_alternate(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node_leaf_list *leaf;
+    uint64_t mispred;
+
+    /* int8 | enumeration { auto } | decimal64 | string, the enum is the only member tried out of order */
+    check_uni(st, "5", LY_TYPE_INT8);
+    assert_int_equal(((struct lyd_node_leaf_list *)st->data->child)->value.int8, 5);
+    check_uni(st, "auto", LY_TYPE_ENUM);
+    mispred = ly_ctx_get_union_mispredictions(st->ctx);
+    check_uni(st, "auto", LY_TYPE_ENUM);
+    assert_int_equal(ly_ctx_get_union_mispredictions(st->ctx), mispred);
+
+    /* the remembered enum does not match, still the first member */
+    check_uni(st, "5", LY_TYPE_INT8);
+    assert_int_equal(ly_ctx_get_union_mispredictions(st->ctx), mispred + 1);
+
+    /* out of the int8 range */
+    check_uni(st, "200", LY_TYPE_DEC64);
+    assert_int_equal(((struct lyd_node_leaf_list *)st->data->child)->value.dec64, 20000);
+    check_uni(st, "1.5", LY_TYPE_DEC64);
+    assert_int_equal(((struct lyd_node_leaf_list *)st->data->child)->value.dec64, 150);
+
+    /* a decimal64 was the previous value, but int8 comes first */
+    check_uni(st, "-7", LY_TYPE_INT8);
+    assert_int_equal(((struct lyd_node_leaf_list *)st->data->child)->value.int8, -7);
+
+    /* numeric-looking strings */
+    check_uni(st, "12abc", LY_TYPE_STRING);
+    check_uni(st, "1.555", LY_TYPE_STRING);
+    check_uni(st, "12", LY_TYPE_INT8);
+    check_uni(st, "auto", LY_TYPE_ENUM);
+    check_uni(st, "autos", LY_TYPE_STRING);
+    check_uni(st, "auto", LY_TYPE_ENUM);
+    check_uni(st, "1000", LY_TYPE_DEC64);
+    check_uni(st, "auto", LY_TYPE_ENUM);
+    check_uni(st, "1.25", LY_TYPE_DEC64);
+
+    leaf = parse_leaf(st, "uni", "127");
+    assert_non_null(leaf);
+    assert_int_equal(leaf->value_type, LY_TYPE_INT8);
+    assert_int_equal(leaf->value.int8, 127);
+}
+
+int
+main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_range_edges, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_range_gaps, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_range_derived, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_length_edges, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_typedef_chain, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_typedef_override, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_names_unknown, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_ident_modules, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_names_many, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_union_alternate, setup_f, teardown_f), };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,604 @@
+/**
+ * @file test_values.c
+ * @brief Cmocka tests for the internal representation of data node values.
+ *
+ * Copyright (c) 2015 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../config.h"
+#include "../../src/libyang.h"
+#include "../../src/dict_private.h"
+
+struct state {
+    struct ly_ctx *ctx;
+    struct lyd_node *data;
+};
+
+static const char *bits_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<small>a c</small>"
+  "<wide64>b0 b31 b63</wide64>"
+  "<wide>b1 b64 b69</wide>"
+"</values>";
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+    const char *schemafile = TESTS_DIR"/data/files/values.yin";
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    /* libyang context */
+    st->ctx = ly_ctx_new(NULL);
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return -1;
+    }
+
+    /* schema */
+    if (!lys_parse_path(st->ctx, schemafile, LYS_IN_YIN)) {
+        fprintf(stderr, "Failed to load data model \"%s\".\n", schemafile);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    lyd_free_withsiblings(st->data);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+static struct lyd_node_leaf_list *
+get_leaf(struct lyd_node *root, const char *name)
+{
+    struct lyd_node *iter;
+
+    for (iter = root->child; iter; iter = iter->next) {
+        if (!strcmp(iter->schema->name, name)) {
+            return (struct lyd_node_leaf_list *)iter;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+check_bits(struct lyd_node *root)
+{
+    struct lyd_node_leaf_list *leaf;
+    uint32_t i;
+
+    leaf = get_leaf(root, "small");
+    assert_non_null(leaf);
+    assert_int_equal(leaf->value_type, LY_TYPE_BITS);
+    assert_false(leaf->flags & LYD_NODE_BITS_EXT);
+    assert_true(lyd_bits_isset(leaf, 0));
+    assert_false(lyd_bits_isset(leaf, 1));
+    assert_true(lyd_bits_isset(leaf, 2));
+    assert_false(lyd_bits_isset(leaf, 3));
+
+    /* all the 64 bits fit into the value */
+    leaf = get_leaf(root, "wide64");
+    assert_non_null(leaf);
+    assert_false(leaf->flags & LYD_NODE_BITS_EXT);
+    for (i = 0; i < 64; ++i) {
+        assert_int_equal(lyd_bits_isset(leaf, i), (i == 0) || (i == 31) || (i == 63));
+    }
+    assert_false(lyd_bits_isset(leaf, 64));
+
+    leaf = get_leaf(root, "wide");
+    assert_non_null(leaf);
+    assert_true(leaf->flags & LYD_NODE_BITS_EXT);
+    for (i = 0; i < 70; ++i) {
+        assert_int_equal(lyd_bits_isset(leaf, i), (i == 1) || (i == 64) || (i == 69));
+    }
+    assert_false(lyd_bits_isset(leaf, 128));
+}
+
+static void
+test_bits_parse(void **state)
+{
+    struct state *st = (*state);
+
+    st->data = lyd_parse_mem(st->ctx, bits_data, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+    check_bits(st->data);
+
+    /* not a bits value */
+    assert_false(lyd_bits_isset(NULL, 0));
+    assert_int_equal(ly_errno, LY_EINVAL);
+}
+
+static void
+test_bits_dup(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *dup;
+
+    st->data = lyd_parse_mem(st->ctx, bits_data, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+
+    dup = lyd_dup(st->data, 1);
+    assert_non_null(dup);
+    check_bits(dup);
+
+    /* the duplicate owns its bitmap */
+    lyd_free(st->data);
+    st->data = dup;
+    check_bits(st->data);
+}
+
+static void
+test_dup_childless(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *dup;
+
+    st->data = lyd_parse_mem(st->ctx, bits_data, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+
+    /* recursive duplication of a node without children does not continue to its siblings */
+    dup = lyd_dup(st->data->child, 1);
+    assert_non_null(dup);
+    assert_ptr_equal(dup->next, NULL);
+    assert_ptr_equal(dup->prev, dup);
+    assert_string_equal(dup->schema->name, "small");
+    lyd_free(dup);
+
+    /* the last child */
+    dup = lyd_dup(st->data->child->prev, 1);
+    assert_non_null(dup);
+    assert_ptr_equal(dup->next, NULL);
+    assert_string_equal(dup->schema->name, "wide");
+    lyd_free(dup);
+}
+
+/* the reference count of a dictionary string is stored right before it */
+static uint32_t
+dict_refcount(const char *str)
+{
+    return ((const struct dict_str *)str - 1)->refcount;
+}
+
+#define DEEP_LEVELS 3000
+
+static void
+test_dup_deep(void **state)
+{
+    struct state *st = (*state);
+    const struct lys_module *mod;
+    struct lyd_node *parent, *node, *dup;
+    struct lyd_node_leaf_list *leaf;
+    const char *value, *attr_name, *attr_value;
+    char *schema;
+    int i, len;
+
+    /* nested containers, each with a leaf */
+    schema = malloc(DEEP_LEVELS * 80 + 256);
+    assert_non_null(schema);
+    len = sprintf(schema, "<module name=\"deep\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\">"
+                  "<namespace uri=\"urn:libyang:tests:deep\"/><prefix value=\"d\"/>");
+    for (i = 0; i < DEEP_LEVELS; ++i) {
+        len += sprintf(schema + len, "<container name=\"c\"><leaf name=\"v\"><type name=\"string\"/></leaf>");
+    }
+    for (i = 0; i < DEEP_LEVELS; ++i) {
+        len += sprintf(schema + len, "</container>");
+    }
+    sprintf(schema + len, "</module>");
+    mod = lys_parse_mem(st->ctx, schema, LYS_IN_YIN);
+    free(schema);
+    assert_non_null(mod);
+
+    value = lydict_insert(st->ctx, "deep-value", 0);
+    attr_name = lydict_insert(st->ctx, "mark", 0);
+    attr_value = lydict_insert(st->ctx, "deep-attr", 0);
+
+    parent = NULL;
+    for (i = 0; i < DEEP_LEVELS; ++i) {
+        node = lyd_new(parent, mod, "c");
+        assert_non_null(node);
+        assert_non_null(lyd_insert_attr(node, "deep:mark", "deep-attr"));
+        assert_non_null(lyd_new_leaf(node, mod, "v", "deep-value"));
+        if (!parent) {
+            st->data = node;
+        }
+        parent = node;
+    }
+    assert_int_equal(dict_refcount(value), DEEP_LEVELS + 1);
+    assert_int_equal(dict_refcount(attr_name), DEEP_LEVELS + 1);
+    assert_int_equal(dict_refcount(attr_value), DEEP_LEVELS + 1);
+
+    dup = lyd_dup(st->data, 1);
+    assert_non_null(dup);
+    assert_int_equal(dict_refcount(value), 2 * DEEP_LEVELS + 1);
+    assert_int_equal(dict_refcount(attr_name), 2 * DEEP_LEVELS + 1);
+    assert_int_equal(dict_refcount(attr_value), 2 * DEEP_LEVELS + 1);
+
+    /* the whole depth is copied */
+    for (i = 0, node = dup; node; node = node->child->next, ++i) {
+        assert_ptr_equal(node->attr->value, attr_value);
+        leaf = (struct lyd_node_leaf_list *)node->child;
+        assert_string_equal(leaf->schema->name, "v");
+        assert_ptr_equal(leaf->value_str, value);
+        assert_ptr_equal(node->child->parent, node);
+    }
+    assert_int_equal(i, DEEP_LEVELS);
+
+    lyd_free(dup);
+    assert_int_equal(dict_refcount(value), DEEP_LEVELS + 1);
+    assert_int_equal(dict_refcount(attr_name), DEEP_LEVELS + 1);
+    assert_int_equal(dict_refcount(attr_value), DEEP_LEVELS + 1);
+
+    lyd_free(st->data);
+    st->data = NULL;
+    assert_int_equal(dict_refcount(value), 1);
+    assert_int_equal(dict_refcount(attr_name), 1);
+    assert_int_equal(dict_refcount(attr_value), 1);
+
+    lydict_remove(st->ctx, value);
+    lydict_remove(st->ctx, attr_name);
+    lydict_remove(st->ctx, attr_value);
+}
+
+static void
+test_bits_change(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node_leaf_list *leaf;
+    uint32_t i;
+
+    st->data = lyd_parse_mem(st->ctx, bits_data, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+
+    leaf = get_leaf(st->data, "wide");
+    assert_int_equal(lyd_change_leaf(leaf, "b0 b68"), 0);
+    assert_true(leaf->flags & LYD_NODE_BITS_EXT);
+    for (i = 0; i < 70; ++i) {
+        assert_int_equal(lyd_bits_isset(leaf, i), (i == 0) || (i == 68));
+    }
+
+    /* invalid value keeps the previous bitmap */
+    assert_int_not_equal(lyd_change_leaf(leaf, "b1 b70"), 0);
+    assert_true(leaf->flags & LYD_NODE_BITS_EXT);
+    assert_true(lyd_bits_isset(leaf, 68));
+    assert_false(lyd_bits_isset(leaf, 1));
+
+    leaf = get_leaf(st->data, "wide64");
+    assert_int_not_equal(lyd_change_leaf(leaf, "b0 b64"), 0);
+    assert_true(lyd_bits_isset(leaf, 63));
+    assert_int_equal(lyd_change_leaf(leaf, ""), 0);
+    assert_false(leaf->flags & LYD_NODE_BITS_EXT);
+    for (i = 0; i < 64; ++i) {
+        assert_false(lyd_bits_isset(leaf, i));
+    }
+}
+
+static void
+test_typed(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node_leaf_list *leaf;
+    const char *data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<int8>+12</int8>"
+  "<uint64>18446744073709551615</uint64>"
+  "<dec64>-1.500</dec64>"
+  "<bool>true</bool>"
+  "<enum>two</enum>"
+  "<str>text</str>"
+"</values>";
+
+    st->data = lyd_parse_mem(st->ctx, data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TYPED);
+    assert_non_null(st->data);
+
+    /* only the typed values are kept, the canonical strings are created on demand */
+    leaf = get_leaf(st->data, "int8");
+    assert_int_equal(leaf->value.int8, 12);
+    assert_string_equal(lyd_value_str(leaf), "12");
+    /* cached */
+    assert_ptr_equal(lyd_value_str(leaf), leaf->value_str);
+
+    leaf = get_leaf(st->data, "uint64");
+    assert_string_equal(lyd_value_str(leaf), "18446744073709551615");
+    leaf = get_leaf(st->data, "dec64");
+    assert_int_equal(leaf->value.dec64, -1500);
+    assert_string_equal(lyd_value_str(leaf), "-1.5");
+    leaf = get_leaf(st->data, "bool");
+    assert_string_equal(lyd_value_str(leaf), "true");
+    leaf = get_leaf(st->data, "enum");
+    assert_string_equal(lyd_value_str(leaf), "two");
+
+    /* strings are always kept */
+    leaf = get_leaf(st->data, "str");
+    assert_string_equal(leaf->value_str, "text");
+    assert_ptr_equal(lyd_value_str(leaf), leaf->value_str);
+}
+
+static const char *trusted_data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<wide>b1 b69</wide>"
+  "<int8>12</int8>"
+  "<dec64>-1.5</dec64>"
+  "<enum>two</enum>"
+"</values>";
+
+static void
+check_trusted(struct lyd_node *root, int parsed)
+{
+    struct lyd_node_leaf_list *leaf;
+
+    leaf = get_leaf(root, "int8");
+    assert_int_equal(leaf->value_type, parsed ? LY_TYPE_INT8 : LY_TYPE_DER);
+    assert_string_equal(leaf->value_str, "12");
+    leaf = get_leaf(root, "enum");
+    assert_int_equal(leaf->value_type, parsed ? LY_TYPE_ENUM : LY_TYPE_DER);
+    assert_string_equal(leaf->value_str, "two");
+}
+
+static void
+test_trusted_print(void **state)
+{
+    struct state *st = (*state);
+    char *str;
+
+    st->data = lyd_parse_mem(st->ctx, trusted_data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY);
+    assert_non_null(st->data);
+    /* values are not parsed */
+    check_trusted(st->data, 0);
+
+    /* printers parse the values they need the type of */
+    assert_int_equal(lyd_print_mem(&str, st->data, LYD_XML, 0), 0);
+    assert_string_equal(str, trusted_data);
+    free(str);
+    check_trusted(st->data, 1);
+
+    lyd_free(st->data);
+    st->data = lyd_parse_mem(st->ctx, trusted_data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY);
+    assert_non_null(st->data);
+    assert_int_equal(lyd_print_mem(&str, st->data, LYD_JSON, 0), 0);
+    assert_non_null(strstr(str, "\"int8\": 12"));
+    assert_non_null(strstr(str, "\"dec64\": -1.5"));
+    assert_non_null(strstr(str, "\"enum\": \"two\""));
+    free(str);
+    check_trusted(st->data, 1);
+}
+
+static void
+test_trusted_typed(void **state)
+{
+    struct state *st = (*state);
+
+    /* without LYD_OPT_LAZY the values are parsed right away */
+    st->data = lyd_parse_mem(st->ctx, trusted_data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED);
+    assert_non_null(st->data);
+    check_trusted(st->data, 1);
+    assert_int_equal(get_leaf(st->data, "int8")->value.int8, 12);
+    assert_true(lyd_bits_isset(get_leaf(st->data, "wide"), 69));
+
+    /* so an invalid value is refused */
+    lyd_free(st->data);
+    st->data = lyd_parse_mem(st->ctx, "<values xmlns=\"urn:libyang:tests:values\"><int8>300</int8></values>",
+                             LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED);
+    assert_null(st->data);
+
+    /* LYD_OPT_LAZY alone changes nothing */
+    st->data = lyd_parse_mem(st->ctx, trusted_data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_LAZY);
+    assert_non_null(st->data);
+    check_trusted(st->data, 1);
+}
+
+static void
+test_trusted_validate(void **state)
+{
+    struct state *st = (*state);
+
+    st->data = lyd_parse_mem(st->ctx, trusted_data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY);
+    assert_non_null(st->data);
+    check_trusted(st->data, 0);
+
+    assert_int_equal(lyd_validate(st->data, LYD_OPT_CONFIG), 0);
+    check_trusted(st->data, 1);
+    assert_true(lyd_bits_isset(get_leaf(st->data, "wide"), 69));
+
+    /* invalid trusted value is found by the validation */
+    lyd_free(st->data);
+    st->data = lyd_parse_mem(st->ctx, "<values xmlns=\"urn:libyang:tests:values\"><int8>300</int8></values>",
+                             LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY);
+    assert_non_null(st->data);
+    assert_int_not_equal(lyd_validate(st->data, LYD_OPT_CONFIG), 0);
+}
+
+static void
+test_trusted_xpath(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *set;
+
+    st->data = lyd_parse_mem(st->ctx, trusted_data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY);
+    assert_non_null(st->data);
+
+    /* the string representation is used for the unparsed values */
+    set = lyd_get_node(st->data, "/values:values[int8 = 12][dec64 < -1][enum = 'two']/int8");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_ptr_equal(set->dset[0], get_leaf(st->data, "int8"));
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/values:values[int8 + 1 = 14]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+}
+
+static void
+test_trusted_lyb(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *data;
+    char *lyb, *str;
+
+    st->data = lyd_parse_mem(st->ctx, trusted_data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY);
+    assert_non_null(st->data);
+
+    /* printed in the binary form */
+    assert_int_equal(lyd_print_mem(&lyb, st->data, LYD_LYB, 0), 0);
+    check_trusted(st->data, 1);
+
+    data = lyd_parse_mem(st->ctx, lyb, LYD_LYB, LYD_OPT_CONFIG);
+    free(lyb);
+    assert_non_null(data);
+    check_trusted(data, 1);
+    assert_int_equal(lyd_print_mem(&str, data, LYD_XML, 0), 0);
+    assert_string_equal(str, trusted_data);
+    free(str);
+    lyd_free(data);
+
+    /* and read back as trusted again */
+    lyd_free(st->data);
+    st->data = lyd_parse_mem(st->ctx, trusted_data, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY);
+    assert_non_null(st->data);
+    assert_int_equal(lyd_print_mem(&lyb, st->data, LYD_LYB, 0), 0);
+    lyd_free(st->data);
+    st->data = lyd_parse_mem(st->ctx, lyb, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_TRUSTED | LYD_OPT_LAZY);
+    free(lyb);
+    assert_non_null(st->data);
+    assert_int_equal(lyd_validate(st->data, LYD_OPT_CONFIG), 0);
+    check_trusted(st->data, 1);
+}
+
+static void
+test_value_type(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node_leaf_list *leaf;
+    const char *data =
+"<values xmlns=\"urn:libyang:tests:values\">"
+  "<ref>5</ref>"
+  "<inst xmlns:v=\"urn:libyang:tests:values\">/v:values/v:int8</inst>"
+"</values>";
+
+    /* the value type and the unresolved flags share a single byte, a leaf is as large as 8 pointers on LP64 */
+    if (sizeof(void *) == 8) {
+        assert_int_equal(sizeof(struct lyd_node_leaf_list), 64);
+    }
+
+    st->data = lyd_parse_mem(st->ctx, data, LYD_XML, LYD_OPT_EDIT);
+    assert_non_null(st->data);
+
+    /* unresolved leafref stores the type of its target */
+    leaf = get_leaf(st->data, "ref");
+    assert_int_equal(leaf->value_type, LY_TYPE_INT8 | LY_TYPE_LEAFREF_UNRES);
+    assert_int_equal(leaf->value_type & LY_DATA_TYPE_MASK, LY_TYPE_INT8);
+
+    leaf = get_leaf(st->data, "inst");
+    assert_int_equal(leaf->value_type, LY_TYPE_INST | LY_TYPE_INST_UNRES);
+    assert_int_equal(leaf->value_type & LY_DATA_TYPE_MASK, LY_TYPE_INST);
+}
+
+static void
+test_alloc(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *item, *next, *dup;
+    struct lyd_node_leaf_list *leaf;
+    char buf[16];
+    uint32_t i;
+
+    /* enough nodes to fill several allocation blocks of the data pool */
+    st->data = lyd_new(NULL, ly_ctx_get_module(st->ctx, "values", NULL), "values");
+    assert_non_null(st->data);
+    for (i = 0; i < 300; ++i) {
+        sprintf(buf, "%u", i);
+        item = lyd_new(st->data, NULL, "item");
+        assert_non_null(item);
+        assert_non_null(lyd_new_leaf(item, NULL, "id", buf));
+        assert_non_null(lyd_new_leaf(item, NULL, "name", buf));
+    }
+
+    /* free every other entry and reuse the released nodes */
+    i = 0;
+    LY_TREE_FOR_SAFE(st->data->child, next, item) {
+        if (i++ % 2) {
+            lyd_free(item);
+        }
+    }
+    for (i = 300; i < 450; ++i) {
+        sprintf(buf, "%u", i);
+        item = lyd_new(st->data, NULL, "item");
+        assert_non_null(item);
+        assert_non_null(lyd_new_leaf(item, NULL, "id", buf));
+        assert_non_null(lyd_new_leaf(item, NULL, "name", buf));
+    }
+
+    dup = lyd_dup(st->data, 1);
+    assert_non_null(dup);
+    lyd_free(st->data);
+    st->data = dup;
+
+    /* no node was handed out twice */
+    i = 0;
+    LY_TREE_FOR(st->data->child, item) {
+        leaf = (struct lyd_node_leaf_list *)item->child;
+        sprintf(buf, "%u", (i < 150) ? 2 * i : i + 150);
+        assert_string_equal(leaf->value_str, buf);
+        assert_int_equal(leaf->value.uint32, (i < 150) ? 2 * i : i + 150);
+        assert_string_equal(((struct lyd_node_leaf_list *)leaf->next)->value_str, buf);
+        assert_ptr_equal(leaf->parent, item);
+        ++i;
+    }
+    assert_int_equal(i, 300);
+    assert_int_equal(lyd_validate(st->data, LYD_OPT_CONFIG), 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+                    cmocka_unit_test_setup_teardown(test_bits_parse, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_bits_dup, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_dup_childless, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_dup_deep, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_bits_change, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_typed, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_trusted_print, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_trusted_typed, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_trusted_validate, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_trusted_xpath, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_trusted_lyb, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_value_type, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_alloc, setup_f, teardown_f), };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
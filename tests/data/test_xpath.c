@@ -0,0 +1,741 @@
+/**
+ * @file test_xpath.c
+ * @author Radek Krejci <rkrejci@cesnet.cz>
+ * @brief Cmocka tests for XPath evaluation on large expressions and data.
+ *
+ * Copyright (c) 2016 CESNET, z.s.p.o.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the Company nor the names of its contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "../config.h"
+#include "../../src/libyang.h"
+
+/* more than fits into 16 bits */
+#define LARGE_COUNT 70000
+
+/* list entries for more than 1M data nodes, every entry has 2 leaves */
+#define HUGE_COUNT 340000
+
+struct state {
+    struct ly_ctx *ctx;
+    const struct lys_module *mod;
+    struct lyd_node *data;
+};
+
+static struct lyd_node *
+new_entry(struct state *st, unsigned int name, int value)
+{
+    struct lyd_node *entry;
+    char buf[16];
+
+    entry = lyd_new(st->data, st->mod, "entry");
+    if (!entry) {
+        return NULL;
+    }
+    sprintf(buf, "%u", name);
+    if (!lyd_new_leaf(entry, st->mod, "name", buf)) {
+        return NULL;
+    }
+    sprintf(buf, "%d", value);
+    if (!lyd_new_leaf(entry, st->mod, "value", buf)) {
+        return NULL;
+    }
+
+    return entry;
+}
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+    const char *schemafile = TESTS_DIR"/data/files/xpath.yin";
+    unsigned int i;
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    /* libyang context */
+    st->ctx = ly_ctx_new(NULL);
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return -1;
+    }
+
+    /* schema */
+    st->mod = lys_parse_path(st->ctx, schemafile, LYS_IN_YIN);
+    if (!st->mod) {
+        fprintf(stderr, "Failed to load data model \"%s\".\n", schemafile);
+        return -1;
+    }
+
+    /* data */
+    st->data = lyd_new(NULL, st->mod, "top");
+    if (!st->data) {
+        fprintf(stderr, "Failed to create data.\n");
+        return -1;
+    }
+    for (i = 1; i <= 10; ++i) {
+        if (!new_entry(st, i, i * 10)) {
+            fprintf(stderr, "Failed to create data.\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    lyd_free(st->data);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+static void
+test_long_literal(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *set;
+    char *expr;
+    int len;
+
+    expr = malloc(LARGE_COUNT + 128);
+    assert_non_null(expr);
+    len = sprintf(expr, "/xpath:top/xpath:entry[string-length('");
+    memset(expr + len, 'a', LARGE_COUNT);
+    len += LARGE_COUNT;
+    sprintf(expr + len, "') = %d]", LARGE_COUNT);
+
+    set = lyd_get_node(st->data, expr);
+    assert_non_null(set);
+    assert_int_equal(set->number, 10);
+    ly_set_free(set);
+
+    /* a number longer than 65535 characters, all of them are used */
+    len = sprintf(expr, "/xpath:top/xpath:entry[number('");
+    memset(expr + len, '0', 65536);
+    len += 65536;
+    sprintf(expr + len, "5') = 5]");
+
+    set = lyd_get_node(st->data, expr);
+    free(expr);
+    assert_non_null(set);
+    assert_int_equal(set->number, 10);
+    ly_set_free(set);
+}
+
+static void
+test_many_tokens(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *set;
+    char *expr;
+    int i, len;
+
+    /* every "+1" are 2 tokens */
+    expr = malloc(LARGE_COUNT + 128);
+    assert_non_null(expr);
+    len = sprintf(expr, "/xpath:top/xpath:entry[xpath:value = 0");
+    for (i = 0; i < LARGE_COUNT / 2; ++i) {
+        len += sprintf(expr + len, "+1");
+    }
+    sprintf(expr + len, " - %d]", LARGE_COUNT / 2 - 50);
+
+    set = lyd_get_node(st->data, expr);
+    free(expr);
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_string_equal(((struct lyd_node_leaf_list *)set->dset[0]->child)->value_str, "5");
+    ly_set_free(set);
+}
+
+static void
+test_compiled(void **state)
+{
+    struct state *st = (*state);
+    struct lyxp_expr *exp;
+    struct ly_set *set;
+    int i;
+
+    exp = lyd_xpath_compile("/xpath:top/xpath:entry[xpath:value mod 20 = 0 and xpath:value > 20 or xpath:name = 1]");
+    assert_non_null(exp);
+
+    /* the compiled expression must give the same result every time */
+    for (i = 0; i < 3; ++i) {
+        set = lyd_get_node_compiled(st->data, exp);
+        assert_non_null(set);
+        assert_int_equal(set->number, 5);
+        ly_set_free(set);
+    }
+
+    lyd_xpath_free(exp);
+
+    assert_null(lyd_xpath_compile("/xpath:top/xpath:entry["));
+}
+
+static void
+test_union_dup(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *set;
+    unsigned int i;
+
+    /* enough nodes for the sets to use their hash table */
+    for (i = 11; i <= 100; ++i) {
+        assert_non_null(new_entry(st, i, i * 10));
+    }
+
+    set = lyd_get_node(st->data, "//xpath:name | //xpath:value | //xpath:name");
+    assert_non_null(set);
+    assert_int_equal(set->number, 200);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "//xpath:name/.. | //xpath:value/.. | /xpath:top/xpath:entry");
+    assert_non_null(set);
+    assert_int_equal(set->number, 100);
+    ly_set_free(set);
+
+    /* the result is in the document order */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name > 50] | /xpath:top/xpath:entry[xpath:name <= 60]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 100);
+    for (i = 0; i < set->number; ++i) {
+        assert_int_equal(((struct lyd_node_leaf_list *)set->dset[i]->child)->value.uint32, i + 1);
+    }
+    ly_set_free(set);
+}
+
+static void
+test_key_predicate(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *entry;
+    struct ly_set *set;
+    unsigned int i;
+
+    for (i = 11; i <= 1000; ++i) {
+        assert_non_null(new_entry(st, i, i * 10));
+    }
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name = 500]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_int_equal(((struct lyd_node_leaf_list *)set->dset[0]->child)->value.uint32, 500);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[name='7']/xpath:value");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_int_equal(((struct lyd_node_leaf_list *)set->dset[0])->value.int32, 70);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry['42' = xpath:name]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    /* literals are compared as strings, numbers as numbers */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name = '050']");
+    assert_non_null(set);
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name = 050]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name = 3][xpath:name = 4]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+
+    /* not a key, evaluated generally */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:value = 50]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_int_equal(((struct lyd_node_leaf_list *)set->dset[0]->child)->value.uint32, 5);
+    ly_set_free(set);
+
+    /* a key after the other children */
+    entry = lyd_new(st->data, st->mod, "entry");
+    assert_non_null(entry);
+    assert_non_null(lyd_new_leaf(entry, st->mod, "value", "1"));
+    assert_non_null(lyd_new_leaf(entry, st->mod, "name", "2000"));
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name = 2000]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_ptr_equal(set->dset[0], entry);
+    ly_set_free(set);
+
+    /* a missing key is an empty node-set, equal to nothing */
+    entry = lyd_new(st->data, st->mod, "entry");
+    assert_non_null(entry);
+    assert_non_null(lyd_new_leaf(entry, st->mod, "value", "2"));
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name = '']");
+    assert_non_null(set);
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+}
+
+static void
+test_const_fold(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *set;
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:value = 10 * (2 + 3)]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_int_equal(((struct lyd_node_leaf_list *)set->dset[0]->child)->value.uint32, 5);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name > 10 div 4]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 8);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name mod 3 = 5 mod 4]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 4);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name - 1 - 2 = 1]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_int_equal(((struct lyd_node_leaf_list *)set->dset[0]->child)->value.uint32, 4);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name = -(-3)]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    /* infinity is not folded */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:name = 1 div 0]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+
+    /* a number predicate is still a position */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[1 + 2]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    assert_int_equal(((struct lyd_node_leaf_list *)set->dset[0]->child)->value.uint32, 3);
+    ly_set_free(set);
+}
+
+static void
+test_string_values(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *set;
+    unsigned int i;
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry/xpath:name[. = '5']");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry/xpath:value[. != '50']");
+    assert_non_null(set);
+    assert_int_equal(set->number, 9);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[translate('abc', 'b', '') = 'ac']"
+                                 "[normalize-space('  a   b ') = 'a b']");
+    assert_non_null(set);
+    assert_int_equal(set->number, 10);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[string(1 div 0) = 'Infinity'][string(-7) = '-7']"
+                                 "[string(1.5) = '1.5'][string(true()) = 'true']");
+    assert_non_null(set);
+    assert_int_equal(set->number, 10);
+    ly_set_free(set);
+
+    /* every value is cast to a string */
+    for (i = 11; i <= 1000; ++i) {
+        assert_non_null(new_entry(st, i, i * 10));
+    }
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry/xpath:value[. = '5000']");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+}
+
+static void
+test_integer_math(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *set;
+    struct lyd_node_leaf_list *leaf;
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:value * 100000000 = 1000000000]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    /* beyond 64-bit integers */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:value * 1000000000000 * 1000000000 > 9000000000000000000000]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 10);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:value + 999999999999999990 = 1000000000000000000]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    /* not integers */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:value div 4 = 2.5]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[xpath:value div 20 < 1][round(10 div 4) = 3]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[-xpath:value mod 3 = -1]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 4);
+    ly_set_free(set);
+
+    /* negative zero */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[1 div ((xpath:value - xpath:value) * -1) < 0]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 10);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry[sum(/xpath:top/xpath:entry/xpath:value) = 550]"
+                                 "[count(/xpath:top/xpath:entry) = 10]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 10);
+    ly_set_free(set);
+
+    /* decimal64 values */
+    assert_non_null(lyd_new_leaf(st->data, st->mod, "dec", "1.5"));
+    leaf = (struct lyd_node_leaf_list *)lyd_new_leaf(st->data, st->mod, "udec", "1.5");
+    assert_non_null(leaf);
+    assert_int_equal(leaf->value_type, LY_TYPE_DEC64);
+    assert_int_equal(leaf->value.dec64, 150);
+
+    set = lyd_get_node(st->data, "/xpath:top[xpath:dec = 1.5][xpath:dec * 2 = 3]"
+                                 "[xpath:udec = 1.5][xpath:udec * 2 = 3]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top[xpath:udec = 150]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+
+    /* a decimal64 in a union with an integral value */
+    assert_int_equal(lyd_change_leaf(leaf, "2.00"), 0);
+    assert_int_equal(leaf->value_type, LY_TYPE_DEC64);
+    set = lyd_get_node(st->data, "/xpath:top[xpath:udec = 2][xpath:udec + 1 = 3]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "/xpath:top[xpath:udec = 200]");
+    assert_non_null(set);
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+}
+
+static void
+test_huge_tree(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *set;
+    unsigned int i;
+
+    for (i = 11; i <= HUGE_COUNT; ++i) {
+        assert_non_null(new_entry(st, i, i % 1000));
+    }
+
+    set = lyd_get_node(st->data, "//*");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1 + HUGE_COUNT * 3);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "//xpath:value | /xpath:top/xpath:entry/xpath:name");
+    assert_non_null(set);
+    assert_int_equal(set->number, HUGE_COUNT * 2);
+    assert_string_equal(set->dset[0]->schema->name, "name");
+    assert_string_equal(set->dset[HUGE_COUNT * 2 - 1]->schema->name, "value");
+    assert_int_equal(((struct lyd_node_leaf_list *)set->dset[HUGE_COUNT * 2 - 2])->value.uint32, HUGE_COUNT);
+    ly_set_free(set);
+
+    set = lyd_get_node(st->data, "//xpath:name/..");
+    assert_non_null(set);
+    assert_int_equal(set->number, HUGE_COUNT);
+    ly_set_free(set);
+}
+
+static void
+test_cond_deps(void **state)
+{
+    struct state *st = (*state);
+    struct lys_node *scond, *slimit, *sused, *sextra, *sother;
+    struct lyd_node *cond, *limit, *other;
+
+    scond = st->mod->data->next;
+    slimit = scond->child;
+    sused = slimit->next;
+    sextra = sused->next;
+    sother = sextra->next;
+
+    /* schema nodes whose data can affect the conditions */
+    assert_null(st->mod->data->cond_deps);
+    assert_non_null(slimit->cond_deps);
+    assert_int_equal(slimit->cond_deps->number, 2);
+    assert_ptr_equal(slimit->cond_deps->sset[0], sused);
+    assert_ptr_equal(slimit->cond_deps->sset[1], sextra);
+    assert_non_null(sother->cond_deps);
+    assert_int_equal(sother->cond_deps->number, 1);
+    assert_ptr_equal(sother->cond_deps->sset[0], sother);
+
+    cond = lyd_new(NULL, st->mod, "cond");
+    assert_non_null(cond);
+    limit = lyd_new_leaf(cond, st->mod, "limit", "10");
+    assert_non_null(limit);
+    assert_non_null(lyd_new_leaf(cond, st->mod, "used", "5"));
+    other = lyd_new_leaf(cond, st->mod, "other", "short");
+    assert_non_null(other);
+    assert_int_equal(lyd_validate(cond, LYD_OPT_CONFIG), 0);
+
+    /* must of a previously validated node depending on a changed node */
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)limit, "3"), 0);
+    assert_int_not_equal(lyd_validate(cond, LYD_OPT_CONFIG | LYD_OPT_CHANGED), 0);
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)limit, "20"), 0);
+    assert_int_equal(lyd_validate(cond, LYD_OPT_CONFIG | LYD_OPT_CHANGED), 0);
+
+    /* pretend other was validated, its must does not depend on limit so it is not evaluated */
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)other, "invalid"), 0);
+    other->validity = LYD_VAL_OK;
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)limit, "30"), 0);
+    assert_int_equal(lyd_validate(cond, LYD_OPT_CONFIG | LYD_OPT_CHANGED), 0);
+    assert_int_not_equal(lyd_validate(cond, LYD_OPT_CONFIG), 0);
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)other, "short"), 0);
+
+    /* removed node */
+    assert_int_equal(lyd_unlink(limit), 0);
+    lyd_free(limit);
+    assert_int_not_equal(lyd_validate(cond, LYD_OPT_CONFIG | LYD_OPT_CHANGED), 0);
+
+    lyd_free(cond);
+}
+
+static void
+check_find_iter(const struct lyd_node *data, const char *expr)
+{
+    struct lyd_find_iter *iter;
+    struct ly_set *set;
+    struct lyd_node *node;
+    unsigned int i;
+
+    set = lyd_get_node(data, expr);
+    assert_non_null(set);
+    iter = lyd_find_iter_new(data, expr);
+    assert_non_null(iter);
+
+    for (i = 0; (node = lyd_find_iter_next(iter)); ++i) {
+        assert_true(i < set->number);
+        assert_ptr_equal(node, set->dset[i]);
+    }
+    assert_int_equal(i, set->number);
+    assert_null(lyd_find_iter_next(iter));
+
+    lyd_find_iter_free(iter);
+    ly_set_free(set);
+}
+
+static void
+test_find_iter(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_find_iter *iter;
+    struct lyd_node *node;
+    struct ly_set *set;
+    unsigned int i;
+
+    /* simple location paths */
+    check_find_iter(st->data, "/xpath:top/xpath:entry/xpath:value");
+    check_find_iter(st->data, "/xpath:top/xpath:entry/*");
+    check_find_iter(st->data, "xpath:entry/xpath:name");
+    check_find_iter(st->data, "*");
+    check_find_iter(st->data->child, "xpath:value");
+    check_find_iter(st->data, "/xpath:top/xpath:entry/xpath:name/xpath:value");
+    check_find_iter(st->data, "/xpath:top/xpath:none");
+
+    /* general expressions */
+    check_find_iter(st->data, "//xpath:value[. > 50]");
+    check_find_iter(st->data, "/xpath:top/xpath:entry[xpath:name = 3]/xpath:value");
+    check_find_iter(st->data, "count(//xpath:entry)");
+
+    /* stop early */
+    iter = lyd_find_iter_new(st->data, "/xpath:top/xpath:entry");
+    assert_non_null(iter);
+    node = lyd_find_iter_next(iter);
+    assert_ptr_equal(node, st->data->child);
+    lyd_find_iter_free(iter);
+
+    assert_null(lyd_find_iter_new(st->data, "/unknown:top"));
+    assert_null(lyd_find_iter_new(st->data, "/xpath:top/"));
+
+    /* schema node instances */
+    set = lyd_get_node(st->data, "/xpath:top/xpath:entry/xpath:value");
+    assert_non_null(set);
+    iter = lyd_find_iter_new2(st->data, set->dset[0]->schema);
+    assert_non_null(iter);
+    for (i = 0; (node = lyd_find_iter_next(iter)); ++i) {
+        assert_true(i < set->number);
+        assert_ptr_equal(node, set->dset[i]);
+    }
+    assert_int_equal(i, set->number);
+    lyd_find_iter_free(iter);
+    ly_set_free(set);
+}
+
+static int
+set_has(struct ly_set *set, void *node)
+{
+    unsigned int i;
+
+    for (i = 0; set && (i < set->number); ++i) {
+        if (set->set[i] == node) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+test_cond_deps_modules(void **state)
+{
+    struct state *st = (*state);
+    const struct lys_module *mod;
+    struct lys_node *scond, *slimit, *sother, *smax, *snote, *swatch, *slate;
+    unsigned int limit_deps;
+    const char *aug =
+"<module name=\"xpath-aug\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\">"
+  "<namespace uri=\"urn:libyang:tests:xpath-aug\"/>"
+  "<prefix value=\"xa\"/>"
+  "<import module=\"xpath\"><prefix value=\"xp\"/></import>"
+  "<augment target-node=\"/xp:cond\">"
+    "<leaf name=\"max\"><type name=\"uint32\"/><must condition=\". &gt;= ../xp:limit\"/></leaf>"
+    "<leaf name=\"note\"><type name=\"string\"/><when condition=\"../xp:other = 'x'\"/></leaf>"
+  "</augment>"
+  "<container name=\"watch\">"
+    "<must condition=\"count(/xp:cond/*) &lt; 10\"/>"
+  "</container>"
+"</module>";
+    const char *late =
+"<module name=\"xpath-late\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\">"
+  "<namespace uri=\"urn:libyang:tests:xpath-late\"/>"
+  "<prefix value=\"xl\"/>"
+  "<import module=\"xpath\"><prefix value=\"xp\"/></import>"
+  "<augment target-node=\"/xp:cond\">"
+    "<leaf name=\"late\"><type name=\"string\"/></leaf>"
+  "</augment>"
+"</module>";
+    const char *invalid =
+"<module name=\"xpath-invalid\" xmlns=\"urn:ietf:params:xml:ns:yang:yin:1\">"
+  "<namespace uri=\"urn:libyang:tests:xpath-invalid\"/>"
+  "<prefix value=\"xi\"/>"
+  "<import module=\"xpath\"><prefix value=\"xp\"/></import>"
+  "<augment target-node=\"/xp:cond\">"
+    "<leaf name=\"bad\"><type name=\"uint32\"/><must condition=\". &lt; ../xp:limit\"/></leaf>"
+  "</augment>"
+  "<augment target-node=\"/xp:missing\">"
+    "<leaf name=\"worse\"><type name=\"uint32\"/></leaf>"
+  "</augment>"
+"</module>";
+
+    scond = st->mod->data->next;
+    slimit = scond->child;
+    sother = slimit->next->next->next;
+    limit_deps = slimit->cond_deps->number;
+
+    /* the new conditions depend on the nodes of the older module */
+    mod = lys_parse_mem(st->ctx, aug, LYS_IN_YIN);
+    assert_non_null(mod);
+    for (smax = scond->child; smax && strcmp(smax->name, "max"); smax = smax->next);
+    assert_non_null(smax);
+    snote = smax->next;
+    assert_string_equal(snote->name, "note");
+    swatch = mod->data;
+    assert_int_equal(slimit->cond_deps->number, limit_deps + 2);
+    assert_true(set_has(slimit->cond_deps, smax));
+    assert_true(set_has(slimit->cond_deps, swatch));
+    assert_true(set_has(sother->cond_deps, snote));
+    assert_true(set_has(smax->cond_deps, swatch));
+
+    /* a failed module leaves the dependencies as they were */
+    assert_null(lys_parse_mem(st->ctx, invalid, LYS_IN_YIN));
+    assert_int_equal(slimit->cond_deps->number, limit_deps + 2);
+    assert_null(scond->child->prev->next);
+    assert_ptr_equal(scond->child->prev, snote);
+
+    /* an older condition reaching the nodes of a newer augment */
+    mod = lys_parse_mem(st->ctx, late, LYS_IN_YIN);
+    assert_non_null(mod);
+    slate = scond->child->prev;
+    assert_string_equal(slate->name, "late");
+    assert_non_null(slate->cond_deps);
+    assert_int_equal(slate->cond_deps->number, 1);
+    assert_ptr_equal(slate->cond_deps->sset[0], swatch);
+    assert_int_equal(slimit->cond_deps->number, limit_deps + 2);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+                    cmocka_unit_test_setup_teardown(test_long_literal, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_many_tokens, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_compiled, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_union_dup, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_key_predicate, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_const_fold, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_string_values, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_integer_math, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_huge_tree, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_cond_deps, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_cond_deps_modules, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_find_iter, setup_f, teardown_f), };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+
+static double
+time_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* list items with index from first to last, p1 is index + shift */
+static struct lyd_node *
+create_items(const struct lys_module *mod, int first, int last, int shift)
+{
+	int i;
+	char buf[30];
+	struct lyd_node *data = NULL, *next;
+
+	for (i = first; i <= last; i++) {
+		next = lyd_new(NULL, mod, "ptest1");
+		sprintf(buf, "%d", i);
+		lyd_new_leaf(next, mod, "index", buf);
+		sprintf(buf, "%d", i + shift);
+		lyd_new_leaf(next, mod, "p1", buf);
+		if (!data) {
+			data = next;
+		} else {
+			lyd_insert_after(data->prev, next);
+		}
+	}
+
+	return data;
+}
+
+int main(int argc, char *argv[])
+{
+	int i, items, count;
+	struct ly_ctx *ctx = NULL;
+	struct lyd_node *data = NULL, *source, *iter;
+	const struct lys_module *mod;
+	double start;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s model.yin items\n", argv[0]);
+		return 1;
+	}
+	items = atoi(argv[2]);
+
+	/* libyang context */
+	ctx = ly_ctx_new(NULL);
+	if (!ctx) {
+		fprintf(stderr, "Failed to create context.\n");
+		return 1;
+	}
+
+	/* schema */
+	if (!(mod = lys_parse_path(ctx, argv[1], LYS_IN_YIN))) {
+		fprintf(stderr, "Failed to load data model.\n");
+		goto cleanup;
+	}
+
+	/* target data */
+	data = create_items(mod, 1, items, 0);
+
+	/* a tenth of the items merged, half of them change existing items, the other half is new */
+	for (i = 0; i < 2; i++) {
+		source = create_items(mod, items - items / 20 + 1 + i * items / 20, items + items / 20 + i * items / 20, 1);
+
+		start = time_ms();
+		if (lyd_merge(data, source, i ? LYD_MERGEOPT_DESTRUCT : 0)) {
+			fprintf(stderr, "Merge failed.\n");
+			if (!i) {
+				lyd_free_withsiblings(source);
+			}
+			goto cleanup;
+		}
+		start = time_ms() - start;
+		count = 0;
+		LY_TREE_FOR(data, iter) {
+			count++;
+		}
+		printf(" %-48s %8d items %10.1f ms\n", i ? "merge, destructive" : "merge", count, start);
+		if (!i) {
+			lyd_free_withsiblings(source);
+		}
+	}
+
+cleanup:
+	lyd_free_withsiblings(data);
+	ly_ctx_destroy(ctx, NULL);
+
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+
+static const char *queries[] = {
+	"//*",
+	"//index",
+	"/perftest:ptest1/index | /perftest:ptest1/p1",
+	"//index | //p1 | //index",
+	"//index/.. | //p1/..",
+	"/perftest:ptest1[index = 10]/p1",
+	NULL
+};
+
+/* evaluated from every list item, the way must and when conditions are */
+static const char *conditions[] = {
+	"p1[. * 2 + 1 >= 3 * 4 - 2]",
+	"index[. mod 2 = 0 and . != 3]",
+	"p1[. != 0 or . < -(1 + 1)]",
+	"index[. = ../p1]",
+	"index[. > 1000 and . <= 50000]",
+	"p1[. + 1 > ../index]",
+	"p1[. * 3 - ../index >= 2 * ../index]",
+	NULL
+};
+
+static double
+time_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+	int i, items;
+	struct ly_ctx *ctx = NULL;
+	char buf[30];
+	struct lyd_node *data = NULL, *next;
+	const struct lys_module *mod;
+	struct ly_set *set;
+	struct lyxp_expr *exp;
+	struct lyd_find_iter *iter;
+	unsigned int matches;
+	double start;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s model.yin items\n", argv[0]);
+		return 1;
+	}
+	items = atoi(argv[2]);
+
+	/* libyang context */
+	ctx = ly_ctx_new(NULL);
+	if (!ctx) {
+		fprintf(stderr, "Failed to create context.\n");
+		return 1;
+	}
+
+	/* schema */
+	if (!(mod = lys_parse_path(ctx, argv[1], LYS_IN_YIN))) {
+		fprintf(stderr, "Failed to load data model.\n");
+		goto cleanup;
+	}
+
+	/* data */
+	for (i = 1; i <= items; i++) {
+		next = lyd_new(NULL, mod, "ptest1");
+		sprintf(buf, "%d", i);
+		lyd_new_leaf(next, mod, "index", buf);
+		lyd_new_leaf(next, mod, "p1", buf);
+		if (!data) {
+			data = next;
+		} else {
+			lyd_insert_after(data->prev, next);
+		}
+	}
+
+	/* queries */
+	for (i = 0; queries[i]; i++) {
+		start = time_ms();
+		set = lyd_get_node(data, queries[i]);
+		if (!set) {
+			fprintf(stderr, "Query \"%s\" failed.\n", queries[i]);
+			goto cleanup;
+		}
+		printf(" %-48s %8u nodes %10.1f ms\n", queries[i], set->number, time_ms() - start);
+		ly_set_free(set);
+	}
+
+	/* lazy iteration, first match only and all the matches */
+	for (i = 0; i < 2; i++) {
+		start = time_ms();
+		iter = lyd_find_iter_new(data, "/perftest:ptest1/index");
+		if (!iter) {
+			fprintf(stderr, "Iterator failed.\n");
+			goto cleanup;
+		}
+		matches = 0;
+		while (lyd_find_iter_next(iter)) {
+			matches++;
+			if (!i) {
+				/* stop at the first match */
+				break;
+			}
+		}
+		lyd_find_iter_free(iter);
+		printf(" %-48s %8u nodes %10.1f ms\n", i ? "iterator, all matches" : "iterator, first match", matches,
+		       time_ms() - start);
+	}
+
+	/* compiled conditions */
+	for (i = 0; conditions[i]; i++) {
+		exp = lyd_xpath_compile(conditions[i]);
+		if (!exp) {
+			fprintf(stderr, "Condition \"%s\" failed to compile.\n", conditions[i]);
+			goto cleanup;
+		}
+		matches = 0;
+		start = time_ms();
+		for (next = data; next; next = next->next) {
+			set = lyd_get_node_compiled(next, exp);
+			if (!set) {
+				fprintf(stderr, "Condition \"%s\" failed.\n", conditions[i]);
+				lyd_xpath_free(exp);
+				goto cleanup;
+			}
+			matches += set->number;
+			ly_set_free(set);
+		}
+		printf(" %-48s %8u nodes %10.1f ms\n", conditions[i], matches, time_ms() - start);
+		lyd_xpath_free(exp);
+	}
+
+cleanup:
+	lyd_free_withsiblings(data);
+	ly_ctx_destroy(ctx, NULL);
+
+	return 0;
+}
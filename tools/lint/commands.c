@@ -60,7 +60,7 @@ cmd_print_help(void)
 void
 cmd_data_help(void)
 {
-    printf("data [-(-s)trict] [-x OPTION] [-o <output-file>] [-f (xml | json)]  <data-file-name>\n");
+    printf("data [-(-s)trict] [-x OPTION] [-o <output-file>] [-f (xml | json | lyb)]  <data-file-name>\n");
     printf("Accepted OPTIONs:\n");
     printf("\tauto       - resolve data type (one of the following) automatically (as pyang does),\n");
     printf("\t             this option is applicable only in case of XML input data.\n");
@@ -352,6 +352,8 @@ cmd_data(const char *arg)
                 outformat = LYD_XML_FORMAT;
             } else if (!strcmp(optarg, "json")) {
                 outformat = LYD_JSON;
+            } else if (!strcmp(optarg, "lyb")) {
+                outformat = LYD_LYB;
             } else {
                 fprintf(stderr, "Unknown output format \"%s\".\n", optarg);
                 goto cleanup;
@@ -410,8 +412,10 @@ cmd_data(const char *arg)
         informat = LYD_XML;
     } else if (len >= 6 && !strcmp(&argv[optind][len - 5], ".json")) {
         informat = LYD_JSON;
+    } else if (len >= 5 && !strcmp(&argv[optind][len - 4], ".lyb")) {
+        informat = LYD_LYB;
     } else {
-        fprintf(stderr, "Unable to resolve format of the input file, please add \".xml\" or \".json\" suffix.\n");
+        fprintf(stderr, "Unable to resolve format of the input file, please add \".xml\", \".json\" or \".lyb\" suffix.\n");
         goto cleanup;
     }
 
@@ -621,7 +625,7 @@ cmd_xpath(const char *arg)
             }
             printf("\"%s\"", node->schema->name);
             if (node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
-                printf(" (val: %s)", ((struct lyd_node_leaf_list *)node)->value_str);
+                printf(" (val: %s)", lyd_value_str((struct lyd_node_leaf_list *)node));
             } else if (node->schema->nodetype == LYS_LIST) {
                 keys = lyd_get_list_keys(node);
                 if (keys && keys->number) {
@@ -631,7 +635,7 @@ cmd_xpath(const char *arg)
                             printf(" ");
                         }
                         printf("\"%s\": %s", keys->dset[j]->schema->name,
-                               ((struct lyd_node_leaf_list *)keys->dset[j])->value_str);
+                               lyd_value_str((struct lyd_node_leaf_list *)keys->dset[j]));
                     }
                     printf(")");
                 }
@@ -668,7 +672,7 @@ cmd_list(const char *UNUSED(arg))
 
     LY_TREE_FOR(ylib->child, node) {
         if (!strcmp(node->schema->name, "module-set-id")) {
-            printf("List of the loaded models (mod-set-id %s):\n", ((struct lyd_node_leaf_list *)node)->value_str);
+            printf("List of the loaded models (mod-set-id %s):\n", lyd_value_str((struct lyd_node_leaf_list *)node));
             break;
         }
     }